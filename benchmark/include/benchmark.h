@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace benchmark {
+
+// The port the benchmarks run task-trackerd on
+const uint16_t PORT = 18303;
+
+const std::string TOKEN = "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB";
+
+// ** cLatencies
+//
+// Collects the time taken for each request so that we can report percentiles
+//
+class cLatencies {
+public:
+  void Add(std::chrono::microseconds latency) { latencies.push_back(latency); }
+  void Add(const cLatencies& rhs);
+
+  size_t GetCount() const { return latencies.size(); }
+
+  // Returns the latency that percentile of requests were faster than, ie. 0.99 for p99
+  std::chrono::microseconds GetPercentile(double percentile);
+
+private:
+  std::vector<std::chrono::microseconds> latencies;
+  bool sorted = false;
+};
+
+class cResult {
+public:
+  std::string name;
+  size_t requests = 0;
+  size_t errors = 0;
+  std::chrono::microseconds elapsed;
+  cLatencies latencies;
+};
+
+// Perform requests from nclients threads at once for the duration, each call to perform_request is timed
+// perform_request should return false if the request failed
+cResult RunClients(const std::string& name, size_t nclients, std::chrono::milliseconds duration, const std::function<bool()>& perform_request);
+
+void PrintResultHeader();
+void PrintResult(cResult& result);
+
+// Each benchmark, these return false if the benchmark could not be run
+bool BenchmarkBackend();
+bool BenchmarkKeepAlive();
+bool BenchmarkThreadingModel();
+bool BenchmarkTLSHandshake();
+
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "https_client.h"
+#include "io_uring_web_server.h"
+#include "web_server.h"
+
+namespace benchmark {
+
+namespace {
+
+bool RunBackend(tasktracker::BACKEND backend, size_t nclients, std::chrono::milliseconds duration)
+{
+  tasktracker::cWebServerOptions options;
+  options.backend = backend;
+
+  // Both backends serve every connection from one thread, so this compares the event loops rather than the number of threads
+  options.threading_model = tasktracker::THREADING_MODEL::SINGLE_THREAD;
+
+  // Every client connects from 127.0.0.1, so allow all of them through the per IP limit
+  options.per_ip_connection_limit = nclients;
+
+  tasktracker::cWebServerManager web_server_manager;
+
+  // NOTE: Plain HTTP so that the TLS record layer doesn't hide the difference between the backends
+  const bool fuzzing = false;
+  if (!web_server_manager.Create(util::cIPAddress(127, 0, 0, 1), PORT, "", "", fuzzing, { tasktracker::cFeedView("default", TOKEN) }, options)) {
+    std::cerr<<"Error creating web server"<<std::endl;
+    return false;
+  }
+
+  bool result = true;
+
+  for (const std::string& url : { std::string("/style.css"), "/feed/atom.xml?token=" + TOKEN }) {
+    // Each client keeps its connection open for every request
+    cResult client_result = RunClients(std::string(tasktracker::GetBackendName(backend)) + " " + url.substr(0, url.find('?')), nclients, duration, [&url]() {
+      thread_local cHTTPSConnection connection;
+      if (!connection.IsOpen() && !connection.Open(PORT, "")) {
+        return false;
+      }
+
+      cHTTPResponse response;
+      return connection.PerformGetRequest(url, response) && (response.headers.response_code == 200);
+    });
+    PrintResult(client_result);
+
+    result = (client_result.errors == 0) && result;
+  }
+
+  result = web_server_manager.Destroy() && result;
+
+  return result;
+}
+
+}
+
+bool BenchmarkBackend()
+{
+  std::cout<<"Backend, keep-alive plain HTTP"<<std::endl;
+  PrintResultHeader();
+
+  const size_t nclients = 64;
+  const std::chrono::milliseconds duration(5000);
+
+  bool result = RunBackend(tasktracker::BACKEND::LIBMICROHTTPD, nclients, duration);
+
+  if (tasktracker::IsIOUringWebServerAvailable()) {
+    result = RunBackend(tasktracker::BACKEND::IO_URING, nclients, duration) && result;
+  } else {
+    std::cout<<"io_uring backend is not available, build with -DTASK_TRACKER_IO_URING=ON on Linux 6.0 or later"<<std::endl;
+  }
+
+  std::cout<<std::endl;
+
+  return result;
+}
+
+}
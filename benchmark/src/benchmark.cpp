@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+#include "benchmark.h"
+
+namespace benchmark {
+
+void cLatencies::Add(const cLatencies& rhs)
+{
+  latencies.insert(latencies.end(), rhs.latencies.begin(), rhs.latencies.end());
+  sorted = false;
+}
+
+std::chrono::microseconds cLatencies::GetPercentile(double percentile)
+{
+  if (latencies.empty()) {
+    return std::chrono::microseconds(0);
+  }
+
+  if (!sorted) {
+    std::sort(latencies.begin(), latencies.end());
+    sorted = true;
+  }
+
+  const size_t index = std::min(latencies.size() - 1, static_cast<size_t>(percentile * latencies.size()));
+  return latencies[index];
+}
+
+cResult RunClients(const std::string& name, size_t nclients, std::chrono::milliseconds duration, const std::function<bool()>& perform_request)
+{
+  std::atomic<bool> stop(false);
+
+  std::vector<cLatencies> client_latencies(nclients);
+  std::vector<size_t> client_errors(nclients, 0);
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < nclients; i++) {
+    threads.push_back(std::thread([&, i]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+        const std::chrono::steady_clock::time_point request_start = std::chrono::steady_clock::now();
+        const bool result = perform_request();
+        const std::chrono::steady_clock::time_point request_end = std::chrono::steady_clock::now();
+
+        if (result) {
+          client_latencies[i].Add(std::chrono::duration_cast<std::chrono::microseconds>(request_end - request_start));
+        } else {
+          client_errors[i]++;
+        }
+      }
+    }));
+  }
+
+  std::this_thread::sleep_for(duration);
+  stop.store(true);
+
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  cResult result;
+  result.name = name;
+  result.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  for (size_t i = 0; i < nclients; i++) {
+    result.latencies.Add(client_latencies[i]);
+    result.errors += client_errors[i];
+  }
+  result.requests = result.latencies.GetCount();
+
+  return result;
+}
+
+void PrintResultHeader()
+{
+  printf("%-40s %10s %8s %12s %10s %10s %10s\n", "benchmark", "requests", "errors", "requests/s", "p50 ms", "p99 ms", "max ms");
+}
+
+void PrintResult(cResult& result)
+{
+  const double seconds = result.elapsed.count() / 1000000.0;
+  const double requests_per_second = (seconds > 0.0) ? (result.requests / seconds) : 0.0;
+
+  printf("%-40s %10zu %8zu %12.1f %10.2f %10.2f %10.2f\n",
+    result.name.c_str(),
+    result.requests,
+    result.errors,
+    requests_per_second,
+    result.latencies.GetPercentile(0.5).count() / 1000.0,
+    result.latencies.GetPercentile(0.99).count() / 1000.0,
+    result.latencies.GetPercentile(1.0).count() / 1000.0
+  );
+  fflush(stdout);
+}
+
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "https_client.h"
+#include "web_server.h"
+
+namespace benchmark {
+
+namespace {
+
+bool RunKeepAlive(const std::string& url, const std::string& name, size_t requests_per_connection, size_t nclients, std::chrono::milliseconds duration)
+{
+  // Each client thread reuses its connection for requests_per_connection requests and then opens a new one
+  cResult result = RunClients(name + " " + std::to_string(requests_per_connection) + " per connection", nclients, duration, [&url, requests_per_connection]() {
+    thread_local cHTTPSConnection connection;
+    thread_local size_t requests_on_connection = 0;
+
+    if (!connection.IsOpen() || (requests_on_connection >= requests_per_connection)) {
+      requests_on_connection = 0;
+      if (!connection.Open(PORT, "./test/configuration/unit_test_server.crt")) {
+        return false;
+      }
+    }
+
+    requests_on_connection++;
+
+    cHTTPResponse response;
+    return connection.PerformGetRequest(url, response) && (response.headers.response_code == 200);
+  });
+  PrintResult(result);
+
+  return (result.errors == 0);
+}
+
+}
+
+bool BenchmarkKeepAlive()
+{
+  std::cout<<"Keep-alive"<<std::endl;
+  PrintResultHeader();
+
+  const size_t nclients = 16;
+  const std::chrono::milliseconds duration(5000);
+
+  tasktracker::cWebServerOptions options;
+  options.threading_model = tasktracker::THREADING_MODEL::THREAD_POOL;
+
+  // Every client connects from 127.0.0.1, so allow all of them through the per IP limit
+  options.per_ip_connection_limit = nclients;
+
+  tasktracker::cWebServerManager web_server_manager;
+
+  const bool fuzzing = false;
+  if (!web_server_manager.Create(util::cIPAddress(127, 0, 0, 1), PORT, "./test/configuration/unit_test_server.key", "./test/configuration/unit_test_server.crt", fuzzing, { tasktracker::cFeedView("default", TOKEN) }, options)) {
+    std::cerr<<"Error creating web server"<<std::endl;
+    return false;
+  }
+
+  bool result = true;
+
+  // 1 request per connection is a full handshake every time, like a feed reader that doesn't keep its connection open between polls
+  for (size_t requests_per_connection : { 1, 10, 100 }) {
+    result = RunKeepAlive("/style.css", "static", requests_per_connection, nclients, duration) && result;
+    result = RunKeepAlive("/feed/atom.xml?token=" + TOKEN, "feed", requests_per_connection, nclients, duration) && result;
+  }
+
+  result = web_server_manager.Destroy() && result;
+
+  std::cout<<std::endl;
+
+  return result;
+}
+
+}
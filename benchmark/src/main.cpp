@@ -0,0 +1,68 @@
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+
+#include "benchmark.h"
+#include "gnutlsmm.h"
+
+namespace {
+
+class cBenchmark {
+public:
+  const char* name;
+  bool (*function)();
+};
+
+const cBenchmark benchmarks[] = {
+  { "threading_model", &benchmark::BenchmarkThreadingModel },
+  { "tls_handshake", &benchmark::BenchmarkTLSHandshake },
+  { "keep_alive", &benchmark::BenchmarkKeepAlive },
+  { "backend", &benchmark::BenchmarkBackend },
+};
+
+void PrintUsage()
+{
+  std::cout<<"Usage: ./benchmarks [BENCHMARK]..."<<std::endl;
+  std::cout<<"Run from the root of the repository, with no arguments every benchmark is run"<<std::endl;
+  std::cout<<std::endl;
+  std::cout<<"Benchmarks:"<<std::endl;
+  for (auto&& benchmark : benchmarks) {
+    std::cout<<"  "<<benchmark.name<<std::endl;
+  }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  gnutlsmm::helper gnutlsHelper;
+
+  bool result = true;
+
+  if (argc == 1) {
+    // Run every benchmark
+    for (auto&& benchmark : benchmarks) {
+      result = benchmark.function() && result;
+    }
+  } else {
+    for (int i = 1; i < argc; i++) {
+      const cBenchmark* found = nullptr;
+      for (auto&& benchmark : benchmarks) {
+        if (strcmp(argv[i], benchmark.name) == 0) {
+          found = &benchmark;
+          break;
+        }
+      }
+
+      if (found == nullptr) {
+        PrintUsage();
+        return EXIT_FAILURE;
+      }
+
+      result = found->function() && result;
+    }
+  }
+
+  return (result ? EXIT_SUCCESS : EXIT_FAILURE);
+}
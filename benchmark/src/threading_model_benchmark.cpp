@@ -0,0 +1,70 @@
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "https_client.h"
+#include "web_server.h"
+
+namespace benchmark {
+
+namespace {
+
+bool RunThreadingModel(const tasktracker::cWebServerOptions& options, const std::string& name, size_t nclients, std::chrono::milliseconds duration)
+{
+  tasktracker::cWebServerManager web_server_manager;
+
+  const bool fuzzing = false;
+  if (!web_server_manager.Create(util::cIPAddress(127, 0, 0, 1), PORT, "./test/configuration/unit_test_server.key", "./test/configuration/unit_test_server.crt", fuzzing, { tasktracker::cFeedView("default", TOKEN) }, options)) {
+    std::cerr<<"Error creating web server"<<std::endl;
+    return false;
+  }
+
+  // A small static resource, this is mostly measuring the TLS handshake and how connections are spread across threads
+  const std::string static_request = HTTPSCreateRequest("/style.css");
+  cResult static_result = RunClients(name + " static", nclients, duration, [&static_request]() {
+    cHTTPResponse response;
+    return GnuTLSPerformRequest(static_request, PORT, "Benchmark", "./server.crt", response) && (response.headers.response_code == 200);
+  });
+  PrintResult(static_result);
+
+  // The feed, this is rendered once and then served from the cache
+  const std::string feed_request = "GET /feed/atom.xml?token=" + TOKEN + " HTTP/1.0\r\nAccept-Encoding: gzip\r\n\r\n";
+  cResult feed_result = RunClients(name + " feed", nclients, duration, [&feed_request]() {
+    cHTTPResponse response;
+    return GnuTLSPerformRequest(feed_request, PORT, "Benchmark", "./server.crt", response) && (response.headers.response_code == 200);
+  });
+  PrintResult(feed_result);
+
+  return web_server_manager.Destroy();
+}
+
+}
+
+bool BenchmarkThreadingModel()
+{
+  std::cout<<"Threading model"<<std::endl;
+  PrintResultHeader();
+
+  const size_t nclients = 16;
+  const std::chrono::milliseconds duration(5000);
+
+  bool result = true;
+
+  tasktracker::cWebServerOptions options;
+
+  options.threading_model = tasktracker::THREADING_MODEL::SINGLE_THREAD;
+  result = RunThreadingModel(options, "single_thread", nclients, duration) && result;
+
+  options.threading_model = tasktracker::THREADING_MODEL::THREAD_POOL;
+  options.thread_pool_size = 0;
+  result = RunThreadingModel(options, "thread_pool", nclients, duration) && result;
+
+  options.threading_model = tasktracker::THREADING_MODEL::THREAD_PER_CONNECTION;
+  result = RunThreadingModel(options, "thread_per_connection", nclients, duration) && result;
+
+  std::cout<<std::endl;
+
+  return result;
+}
+
+}
@@ -0,0 +1,92 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "https_client.h"
+#include "self_signed_certificate.h"
+#include "web_server.h"
+
+namespace benchmark {
+
+namespace {
+
+bool RunTLSHandshake(KEY_TYPE key_type, const std::string& priorities, size_t nclients, std::chrono::milliseconds duration)
+{
+  // Generate a certificate with this type of key
+  const std::filesystem::path folder = std::filesystem::temp_directory_path();
+  const std::string private_key = (folder / (std::string("task_tracker_benchmark_") + GetKeyTypeName(key_type) + ".key")).string();
+  const std::string public_cert = (folder / (std::string("task_tracker_benchmark_") + GetKeyTypeName(key_type) + ".crt")).string();
+  if (!GenerateSelfSignedCertificate(key_type, private_key, public_cert)) {
+    return false;
+  }
+
+  tasktracker::cWebServerOptions options;
+  options.threading_model = tasktracker::THREADING_MODEL::THREAD_POOL;
+  options.tls_priorities = priorities;
+
+  tasktracker::cWebServerManager web_server_manager;
+
+  const bool fuzzing = false;
+  if (!web_server_manager.Create(util::cIPAddress(127, 0, 0, 1), PORT, private_key, public_cert, fuzzing, { tasktracker::cFeedView("default", TOKEN) }, options)) {
+    std::cerr<<"Error creating web server"<<std::endl;
+    return false;
+  }
+
+  const std::string name = std::string(GetKeyTypeName(key_type)) + " " + (priorities.empty() ? "default" : priorities);
+
+  // Every request is a new connection with a full handshake, the 404 response is prebuilt so there is very little work apart from the handshake
+  const std::string request = HTTPSCreateRequest("/not_found");
+  cResult full_result = RunClients(name + " full", nclients, duration, [&request, &public_cert]() {
+    cHTTPResponse response;
+    return GnuTLSPerformRequest(request, PORT, "Benchmark", public_cert, response) && (response.headers.response_code == 404);
+  });
+  PrintResult(full_result);
+
+  // Each client resumes its previous session after the first request
+  cResult resumed_result = RunClients(name + " resumed", nclients, duration, [&request, &public_cert]() {
+    thread_local cTLSSession tls_session;
+    cHTTPResponse response;
+    return GnuTLSPerformRequest(request, PORT, "Benchmark", public_cert, tls_session, response) && (response.headers.response_code == 404);
+  });
+  PrintResult(resumed_result);
+
+  const bool result = web_server_manager.Destroy();
+
+  std::filesystem::remove(private_key);
+  std::filesystem::remove(public_cert);
+
+  return result;
+}
+
+}
+
+bool BenchmarkTLSHandshake()
+{
+  std::cout<<"TLS handshake, requests per second is handshakes per second"<<std::endl;
+  PrintResultHeader();
+
+  const size_t nclients = 16;
+  const std::chrono::milliseconds duration(5000);
+
+  // NOTE: The test client only speaks TLS 1.2, so these are compared with TLS 1.2 handshakes
+  const std::string priorities[] = {
+    "", // The libmicrohttpd default
+    "PERFORMANCE:%SERVER_PRECEDENCE", // Prefers the cheaper ciphers, with an RSA key this allows RSA key exchange without forward secrecy
+    "NORMAL:-KX-ALL:+ECDHE-ECDSA:+ECDHE-RSA:-GROUP-ALL:+GROUP-X25519:+GROUP-SECP256R1", // Only ECDHE key exchange on the cheapest groups
+  };
+
+  bool result = true;
+
+  for (KEY_TYPE key_type : { KEY_TYPE::RSA_2048, KEY_TYPE::ECDSA_P256, KEY_TYPE::ED25519 }) {
+    for (auto&& priority : priorities) {
+      result = RunTLSHandshake(key_type, priority, nclients, duration) && result;
+    }
+  }
+
+  std::cout<<std::endl;
+
+  return result;
+}
+
+}
@@ -24,15 +24,12 @@ bool tcp_connection::connect(const util::cIPAddress& ip, int port)
   close();
 
   // Connect to server
-  sd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_storage sa;
+  const socklen_t sa_length = util::ToSockAddr(ip, uint16_t(port), sa);
 
-  struct sockaddr_in sa;
-  ::memset(&sa, '\0', sizeof(sa));
-  sa.sin_family = AF_INET;
-  sa.sin_port = ::htons(port);
-  ::inet_pton(AF_INET, util::ToString(ip).c_str(), &sa.sin_addr);
+  sd = ::socket(sa.ss_family, SOCK_STREAM, 0);
 
-  const int result = ::connect(sd, (struct sockaddr *) &sa, sizeof(sa));
+  const int result = ::connect(sd, (struct sockaddr *) &sa, sa_length);
   return (result >= 0);
 }
 
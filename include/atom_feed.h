@@ -4,6 +4,7 @@
 #include <sstream>
 
 #include "feed_data.h"
+#include "feed_view.h"
 #include "random.h"
 
 namespace feed {
@@ -12,4 +13,7 @@ std::string GenerateFeedID(util::cPseudoRandomNumberGenerator& rng);
 
 bool WriteFeedXML(const tasktracker::cFeedData& feed_data, std::ostringstream& output);
 
+// Only the entries that match the filter are written
+bool WriteFeedXML(const tasktracker::cFeedData& feed_data, const tasktracker::cFeedViewFilter& filter, std::ostringstream& output);
+
 }
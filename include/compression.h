@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+// NOTE: These are in order of preference when a client accepts several encodings equally
+enum class CONTENT_ENCODING {
+  BROTLI,
+  ZSTD,
+  GZIP,
+  IDENTITY,
+};
+
+const size_t CONTENT_ENCODING_COUNT = 4;
+
+// A bit mask of CONTENT_ENCODING values
+constexpr uint32_t GetContentEncodingBit(CONTENT_ENCODING encoding) { return (1u << static_cast<uint32_t>(encoding)); }
+const uint32_t CONTENT_ENCODINGS_ALL = (1u << CONTENT_ENCODING_COUNT) - 1;
+
+// Returns the name used in the Accept-Encoding and Content-Encoding headers, ie. "br"
+const char* GetContentEncodingName(CONTENT_ENCODING encoding);
+
+bool Compress(CONTENT_ENCODING encoding, std::string_view input, std::string& output);
+
+
+// ** cEncodedContent
+//
+// Some content along with each of its compressed variants, these are created once up front so that requests only have to pick one
+//
+class cEncodedContent {
+public:
+  cEncodedContent();
+
+  // Set the content and create each of the compressed variants, returns false if any of the compressed variants could not be created
+  bool Create(std::string_view content);
+  bool Create(std::string&& content); // Takes ownership of content for the identity variant instead of copying it
+
+  // Set a variant that was already created elsewhere, ie. by another process, this doesn't compress anything
+  void SetVariant(CONTENT_ENCODING encoding, std::string_view content);
+
+  constexpr uint32_t GetAvailableEncodings() const { return available_encodings; }
+  const std::string& Get(CONTENT_ENCODING encoding) const { return variants[static_cast<size_t>(encoding)]; }
+
+private:
+  bool CreateCompressedVariants(std::string_view content);
+
+  uint32_t available_encodings;
+  std::array<std::string, CONTENT_ENCODING_COUNT> variants;
+};
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+#include "compression.h"
+
+namespace tasktracker {
+
+// ** cEmbeddedResource
+//
+// A static resource that is compiled into the executable, see tools/embed_resources.cpp which generates these from the resources folder
+//
+class cEmbeddedResource {
+public:
+  std::string_view request_path;
+  std::string_view mime_type;
+  std::array<std::string_view, util::CONTENT_ENCODING_COUNT> variants; // The content for each encoding
+  std::array<std::string_view, util::CONTENT_ENCODING_COUNT> etags; // The etag for each encoding
+};
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "compression.h"
+#include "feed_view.h"
+
+namespace tasktracker {
+
+class cFeedSnapshot;
+
+// The values used to answer conditional requests for the feed, these can be worked out without rendering the feed
+class cFeedValidators {
+public:
+  uint64_t generation;
+  std::string etag;
+  std::chrono::system_clock::time_point last_modified; // The date of the newest entry
+  std::string last_modified_text;
+};
+
+class cRenderedFeed {
+public:
+  cFeedValidators validators;
+  util::cEncodedContent content; // The rendered feed and its compressed variants
+};
+
+// ** cFeedRenderCache
+//
+// Caches the rendered Atom feed, the feed is rendered and compressed at most once per feed data generation
+// If several requests arrive while the feed is stale only the first one renders it, the others wait for that render and share the result
+// Each view of the feed has its own cache, only the entries that match the filter are rendered
+// In a worker process the feed is rendered by the tracker process, so "rendering" copies the view out of the shared feed snapshot instead
+//
+class cFeedRenderCache {
+public:
+  explicit cFeedRenderCache(const cFeedViewFilter& filter = cFeedViewFilter());
+  cFeedRenderCache(const cFeedViewFilter& filter, const cFeedSnapshot& feed_snapshot, size_t feed_snapshot_view);
+
+  // Returns the validators for the current feed data generation without rendering the feed
+  cFeedValidators GetValidators() const;
+
+  // Returns the rendered feed for the current feed data generation, rendering it if required
+  std::shared_ptr<const cRenderedFeed> Get();
+
+  // Returns the rendered feed if it is already up to date, or nullptr if it would have to be rendered, this never renders
+  std::shared_ptr<const cRenderedFeed> GetIfCurrent() const;
+
+  uint64_t GetRenderCount() const;
+
+  const cFeedViewFilter& GetFilter() const { return filter; }
+
+private:
+  uint64_t GetGeneration() const;
+  std::shared_ptr<const cRenderedFeed> Render() const;
+
+  const cFeedViewFilter filter;
+  const uint64_t filter_hash; // Mixed into the ETag so that different views of the same generation have different ETags
+
+  // If this is set the feed comes from the snapshot, the generations are the snapshot's generations rather than feed_data_generation
+  const cFeedSnapshot* feed_snapshot;
+  const size_t feed_snapshot_view;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv_render_finished;
+  bool rendering;
+  uint64_t render_count;
+  std::shared_ptr<const cRenderedFeed> rendered;
+};
+
+}
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <string>
 #include <mutex>
+#include <optional>
+#include <vector>
 
 #include "ring_buffer.h"
 
@@ -12,20 +15,30 @@ const size_t MAX_FEED_ENTRIES = 50;
 
 class cFeedProperties {
 public:
+  cFeedProperties();
+
   std::string title;
   std::string link;
   std::chrono::system_clock::time_point date_updated;
   std::string author_name;
   std::string id;
+  uint32_t update_period_minutes; // How often the feed can change, this is written as a Syndication module hint for feed readers, 0 leaves it out
 };
 
 class cFeedEntry {
 public:
+  cFeedEntry();
+
   std::string title;
   std::string link;
   std::string summary;
   std::chrono::system_clock::time_point date_updated; // NOTE: This is the date the event was published, not the task date due
   std::string id;
+
+  // What the entry is about, used to filter the feed views
+  bool high_priority;
+  std::string project; // The Gitlab project path, for example "home/garden"
+  std::vector<std::string> labels;
 };
 
 class cFeedData {
@@ -40,6 +53,14 @@ public:
 extern std::mutex mutex_feed_data;
 extern cFeedData feed_data;
 
+// Incremented while holding mutex_feed_data each time feed_data is modified, anything derived from the feed data can compare generations to see if it is stale
+extern std::atomic<uint64_t> feed_data_generation;
+
+// When the tracker thread next polls Gitlab, the feed data doesn't change before then so the feed can be cached until it
+// Returns nothing if the tracker thread hasn't scheduled a poll
+void SetNextFeedUpdate(std::chrono::system_clock::time_point next_update);
+std::optional<std::chrono::system_clock::time_point> GetNextFeedUpdate();
+
 bool LoadFeedDataFromFile(const std::string& external_url);
 bool SaveFeedDataToFile();
 
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "feed_data.h"
+#include "feed_view.h"
+#include "ring_buffer.h"
+
+// Server-Sent Events for the feed, the tracker thread publishes each new feed entry and the web servers push it to the clients of /feed/events
+
+namespace tasktracker {
+
+extern const std::string EVENT_STREAM_MIMETYPE;
+
+// The most recent events are kept for clients that reconnect, this matches the number of entries in the feed
+const size_t MAX_FEED_EVENTS = MAX_FEED_ENTRIES;
+
+// Each event stream gets a comment this often so that proxies don't close it and we find out if the client has gone
+constexpr std::chrono::seconds FEED_EVENTS_HEARTBEAT_INTERVAL = std::chrono::seconds(15);
+
+class cFeedEvent {
+public:
+  uint64_t id;
+  cFeedEntry entry; // For filtering by view
+  std::string data; // The entry as JSON on a single line, this is formatted once and shared by every client
+};
+
+// ** cFeedEventQueue
+//
+// Fans the new feed entries out to every web server, each web server asks for the events after the last one that it has seen
+// The event IDs are the time each entry was published in milliseconds, so a Last-Event-ID from before a restart still makes sense
+// NOTE: The listeners are called on the publishing thread, they should only wake up their own event loop
+//
+class cFeedEventQueue {
+public:
+  cFeedEventQueue();
+
+  // Publish new entries, they are kept until MAX_FEED_EVENTS newer events have been published
+  void Publish(const std::vector<cFeedEntry>& entries);
+
+  // Returns the ID of the latest event, or 0 if nothing has been published
+  uint64_t GetLastEventID() const;
+
+  // Returns the events after after_event_id, oldest first
+  std::vector<std::shared_ptr<const cFeedEvent>> GetEventsAfter(uint64_t after_event_id) const;
+
+  // on_publish is called after each publish, RemoveListener waits for a call that is in progress to return
+  size_t AddListener(std::function<void()> on_publish);
+  void RemoveListener(size_t listener);
+
+  void Clear();
+
+private:
+  mutable std::mutex mutex;
+  util::ring_buffer<std::shared_ptr<const cFeedEvent>, MAX_FEED_EVENTS> events;
+  uint64_t last_event_id;
+
+  std::mutex mutex_listeners;
+  std::map<size_t, std::function<void()>> listeners;
+  size_t next_listener;
+};
+
+// The queue that the tracker thread publishes to
+cFeedEventQueue& GetFeedEventQueue();
+
+
+// ** cFeedEventStream
+//
+// One client's event stream, the events for the client's view are formatted into a buffer until the web server sends them
+// The buffer is limited so that a client that stops reading can't make us hold on to every event, the web server disconnects it instead and it can resume with Last-Event-ID
+//
+class cFeedEventStream {
+public:
+  // The stream starts after last_event_id
+  cFeedEventStream(const cFeedViewFilter& filter, uint64_t last_event_id, size_t buffer_limit_bytes);
+
+  // Format the events that have been published since the last update, returns false if they don't fit in the buffer
+  bool Update(const cFeedEventQueue& queue);
+
+  // Add a comment line, returns false if it doesn't fit in the buffer
+  bool AddHeartbeat();
+
+  bool IsEmpty() const { return buffer.empty(); }
+
+  // Move the buffered text out so that it can be sent
+  std::string Take();
+
+  // Copy up to size bytes of the buffered text out, returns the number of bytes copied
+  size_t Read(char* out_data, size_t size);
+
+private:
+  bool Append(std::string_view text);
+
+  const cFeedViewFilter filter;
+  const size_t buffer_limit_bytes;
+  uint64_t last_event_id;
+  std::string buffer;
+};
+
+// Parse a Last-Event-ID header, an empty or missing header starts from the latest event
+uint64_t ParseLastEventID(const char* last_event_id, const cFeedEventQueue& queue);
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "feed_cache.h"
+
+namespace tasktracker {
+
+class cTLSSessionTicketKey;
+
+// ** cFeedSnapshot
+//
+// The rendered feed for every view in a shared memory region, the tracker process renders the feed into it and the worker processes serve it
+// The tracker process is the only writer and a seqlock guards the region, the writer never waits for the readers and the readers never take a lock
+// A reader that overlaps a write just copies the view again, the feed only changes every half an hour or so, so that is rare
+// NOTE: The region is a memfd, it is created before the worker processes are started and they inherit the file descriptor
+//
+class cFeedSnapshot {
+public:
+  cFeedSnapshot();
+  ~cFeedSnapshot();
+
+  // Create the region in the tracker process, data_size_bytes is the space for every view and all of its compressed variants
+  bool Create(size_t view_count, size_t data_size_bytes);
+
+  // Map a region that the tracker process created, the worker processes can only read it
+  bool Open(int fd);
+
+  void Close();
+
+  constexpr int GetFD() const { return fd; }
+  size_t GetViewCount() const;
+
+  // Copy the rendered views into the region, there must be one for each view in order, returns false if they don't fit
+  bool Publish(const std::vector<std::shared_ptr<const cRenderedFeed>>& rendered_views);
+
+  // Incremented each time the feed is published, this is 0 until the first time
+  uint64_t GetGeneration() const;
+
+  // When the tracker process next polls Gitlab, the worker processes use this for the Cache-Control header of the feed
+  void SetNextUpdate(std::chrono::system_clock::time_point next_update);
+  std::optional<std::chrono::system_clock::time_point> GetNextUpdate() const;
+
+  // The TLS session ticket key that every worker process uses, so that a client can resume its session with whichever worker the kernel gives its connection to
+  // NOTE: This is set before the worker processes are started and never changes, so it is outside the seqlock
+  bool SetTLSSessionTicketKey(const cTLSSessionTicketKey& key);
+  bool GetTLSSessionTicketKey(cTLSSessionTicketKey& out_key) const;
+
+  // Returns the validators for the latest generation without copying the feed, or false if nothing has been published yet
+  bool ReadValidators(size_t view, cFeedValidators& out_validators) const;
+
+  // Returns a copy of the view from the latest generation, or nullptr if nothing has been published yet
+  std::shared_ptr<const cRenderedFeed> Read(size_t view) const;
+
+private:
+  bool Map(int fd, bool writable);
+
+  int fd;
+  bool writable;
+  size_t region_size_bytes;
+  void* region;
+};
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "feed_data.h"
+
+namespace tasktracker {
+
+// ** cFeedViewFilter
+//
+// Selects which feed entries are shown in a view of the feed, an empty filter shows every entry
+//
+class cFeedViewFilter {
+public:
+  cFeedViewFilter();
+
+  bool IsEmpty() const;
+  bool IsMatch(const cFeedEntry& entry) const;
+
+  // Returns a string that is the same for filters that select the same entries
+  std::string GetKey() const;
+
+  bool high_priority_only;
+  std::string project; // Only entries for this project, empty matches every project
+  std::vector<std::string> labels; // Only entries with at least one of these labels, empty matches every entry
+};
+
+// ** cFeedView
+//
+// A token and the view of the feed that the token gives access to
+//
+class cFeedView {
+public:
+  cFeedView();
+  cFeedView(const std::string& name, const std::string& token, const cFeedViewFilter& filter = cFeedViewFilter());
+
+  std::string name; // Only used for logging
+  std::string token;
+  cFeedViewFilter filter;
+};
+
+}
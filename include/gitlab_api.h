@@ -14,6 +14,8 @@ public:
   std::string title;
   std::chrono::system_clock::time_point due_date;
   std::string web_url;
+  std::string project; // The full path of the project, for example "home/garden"
+  std::vector<std::string> labels;
 };
 
 bool QueryGitlabAPI(const tasktracker::cSettings& settings, std::vector<cIssue>& out_gitlab_issues);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "compression.h"
+
+namespace http {
+
+// NOTE: Method names are case sensitive, "get" is not the same method as "GET"
+enum class METHOD {
+  GET,
+  HEAD,
+  POST,
+  PUT,
+  DELETE,
+  PATCH,
+  OPTIONS,
+  UNKNOWN, // Any other method, these are never allowed
+};
+
+METHOD ParseMethod(std::string_view text);
+const char* GetMethodName(METHOD method);
+
+// A bit mask of METHOD values
+constexpr uint32_t GetMethodBit(METHOD method) { return (1u << static_cast<uint32_t>(method)); }
+
+// Create the value for the Allow header of a 405 response from a mask of allowed methods, ie. "GET, HEAD"
+std::string CreateAllowHeader(uint32_t methods);
+
+// Create a strong ETag from a 64 bit value, ie. "\"0123456789abcdef\""
+std::string CreateETag(uint64_t value);
+
+// Create the ETag for a compressed variant of a resource, ie. "\"0123456789abcdef\"" becomes "\"0123456789abcdef-gzip\"", the identity encoding returns the etag unchanged
+std::string CreateETagForEncoding(std::string_view etag, util::CONTENT_ENCODING encoding);
+
+// Returns true if the etag is listed in an If-None-Match header value, this uses the weak comparison as required for If-None-Match
+bool IsETagInList(std::string_view if_none_match, std::string_view etag);
+
+// Evaluate the conditional request headers for a GET or HEAD request, returns true if we should respond with 304 Not Modified
+// If-None-Match takes precedence, If-Modified-Since is only checked if there is no If-None-Match header
+// if_none_match and if_modified_since may be nullptr if the request didn't have those headers
+bool IsNotModified(const char* if_none_match, const char* if_modified_since, std::string_view etag, const std::optional<std::chrono::system_clock::time_point>& last_modified);
+
+// Choose the best encoding from the available_encodings mask (See util::GetContentEncodingBit) for an Accept-Encoding header value
+// accept_encoding may be nullptr if the request didn't have an Accept-Encoding header in which case we use the identity encoding
+util::CONTENT_ENCODING ChooseContentEncoding(const char* accept_encoding, uint32_t available_encodings);
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace tasktracker {
+
+// ** cInFlightRequests
+//
+// Counts the requests that a backend has started but not finished responding to, so that shutting down can wait for exactly as long as they take
+//
+class cInFlightRequests {
+public:
+  cInFlightRequests();
+
+  void Started();
+  void Completed();
+
+  size_t Get() const;
+
+  // Wait until there are no requests in flight, returns false if there are still some at the deadline
+  bool WaitUntilIdle(std::chrono::steady_clock::time_point deadline) const;
+
+private:
+  mutable std::mutex mutex;
+  mutable std::condition_variable cv_idle;
+  size_t count;
+};
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "web_resources.h"
+#include "web_server_backend.h"
+
+namespace tasktracker {
+
+// Returns true if the io_uring backend was compiled in, see the TASK_TRACKER_IO_URING CMake option
+bool IsIOUringWebServerAvailable();
+
+// Create the io_uring backend, this returns nullptr if the backend was not compiled in
+// NOTE: feed_route must outlive the backend
+cWebServerBackend* CreateIOUringWebServer(const cFeedRoute& feed_route);
+
+}
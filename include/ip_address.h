@@ -2,45 +2,124 @@
 
 #include <cstdint>
 
+#include <array>
+#include <string>
 #include <string_view>
 
+#include <sys/socket.h>
+
 namespace util {
 
+enum class ADDRESS_FAMILY {
+  IPV4,
+  IPV6,
+};
+
 class cIPAddress {
 public:
   cIPAddress();
   cIPAddress(uint8_t octet0, uint8_t octet1, uint8_t octet2, uint8_t octet3);
+  explicit cIPAddress(const std::array<uint8_t, 16>& ipv6_bytes);
 
   void Clear();
 
+  constexpr bool IsIPv4() const { return (family == ADDRESS_FAMILY::IPV4); }
+  constexpr bool IsIPv6() const { return (family == ADDRESS_FAMILY::IPV6); }
+
+  constexpr bool IsAny() const; // 0.0.0.0 or ::
   constexpr bool IsValid() const;
 
-  uint8_t octet0;
-  uint8_t octet1;
-  uint8_t octet2;
-  uint8_t octet3;
+  bool operator==(const cIPAddress& rhs) const = default;
+
+  ADDRESS_FAMILY family;
+  std::array<uint8_t, 16> bytes; // Network byte order, an IPv4 address only uses the first 4 bytes and the rest are zero
 };
 
+inline constexpr bool cIPAddress::IsAny() const
+{
+  for (uint8_t byte : bytes) {
+    if (byte != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 inline constexpr bool cIPAddress::IsValid() const
 {
+  if (IsIPv6()) {
+    // ::1
+    bool loopback = (bytes[15] == 1);
+    for (size_t i = 0; i < 15; i++) {
+      loopback = loopback && (bytes[i] == 0);
+    }
+
+    // There is no NAT in front of an IPv6 server, so unlike IPv4 a global address is fine
+    return (
+      // 2000::/3 global unicast
+      ((bytes[0] & 0xe0) == 0x20) ||
+
+      // fc00::/7 unique local
+      ((bytes[0] & 0xfe) == 0xfc) ||
+
+      loopback
+    );
+  }
+
   // No this is not complete, but it is good enough, I'm only using the 192.168.x.x range anyway, feel free to improve these checks
   return (
     // 10.0.0.0 - 10.255.255.255 (10/8 prefix)
-    (octet0 == 10) ||
+    (bytes[0] == 10) ||
 
     // 172.16.0.0 - 172.31.255.255 (172.16/12 prefix)
-    ((octet0 == 172) && ((octet1 >= 16) && (octet1 <= 31))) ||
+    ((bytes[0] == 172) && ((bytes[1] >= 16) && (bytes[1] <= 31))) ||
 
     // 192.168.0.0 - 192.168.255.255 (192.168/16 prefix)
-    ((octet0 == 192) && (octet1 == 168)) ||
+    ((bytes[0] == 192) && (bytes[1] == 168)) ||
 
     // 127.0.0.1
-    ((octet0 == 127) && (octet1 == 0) && (octet2 == 0) && (octet3 == 1))
+    ((bytes[0] == 127) && (bytes[1] == 0) && (bytes[2] == 0) && (bytes[3] == 1))
   );
 }
 
 
+// An address and the number of leading bits that make up the network, ie. 192.168.0.0/16
+class cIPNetwork {
+public:
+  cIPNetwork();
+  cIPNetwork(const cIPAddress& address, uint8_t prefix_length);
+
+  bool Contains(const cIPAddress& address) const;
+
+  bool operator==(const cIPNetwork& rhs) const = default;
+
+  cIPAddress address; // The bits after the prefix are zero
+  uint8_t prefix_length; // 0 to 32 for IPv4, 0 to 128 for IPv6
+};
+
+
+// Formats IPv4 addresses as dotted quads and IPv6 addresses in the RFC 5952 canonical form, ie. "2001:db8::1"
 std::string ToString(const cIPAddress& address);
-bool ParseAddress(const std::string& text, cIPAddress& out_address);
+
+// Parses an IPv4 dotted quad or an IPv6 address without brackets, this doesn't allocate
+bool ParseAddress(std::string_view text, cIPAddress& out_address);
+
+// Parses "192.168.0.3:8443" or "[2001:db8::3]:8443", IPv6 addresses must be in brackets
+bool ParseAddressAndPort(std::string_view text, cIPAddress& out_address, uint16_t& out_port);
+
+// Formats a network as "192.168.0.0/16" or "2001:db8::/32"
+std::string ToString(const cIPNetwork& network);
+
+// Parses "192.168.0.0/16" or "2001:db8::/32", an address without a prefix length is a network of just that address
+// NOTE: The bits after the prefix are cleared, so "192.168.0.3/16" is 192.168.0.0/16
+bool ParseNetwork(std::string_view text, cIPNetwork& out_network);
+
+// Fills in a sockaddr_in or sockaddr_in6 for the address and returns its length
+socklen_t ToSockAddr(const cIPAddress& address, uint16_t port, struct sockaddr_storage& out_address);
+
+// Gets the address from a sockaddr_in or sockaddr_in6, returns false for any other family such as a Unix domain socket
+// NOTE: IPv4 mapped addresses from a dual stack socket are returned as IPv4 addresses so that a client is the same client on either socket
+bool FromSockAddr(const struct sockaddr* address, cIPAddress& out_address);
 
 }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vector>
+
+#include "ip_address.h"
+
+namespace util {
+
+// ** cIPAddressFilter
+//
+// Decides whether a client address may connect from lists of allowed and denied networks
+// The networks are compiled into a binary trie for each address family, a lookup walks at most 32 or 128 nodes and the most specific matching network wins
+// If no network matches the client is allowed unless there is an allow list, then only the networks on it are allowed
+// NOTE: If the same network is on both lists it is denied
+//
+class cIPAddressFilter {
+public:
+  cIPAddressFilter();
+
+  void Create(const std::vector<cIPNetwork>& allow, const std::vector<cIPNetwork>& deny);
+  void Clear();
+
+  bool IsEnabled() const { return !nodes.empty(); }
+
+  bool IsAllowed(const cIPAddress& address) const;
+
+private:
+  enum class RULE : uint8_t {
+    NONE,
+    ALLOW,
+    DENY,
+  };
+
+  class cNode {
+  public:
+    uint32_t children[2]; // The index of the node for the next bit being 0 or 1, 0 if there isn't one (The roots are never children)
+    RULE rule; // The rule for the network that ends at this node
+  };
+
+  static const uint32_t IPV4_ROOT = 0;
+  static const uint32_t IPV6_ROOT = 1;
+
+  void Insert(const cIPNetwork& network, RULE rule);
+
+  bool default_allowed; // When no network matches
+  std::vector<cNode> nodes;
+};
+
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <json-c/json.h>
 
 namespace json {
@@ -9,6 +12,7 @@ bool JSONParseString(const struct json_object* json, const std::string& name, st
 bool JSONParseBool(const struct json_object* json, const std::string& name, bool& out_value);
 bool JSONParseUint16(const struct json_object* json, const std::string& name, uint16_t& out_value);
 bool JSONParseUint64(const struct json_object* json, const std::string& name, uint64_t& out_value);
+bool JSONParseStringArray(const struct json_object* json, const std::string& name, std::vector<std::string>& out_values);
 
 
 class cJSONDocument {
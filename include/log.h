@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <charconv>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// The lowest level that is compiled in, log statements below this level are removed entirely
+// 0 = VERBOSE, 1 = INFO, 2 = WARNING, 3 = ERROR
+#ifndef TASK_TRACKER_LOG_LEVEL
+#ifdef NDEBUG
+#define TASK_TRACKER_LOG_LEVEL 1
+#else
+#define TASK_TRACKER_LOG_LEVEL 0
+#endif
+#endif
+
+namespace logging {
+
+// NOTE: This is VERBOSE rather than DEBUG because DEBUG is defined for debug builds
+enum class LEVEL {
+  VERBOSE = 0,
+  INFO = 1,
+  WARNING = 2,
+  ERROR = 3,
+};
+
+constexpr bool IsLevelCompiledIn(LEVEL level) { return (static_cast<int>(level) >= TASK_TRACKER_LOG_LEVEL); }
+
+// Longer lines are truncated
+const size_t MAX_LINE_LENGTH = 512;
+
+// Start the writer thread, log lines are queued in a per thread buffer and written by the writer thread
+// Until this is called (And after Stop is called) log lines are written synchronously, which is what the tests and tools want
+bool Start();
+
+// Write any queued log lines and stop the writer thread
+void Stop();
+
+// The number of log lines that were dropped because a thread's buffer was full, the writer thread also logs a warning with the number dropped
+uint64_t GetDroppedCount();
+
+// Write a log line, VERBOSE and INFO go to stdout, WARNING and ERROR go to stderr
+// If the writer thread is running this just copies the line into this thread's buffer, it doesn't lock or make any system calls
+// If the buffer is full VERBOSE and INFO lines are dropped, WARNING and ERROR lines are written synchronously instead
+void Write(LEVEL level, std::string_view text);
+
+
+// Wrap a value from a client in this to write it in quotes with any control characters, quotes and backslashes escaped, ie. LOG_INFO<<quoted(url)
+class quoted {
+public:
+  explicit constexpr quoted(std::string_view _value) : value(_value) {}
+
+  std::string_view value;
+};
+
+
+// ** cLogLine
+//
+// Builds a log line in a fixed size buffer and writes it when it goes out of scope, use the LOG_ macros below rather than using this directly
+//
+class cLogLine {
+public:
+  explicit cLogLine(LEVEL level);
+  ~cLogLine();
+
+  cLogLine(const cLogLine&) = delete;
+  cLogLine& operator=(const cLogLine&) = delete;
+
+  cLogLine& operator<<(const quoted& value);
+
+  template <class T>
+  cLogLine& operator<<(const T& value);
+
+private:
+  void Append(std::string_view value);
+
+  LEVEL level;
+  size_t length;
+  char text[MAX_LINE_LENGTH];
+};
+
+template <class T>
+cLogLine& cLogLine::operator<<(const T& value)
+{
+  if constexpr (std::is_same_v<T, bool>) {
+    Append(value ? "true" : "false");
+  } else if constexpr (std::is_same_v<T, char>) {
+    Append(std::string_view(&value, 1));
+  } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+    Append((value != nullptr) ? value : "(null)");
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    // Format numbers straight into our buffer
+    char buffer[32];
+    const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    Append(std::string_view(buffer, result.ptr - buffer));
+  } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+    Append(std::string_view(value));
+  } else {
+    // Fallback for anything else that can be written to a stream
+    std::ostringstream o;
+    o<<value;
+    Append(o.str());
+  }
+
+  return *this;
+}
+
+}
+
+// Use these like a stream, ie. LOG_INFO<<"Serving "<<url;
+// NOTE: The if else form means no code is generated for levels below TASK_TRACKER_LOG_LEVEL, and it is safe to use in an unbraced if statement
+#define LOG_AT_LEVEL(LOG_LEVEL) if constexpr (!logging::IsLevelCompiledIn(LOG_LEVEL)) {} else logging::cLogLine(LOG_LEVEL)
+
+#define LOG_VERBOSE LOG_AT_LEVEL(logging::LEVEL::VERBOSE)
+#define LOG_INFO LOG_AT_LEVEL(logging::LEVEL::INFO)
+#define LOG_WARNING LOG_AT_LEVEL(logging::LEVEL::WARNING)
+#define LOG_ERROR LOG_AT_LEVEL(logging::LEVEL::ERROR)
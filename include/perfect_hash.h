@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+#include "util.h"
+
+namespace util {
+
+// ** perfect_hash_table
+//
+// A lookup table for a fixed set of keys that are known at compile time
+// When the table is built we search for a seed that hashes every key to a different slot, so a lookup is always one hash and at most one string comparison
+//
+template <size_t N>
+class perfect_hash_table
+{
+public:
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  consteval explicit perfect_hash_table(const std::array<std::string_view, N>& keys);
+
+  // Returns the index of the key in the array of keys the table was built from, or npos if the key is not in the table
+  constexpr size_t find(std::string_view key) const;
+
+private:
+  // A power of two with at least twice as many slots as keys, which keeps the seed search short
+  static constexpr size_t SLOTS = std::max<size_t>(std::bit_ceil(2 * N), 2);
+  static constexpr int SLOT_BITS = std::countr_zero(SLOTS);
+  static constexpr uint8_t EMPTY_SLOT = std::numeric_limits<uint8_t>::max();
+  static_assert(N < EMPTY_SLOT, "perfect_hash_table only supports up to 254 keys");
+
+  static constexpr size_t GetSlot(std::string_view key, uint64_t seed);
+  consteval bool TryBuild(uint64_t seed);
+
+  std::array<std::string_view, N> keys;
+  std::array<uint8_t, SLOTS> slots;
+  uint64_t seed;
+};
+
+template <size_t N>
+consteval perfect_hash_table<N>::perfect_hash_table(const std::array<std::string_view, N>& _keys) :
+  keys(_keys),
+  slots(),
+  seed(0)
+{
+  // Keep trying seeds until we find one without any collisions, if the keys contain duplicates this will fail to compile
+  const uint64_t max_seed = 100000;
+  for (uint64_t s = 1; s < max_seed; s++) {
+    if (TryBuild(s)) {
+      seed = s;
+      return;
+    }
+  }
+
+  throw "perfect_hash_table could not find a seed, are there duplicate keys?";
+}
+
+template <size_t N>
+constexpr size_t perfect_hash_table<N>::GetSlot(std::string_view key, uint64_t seed)
+{
+  // NOTE: We use the top bits because the low bits of FNV-1a only depend on the low bits of each character, so changing the seed doesn't separate them
+  return HashFNV1a64(key, 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull)) >> (64 - SLOT_BITS);
+}
+
+template <size_t N>
+consteval bool perfect_hash_table<N>::TryBuild(uint64_t s)
+{
+  slots.fill(EMPTY_SLOT);
+
+  for (size_t i = 0; i < N; i++) {
+    const size_t slot = GetSlot(keys[i], s);
+    if (slots[slot] != EMPTY_SLOT) {
+      return false;
+    }
+
+    slots[slot] = static_cast<uint8_t>(i);
+  }
+
+  return true;
+}
+
+template <size_t N>
+constexpr size_t perfect_hash_table<N>::find(std::string_view key) const
+{
+  const uint8_t index = slots[GetSlot(key, seed)];
+  if ((index == EMPTY_SLOT) || (keys[index] != key)) {
+    return npos;
+  }
+
+  return index;
+}
+
+}
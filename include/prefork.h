@@ -0,0 +1,21 @@
+#pragma once
+
+#include "settings.h"
+
+// Prefork mode, the tracker process polls Gitlab and renders the feed into a shared memory snapshot, and the worker processes serve it
+// Each worker process binds the same ports with SO_REUSEPORT, so the kernel spreads the connections between them and a crash only takes out one worker
+
+namespace tasktracker {
+
+// The tracker process starts each worker process with this argument followed by the file descriptor of the feed snapshot
+constexpr const char* PREFORK_WORKER_ARGUMENT = "--prefork-worker";
+
+// Run the tracker process side, this starts the worker processes, keeps the feed snapshot up to date and restarts any worker that crashes
+// When the settings are reloaded the tracker process publishes the new views and sends each worker SIGHUP so that it reloads them too
+// NOTE: The task tracker thread must already be running
+bool RunPreforkServer(cSettingsStore& settings_store);
+
+// Run a worker process, this serves the feed from the snapshot until the tracker process stops it
+bool RunPreforkWorker(cSettingsStore& settings_store, int feed_snapshot_fd);
+
+}
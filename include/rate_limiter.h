@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace util {
+
+class cRateLimiterCounters {
+public:
+  cRateLimiterCounters() : allowed(0), limited(0), replaced(0) {}
+
+  uint64_t allowed;
+  uint64_t limited; // Requests that were turned away because the client's bucket was empty
+  uint64_t replaced; // Clients that were still active when their bucket was given to another client
+};
+
+// ** cRateLimiter
+//
+// A token bucket for each client, each request takes a token and the tokens refill at a steady rate up to the burst size
+// The buckets live in a fixed size set associative hash table, each set is 4 buckets in one cache line, so a lookup touches one cache line and the memory never grows however many clients we see
+// A bucket that has refilled is the same as a new bucket, so it ages out and can be given to another client, if every bucket in a set is still refilling the least recently used one is replaced
+// NOTE: A client that is replaced starts again with a full bucket, that only happens when more than 4 active clients hash to the same set
+//
+class cRateLimiter {
+public:
+  cRateLimiter();
+
+  // requests_per_minute of 0 disables the limiter, set_count is rounded up to a power of two
+  bool Create(uint32_t requests_per_minute, uint32_t burst, size_t set_count = 4096);
+
+  bool IsEnabled() const { return (requests_per_minute != 0); }
+
+  // Take a token for a client, key is a hash that identifies the client
+  // Returns true if the request is allowed, or false with out_retry_after_seconds set to how long until the client has a token again
+  bool TryTake(uint64_t key, uint32_t& out_retry_after_seconds);
+  bool TryTake(uint64_t key, std::chrono::steady_clock::time_point now, uint32_t& out_retry_after_seconds);
+
+  cRateLimiterCounters GetCounters() const;
+
+private:
+  // The tokens are fixed point, a token is 60000 units so that a bucket refills by exactly requests_per_minute units each millisecond
+  static const uint32_t TOKEN = 60 * 1000;
+
+  class cBucket {
+  public:
+    uint64_t key; // 0 is an empty bucket
+    uint32_t tokens;
+    uint32_t updated_ms; // Since the limiter was created, this wraps after 49 days which only means an idle client refills a bit later
+  };
+
+  class alignas(64) cSet {
+  public:
+    cBucket buckets[4];
+  };
+
+  uint32_t GetRefilledTokens(const cBucket& bucket, uint32_t now_ms) const;
+
+  uint32_t requests_per_minute;
+  uint32_t capacity; // The burst size in fixed point tokens
+  std::chrono::steady_clock::time_point epoch;
+
+  mutable std::mutex mutex;
+  std::vector<cSet> sets;
+  cRateLimiterCounters counters;
+};
+
+}
@@ -1,9 +1,13 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
-#include "ip_address.h"
+#include "feed_view.h"
+#include "web_server_options.h"
 
 namespace tasktracker {
 
@@ -16,14 +20,19 @@ public:
   constexpr bool IsValid() const;
   void Clear();
 
+  // The feed views and the certificate are applied when the settings are reloaded, the rest are only read at start up
+  // Returns true if any of the settings that are only read at start up are different in new_settings
+  bool RequiresRestartToApply(const cSettings& new_settings) const;
+
   constexpr bool GetRunningInContainer() const { return running_in_container; }
 
-  constexpr const util::cIPAddress& GetIP() const { return ip; }
-  constexpr uint16_t GetPort() const { return port; }
+  constexpr const std::vector<cListenEndpoint>& GetListenEndpoints() const { return listen_endpoints; } // "ip" and "port" are the first endpoint if they are set
   constexpr const std::string& GetExternalURL() const { return external_url; }
   constexpr const std::string& GetHTTPSPrivateKey() const { return https_private_key; }
   constexpr const std::string& GetHTTPSPublicCert() const { return https_public_cert; }
   constexpr const std::string& GetToken() const { return token; }
+  constexpr const std::vector<cFeedView>& GetFeedViews() const { return feed_views; } // Includes the view for "token" if it is set
+  constexpr const cWebServerOptions& GetWebServerOptions() const { return web_server_options; }
 
   constexpr const std::string& GetGitlabURL() const { return gitlab_url; }
   constexpr const std::string& GetGitlabAPIToken() const { return gitlab_api_token; }
@@ -33,12 +42,13 @@ private:
   bool running_in_container;
 
   // RSS server settings
-  util::cIPAddress ip;
-  uint16_t port;
+  std::vector<cListenEndpoint> listen_endpoints;
   std::string external_url;
   std::string https_private_key;
   std::string https_public_cert;
   std::string token;
+  std::vector<cFeedView> feed_views;
+  cWebServerOptions web_server_options;
 
   // Gitlab settings
   std::string gitlab_url;
@@ -46,4 +56,27 @@ private:
   std::string gitlab_https_public_cert;
 };
 
+// ** cSettingsStore
+//
+// The current settings, a reload parses the file into a new cSettings and publishes it in one step
+// The published settings are never changed, so anything holding on to them keeps a consistent view until it asks for the current settings again
+//
+class cSettingsStore {
+public:
+  explicit cSettingsStore(const std::string& file_path);
+
+  // Load the settings file, if it can't be parsed the current settings are kept
+  bool Load();
+
+  const std::string& GetFilePath() const { return file_path; }
+
+  std::shared_ptr<const cSettings> Get() const;
+
+private:
+  const std::string file_path;
+
+  mutable std::mutex mutex;
+  std::shared_ptr<const cSettings> settings;
+};
+
 }
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tasktracker {
+
+// ** cSettingsWatcher
+//
+// Asks for the settings to be reloaded on SIGHUP, or when inotify sees the settings file or the certificate files change
+// The directories are watched rather than the files, editors and certificate renewal tools replace files by renaming a new file over the top of them, which a watch on the old file would miss
+// NOTE: This is polled from the main loop, so a burst of changes such as a certificate and its private key being replaced one after the other only causes one reload
+//
+class cSettingsWatcher {
+public:
+  cSettingsWatcher();
+  ~cSettingsWatcher();
+
+  // Installs the SIGHUP handler and watches file_paths, this can be called again to watch a different set of files
+  bool Create(const std::vector<std::string>& file_paths);
+  void Destroy();
+
+  // Returns true once after a SIGHUP or a change to any of the watched files
+  bool IsReloadRequested();
+
+private:
+  int inotify_fd;
+  std::vector<std::pair<int, std::string>> watched_directories; // The watch descriptor and directory
+  std::vector<std::pair<std::string, std::string>> watched_files; // The directory and file name
+};
+
+}
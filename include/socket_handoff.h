@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "web_server_options.h"
+
+// Zero downtime restarts, the listening sockets are either inherited from systemd socket activation or handed over by the process we are replacing
+// On SIGUSR2 the running process starts a new copy of itself and passes it the listening sockets over a Unix domain socket, once the new process is accepting connections the old one stops accepting and drains its connections
+// The listening sockets stay open the whole time, so the kernel queues new connections for whichever process accepts next and none are refused
+
+namespace tasktracker {
+
+// The new process is started with this argument followed by its end of the Unix domain socket that the listening sockets are passed over
+constexpr const char* HANDOFF_ARGUMENT = "--handoff";
+
+// Returns the listening sockets passed to us by systemd socket activation (LISTEN_FDS), or an empty list if we were not socket activated
+std::vector<int> GetSystemdListenSockets();
+
+// Tells systemd about a change of state, ie. "READY=1", this does nothing if systemd didn't give us a notify socket
+void NotifySystemd(const std::string& state);
+
+// Gives each endpoint the inherited socket that is bound to the same address, or the same path for a Unix domain socket
+// Sockets that don't match an endpoint are closed, endpoints without a socket create their own
+void AssignListenSockets(std::vector<int>& sockets, std::vector<cListenEndpoint>& endpoints);
+
+// Passes the listening sockets to the new process, and receives them in the new process
+bool SendListenSockets(int handoff_socket, const std::vector<int>& sockets);
+bool ReceiveListenSockets(int handoff_socket, std::vector<int>& out_sockets);
+
+// Tells the process we are replacing that we are accepting connections, it stops accepting and drains its connections
+bool SendHandOffReady(int handoff_socket);
+
+// SIGUSR2 asks us to hand our listening sockets over to a new process
+void InstallHandOffSignalHandler();
+
+// The executable that is started to take over, InstallHandOffSignalHandler sets this to the executable we were started from
+void SetHandOffExecutablePath(const std::string& path);
+
+// Returns true once for each SIGUSR2
+bool IsHandOffRequested();
+
+// Starts a new process and hands it the listening sockets, returns true once the new process is accepting connections on them
+// before_start is called before the new process is started, the new process loads the feed data as it starts so anything that writes the feed data has to be stopped and the feed data saved by then
+// If the new process fails to start we keep serving
+bool HandOffListenSockets(const std::vector<int>& sockets, const std::function<void()>& before_start);
+
+}
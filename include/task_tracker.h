@@ -3,6 +3,7 @@
 #include <chrono>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "settings.h"
 
@@ -13,6 +14,8 @@ public:
   std::string title;
   std::chrono::system_clock::time_point date_due;
   std::string link;
+  std::string project;
+  std::vector<std::string> labels;
 };
 
 class cTaskList {
@@ -22,6 +25,11 @@ public:
 
 bool LoadTasksFromFile(const std::string& file_path, cTaskList& tasks);
 
-bool RunServer(const cSettings& settings);
+// SIGTERM or SIGINT asks the server to shut down gracefully, the main loop checks for it
+void InstallShutdownSignalHandler();
+bool IsShutdownRequested();
+
+// handoff_socket is the Unix domain socket that the process we are replacing passes its listening sockets over, or -1 when starting normally
+bool RunServer(cSettingsStore& settings_store, int handoff_socket = -1);
 
 }
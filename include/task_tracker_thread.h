@@ -1,9 +1,52 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "feed_data.h"
+#include "random.h"
 #include "settings.h"
+#include "task_tracker.h"
 
 namespace tasktracker {
 
-bool StartTaskTrackerThread(const cSettings& settings);
+// ** cTaskTrackerThread
+//
+// Polls Gitlab for tasks and adds a feed entry whenever a task gets close to its due date
+// The thread spends almost all of its time waiting for the next update, Stop wakes it up so that shutting down doesn't have to wait for it
+//
+class cTaskTrackerThread {
+public:
+  // NOTE: settings must outlive the thread
+  explicit cTaskTrackerThread(const cSettings& settings);
+  ~cTaskTrackerThread();
+
+  bool Start();
+
+  // Wakes the thread up and waits for it to exit, then saves the feed data
+  // NOTE: A Gitlab query that is already running is allowed to finish
+  void Stop();
+
+private:
+  void MainLoop();
+
+  // Waits for the timeout, returns false if we were asked to stop
+  bool WaitFor(std::chrono::milliseconds timeout);
+
+  void UpdateTaskListFromGitlabIssues(cTaskList& task_list);
+  void AddFeedEntry(std::vector<cFeedEntry>& entries_to_add, const cTask& task, bool high_priority, const std::string& summary);
+  void CheckTasksAndUpdateFeedEntries(cTaskList& task_list, const std::chrono::system_clock::time_point& start_time, const std::chrono::system_clock::time_point& end_time);
+
+  const cSettings& settings;
+  util::cPseudoRandomNumberGenerator rng;
+
+  std::mutex mutex;
+  std::condition_variable cv_stop;
+  bool stop_requested;
+  std::thread thread;
+};
 
 }
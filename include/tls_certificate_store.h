@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gnutls/abstract.h>
+#include <gnutls/gnutls.h>
+
+namespace tasktracker {
+
+// ** cTLSCertificate
+//
+// A certificate chain and its private key loaded into GnuTLS, this is never changed once it has been loaded
+//
+class cTLSCertificate {
+public:
+  cTLSCertificate();
+  ~cTLSCertificate();
+
+  cTLSCertificate(const cTLSCertificate&) = delete;
+  cTLSCertificate& operator=(const cTLSCertificate&) = delete;
+
+  // Load the PEM encoded certificate chain and private key, this fails if the private key doesn't belong to the first certificate
+  bool Load(const std::string& private_key_pem, const std::string& public_cert_pem);
+
+  static const unsigned int MAX_CHAIN_LENGTH = 8;
+
+  gnutls_pcert_st chain[MAX_CHAIN_LENGTH];
+  unsigned int chain_length;
+  gnutls_privkey_t private_key;
+
+  std::string private_key_pem; // What was loaded, so that a reload can tell whether the files have changed
+  std::string public_cert_pem;
+};
+
+// ** cTLSCertificateStore
+//
+// The certificate that TLS handshakes use, a reload loads the files into a new cTLSCertificate and swaps it in without affecting existing connections
+// NOTE: Neither GnuTLS nor libmicrohttpd pass user data to the certificate callback, and every TLS endpoint serves the certificate from the settings, so there is one store for the whole process
+//
+class cTLSCertificateStore {
+public:
+  // Load the certificate and private key files, if they haven't changed since the last load this does nothing, if they can't be loaded the current certificate is kept
+  bool Load(const std::string& private_key, const std::string& public_cert);
+
+  std::shared_ptr<const cTLSCertificate> Get() const;
+
+private:
+  mutable std::mutex mutex;
+  std::shared_ptr<const cTLSCertificate> certificate;
+
+  // GnuTLS holds on to the certificate for the rest of the handshake after the callback returns, so replaced certificates are kept until we exit
+  // NOTE: Certificates are only replaced every few months, so this only ever holds a handful
+  std::vector<std::shared_ptr<const cTLSCertificate>> replaced_certificates;
+};
+
+cTLSCertificateStore& GetTLSCertificateStore();
+
+// The GnuTLS certificate callback (gnutls_certificate_retrieve_function2), this returns the current certificate from the store
+int RetrieveTLSCertificate(gnutls_session_t session, const gnutls_datum_t* req_ca_rdn, int nreqs, const gnutls_pk_algorithm_t* pk_algos, int pk_algos_length, gnutls_pcert_st** pcert, unsigned int* pcert_length, gnutls_privkey_t* pkey);
+
+}
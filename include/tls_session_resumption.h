@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+
+#include <gnutls/gnutls.h>
+
+#include "web_server_options.h"
+
+namespace tasktracker {
+
+class cTLSSessionCounters {
+public:
+  cTLSSessionCounters() : full_handshakes(0), resumed_handshakes(0) {}
+
+  uint64_t full_handshakes;
+  uint64_t resumed_handshakes; // Connections that resumed a previous session with a session ticket
+};
+
+// ** cTLSSessionTicketKey
+//
+// The key that session tickets are encrypted with, a client can only resume its session with a server that has the key that issued its ticket
+// Every endpoint in the process uses the same key, and in prefork mode the tracker process passes its key to every worker process in the feed snapshot
+//
+class cTLSSessionTicketKey {
+public:
+  cTLSSessionTicketKey();
+  ~cTLSSessionTicketKey();
+
+  cTLSSessionTicketKey(const cTLSSessionTicketKey&) = delete;
+  cTLSSessionTicketKey& operator=(const cTLSSessionTicketKey&) = delete;
+
+  // Generate a new random key, tickets from before a restart are ignored because each time we start we generate a new key
+  bool Generate();
+
+  // Use a key that was generated by another process
+  bool Set(const unsigned char* data, size_t size);
+
+  void Clear();
+
+  bool IsValid() const { return (key.data != nullptr); }
+  const gnutls_datum_t& Get() const { return key; }
+
+private:
+  gnutls_datum_t key;
+};
+
+// The key that every endpoint in this process uses, this is generated or set before the web servers are created and isn't changed while they are running
+cTLSSessionTicketKey& GetTLSSessionTicketKey();
+
+// ** cTLSSessionResumption
+//
+// Lets clients resume a previous TLS session with a session ticket instead of performing a full handshake on every connection
+// NOTE: Session tickets are enabled on each GnuTLS session when the connection starts, before the handshake has happened
+//
+class cTLSSessionResumption {
+public:
+  cTLSSessionResumption();
+  ~cTLSSessionResumption();
+
+  // The key is copied, it must be valid if session tickets are enabled
+  bool Create(const cWebServerOptions& options, const cTLSSessionTicketKey& shared_ticket_key);
+  void Destroy();
+
+  void EnableForSession(gnutls_session_t session) const;
+
+  void CountHandshake(gnutls_session_t session);
+  cTLSSessionCounters GetCounters() const;
+
+private:
+  bool enabled;
+  gnutls_datum_t ticket_key; // Our copy of the shared key used to encrypt the session tickets
+  unsigned int lifetime_seconds;
+
+  std::atomic<uint64_t> full_handshakes;
+  std::atomic<uint64_t> resumed_handshakes;
+};
+
+}
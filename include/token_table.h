@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tasktracker {
+
+// ** cTokenTable
+//
+// Maps the tokens we accept to their index in the list they were created from
+// The table is built once at start up, lookups hash the token once and compare it against at most a few stored tokens without allocating
+//
+class cTokenTable {
+public:
+  static constexpr size_t npos = SIZE_MAX;
+
+  cTokenTable();
+
+  bool Create(const std::vector<std::string>& tokens);
+  void Clear();
+
+  size_t size() const { return tokens.size(); }
+
+  // Returns the index of the token, or npos if it is not in the table
+  size_t Find(std::string_view token) const;
+
+private:
+  static constexpr uint32_t EMPTY = UINT32_MAX;
+
+  size_t mask; // The number of slots minus one, the number of slots is a power of two
+  std::vector<std::string> tokens;
+  std::vector<uint32_t> slots; // Index into tokens, or EMPTY
+};
+
+}
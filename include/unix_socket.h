@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+namespace tasktracker {
+
+// Create a Unix domain socket at path and start listening on it, a socket left behind by a previous run is removed first
+// The socket is readable and writable by the owner and group so that a reverse proxy in the same group can connect to it
+// Returns the socket, or -1 on error
+int OpenUnixListeningSocket(const std::string& path, unsigned int backlog);
+
+// Remove the socket from the file system, the caller closes the socket itself
+void RemoveUnixListeningSocket(const std::string& path);
+
+}
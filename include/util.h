@@ -3,6 +3,7 @@
 #include <cstdint>
 
 #include <chrono>
+#include <string>
 #include <string_view>
 
 namespace util {
@@ -13,6 +14,17 @@ inline constexpr T clamp(const T& i, const T& lower, const T& upper) noexcept
   return (i < lower) ? lower : (i > upper) ? upper : i;
 }
 
+// FNV-1a 64 bit hash, this is not a cryptographic hash, it is just for detecting changes to content and for hash tables
+inline constexpr uint64_t HashFNV1a64(std::string_view data, uint64_t offset_basis = 14695981039346656037ull) noexcept
+{
+  uint64_t hash = offset_basis;
+  for (char c : data) {
+    hash ^= uint64_t(uint8_t(c));
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
 // msleep(): Sleep for the requested number of milliseconds
 int msleep(long msec) noexcept;
 
@@ -23,6 +35,10 @@ std::chrono::system_clock::time_point GetTime() noexcept;
 // ie. "2012-03-02T04:07:34.0218628Z"
 std::string GetDateTimeUTCISO8601(std::chrono::system_clock::time_point time) noexcept;
 bool ParseDateTimeUTCISO8601(std::string_view buffer, std::chrono::system_clock::time_point& value) noexcept;
+// Get a HTTP date string (RFC 9110 IMF-fixdate)
+// ie. "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string GetDateTimeHTTP(std::chrono::system_clock::time_point time) noexcept;
+bool ParseDateTimeHTTP(std::string_view buffer, std::chrono::system_clock::time_point& value) noexcept;
 bool IsDateWithinRange(const std::chrono::system_clock::time_point& date, const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end) noexcept;
 
 std::string GetHomeFolder() noexcept;
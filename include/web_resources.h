@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "compression.h"
+#include "embedded_resources.h"
+#include "feed_cache.h"
+#include "feed_events.h"
+#include "feed_view.h"
+#include "http_headers.h"
+#include "ip_address.h"
+#include "rate_limiter.h"
+#include "token_table.h"
+#include "web_server_options.h"
+
+// What the web server serves, this is shared by each of the web server backends so that they answer requests the same way
+
+namespace tasktracker {
+
+class cFeedSnapshot;
+
+extern const std::string ATOM_FEED_MIMETYPE;
+
+// The bodies of the error responses
+extern const std::string BAD_REQUEST;
+extern const std::string UNAUTHORISED;
+extern const std::string PAGE_NOT_FOUND;
+extern const std::string METHOD_NOT_ALLOWED;
+extern const std::string TOO_MANY_REQUESTS;
+extern const std::string SERVICE_UNAVAILABLE;
+
+// The security headers that are added to every response, as name and value pairs
+const std::vector<std::pair<std::string, std::string>>& GetSecurityHeaders();
+
+// The same headers without Cache-Control, for responses that work out their own from when the feed next changes
+const std::vector<std::pair<std::string, std::string>>& GetSecurityHeadersExceptCacheControl();
+
+
+// The route table is every embedded static resource followed by the dynamic routes
+constexpr size_t FEED_ROUTE = embedded::request_paths.size();
+constexpr size_t FEED_EVENTS_ROUTE = FEED_ROUTE + 1;
+constexpr size_t ROUTE_COUNT = FEED_EVENTS_ROUTE + 1;
+
+constexpr size_t ROUTE_NOT_FOUND = SIZE_MAX;
+
+// Returns the index of the route for the path part of a url, or ROUTE_NOT_FOUND
+// NOTE: The paths are known at compile time, so this is one perfect hash lookup however many routes there are
+size_t FindRoute(std::string_view path);
+
+// Returns a mask of the methods that a route allows (See http::GetMethodBit)
+uint32_t GetRouteMethods(size_t route);
+
+
+// What to send in response to a request for the feed
+class cFeedResponse {
+public:
+  cFeedResponse();
+
+  unsigned int status_code; // 200, 304 or 401
+  util::CONTENT_ENCODING encoding;
+  std::string etag;
+  std::string last_modified;
+  std::string cache_control; // Empty if we don't know when the feed is next updated, the security headers then supply the default Cache-Control header
+  std::string expires;
+  std::shared_ptr<const cRenderedFeed> rendered; // Owns content, this is nullptr for a HEAD request when the feed hasn't been rendered yet
+  std::string_view content;
+};
+
+// ** cFeedRoute
+//
+// Serves each view of the feed, the token in the request selects the view and each view has its own render cache
+// Requests can be rate limited per client IP address and per token, the limits are checked before anything is rendered
+// The views can be replaced while we are running, requests that have already looked up their view keep using it
+//
+class cFeedRoute {
+public:
+  cFeedRoute();
+
+  // In a worker process feed_snapshot is the feed rendered by the tracker process, otherwise it is nullptr and the feed is rendered from feed_data
+  bool Create(const std::vector<cFeedView>& feed_views, const cWebServerOptions& options = cWebServerOptions(), const cFeedSnapshot* feed_snapshot = nullptr);
+
+  // Replace the views with the tokens and filters from reloaded settings, on error the current views are kept
+  // NOTE: The per token rate limits start again from full buckets
+  bool SetFeedViews(const std::vector<cFeedView>& feed_views);
+
+  // Takes a token from the client's buckets, returns true with out_retry_after_seconds set if the request should get a 429 response instead
+  // address is nullptr for a Unix domain socket where every connection comes from the reverse proxy, an invalid token is left for GetResponse to turn away
+  bool IsRateLimited(const util::cIPAddress* address, const char* token, uint32_t& out_retry_after_seconds) const;
+
+  // Returns the render cache for the view selected by token, or nullptr if the token is missing or invalid
+  std::shared_ptr<cFeedRenderCache> GetFeedRenderCache(const char* token) const;
+
+  // Returns the render cache that has to render before this request can be answered, or nullptr if the request can be answered straight away
+  // A conditional request for the version of the feed that the client already has is answered with a 304 without rendering
+  // This lets the backends render on a worker thread
+  std::shared_ptr<cFeedRenderCache> GetFeedRenderCacheIfRenderRequired(http::METHOD method, const char* token, const char* accept_encoding, const char* if_none_match, const char* if_modified_since) const;
+
+  // Work out the response, this renders the feed if it is out of date unless this is a HEAD request
+  // Each of the header values may be nullptr if the request didn't have that header
+  void GetResponse(http::METHOD method, const char* token, const char* accept_encoding, const char* if_none_match, const char* if_modified_since, cFeedResponse& out_response) const;
+
+  // Start an event stream for the view selected by token, it starts after last_event_id, or from the latest event if that is nullptr
+  // Returns nullptr with out_status_code set to 401 if the token is missing or invalid, or 404 in a worker process which doesn't get the events
+  std::unique_ptr<cFeedEventStream> CreateEventStream(const char* token, const char* last_event_id, unsigned int& out_status_code) const;
+
+private:
+  // The tokens and their views, this is never changed once it is published, a reload publishes a new one
+  class cFeedViews {
+  public:
+    cTokenTable token_table;
+    std::vector<std::shared_ptr<cFeedRenderCache>> feed_render_caches; // For each view, in the same order as the tokens in the token table
+    std::unique_ptr<util::cRateLimiter> token_rate_limiter;
+  };
+
+  std::shared_ptr<const cFeedViews> GetFeedViews() const;
+
+  const cFeedSnapshot* feed_snapshot;
+  size_t event_stream_buffer_bytes;
+  uint32_t token_rate_limit_per_minute;
+  uint32_t token_rate_limit_burst;
+
+  mutable std::mutex mutex;
+  std::shared_ptr<const cFeedViews> views;
+
+  std::unique_ptr<util::cRateLimiter> ip_rate_limiter;
+};
+
+}
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <cstdint>
+
+#include <chrono>
+#include <vector>
+
+#include "feed_view.h"
 #include "ip_address.h"
+#include "web_server_backend.h"
+#include "web_server_options.h"
+#include "worker_pool.h"
 
 namespace tasktracker {
 
-class cStaticResourcesRequestHandler;
-class cDynamicResourcesRequestHandler;
-class cWebServer;
+class cFeedRoute;
+class cFeedSnapshot;
 
 // TODO: Refactor this, it is a bit of a mess
 class cWebServerManager {
@@ -14,14 +22,32 @@ public:
   cWebServerManager();
   ~cWebServerManager();
 
-  bool Create(const util::cIPAddress& host, uint16_t port, const std::string& private_key, const std::string& public_cert, bool fuzzing, const std::string& token);
+  // Opens a backend for each endpoint, they all serve the same feed
+  // In a worker process feed_snapshot is the feed rendered by the tracker process
+  bool Create(const std::vector<cListenEndpoint>& endpoints, const std::string& private_key, const std::string& public_cert, bool fuzzing, const std::vector<cFeedView>& feed_views, const cWebServerOptions& options = cWebServerOptions(), const cFeedSnapshot* feed_snapshot = nullptr);
+  bool Create(const util::cIPAddress& host, uint16_t port, const std::string& private_key, const std::string& public_cert, bool fuzzing, const std::vector<cFeedView>& feed_views, const cWebServerOptions& options = cWebServerOptions());
+  // Stops accepting connections and waits for the requests in flight to finish, up to cWebServerOptions::shutdown_timeout_seconds, before closing every connection
   bool Destroy();
 
+  // Apply reloaded settings, the feed views are replaced and the certificate is loaded again if it has changed
+  // Connections that are already open are unaffected, if anything fails to load the current feed views and certificate are kept
+  bool Reload(const std::vector<cFeedView>& feed_views, const std::string& private_key, const std::string& public_cert);
+
+  // The listening socket of each endpoint, so that a new process can take them over
+  std::vector<int> GetListeningSockets() const;
+
+  // A new process is accepting on our listening sockets, stop accepting and leave them open for it, call Destroy to drain the open connections
+  void HandOffListeningSockets();
+
+  cTLSSessionCounters GetTLSSessionCounters() const;
+  util::cWorkerPoolCounters GetWorkerPoolCounters() const;
+
 private:
   // NOTE: We would use std::unique_ptr, but it needs to know about the destructor of the item to delete it
-  cStaticResourcesRequestHandler* static_resources_request_handler;
-  cDynamicResourcesRequestHandler* dynamic_resources_request_handler;
-  cWebServer* webserver;
+  cFeedRoute* feed_route;
+  std::vector<cWebServerBackend*> webservers; // One for each endpoint
+  bool tls; // At least one endpoint serves HTTPS
+  std::chrono::seconds shutdown_timeout;
 };
 
 }
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+#include <string>
+
+#include "tls_session_resumption.h"
+#include "web_server_options.h"
+#include "worker_pool.h"
+
+namespace tasktracker {
+
+// ** cWebServerBackend
+//
+// Accepts connections and serves the routes in web_resources.h, cWebServerManager creates the backend selected by cWebServerOptions::backend
+//
+class cWebServerBackend {
+public:
+  virtual ~cWebServerBackend() {}
+
+  virtual bool Open(const cListenEndpoint& endpoint, const std::string& private_key, const std::string& public_cert, bool fuzzing, const cWebServerOptions& options) = 0;
+
+  // Stop accepting new connections, connections that are already open are still serviced until Close is called
+  virtual void NoMoreConnections() = 0;
+
+  // Wait for the requests that have already started to finish, returns false if some are still in flight at the deadline
+  virtual bool WaitForInFlightRequests(std::chrono::steady_clock::time_point deadline) const = 0;
+  virtual size_t GetInFlightRequests() const = 0;
+
+  virtual bool Close() = 0;
+
+  // The listening socket, so that it can be handed over to a new process, or -1 if we are not listening
+  virtual int GetListeningSocket() const = 0;
+
+  // Another process is now accepting connections on the listening socket, stop accepting without shutting the socket down or removing its Unix domain socket path
+  virtual void HandOffListeningSocket() = 0;
+
+  virtual cTLSSessionCounters GetTLSSessionCounters() const = 0;
+  virtual util::cWorkerPoolCounters GetWorkerPoolCounters() const = 0;
+};
+
+}
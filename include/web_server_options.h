@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ip_address.h"
+
+namespace tasktracker {
+
+// ** cListenEndpoint
+//
+// An address and port, or a Unix domain socket, to listen on, each endpoint gets its own listening socket and backend
+// NOTE: Unix domain sockets are for a reverse proxy on the same machine that terminates TLS, so they always serve plain HTTP
+//
+class cListenEndpoint {
+public:
+  cListenEndpoint();
+  cListenEndpoint(const util::cIPAddress& address, uint16_t port);
+  explicit cListenEndpoint(const std::string& unix_socket_path);
+
+  constexpr bool IsUnixSocket() const { return !unix_socket_path.empty(); }
+
+  bool operator==(const cListenEndpoint& rhs) const = default;
+
+  util::cIPAddress address;
+  uint16_t port;
+  bool dual_stack; // Only used for the IPv6 any address "::", the socket also accepts IPv4 connections as IPv4 mapped addresses
+
+  std::string unix_socket_path; // If this is set then the address and port are not used
+
+  int listen_socket; // An already listening socket inherited from systemd or from the process we are replacing, -1 creates a new socket
+};
+
+// Parse "192.168.0.3:8443", "[2001:db8::3]:8443" or "unix:/run/task-tracker/task-tracker.sock"
+bool ParseListenEndpoint(std::string_view text, cListenEndpoint& out_endpoint);
+
+// The IPv6 any address listens dual stack unless there is also an IPv4 endpoint on the same port, the IPv4 socket would fail to bind otherwise
+void SetDualStack(std::vector<cListenEndpoint>& endpoints);
+
+// Returns the endpoint in the format that ParseListenEndpoint accepts
+std::string ToString(const cListenEndpoint& endpoint);
+
+// What accepts and services the connections
+enum class BACKEND {
+  LIBMICROHTTPD, // libmicrohttpd with the threading model below
+  IO_URING, // A single thread running an io_uring event loop, this is only available when built with the TASK_TRACKER_IO_URING CMake option
+};
+
+// Parse "libmicrohttpd" or "io_uring"
+bool ParseBackend(std::string_view text, BACKEND& out_backend);
+const char* GetBackendName(BACKEND backend);
+
+// How libmicrohttpd services connections
+enum class THREADING_MODEL {
+  SINGLE_THREAD, // One internal thread polls and services every connection
+  THREAD_POOL, // A pool of threads each running their own epoll loop, connections are spread across the pool
+  THREAD_PER_CONNECTION, // One internal thread accepts connections and each connection gets its own thread
+};
+
+// Parse "single_thread", "thread_pool" or "thread_per_connection"
+bool ParseThreadingModel(std::string_view text, THREADING_MODEL& out_threading_model);
+const char* GetThreadingModelName(THREADING_MODEL threading_model);
+
+class cWebServerOptions {
+public:
+  cWebServerOptions();
+
+  bool operator==(const cWebServerOptions& rhs) const = default;
+
+  BACKEND backend;
+
+  THREADING_MODEL threading_model;
+  size_t thread_pool_size; // Only used for THREAD_POOL, 0 uses one thread per CPU core
+
+  // The GnuTLS priority string for the HTTPS listener, this chooses the protocol versions, key exchanges and ciphers, empty uses the libmicrohttpd default
+  // https://gnutls.org/manual/html_node/Priority-Strings.html
+  std::string tls_priorities;
+
+  // TLS session resumption, clients that reconnect can skip the full handshake by presenting a session ticket from a previous connection
+  bool tls_session_tickets;
+  unsigned int tls_session_lifetime_seconds; // How long a session ticket can be used for
+
+  // Connection lifecycle limits, RSS readers tend to keep idle keep-alive connections open between polls so these stop them from pinning threads and memory
+  unsigned int connection_timeout_seconds; // Idle connections are closed after this long without any activity
+  unsigned int connection_limit; // The maximum number of simultaneous connections in total
+  unsigned int per_ip_connection_limit; // The maximum number of simultaneous connections from a single IP address
+  size_t connection_memory_limit_bytes; // The memory pool for each connection, this holds the request headers and the read and write buffers
+  unsigned int listen_backlog; // The number of pending connections the kernel queues before the server accepts them
+  unsigned int shutdown_timeout_seconds; // When shutting down, the longest we wait for the requests in flight to finish before closing their connections
+
+  // Clients are checked against these networks when they connect, before the TLS handshake, the most specific matching network wins
+  // If allow_networks is empty every client is allowed unless it is in deny_networks, otherwise only clients in allow_networks are allowed
+  // NOTE: Connections on a Unix domain socket come from the reverse proxy, so they are not checked
+  std::vector<util::cIPNetwork> allow_networks;
+  std::vector<util::cIPNetwork> deny_networks;
+
+  // Slow work such as rendering the feed runs on a pool of worker threads instead of the threads that service connections
+  size_t worker_threads; // 0 does the slow work inline
+  size_t worker_queue_limit; // When this many jobs are waiting new requests that need slow work get a 503 response
+
+  // The tracker process can start worker processes that serve the feed, each one binds the same ports and the kernel spreads the connections between them
+  size_t worker_processes; // 0 serves from the tracker process
+  bool reuse_port; // Set in each worker process so that they can all bind the same ports with SO_REUSEPORT
+
+  // Token bucket rate limits for feed requests, checked before the feed is rendered, requests over the limit get a 429 response
+  unsigned int ip_rate_limit_per_minute; // Requests from each IP address, 0 disables it
+  unsigned int ip_rate_limit_burst; // The number of requests that can be made at once before the rate applies
+  unsigned int token_rate_limit_per_minute; // Requests for each token, 0 disables it
+  unsigned int token_rate_limit_burst;
+
+  // Each /feed/events client has a buffer for the events that haven't been sent yet, a client that falls this far behind is disconnected
+  size_t event_stream_buffer_bytes;
+};
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+class cWorkerPoolCounters {
+public:
+  cWorkerPoolCounters() : queue_depth(0), peak_queue_depth(0), completed(0), rejected(0) {}
+
+  size_t queue_depth; // Jobs waiting for a worker right now
+  size_t peak_queue_depth; // The deepest the queue has been
+  uint64_t completed;
+  uint64_t rejected; // Jobs that were turned away because the queue was full
+};
+
+// ** cWorkerPool
+//
+// A fixed number of threads that run jobs from a bounded queue, this lets slow work such as rendering happen away from the threads that service connections
+// When the queue is full new jobs are rejected straight away so the caller can tell the client to come back later instead of the queue growing without limit
+//
+class cWorkerPool {
+public:
+  cWorkerPool();
+  ~cWorkerPool();
+
+  bool Create(size_t nthreads, size_t max_queue_depth);
+
+  // Runs every job that has already been queued and then stops the threads
+  void Destroy();
+
+  // NOTE: This is false as soon as Destroy starts, so it is safe to call from the threads that are still servicing connections while the pool is destroyed
+  bool IsRunning() const { return running.load(std::memory_order_acquire); }
+
+  // Queue a job to be run on a worker thread, returns false without queueing it if the queue is full or the pool is not running
+  bool TrySubmit(std::function<void()>&& job);
+
+  cWorkerPoolCounters GetCounters() const;
+
+private:
+  void Run();
+
+  size_t max_queue_depth;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv_job_queued;
+  bool stopping;
+  std::atomic<bool> running;
+  std::deque<std::function<void()>> queue;
+  cWorkerPoolCounters counters;
+
+  std::vector<std::thread> threads; // Only touched by Create and Destroy
+};
+
+}
@@ -1,8 +1,9 @@
-#include <iostream>
+#include <algorithm>
 #include <sstream>
 #include <string>
 
 #include "atom_feed.h"
+#include "log.h"
 #include "util.h"
 #include "xml_string_writer.h"
 
@@ -27,6 +28,19 @@ std::string GetRandomHexCharacters(util::cPseudoRandomNumberGenerator& rng, size
   return o.str();
 }
 
+// The Syndication module describes how often a feed is updated as a number of times per hour or per day
+// https://web.resource.org/rss/1.0/modules/syndication/
+void GetSyndicationUpdatePeriod(uint32_t update_period_minutes, std::string& out_period, uint32_t& out_frequency)
+{
+  if (update_period_minutes <= 60) {
+    out_period = "hourly";
+    out_frequency = 60 / update_period_minutes;
+  } else {
+    out_period = "daily";
+    out_frequency = std::max<uint32_t>(1, (24 * 60) / update_period_minutes);
+  }
+}
+
 }
 
 namespace feed {
@@ -51,51 +65,51 @@ bool WriteFeedXMLEntry(util::cXMLStringWriter& writer, const tasktracker::cFeedE
 {
   // Start the entry element
   if (!writer.BeginElement("entry")) {
-    std::cerr<<"Failed to start entry element"<<std::endl;
+    LOG_ERROR<<"Failed to start entry element";
     return false;
   }
 
   // Write the title element
   if (!writer.WriteElementWithContent("title", entry.title)) {
-    std::cerr<<"Failed to write title element"<<std::endl;
+    LOG_ERROR<<"Failed to write title element";
     return false;
   }
 
   // Write the link element
   if (!writer.BeginElement("link")) {
-    std::cerr<<"Failed to begin link element"<<std::endl;
+    LOG_ERROR<<"Failed to begin link element";
     return false;
   }
   if (!writer.WriteElementAttribute("href", entry.link)) {
-    std::cerr<<"Failed to add link href attribute"<<std::endl;
+    LOG_ERROR<<"Failed to add link href attribute";
     return false;
   }
   if (!writer.EndElement()) {
-    std::cerr<<"Failed to end link element"<<std::endl;
+    LOG_ERROR<<"Failed to end link element";
     return false;
   }
 
   // Write the id element
   if (!writer.WriteElementWithContent("id", entry.id)) {
-    std::cerr<<"Failed to write id element"<<std::endl;
+    LOG_ERROR<<"Failed to write id element";
     return false;
   }
 
   // TODO: Convert entry.time to the date time
   if (!writer.WriteElementWithContent("updated", util::GetDateTimeUTCISO8601(entry.date_updated))) {
-    std::cerr<<"Failed to write child XML element"<<std::endl;
+    LOG_ERROR<<"Failed to write child XML element";
     return false;
   }
 
   // Write the summary element
   if (!writer.WriteElementWithContent("summary", entry.summary)) {
-    std::cerr<<"Failed to write summary element"<<std::endl;
+    LOG_ERROR<<"Failed to write summary element";
     return false;
   }
 
   // End the entry element
   if (!writer.EndElement()) {
-    std::cerr<<"Failed to end entry element"<<std::endl;
+    LOG_ERROR<<"Failed to end entry element";
     return false;
   }
 
@@ -125,6 +139,11 @@ bool WriteFeedXMLEntry(util::cXMLStringWriter& writer, const tasktracker::cFeedE
 </feed>
 */
 bool WriteFeedXML(const tasktracker::cFeedData& feed_data, std::ostringstream& output)
+{
+  return WriteFeedXML(feed_data, tasktracker::cFeedViewFilter(), output);
+}
+
+bool WriteFeedXML(const tasktracker::cFeedData& feed_data, const tasktracker::cFeedViewFilter& filter, std::ostringstream& output)
 {
   output.clear();
 
@@ -132,87 +151,109 @@ bool WriteFeedXML(const tasktracker::cFeedData& feed_data, std::ostringstream& o
 
   // Create a new XML writer context
   if (!writer.Open()) {
-    std::cerr<<"Failed to create XML writer context"<<std::endl;
+    LOG_ERROR<<"Failed to create XML writer context";
     return false;
   }
 
   if (!writer.BeginDocument()) {
-    std::cerr<<"Failed to write XML declaration"<<std::endl;
+    LOG_ERROR<<"Failed to write XML declaration";
     return false;
   }
 
 
   // Start the feed element
   if (!writer.BeginElement("feed")) {
-    std::cerr<<"Failed to start feed element"<<std::endl;
+    LOG_ERROR<<"Failed to start feed element";
     return false;
   }
   if (!writer.WriteElementNamespace("xmlns", "http://www.w3.org/2005/Atom")) {
-    std::cerr<<"Failed to add feed namespace element"<<std::endl;
+    LOG_ERROR<<"Failed to add feed namespace element";
+    return false;
+  }
+  if ((feed_data.properties.update_period_minutes != 0) && !writer.WriteElementNamespace("xmlns:sy", "http://purl.org/rss/1.0/modules/syndication/")) {
+    LOG_ERROR<<"Failed to add syndication namespace element";
     return false;
   }
 
   // Write the title element
   if (!writer.WriteElementWithContent("title", feed_data.properties.title)) {
-    std::cerr<<"Failed to write child XML element"<<std::endl;
+    LOG_ERROR<<"Failed to write child XML element";
     return false;
   }
 
   // Write the link element
   if (!writer.BeginElement("link")) {
-    std::cerr<<"Failed to begin link element"<<std::endl;
+    LOG_ERROR<<"Failed to begin link element";
     return false;
   }
   if (!writer.WriteElementAttribute("href", feed_data.properties.link)) {
-    std::cerr<<"Failed to add link href attribute"<<std::endl;
+    LOG_ERROR<<"Failed to add link href attribute";
     return false;
   }
   if (!writer.EndElement()) {
-    std::cerr<<"Failed to end link element"<<std::endl;
+    LOG_ERROR<<"Failed to end link element";
     return false;
   }
 
   if (!writer.WriteElementWithContent("updated", util::GetDateTimeUTCISO8601(feed_data.properties.date_updated))) {
-    std::cerr<<"Failed to write child XML element"<<std::endl;
+    LOG_ERROR<<"Failed to write child XML element";
     return false;
   }
 
   // Author
   if (!writer.BeginElement("author")) {
-    std::cerr<<"Failed to start author element"<<std::endl;
+    LOG_ERROR<<"Failed to start author element";
     return false;
   }
 
   if (!writer.WriteElementWithContent("name", feed_data.properties.author_name)) {
-    std::cerr<<"Failed to write name element"<<std::endl;
+    LOG_ERROR<<"Failed to write name element";
     return false;
   }
 
   if (!writer.EndElement()) {
-    std::cerr<<"Failed to end author element"<<std::endl;
+    LOG_ERROR<<"Failed to end author element";
     return false;
   }
 
   if (!writer.WriteElementWithContent("id", feed_data.properties.id)) {
-    std::cerr<<"Failed to write id element"<<std::endl;
+    LOG_ERROR<<"Failed to write id element";
     return false;
   }
 
+  // Tell feed readers how often it is worth checking for updates
+  if (feed_data.properties.update_period_minutes != 0) {
+    std::string period;
+    uint32_t frequency = 0;
+    GetSyndicationUpdatePeriod(feed_data.properties.update_period_minutes, period, frequency);
+
+    if (
+      !writer.WriteElementWithContent("sy:updatePeriod", period) ||
+      !writer.WriteElementWithContent("sy:updateFrequency", std::to_string(frequency))
+    ) {
+      LOG_ERROR<<"Failed to write syndication update elements";
+      return false;
+    }
+  }
+
   // NOTE: We actually want to output the feed data in reverse order, new events are at the top of the feed, older items drop off the end
   const size_t nentries = feed_data.entries.size();
   for (size_t i = 0; i < nentries; i++) {
-    WriteFeedXMLEntry(writer, feed_data.entries[(nentries - i) - 1]);
+    const tasktracker::cFeedEntry& entry = feed_data.entries[(nentries - i) - 1];
+    if (filter.IsMatch(entry)) {
+      WriteFeedXMLEntry(writer, entry);
+    }
   }
  
   // End the feed element
   if (!writer.EndElement()) {
-    std::cerr<<"Failed to end feed element"<<std::endl;
+    LOG_ERROR<<"Failed to end feed element";
     return false;
   }
 
   // End the XML document
   if (!writer.EndDocument()) {
-    std::cerr<<"Failed to end document"<<std::endl;
+    LOG_ERROR<<"Failed to end document";
     return false;
   }
 
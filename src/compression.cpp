@@ -0,0 +1,153 @@
+
+#include <utility>
+
+#include <brotli/encode.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#include "compression.h"
+#include "log.h"
+
+namespace {
+
+bool CompressGzip(std::string_view input, std::string& output)
+{
+  z_stream stream {};
+
+  // NOTE: Adding 16 to the window bits gives us a gzip header and trailer instead of a zlib one
+  const int window_bits = 15 + 16;
+  const int memory_level = 9;
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, window_bits, memory_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+
+  output.resize(deflateBound(&stream, input.length()));
+
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = input.length();
+  stream.next_out = reinterpret_cast<Bytef*>(output.data());
+  stream.avail_out = output.length();
+
+  const int result = deflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return (result == Z_STREAM_END);
+}
+
+bool CompressBrotli(std::string_view input, std::string& output)
+{
+  size_t encoded_size = BrotliEncoderMaxCompressedSize(input.length());
+  if (encoded_size == 0) {
+    return false;
+  }
+
+  output.resize(encoded_size);
+
+  if (BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, input.length(), reinterpret_cast<const uint8_t*>(input.data()), &encoded_size, reinterpret_cast<uint8_t*>(output.data())) != BROTLI_TRUE) {
+    return false;
+  }
+
+  output.resize(encoded_size);
+
+  return true;
+}
+
+bool CompressZstd(std::string_view input, std::string& output)
+{
+  output.resize(ZSTD_compressBound(input.length()));
+
+  const int level = 19;
+  const size_t result = ZSTD_compress(output.data(), output.length(), input.data(), input.length(), level);
+  if (ZSTD_isError(result)) {
+    return false;
+  }
+
+  output.resize(result);
+
+  return true;
+}
+
+}
+
+namespace util {
+
+const char* GetContentEncodingName(CONTENT_ENCODING encoding)
+{
+  switch (encoding) {
+    case CONTENT_ENCODING::BROTLI: return "br";
+    case CONTENT_ENCODING::ZSTD: return "zstd";
+    case CONTENT_ENCODING::GZIP: return "gzip";
+    case CONTENT_ENCODING::IDENTITY: return "identity";
+  }
+
+  return "identity";
+}
+
+bool Compress(CONTENT_ENCODING encoding, std::string_view input, std::string& output)
+{
+  output.clear();
+
+  switch (encoding) {
+    case CONTENT_ENCODING::BROTLI: return CompressBrotli(input, output);
+    case CONTENT_ENCODING::ZSTD: return CompressZstd(input, output);
+    case CONTENT_ENCODING::GZIP: return CompressGzip(input, output);
+    case CONTENT_ENCODING::IDENTITY: {
+      output = input;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+cEncodedContent::cEncodedContent() :
+  available_encodings(GetContentEncodingBit(CONTENT_ENCODING::IDENTITY))
+{
+}
+
+bool cEncodedContent::Create(std::string_view content)
+{
+  variants[static_cast<size_t>(CONTENT_ENCODING::IDENTITY)] = content;
+  return CreateCompressedVariants(content);
+}
+
+bool cEncodedContent::Create(std::string&& content)
+{
+  std::string& identity = variants[static_cast<size_t>(CONTENT_ENCODING::IDENTITY)];
+  identity = std::move(content);
+  return CreateCompressedVariants(identity);
+}
+
+void cEncodedContent::SetVariant(CONTENT_ENCODING encoding, std::string_view content)
+{
+  variants[static_cast<size_t>(encoding)] = content;
+  available_encodings |= GetContentEncodingBit(encoding);
+}
+
+bool cEncodedContent::CreateCompressedVariants(std::string_view content)
+{
+  available_encodings = GetContentEncodingBit(CONTENT_ENCODING::IDENTITY);
+
+  bool result = true;
+
+  for (size_t i = 0; i < CONTENT_ENCODING_COUNT; i++) {
+    const CONTENT_ENCODING encoding = static_cast<CONTENT_ENCODING>(i);
+    if (encoding == CONTENT_ENCODING::IDENTITY) {
+      continue;
+    }
+
+    if (Compress(encoding, content, variants[i])) {
+      available_encodings |= GetContentEncodingBit(encoding);
+    } else {
+      LOG_ERROR<<"cEncodedContent::Create Error compressing content with "<<GetContentEncodingName(encoding);
+      variants[i].clear();
+      result = false;
+    }
+  }
+
+  return result;
+}
+
+}
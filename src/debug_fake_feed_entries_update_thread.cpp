@@ -1,12 +1,13 @@
 #include <cmath>
 
 #include <functional>
-#include <iostream>
 #include <thread>
 
 #include "atom_feed.h"
 #include "debug_fake_feed_entries_update_thread.h"
 #include "feed_data.h"
+#include "feed_events.h"
+#include "log.h"
 #include "util.h"
 
 namespace tasktracker {
@@ -18,7 +19,7 @@ public:
 
 void cDebugFakeFeedEntriesUpdateThread::MainLoop()
 {
-  std::cout<<"cDebugFakeFeedEntriesUpdateThread::MainLoop"<<std::endl;
+  LOG_INFO<<"cDebugFakeFeedEntriesUpdateThread::MainLoop";
 
   util::cPseudoRandomNumberGenerator rng;
 
@@ -50,7 +51,11 @@ void cDebugFakeFeedEntriesUpdateThread::MainLoop()
     {
       std::lock_guard<std::mutex> lock(mutex_feed_data);
       tasktracker::feed_data.entries.push_back(entry);
+      tasktracker::feed_data_generation++;
     }
+
+    // Push it to the event stream clients
+    GetFeedEventQueue().Publish({ entry });
   }
 }
 
@@ -66,21 +71,21 @@ int DebugFakeFeedEntriesUpdateRunThreadFunction(void* pData)
     return 1;
   }
 
-  std::cout<<"DebugFakeFeedEntriesUpdateRunThreadFunction Calling MainLoop"<<std::endl;
+  LOG_INFO<<"DebugFakeFeedEntriesUpdateRunThreadFunction Calling MainLoop";
   pThis->MainLoop();
-  std::cout<<"DebugFakeFeedEntriesUpdateRunThreadFunction MainLoop returned"<<std::endl;
+  LOG_INFO<<"DebugFakeFeedEntriesUpdateRunThreadFunction MainLoop returned";
 
   return 0;
 }
 
 bool DebugStartFakeFeedEntriesUpdateThread()
 {
-  std::cout<<"DebugStartFakeFeedEntriesUpdateThread"<<std::endl;
+  LOG_INFO<<"DebugStartFakeFeedEntriesUpdateThread";
 
   // Ok we have successfully connected and subscribed so now we can start the thread to read updates
   cDebugFakeFeedEntriesUpdateThread* pDebugFakeFeedEntriesUpdateThread = new cDebugFakeFeedEntriesUpdateThread;
   if (pDebugFakeFeedEntriesUpdateThread == nullptr) {
-    std::cerr<<"DebugStartFakeFeedEntriesUpdateThread Error creating DebugFakeFeedEntriesUpdate thread, returning false"<<std::endl;
+    LOG_ERROR<<"DebugStartFakeFeedEntriesUpdateThread Error creating DebugFakeFeedEntriesUpdate thread, returning false";
     return false;
   }
 
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <sstream>
+
+#include "atom_feed.h"
+#include "feed_cache.h"
+#include "feed_data.h"
+#include "feed_snapshot.h"
+#include "http_headers.h"
+#include "log.h"
+#include "util.h"
+
+namespace {
+
+// The generation starts at zero each time we start, so we mix in the start up time to avoid handing out the same ETag for different feeds after a restart
+const uint64_t etag_nonce = std::chrono::duration_cast<std::chrono::nanoseconds>(util::GetTime().time_since_epoch()).count();
+
+}
+
+namespace tasktracker {
+
+namespace {
+
+// ** cRenderingGuard
+//
+// Clears the rendering flag and wakes up the waiting requests when the render is finished, even if rendering threw
+//
+class cRenderingGuard {
+public:
+  cRenderingGuard(std::unique_lock<std::mutex>& lock, bool& rendering, std::condition_variable& cv_render_finished);
+  ~cRenderingGuard();
+
+private:
+  std::unique_lock<std::mutex>& lock;
+  bool& rendering;
+  std::condition_variable& cv_render_finished;
+};
+
+cRenderingGuard::cRenderingGuard(std::unique_lock<std::mutex>& _lock, bool& _rendering, std::condition_variable& _cv_render_finished) :
+  lock(_lock),
+  rendering(_rendering),
+  cv_render_finished(_cv_render_finished)
+{
+  rendering = true;
+}
+
+cRenderingGuard::~cRenderingGuard()
+{
+  // NOTE: The lock is released while rendering
+  if (!lock.owns_lock()) {
+    lock.lock();
+  }
+
+  rendering = false;
+  cv_render_finished.notify_all();
+}
+
+// NOTE: This requires the feed data lock to be held
+cFeedValidators CreateFeedValidators(const cFeedData& feed_data, uint64_t generation, const cFeedViewFilter& filter, uint64_t filter_hash)
+{
+  cFeedValidators validators;
+  validators.generation = generation;
+  validators.etag = http::CreateETag(util::HashFNV1a64(std::to_string(etag_nonce) + ":" + std::to_string(generation) + ":" + std::to_string(filter_hash)));
+
+  // The feed was last modified when the newest entry in this view was added, or when the feed was created if there are no entries yet
+  validators.last_modified = feed_data.properties.date_updated;
+  const size_t nentries = feed_data.entries.size();
+  for (size_t i = 0; i < nentries; i++) {
+    if (filter.IsMatch(feed_data.entries[i])) {
+      validators.last_modified = std::max(validators.last_modified, feed_data.entries[i].date_updated);
+    }
+  }
+
+  validators.last_modified_text = util::GetDateTimeHTTP(validators.last_modified);
+
+  return validators;
+}
+
+}
+
+cFeedRenderCache::cFeedRenderCache(const cFeedViewFilter& _filter) :
+  filter(_filter),
+  filter_hash(util::HashFNV1a64(_filter.GetKey())),
+  feed_snapshot(nullptr),
+  feed_snapshot_view(0),
+  rendering(false),
+  render_count(0)
+{
+}
+
+cFeedRenderCache::cFeedRenderCache(const cFeedViewFilter& _filter, const cFeedSnapshot& _feed_snapshot, size_t _feed_snapshot_view) :
+  filter(_filter),
+  filter_hash(util::HashFNV1a64(_filter.GetKey())),
+  feed_snapshot(&_feed_snapshot),
+  feed_snapshot_view(_feed_snapshot_view),
+  rendering(false),
+  render_count(0)
+{
+}
+
+uint64_t cFeedRenderCache::GetGeneration() const
+{
+  return (feed_snapshot != nullptr) ? feed_snapshot->GetGeneration() : feed_data_generation.load(std::memory_order_acquire);
+}
+
+cFeedValidators cFeedRenderCache::GetValidators() const
+{
+  const uint64_t generation = GetGeneration();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if ((rendered != nullptr) && (rendered->validators.generation >= generation)) {
+      return rendered->validators;
+    }
+  }
+
+  // The rendered feed is stale, but we can still work out the validators without rendering it
+  cFeedValidators validators;
+  if ((feed_snapshot != nullptr) && feed_snapshot->ReadValidators(feed_snapshot_view, validators)) {
+    return validators;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_feed_data);
+  return CreateFeedValidators(feed_data, feed_data_generation.load(std::memory_order_acquire), filter, filter_hash);
+}
+
+std::shared_ptr<const cRenderedFeed> cFeedRenderCache::Get()
+{
+  const uint64_t generation = GetGeneration();
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    // If we have already rendered this generation (Or a later one) then we can just return it
+    if ((rendered != nullptr) && (rendered->validators.generation >= generation)) {
+      return rendered;
+    }
+
+    // Nobody else is rendering, so it is our turn
+    if (!rendering) {
+      break;
+    }
+
+    // Someone else is already rendering the feed, wait for them to finish and then check again
+    cv_render_finished.wait(lock);
+  }
+
+  cRenderingGuard guard(lock, rendering, cv_render_finished);
+
+  // Render without holding our lock so that requests for the previous generation are not blocked
+  lock.unlock();
+  std::shared_ptr<const cRenderedFeed> new_rendered = Render();
+  lock.lock();
+
+  rendered = new_rendered;
+  render_count++;
+
+  return rendered;
+}
+
+std::shared_ptr<const cRenderedFeed> cFeedRenderCache::GetIfCurrent() const
+{
+  const uint64_t generation = GetGeneration();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if ((rendered != nullptr) && (rendered->validators.generation >= generation)) {
+    return rendered;
+  }
+
+  return nullptr;
+}
+
+uint64_t cFeedRenderCache::GetRenderCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return render_count;
+}
+
+std::shared_ptr<const cRenderedFeed> cFeedRenderCache::Render() const
+{
+  if (feed_snapshot != nullptr) {
+    // The tracker process has already rendered and compressed it, we just copy it out of the snapshot
+    std::shared_ptr<const cRenderedFeed> copied = feed_snapshot->Read(feed_snapshot_view);
+    if (copied != nullptr) {
+      return copied;
+    }
+
+    // The tracker process publishes the feed before it starts the worker processes, so this should never happen
+    LOG_ERROR<<"cFeedRenderCache::Render Nothing has been published to the feed snapshot, rendering it in this process";
+  }
+
+  std::shared_ptr<cRenderedFeed> new_rendered = std::make_shared<cRenderedFeed>();
+
+  std::ostringstream output;
+  {
+    std::lock_guard<std::mutex> lock(mutex_feed_data);
+
+    // NOTE: We read the generation while holding the feed data lock so that it matches the data we render
+    new_rendered->validators = CreateFeedValidators(feed_data, feed_data_generation.load(std::memory_order_acquire), filter, filter_hash);
+    feed::WriteFeedXML(feed_data, filter, output);
+  }
+
+  // Compress it once here so that each request only has to pick a variant
+  // NOTE: The rendered buffer is moved out of the stream and becomes the identity variant, the responses then share it without copying
+  new_rendered->content.Create(std::move(output).str());
+
+  return new_rendered;
+}
+
+}
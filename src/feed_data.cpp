@@ -8,6 +8,7 @@
 #include "atom_feed.h"
 #include "feed_data.h"
 #include "json.h"
+#include "log.h"
 #include "random.h"
 #include "util.h"
 
@@ -17,6 +18,38 @@ const std::string feed_data_json_file = "feed_data/feed.json";
 
 std::mutex mutex_feed_data;
 cFeedData feed_data;
+std::atomic<uint64_t> feed_data_generation = 0;
+
+namespace {
+
+std::atomic<int64_t> next_feed_update_ms = 0; // Milliseconds since the epoch, 0 until the tracker thread schedules a poll
+
+}
+
+cFeedProperties::cFeedProperties() :
+  update_period_minutes(0)
+{
+}
+
+cFeedEntry::cFeedEntry() :
+  high_priority(false)
+{
+}
+
+void SetNextFeedUpdate(std::chrono::system_clock::time_point next_update)
+{
+  next_feed_update_ms.store(std::chrono::duration_cast<std::chrono::milliseconds>(next_update.time_since_epoch()).count(), std::memory_order_release);
+}
+
+std::optional<std::chrono::system_clock::time_point> GetNextFeedUpdate()
+{
+  const int64_t ms = next_feed_update_ms.load(std::memory_order_acquire);
+  if (ms == 0) {
+    return std::nullopt;
+  }
+
+  return std::chrono::system_clock::time_point(std::chrono::milliseconds(ms));
+}
 
 bool LoadFeedDataFromFile(const std::string& external_url)
 {
@@ -34,19 +67,21 @@ bool LoadFeedDataFromFile(const std::string& external_url)
     // Clear the feed entries
     feed_data.entries.clear();
 
+    feed_data_generation++;
+
 
     // Load the feed json file, this is best effort, if it doesn't exist or has an error that is ok
     const size_t nMaxFileSizeBytes = 20 * 1024;
     std::string contents;
     if (!util::ReadFileIntoString(feed_data_json_file, nMaxFileSizeBytes, contents)) {
-      std::cerr<<"File \""<<feed_data_json_file<<"\" not found"<<std::endl;
+      LOG_ERROR<<"File \""<<feed_data_json_file<<"\" not found";
       return false;
     }
 
 
     json::cJSONDocument document(json_tokener_parse(contents.c_str()));
     if (!document.IsValid()) {
-      std::cerr<<"Invalid JSON config \""<<feed_data_json_file<<"\""<<std::endl;
+      LOG_ERROR<<"Invalid JSON config \""<<feed_data_json_file<<"\"";
       return false;
     }
 
@@ -88,7 +123,18 @@ bool LoadFeedDataFromFile(const std::string& external_url)
 
           json::JSONParseString(item, "id", entry.id);
 
-          std::cout<<"Adding entry "<<entry.title<<std::endl;
+          // These were added later so they may not be present (Optional)
+          if (json_object_object_get(item, "high_priority") != nullptr) {
+            json::JSONParseBool(item, "high_priority", entry.high_priority);
+          }
+          if (json_object_object_get(item, "project") != nullptr) {
+            json::JSONParseString(item, "project", entry.project);
+          }
+          if (json_object_object_get(item, "labels") != nullptr) {
+            json::JSONParseStringArray(item, "labels", entry.labels);
+          }
+
+          LOG_INFO<<"Adding entry "<<entry.title;
           feed_data.entries.push_back(entry);
         }
       }
@@ -104,7 +150,7 @@ bool SaveFeedDataToFile()
   if (!std::filesystem::exists("feed_data")) {
     std::error_code ec;
     if (!std::filesystem::create_directory("feed_data", ec)) {
-      std::cerr<<"SaveFeedDataToFile Error creating directory feed_data"<<std::endl;
+      LOG_ERROR<<"SaveFeedDataToFile Error creating directory feed_data";
       return false;
     }
   }
@@ -141,6 +187,15 @@ bool SaveFeedDataToFile()
 
     json_object_object_add(obj_entry, "id", json_object_new_string(entry.id.c_str()));
 
+    json_object_object_add(obj_entry, "high_priority", json_object_new_boolean(entry.high_priority));
+    json_object_object_add(obj_entry, "project", json_object_new_string(entry.project.c_str()));
+
+    struct json_object* labels = json_object_new_array();
+    for (auto&& label : entry.labels) {
+      json_object_array_add(labels, json_object_new_string(label.c_str()));
+    }
+    json_object_object_add(obj_entry, "labels", labels);
+
 	  json_object_array_add(entries, obj_entry);
   }
 	json_object_object_add(jobj, "entries", entries);
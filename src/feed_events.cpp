@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+#include "feed_events.h"
+#include "json.h"
+#include "log.h"
+#include "util.h"
+
+namespace tasktracker {
+
+const std::string EVENT_STREAM_MIMETYPE = "text/event-stream";
+
+namespace {
+
+int64_t GetTimeMS(std::chrono::system_clock::time_point time)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+// Format the entry as JSON, the event stream splits events on new lines so this must be on one line
+std::string FormatEventData(const cFeedEntry& entry)
+{
+  json::cJSONDocument document(json_object_new_object());
+  struct json_object* obj_entry = document.Get();
+
+  json_object_object_add(obj_entry, "id", json_object_new_string(entry.id.c_str()));
+  json_object_object_add(obj_entry, "title", json_object_new_string(entry.title.c_str()));
+  json_object_object_add(obj_entry, "link", json_object_new_string(entry.link.c_str()));
+  json_object_object_add(obj_entry, "summary", json_object_new_string(entry.summary.c_str()));
+  json_object_object_add(obj_entry, "date_updated", json_object_new_string(util::GetDateTimeUTCISO8601(entry.date_updated).c_str()));
+  json_object_object_add(obj_entry, "high_priority", json_object_new_boolean(entry.high_priority));
+  json_object_object_add(obj_entry, "project", json_object_new_string(entry.project.c_str()));
+
+  struct json_object* labels = json_object_new_array();
+  for (auto&& label : entry.labels) {
+    json_object_array_add(labels, json_object_new_string(label.c_str()));
+  }
+  json_object_object_add(obj_entry, "labels", labels);
+
+  // NOTE: json-c escapes new lines in strings, so the plain format is a single line
+  return json_object_to_json_string_ext(obj_entry, JSON_C_TO_STRING_PLAIN | JSON_C_TO_STRING_NOSLASHESCAPE);
+}
+
+}
+
+// ** cFeedEventQueue
+
+cFeedEventQueue::cFeedEventQueue() :
+  last_event_id(0),
+  next_listener(1)
+{
+}
+
+void cFeedEventQueue::Publish(const std::vector<cFeedEntry>& entries)
+{
+  if (entries.empty()) {
+    return;
+  }
+
+  // Format the events before taking the lock
+  std::vector<std::shared_ptr<cFeedEvent>> new_events;
+  for (auto&& entry : entries) {
+    std::shared_ptr<cFeedEvent> event = std::make_shared<cFeedEvent>();
+    event->entry = entry;
+    event->data = FormatEventData(entry);
+    new_events.push_back(event);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto&& event : new_events) {
+      // Entries published in the same millisecond, or after the clock went backwards, still get increasing IDs
+      event->id = std::max<uint64_t>(last_event_id + 1, uint64_t(std::max<int64_t>(0, GetTimeMS(event->entry.date_updated))));
+      last_event_id = event->id;
+      events.push_back(event);
+    }
+  }
+
+  // Tell the web servers
+  std::lock_guard<std::mutex> lock(mutex_listeners);
+  for (auto&& listener : listeners) {
+    listener.second();
+  }
+}
+
+uint64_t cFeedEventQueue::GetLastEventID() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return last_event_id;
+}
+
+std::vector<std::shared_ptr<const cFeedEvent>> cFeedEventQueue::GetEventsAfter(uint64_t after_event_id) const
+{
+  std::vector<std::shared_ptr<const cFeedEvent>> result;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Usually there is nothing new
+  if (after_event_id >= last_event_id) {
+    return result;
+  }
+
+  for (size_t i = 0; i < events.size(); i++) {
+    if (events[i]->id > after_event_id) {
+      result.push_back(events[i]);
+    }
+  }
+
+  return result;
+}
+
+size_t cFeedEventQueue::AddListener(std::function<void()> on_publish)
+{
+  std::lock_guard<std::mutex> lock(mutex_listeners);
+  const size_t listener = next_listener++;
+  listeners[listener] = on_publish;
+  return listener;
+}
+
+void cFeedEventQueue::RemoveListener(size_t listener)
+{
+  std::lock_guard<std::mutex> lock(mutex_listeners);
+  listeners.erase(listener);
+}
+
+void cFeedEventQueue::Clear()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  events.clear();
+  last_event_id = 0;
+}
+
+cFeedEventQueue& GetFeedEventQueue()
+{
+  static cFeedEventQueue queue;
+  return queue;
+}
+
+
+// ** cFeedEventStream
+
+cFeedEventStream::cFeedEventStream(const cFeedViewFilter& _filter, uint64_t _last_event_id, size_t _buffer_limit_bytes) :
+  filter(_filter),
+  buffer_limit_bytes(_buffer_limit_bytes),
+  last_event_id(_last_event_id)
+{
+}
+
+bool cFeedEventStream::Update(const cFeedEventQueue& queue)
+{
+  for (auto&& event : queue.GetEventsAfter(last_event_id)) {
+    last_event_id = event->id;
+
+    if (!filter.IsMatch(event->entry)) {
+      continue;
+    }
+
+    if (!Append("id: " + std::to_string(event->id) + "\nevent: entry\ndata: " + event->data + "\n\n")) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool cFeedEventStream::AddHeartbeat()
+{
+  return Append(":\n\n");
+}
+
+bool cFeedEventStream::Append(std::string_view text)
+{
+  if ((buffer.length() + text.length()) > buffer_limit_bytes) {
+    return false;
+  }
+
+  buffer.append(text);
+  return true;
+}
+
+std::string cFeedEventStream::Take()
+{
+  std::string text;
+  text.swap(buffer);
+  return text;
+}
+
+size_t cFeedEventStream::Read(char* out_data, size_t size)
+{
+  const size_t length = std::min(size, buffer.length());
+  memcpy(out_data, buffer.data(), length);
+  buffer.erase(0, length);
+  return length;
+}
+
+uint64_t ParseLastEventID(const char* last_event_id, const cFeedEventQueue& queue)
+{
+  if ((last_event_id == nullptr) || (last_event_id[0] == 0)) {
+    return queue.GetLastEventID();
+  }
+
+  uint64_t value = 0;
+  const char* end = last_event_id + strlen(last_event_id);
+  const std::from_chars_result result = std::from_chars(last_event_id, end, value);
+  if ((result.ec != std::errc()) || (result.ptr != end)) {
+    LOG_WARNING<<"ParseLastEventID Invalid Last-Event-ID \""<<last_event_id<<"\", starting from the latest event";
+    return queue.GetLastEventID();
+  }
+
+  return value;
+}
+
+}
@@ -0,0 +1,420 @@
+#include <cerrno>
+#include <cstring>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string_view>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "feed_snapshot.h"
+#include "log.h"
+#include "tls_session_resumption.h"
+#include "util.h"
+
+namespace tasktracker {
+
+namespace {
+
+const size_t MAX_ETAG_LENGTH = 64;
+const size_t MAX_TLS_SESSION_TICKET_KEY_SIZE = 64;
+
+// NOTE: The sequence is shared between processes so it has to be a plain atomic instruction, not a lock hidden inside std::atomic
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<int64_t>::is_always_lock_free);
+
+// The region is the header, then the view table, then the data for every variant of every view
+struct cSnapshotHeader {
+  std::atomic<uint64_t> sequence; // Odd while the writer is part way through a write, the generation is half of this
+  uint64_t view_count;
+  uint64_t data_size_bytes;
+  std::atomic<int64_t> next_update_ms; // When the tracker process next polls Gitlab, 0 if it isn't known, this is outside the seqlock because it changes on its own
+  uint64_t tls_session_ticket_key_size; // 0 if session tickets are disabled
+  unsigned char tls_session_ticket_key[MAX_TLS_SESSION_TICKET_KEY_SIZE];
+};
+
+struct cSnapshotView {
+  uint64_t etag_length;
+  char etag[MAX_ETAG_LENGTH];
+  int64_t last_modified_ms;
+  uint32_t available_encodings;
+  uint64_t offsets[util::CONTENT_ENCODING_COUNT]; // From the start of the data
+  uint64_t lengths[util::CONTENT_ENCODING_COUNT];
+};
+
+constexpr size_t GetRegionSizeBytes(size_t view_count, size_t data_size_bytes)
+{
+  return sizeof(cSnapshotHeader) + (view_count * sizeof(cSnapshotView)) + data_size_bytes;
+}
+
+cSnapshotHeader& GetHeader(void* region) { return *static_cast<cSnapshotHeader*>(region); }
+cSnapshotView* GetViews(void* region) { return reinterpret_cast<cSnapshotView*>(&GetHeader(region) + 1); }
+char* GetData(void* region) { return reinterpret_cast<char*>(GetViews(region) + GetHeader(region).view_count); }
+
+// Calls read with the generation until it reads a version of the region that the writer didn't change part way through
+// read returns false if what it copied doesn't make sense, which is expected if the writer changed it, we only give up if the copy was consistent
+// NOTE: Strictly speaking copying while the writer writes is a data race, but we throw away anything we copied while that happened
+template <class T>
+bool ReadConsistent(const cSnapshotHeader& header, T read)
+{
+  while (true) {
+    const uint64_t before = header.sequence.load(std::memory_order_acquire);
+    if (before == 0) {
+      // Nothing has been published yet
+      return false;
+    } else if ((before % 2) != 0) {
+      // The writer is part way through
+      sched_yield();
+      continue;
+    }
+
+    const bool valid = read(before / 2);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header.sequence.load(std::memory_order_relaxed) == before) {
+      return valid;
+    }
+  }
+}
+
+void SetValidators(const cSnapshotView& view, uint64_t generation, cFeedValidators& out_validators)
+{
+  out_validators.generation = generation;
+  out_validators.etag.assign(view.etag, view.etag_length);
+  out_validators.last_modified = std::chrono::system_clock::time_point(std::chrono::milliseconds(view.last_modified_ms));
+}
+
+}
+
+cFeedSnapshot::cFeedSnapshot() :
+  fd(-1),
+  writable(false),
+  region_size_bytes(0),
+  region(nullptr)
+{
+}
+
+cFeedSnapshot::~cFeedSnapshot()
+{
+  Close();
+}
+
+bool cFeedSnapshot::Create(size_t view_count, size_t data_size_bytes)
+{
+  Close();
+
+  // NOTE: This is not close on exec, the worker processes inherit it
+  fd = memfd_create("task-tracker-feed", 0);
+  if (fd < 0) {
+    LOG_ERROR<<"cFeedSnapshot::Create memfd_create failed "<<strerror(errno);
+    return false;
+  }
+
+  const size_t size_bytes = GetRegionSizeBytes(view_count, data_size_bytes);
+  if (ftruncate(fd, off_t(size_bytes)) != 0) {
+    LOG_ERROR<<"cFeedSnapshot::Create ftruncate failed "<<strerror(errno);
+    Close();
+    return false;
+  }
+
+  if (!Map(fd, true)) {
+    Close();
+    return false;
+  }
+
+  // The memfd starts out zeroed, so this is generation 0 with no views published
+  cSnapshotHeader* header = new (region) cSnapshotHeader;
+  header->sequence.store(0, std::memory_order_relaxed);
+  header->view_count = view_count;
+  header->data_size_bytes = data_size_bytes;
+  header->next_update_ms.store(0, std::memory_order_relaxed);
+  header->tls_session_ticket_key_size = 0;
+
+  return true;
+}
+
+bool cFeedSnapshot::Open(int _fd)
+{
+  Close();
+
+  fd = _fd;
+
+  if (!Map(fd, false)) {
+    Close();
+    return false;
+  }
+
+  const cSnapshotHeader& header = GetHeader(region);
+  if ((region_size_bytes < sizeof(cSnapshotHeader)) || (GetRegionSizeBytes(header.view_count, header.data_size_bytes) != region_size_bytes)) {
+    LOG_ERROR<<"cFeedSnapshot::Open Invalid feed snapshot";
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool cFeedSnapshot::Map(int _fd, bool _writable)
+{
+  struct stat s;
+  if (fstat(_fd, &s) != 0) {
+    LOG_ERROR<<"cFeedSnapshot::Map fstat failed "<<strerror(errno);
+    return false;
+  }
+
+  region_size_bytes = size_t(s.st_size);
+  if (region_size_bytes < sizeof(cSnapshotHeader)) {
+    LOG_ERROR<<"cFeedSnapshot::Map The feed snapshot is too small";
+    return false;
+  }
+
+  void* mapped = mmap(nullptr, region_size_bytes, PROT_READ | (_writable ? PROT_WRITE : 0), MAP_SHARED, _fd, 0);
+  if (mapped == MAP_FAILED) {
+    LOG_ERROR<<"cFeedSnapshot::Map mmap failed "<<strerror(errno);
+    return false;
+  }
+
+  region = mapped;
+  writable = _writable;
+
+  return true;
+}
+
+void cFeedSnapshot::Close()
+{
+  if (region != nullptr) {
+    munmap(region, region_size_bytes);
+    region = nullptr;
+  }
+
+  region_size_bytes = 0;
+  writable = false;
+
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
+
+bool cFeedSnapshot::SetTLSSessionTicketKey(const cTLSSessionTicketKey& key)
+{
+  if ((region == nullptr) || !writable) {
+    return false;
+  }
+
+  const gnutls_datum_t& data = key.Get();
+  if (!key.IsValid() || (data.size > MAX_TLS_SESSION_TICKET_KEY_SIZE)) {
+    LOG_ERROR<<"cFeedSnapshot::SetTLSSessionTicketKey Invalid session ticket key";
+    return false;
+  }
+
+  cSnapshotHeader& header = GetHeader(region);
+  memcpy(header.tls_session_ticket_key, data.data, data.size);
+  header.tls_session_ticket_key_size = data.size;
+
+  return true;
+}
+
+bool cFeedSnapshot::GetTLSSessionTicketKey(cTLSSessionTicketKey& out_key) const
+{
+  out_key.Clear();
+
+  if (region == nullptr) {
+    return false;
+  }
+
+  const cSnapshotHeader& header = GetHeader(region);
+  if ((header.tls_session_ticket_key_size == 0) || (header.tls_session_ticket_key_size > MAX_TLS_SESSION_TICKET_KEY_SIZE)) {
+    return false;
+  }
+
+  return out_key.Set(header.tls_session_ticket_key, header.tls_session_ticket_key_size);
+}
+
+size_t cFeedSnapshot::GetViewCount() const
+{
+  return (region != nullptr) ? GetHeader(region).view_count : 0;
+}
+
+bool cFeedSnapshot::Publish(const std::vector<std::shared_ptr<const cRenderedFeed>>& rendered_views)
+{
+  if (!writable) {
+    LOG_ERROR<<"cFeedSnapshot::Publish The feed snapshot is read only";
+    return false;
+  }
+
+  cSnapshotHeader& header = GetHeader(region);
+  if (rendered_views.size() != header.view_count) {
+    LOG_ERROR<<"cFeedSnapshot::Publish Expected "<<header.view_count<<" views, got "<<rendered_views.size();
+    return false;
+  }
+
+  // Check that everything fits before we start so that a failed publish leaves the previous generation in place
+  size_t total_size_bytes = 0;
+  for (auto&& rendered : rendered_views) {
+    if ((rendered == nullptr) || (rendered->validators.etag.length() > MAX_ETAG_LENGTH)) {
+      LOG_ERROR<<"cFeedSnapshot::Publish Invalid rendered feed";
+      return false;
+    }
+
+    for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+      const util::CONTENT_ENCODING encoding = static_cast<util::CONTENT_ENCODING>(i);
+      if ((rendered->content.GetAvailableEncodings() & util::GetContentEncodingBit(encoding)) != 0) {
+        total_size_bytes += rendered->content.Get(encoding).size();
+      }
+    }
+  }
+
+  if (total_size_bytes > header.data_size_bytes) {
+    LOG_ERROR<<"cFeedSnapshot::Publish The feed is "<<total_size_bytes<<" bytes, which doesn't fit in the "<<header.data_size_bytes<<" byte feed snapshot";
+    return false;
+  }
+
+  // Readers that see the odd sequence wait, readers that already started will see that it changed and copy again
+  const uint64_t sequence = header.sequence.load(std::memory_order_relaxed);
+  header.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  cSnapshotView* views = GetViews(region);
+  char* data = GetData(region);
+  size_t offset = 0;
+
+  for (size_t v = 0; v < rendered_views.size(); v++) {
+    const cRenderedFeed& rendered = *rendered_views[v];
+    cSnapshotView& view = views[v];
+
+    view.etag_length = rendered.validators.etag.length();
+    memcpy(view.etag, rendered.validators.etag.data(), view.etag_length);
+    view.last_modified_ms = std::chrono::duration_cast<std::chrono::milliseconds>(rendered.validators.last_modified.time_since_epoch()).count();
+    view.available_encodings = rendered.content.GetAvailableEncodings();
+
+    for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+      const util::CONTENT_ENCODING encoding = static_cast<util::CONTENT_ENCODING>(i);
+      if ((view.available_encodings & util::GetContentEncodingBit(encoding)) == 0) {
+        view.offsets[i] = 0;
+        view.lengths[i] = 0;
+        continue;
+      }
+
+      const std::string& content = rendered.content.Get(encoding);
+      memcpy(data + offset, content.data(), content.size());
+      view.offsets[i] = offset;
+      view.lengths[i] = content.size();
+      offset += content.size();
+    }
+  }
+
+  header.sequence.store(sequence + 2, std::memory_order_release);
+
+  return true;
+}
+
+uint64_t cFeedSnapshot::GetGeneration() const
+{
+  return (region != nullptr) ? (GetHeader(region).sequence.load(std::memory_order_acquire) / 2) : 0;
+}
+
+void cFeedSnapshot::SetNextUpdate(std::chrono::system_clock::time_point next_update)
+{
+  if ((region == nullptr) || !writable) {
+    LOG_ERROR<<"cFeedSnapshot::SetNextUpdate The feed snapshot is not writable";
+    return;
+  }
+
+  const int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(next_update.time_since_epoch()).count();
+  GetHeader(region).next_update_ms.store(ms, std::memory_order_relaxed);
+}
+
+std::optional<std::chrono::system_clock::time_point> cFeedSnapshot::GetNextUpdate() const
+{
+  if (region == nullptr) {
+    return std::nullopt;
+  }
+
+  const int64_t ms = GetHeader(region).next_update_ms.load(std::memory_order_relaxed);
+  if (ms == 0) {
+    return std::nullopt;
+  }
+
+  return std::chrono::system_clock::time_point(std::chrono::milliseconds(ms));
+}
+
+bool cFeedSnapshot::ReadValidators(size_t view, cFeedValidators& out_validators) const
+{
+  if ((region == nullptr) || (view >= GetHeader(region).view_count)) {
+    return false;
+  }
+
+  const cSnapshotView* views = GetViews(region);
+
+  const bool result = ReadConsistent(GetHeader(region), [&](uint64_t generation) {
+    cSnapshotView copy;
+    memcpy(&copy, &views[view], sizeof(copy));
+    if (copy.etag_length > MAX_ETAG_LENGTH) {
+      return false;
+    }
+
+    SetValidators(copy, generation, out_validators);
+    return true;
+  });
+
+  if (result) {
+    out_validators.last_modified_text = util::GetDateTimeHTTP(out_validators.last_modified);
+  }
+
+  return result;
+}
+
+std::shared_ptr<const cRenderedFeed> cFeedSnapshot::Read(size_t view) const
+{
+  if ((region == nullptr) || (view >= GetHeader(region).view_count)) {
+    return nullptr;
+  }
+
+  const cSnapshotView* views = GetViews(region);
+  const char* data = GetData(region);
+  const size_t data_size_bytes = GetHeader(region).data_size_bytes;
+
+  std::shared_ptr<cRenderedFeed> rendered;
+
+  const bool result = ReadConsistent(GetHeader(region), [&](uint64_t generation) {
+    cSnapshotView copy;
+    memcpy(&copy, &views[view], sizeof(copy));
+    if (copy.etag_length > MAX_ETAG_LENGTH) {
+      return false;
+    }
+
+    rendered = std::make_shared<cRenderedFeed>();
+    SetValidators(copy, generation, rendered->validators);
+
+    for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+      const util::CONTENT_ENCODING encoding = static_cast<util::CONTENT_ENCODING>(i);
+      if ((copy.available_encodings & util::GetContentEncodingBit(encoding)) == 0) {
+        continue;
+      }
+
+      // A torn copy of the view could point anywhere
+      if ((copy.offsets[i] > data_size_bytes) || (copy.lengths[i] > (data_size_bytes - copy.offsets[i]))) {
+        return false;
+      }
+
+      rendered->content.SetVariant(encoding, std::string_view(data + copy.offsets[i], copy.lengths[i]));
+    }
+
+    return true;
+  });
+
+  if (!result) {
+    return nullptr;
+  }
+
+  rendered->validators.last_modified_text = util::GetDateTimeHTTP(rendered->validators.last_modified);
+
+  return rendered;
+}
+
+}
@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include "feed_view.h"
+
+namespace tasktracker {
+
+cFeedViewFilter::cFeedViewFilter() :
+  high_priority_only(false)
+{
+}
+
+bool cFeedViewFilter::IsEmpty() const
+{
+  return (!high_priority_only && project.empty() && labels.empty());
+}
+
+bool cFeedViewFilter::IsMatch(const cFeedEntry& entry) const
+{
+  if (high_priority_only && !entry.high_priority) {
+    return false;
+  }
+
+  if (!project.empty() && (entry.project != project)) {
+    return false;
+  }
+
+  if (!labels.empty()) {
+    auto is_wanted_label = [this](const std::string& label) {
+      return (std::find(labels.begin(), labels.end(), label) != labels.end());
+    };
+
+    if (std::none_of(entry.labels.begin(), entry.labels.end(), is_wanted_label)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::string cFeedViewFilter::GetKey() const
+{
+  std::vector<std::string> sorted_labels(labels);
+  std::sort(sorted_labels.begin(), sorted_labels.end());
+
+  // NOTE: Each field is prefixed with its length, otherwise project "a:b" would have the same key as project "a" with label "b"
+  std::string key = (high_priority_only ? "high_priority" : "all");
+  key += ":" + std::to_string(project.length()) + ":" + project;
+  for (auto&& label : sorted_labels) {
+    key += ":" + std::to_string(label.length()) + ":" + label;
+  }
+
+  return key;
+}
+
+
+cFeedView::cFeedView()
+{
+}
+
+cFeedView::cFeedView(const std::string& _name, const std::string& _token, const cFeedViewFilter& _filter) :
+  name(_name),
+  token(_token),
+  filter(_filter)
+{
+}
+
+}
@@ -6,6 +6,7 @@
 #include "gitlab_api.h"
 #include "https_socket.h"
 #include "json.h"
+#include "log.h"
 
 namespace gitlab {
 
@@ -15,7 +16,7 @@ inline bool ParseGitlabIssuesDateTimeYY_MM_SS(const std::string& buffer, std::ch
   std::istringstream ss(buffer);
   std::tm tm{};
   if (!(ss >> std::get_time(&tm, "%Y-%m-%d"))) {
-    std::cerr<<"ParseGitlabIssuesDateTimeYY_MM_SS failed"<<std::endl;
+    LOG_ERROR<<"ParseGitlabIssuesDateTimeYY_MM_SS failed";
     return false;
   }
 
@@ -27,7 +28,7 @@ bool ParseGitlabIssuesResponse(const std::string& response, std::vector<cIssue>&
 {
   json::cJSONDocument document(json_tokener_parse(response.c_str()));
   if (!document.IsValid()) {
-    std::cerr<<"ParseGitlabIssuesResponse Invalid JSON response"<<std::endl;
+    LOG_ERROR<<"ParseGitlabIssuesResponse Invalid JSON response";
     return false;
   }
 
@@ -35,7 +36,7 @@ bool ParseGitlabIssuesResponse(const std::string& response, std::vector<cIssue>&
 
   enum json_type root_type = json_object_get_type(document.Get());
   if (root_type != json_type_array) {
-    std::cerr<<"ParseGitlabIssuesResponse Root node is not an array"<<std::endl;
+    LOG_ERROR<<"ParseGitlabIssuesResponse Root node is not an array";
     return false;
   }
 
@@ -46,7 +47,7 @@ bool ParseGitlabIssuesResponse(const std::string& response, std::vector<cIssue>&
 		struct json_object* issue = json_object_array_get_idx(document.Get(), i);
     enum json_type issue_type = json_object_get_type(issue);
     if (issue_type != json_type_object) {
-      std::cerr<<"ParseGitlabIssuesResponse Issue found that is not an object"<<std::endl;
+      LOG_ERROR<<"ParseGitlabIssuesResponse Issue found that is not an object";
       return false;
     }
 
@@ -73,6 +74,19 @@ bool ParseGitlabIssuesResponse(const std::string& response, std::vector<cIssue>&
       return false;
     }
 
+    // Parse the project from the full reference, something like "home/garden#12" (Optional)
+    struct json_object* references = json_object_object_get(issue, "references");
+    if ((references != nullptr) && (json_object_object_get(references, "full") != nullptr)) {
+      if (json::JSONParseString(references, "full", value)) {
+        new_issue.project = value.substr(0, value.find('#'));
+      }
+    }
+
+    // Parse the labels (Optional)
+    if (json_object_object_get(issue, "labels") != nullptr) {
+      json::JSONParseStringArray(issue, "labels", new_issue.labels);
+    }
+
     //std::cout<<"Item: "<<new_issue.iid<<", "<<new_issue.title<<", "<<new_issue.due_date<<", "<<web_url<<std::endl;
     out_gitlab_issues.push_back(new_issue);
   }
@@ -91,13 +105,13 @@ bool QueryGitlabIssuesAPI(const tasktracker::cSettings& settings, const std::str
 
   curl::cHTTPSSocket socket;
   if (!socket.Open(URL, settings.GetGitlabHTTPSPublicCert(), settings.GetGitlabAPIToken())) {
-    std::cerr<<"QueryGitlabIssuesAPI Error connecting to server"<<std::endl;
+    LOG_ERROR<<"QueryGitlabIssuesAPI Error connecting to server";
     return false;
   }
 
   std::ostringstream o;
   if (!socket.ReadToString(o)) {
-    std::cerr<<"QueryGitlabIssuesAPI Error querying gitlab API"<<std::endl;
+    LOG_ERROR<<"QueryGitlabIssuesAPI Error querying gitlab API";
     return false;
   }
 
@@ -0,0 +1,262 @@
+#include <cctype>
+#include <cstdio>
+
+#include <array>
+
+#include "http_headers.h"
+#include "util.h"
+
+namespace {
+
+std::string_view TrimWhiteSpace(std::string_view text)
+{
+  while (!text.empty() && ((text.front() == ' ') || (text.front() == '\t'))) text.remove_prefix(1);
+  while (!text.empty() && ((text.back() == ' ') || (text.back() == '\t'))) text.remove_suffix(1);
+  return text;
+}
+
+bool IsEqualCaseInsensitive(std::string_view a, std::string_view b)
+{
+  if (a.length() != b.length()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.length(); i++) {
+    if (tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Parse a quality value like "0.5", returning it in thousandths, ie. "0.5" returns 500
+bool ParseQValue(std::string_view text, int& out_value)
+{
+  out_value = 0;
+
+  if (text.empty() || ((text[0] != '0') && (text[0] != '1'))) {
+    return false;
+  }
+
+  int value = (text[0] - '0') * 1000;
+  text.remove_prefix(1);
+
+  if (!text.empty()) {
+    if ((text[0] != '.') || (text.length() > 4)) {
+      return false;
+    }
+    text.remove_prefix(1);
+
+    int multiplier = 100;
+    for (char c : text) {
+      if ((c < '0') || (c > '9')) {
+        return false;
+      }
+      value += (c - '0') * multiplier;
+      multiplier /= 10;
+    }
+  }
+
+  if (value > 1000) {
+    return false;
+  }
+
+  out_value = value;
+  return true;
+}
+
+std::string_view RemoveWeakPrefix(std::string_view etag)
+{
+  if (etag.starts_with("W/")) etag.remove_prefix(2);
+  return etag;
+}
+
+}
+
+namespace http {
+
+METHOD ParseMethod(std::string_view text)
+{
+  if (text == "GET") return METHOD::GET;
+  else if (text == "HEAD") return METHOD::HEAD;
+  else if (text == "POST") return METHOD::POST;
+  else if (text == "PUT") return METHOD::PUT;
+  else if (text == "DELETE") return METHOD::DELETE;
+  else if (text == "PATCH") return METHOD::PATCH;
+  else if (text == "OPTIONS") return METHOD::OPTIONS;
+
+  return METHOD::UNKNOWN;
+}
+
+const char* GetMethodName(METHOD method)
+{
+  switch (method) {
+    case METHOD::GET: return "GET";
+    case METHOD::HEAD: return "HEAD";
+    case METHOD::POST: return "POST";
+    case METHOD::PUT: return "PUT";
+    case METHOD::DELETE: return "DELETE";
+    case METHOD::PATCH: return "PATCH";
+    case METHOD::OPTIONS: return "OPTIONS";
+    case METHOD::UNKNOWN: break;
+  }
+
+  return "UNKNOWN";
+}
+
+std::string CreateAllowHeader(uint32_t methods)
+{
+  std::string allow;
+
+  for (METHOD method : { METHOD::GET, METHOD::HEAD, METHOD::POST, METHOD::PUT, METHOD::DELETE, METHOD::PATCH, METHOD::OPTIONS }) {
+    if ((methods & GetMethodBit(method)) != 0) {
+      if (!allow.empty()) {
+        allow += ", ";
+      }
+      allow += GetMethodName(method);
+    }
+  }
+
+  return allow;
+}
+
+std::string CreateETag(uint64_t value)
+{
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), "\"%016llx\"", static_cast<unsigned long long>(value));
+  return buffer;
+}
+
+std::string CreateETagForEncoding(std::string_view etag, util::CONTENT_ENCODING encoding)
+{
+  if ((encoding == util::CONTENT_ENCODING::IDENTITY) || (etag.length() < 2) || (etag.back() != '"')) {
+    return std::string(etag);
+  }
+
+  std::string result(etag.substr(0, etag.length() - 1));
+  result += "-";
+  result += util::GetContentEncodingName(encoding);
+  result += "\"";
+  return result;
+}
+
+bool IsETagInList(std::string_view if_none_match, std::string_view etag)
+{
+  if (etag.empty()) {
+    return false;
+  }
+
+  const std::string_view opaque_etag = RemoveWeakPrefix(etag);
+
+  // Parse a comma separated list of etags, ie. "\"abc\", W/\"def\"" or "*"
+  while (!if_none_match.empty()) {
+    const size_t comma = if_none_match.find(',');
+    const std::string_view item = TrimWhiteSpace(if_none_match.substr(0, comma));
+
+    if ((item == "*") || (RemoveWeakPrefix(item) == opaque_etag)) {
+      return true;
+    }
+
+    if (comma == std::string_view::npos) {
+      break;
+    }
+
+    if_none_match.remove_prefix(comma + 1);
+  }
+
+  return false;
+}
+
+bool IsNotModified(const char* if_none_match, const char* if_modified_since, std::string_view etag, const std::optional<std::chrono::system_clock::time_point>& last_modified)
+{
+  if (if_none_match != nullptr) {
+    return IsETagInList(if_none_match, etag);
+  }
+
+  if ((if_modified_since != nullptr) && last_modified.has_value()) {
+    // NOTE: HTTP dates only have a resolution of seconds
+    std::chrono::system_clock::time_point since;
+    if (util::ParseDateTimeHTTP(if_modified_since, since)) {
+      return (std::chrono::floor<std::chrono::seconds>(*last_modified) <= since);
+    }
+  }
+
+  return false;
+}
+
+util::CONTENT_ENCODING ChooseContentEncoding(const char* accept_encoding, uint32_t available_encodings)
+{
+  if (accept_encoding == nullptr) {
+    return util::CONTENT_ENCODING::IDENTITY;
+  }
+
+  // The quality value for each encoding in thousandths, -1 means it was not mentioned
+  std::array<int, util::CONTENT_ENCODING_COUNT> qualities;
+  qualities.fill(-1);
+  int wildcard_quality = -1;
+
+  // Parse a list like "gzip, deflate, br;q=0.9, *;q=0"
+  std::string_view text(accept_encoding);
+  while (!text.empty()) {
+    const size_t comma = text.find(',');
+    std::string_view item = TrimWhiteSpace(text.substr(0, comma));
+
+    int quality = 1000;
+    const size_t semicolon = item.find(';');
+    if (semicolon != std::string_view::npos) {
+      const std::string_view parameter = TrimWhiteSpace(item.substr(semicolon + 1));
+      if ((parameter.length() >= 2) && IsEqualCaseInsensitive(parameter.substr(0, 2), "q=")) {
+        if (!ParseQValue(parameter.substr(2), quality)) {
+          quality = 0;
+        }
+      }
+      item = TrimWhiteSpace(item.substr(0, semicolon));
+    }
+
+    if (item == "*") {
+      wildcard_quality = quality;
+    } else if (IsEqualCaseInsensitive(item, "x-gzip")) {
+      qualities[static_cast<size_t>(util::CONTENT_ENCODING::GZIP)] = quality;
+    } else {
+      for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+        if (IsEqualCaseInsensitive(item, util::GetContentEncodingName(static_cast<util::CONTENT_ENCODING>(i)))) {
+          qualities[i] = quality;
+          break;
+        }
+      }
+    }
+
+    if (comma == std::string_view::npos) {
+      break;
+    }
+
+    text.remove_prefix(comma + 1);
+  }
+
+  // Pick the available encoding with the highest quality, the encodings are in order of our preference so the first one wins a tie
+  util::CONTENT_ENCODING best_encoding = util::CONTENT_ENCODING::IDENTITY;
+  int best_quality = 0;
+
+  for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+    const util::CONTENT_ENCODING encoding = static_cast<util::CONTENT_ENCODING>(i);
+    if ((available_encodings & util::GetContentEncodingBit(encoding)) == 0) {
+      continue;
+    }
+
+    int quality = (qualities[i] != -1) ? qualities[i] : wildcard_quality;
+    if ((quality == -1) && (encoding == util::CONTENT_ENCODING::IDENTITY)) {
+      // The identity encoding is acceptable unless it is specifically excluded, but only as a last resort
+      quality = 1;
+    }
+
+    if (quality > best_quality) {
+      best_encoding = encoding;
+      best_quality = quality;
+    }
+  }
+
+  return best_encoding;
+}
+
+}
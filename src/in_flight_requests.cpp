@@ -0,0 +1,43 @@
+#include "in_flight_requests.h"
+#include "log.h"
+
+namespace tasktracker {
+
+cInFlightRequests::cInFlightRequests() :
+  count(0)
+{
+}
+
+void cInFlightRequests::Started()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  count++;
+}
+
+void cInFlightRequests::Completed()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (count == 0) {
+    LOG_ERROR<<"cInFlightRequests::Completed More requests completed than started";
+    return;
+  }
+
+  count--;
+  if (count == 0) {
+    cv_idle.notify_all();
+  }
+}
+
+size_t cInFlightRequests::Get() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return count;
+}
+
+bool cInFlightRequests::WaitUntilIdle(std::chrono::steady_clock::time_point deadline) const
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  return cv_idle.wait_until(lock, deadline, [this]() { return (count == 0); });
+}
+
+}
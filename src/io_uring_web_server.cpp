@@ -0,0 +1,1862 @@
+#include "io_uring_web_server.h"
+#include "log.h"
+
+#ifdef TASK_TRACKER_IO_URING
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gnutls/gnutls.h>
+
+#include <liburing.h>
+
+#include "compression.h"
+#include "embedded_resources.h"
+#include "feed_events.h"
+#include "http_headers.h"
+#include "in_flight_requests.h"
+#include "ip_address_filter.h"
+#include "tls_certificate_store.h"
+#include "unix_socket.h"
+#include "util.h"
+
+namespace tasktracker {
+
+namespace {
+
+const unsigned int QUEUE_DEPTH = 512;
+
+// The receive buffers are provided to the kernel up front in a buffer ring, each multishot receive picks the next free buffer so idle connections don't hold a buffer each
+const unsigned int BUFFER_GROUP_ID = 0;
+const unsigned int BUFFER_COUNT = 512; // Must be a power of 2
+const unsigned int BUFFER_SIZE = 4096;
+
+const size_t TLS_RECORD_SIZE = 16 * 1024;
+
+// What a completion is for, this is stored in the low bits of the user data, the rest is the connection pointer
+enum class OPERATION : uint64_t {
+  ACCEPT = 1,
+  WAKE = 2,
+  TIMER = 3,
+  RECEIVE = 4,
+  SEND = 5,
+  CANCEL = 6,
+};
+
+const uint64_t OPERATION_MASK = 0x7;
+
+uint64_t CreateUserData(const void* object, OPERATION operation)
+{
+  return reinterpret_cast<uint64_t>(object) | static_cast<uint64_t>(operation);
+}
+
+const char* GetStatusText(unsigned int status_code)
+{
+  switch (status_code) {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 429: return "Too Many Requests";
+    case 431: return "Request Header Fields Too Large";
+    case 503: return "Service Unavailable";
+  }
+
+  return "Unknown";
+}
+
+bool IsHeaderName(std::string_view name, std::string_view expected)
+{
+  return (name.length() == expected.length()) && std::equal(name.begin(), name.end(), expected.begin(), [](char a, char b) {
+    return (tolower(static_cast<unsigned char>(a)) == b);
+  });
+}
+
+bool HasConnectionOption(std::string_view value, std::string_view option)
+{
+  // The Connection header is a comma separated list of options, ie. "keep-alive, Upgrade"
+  while (!value.empty()) {
+    const size_t comma = value.find(',');
+    std::string_view item = value.substr(0, comma);
+    while (!item.empty() && ((item.front() == ' ') || (item.front() == '\t'))) item.remove_prefix(1);
+    while (!item.empty() && ((item.back() == ' ') || (item.back() == '\t'))) item.remove_suffix(1);
+    if (IsHeaderName(item, option)) {
+      return true;
+    }
+
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    value.remove_prefix(comma + 1);
+  }
+
+  return false;
+}
+
+int HexDigitValue(char c)
+{
+  if ((c >= '0') && (c <= '9')) return c - '0';
+  else if ((c >= 'a') && (c <= 'f')) return 10 + (c - 'a');
+  else if ((c >= 'A') && (c <= 'F')) return 10 + (c - 'A');
+  return -1;
+}
+
+// Find an argument in a query string and percent decode it, ie. "token" in "token=abc&x=1"
+bool GetQueryArgument(std::string_view query, std::string_view name, std::string& out_value)
+{
+  while (!query.empty()) {
+    const size_t ampersand = query.find('&');
+    const std::string_view argument = query.substr(0, ampersand);
+    const size_t equals = argument.find('=');
+    if (argument.substr(0, equals) == name) {
+      const std::string_view value = (equals != std::string_view::npos) ? argument.substr(equals + 1) : std::string_view();
+
+      out_value.clear();
+      for (size_t i = 0; i < value.length(); i++) {
+        if ((value[i] == '%') && ((i + 2) < value.length()) && (HexDigitValue(value[i + 1]) >= 0) && (HexDigitValue(value[i + 2]) >= 0)) {
+          out_value.push_back(static_cast<char>((HexDigitValue(value[i + 1]) << 4) | HexDigitValue(value[i + 2])));
+          i += 2;
+        } else if (value[i] == '+') {
+          out_value.push_back(' ');
+        } else {
+          out_value.push_back(value[i]);
+        }
+      }
+      return true;
+    }
+
+    if (ampersand == std::string_view::npos) {
+      break;
+    }
+    query.remove_prefix(ampersand + 1);
+  }
+
+  return false;
+}
+
+}
+
+// ** cIOUringRequest
+//
+// The request headers that we use, and what we sent for the access log
+//
+class cIOUringRequest {
+public:
+  cIOUringRequest();
+
+  void Clear();
+
+  std::chrono::steady_clock::time_point start_time;
+  std::string method;
+  std::string url;
+  http::METHOD request_method;
+  bool has_accept_encoding;
+  std::string accept_encoding;
+  bool has_if_none_match;
+  std::string if_none_match;
+  bool has_if_modified_since;
+  std::string if_modified_since;
+  bool has_last_event_id;
+  std::string last_event_id;
+
+  bool has_cache_control; // The response has its own Cache-Control header instead of the one in the security headers
+  unsigned int status_code;
+  size_t content_length;
+  util::CONTENT_ENCODING encoding;
+};
+
+cIOUringRequest::cIOUringRequest()
+{
+  Clear();
+}
+
+void cIOUringRequest::Clear()
+{
+  method.clear();
+  url.clear();
+  request_method = http::METHOD::UNKNOWN;
+  has_accept_encoding = false;
+  accept_encoding.clear();
+  has_if_none_match = false;
+  if_none_match.clear();
+  has_if_modified_since = false;
+  if_modified_since.clear();
+  has_last_event_id = false;
+  last_event_id.clear();
+  has_cache_control = false;
+  status_code = 0;
+  content_length = 0;
+  encoding = util::CONTENT_ENCODING::IDENTITY;
+}
+
+// ** cIOUringConnection
+//
+// A client connection, this is owned by the event loop thread and freed once it is closed and has no operations in flight
+//
+class cIOUringConnection {
+public:
+  explicit cIOUringConnection(int fd);
+
+  int fd;
+  char client_address[INET6_ADDRSTRLEN];
+  bool has_address; // False for a Unix domain socket
+  util::cIPAddress address; // For the rate limits
+  std::chrono::steady_clock::time_point last_activity;
+
+  bool closing;
+  bool receive_pending;
+  bool receive_starved; // The last receive ran out of provided buffers, it is started again on the next timer tick
+  bool send_pending;
+  bool response_pending; // The next request isn't parsed until the response to this one has been sent
+  bool close_after_response;
+
+  std::string received; // Plain text that hasn't been parsed yet
+  cIOUringRequest request;
+
+  // What is being sent, the headers and then the body
+  // NOTE: With TLS the headers are the cipher text and there is no body
+  std::string send_headers;
+  std::string_view send_body;
+  std::shared_ptr<const void> send_body_owner; // Keeps the body alive until it has been sent
+  size_t send_offset;
+  struct iovec send_iov[2];
+  struct msghdr send_msg;
+
+  gnutls_session_t tls_session;
+  bool tls_handshake_done;
+  std::string tls_received; // Cipher text that GnuTLS hasn't read yet
+  size_t tls_received_offset;
+  std::string tls_send_queue; // Cipher text that GnuTLS has written which is waiting for the current send to finish
+
+  // The connection is streaming /feed/events, the response stays pending until the stream ends
+  std::unique_ptr<cFeedEventStream> event_stream;
+  bool event_stream_ending; // The response completes once the buffered events have been sent
+  std::chrono::steady_clock::time_point last_heartbeat;
+};
+
+cIOUringConnection::cIOUringConnection(int _fd) :
+  fd(_fd),
+  has_address(false),
+  last_activity(std::chrono::steady_clock::now()),
+  closing(false),
+  receive_pending(false),
+  receive_starved(false),
+  send_pending(false),
+  response_pending(false),
+  close_after_response(false),
+  send_offset(0),
+  tls_session(nullptr),
+  tls_handshake_done(false),
+  tls_received_offset(0),
+  event_stream_ending(false)
+{
+  strcpy(client_address, "-");
+  memset(send_iov, 0, sizeof(send_iov));
+  memset(&send_msg, 0, sizeof(send_msg));
+}
+
+
+// ** cIOUringWebServer
+//
+// Serves every connection from one thread with an io_uring event loop, the completions from each wait are handled in a batch and all of the operations they queue are submitted together by the next wait
+// Connections are accepted with a multishot accept and read with multishot receives into a provided buffer ring, responses are written with one sendmsg for the headers and the body
+// NOTE: The feed is rendered on the event loop thread when it is out of date
+//
+class cIOUringWebServer : public cWebServerBackend {
+public:
+  explicit cIOUringWebServer(const cFeedRoute& feed_route);
+  ~cIOUringWebServer();
+
+  bool Open(const cListenEndpoint& endpoint, const std::string& private_key, const std::string& public_cert, bool fuzzing, const cWebServerOptions& options) override;
+  void NoMoreConnections() override;
+  bool Close() override;
+
+  bool WaitForInFlightRequests(std::chrono::steady_clock::time_point deadline) const override;
+  size_t GetInFlightRequests() const override;
+
+  int GetListeningSocket() const override;
+  void HandOffListeningSocket() override;
+
+  cTLSSessionCounters GetTLSSessionCounters() const override;
+  util::cWorkerPoolCounters GetWorkerPoolCounters() const override;
+
+private:
+  bool OpenListeningSocket(const cListenEndpoint& endpoint, unsigned int backlog, bool reuse_port);
+  bool OpenTLS(const std::string& private_key, const std::string& public_cert, const cWebServerOptions& options);
+  void Destroy();
+
+  void Wake();
+  void Run();
+
+  struct io_uring_sqe* GetSQE();
+  void SubmitAccept();
+  void SubmitCancelAccept();
+  void SubmitWakeRead();
+  void SubmitTimer();
+  void SubmitReceive(cIOUringConnection& connection);
+  void SubmitSend(cIOUringConnection& connection);
+
+  void OnCompletion(const struct io_uring_cqe& cqe);
+  void OnAccept(const struct io_uring_cqe& cqe);
+  void OnWake();
+  void OnTimer();
+  void OnReceive(cIOUringConnection& connection, const struct io_uring_cqe& cqe);
+  void OnSend(cIOUringConnection& connection, int result);
+
+  void ReturnBuffer(uint16_t buffer_id);
+
+  bool TLSStart(cIOUringConnection& connection);
+  bool TLSReceive(cIOUringConnection& connection, std::string_view cipher_text);
+  bool TLSSend(cIOUringConnection& connection, std::string_view plain_text);
+  void StartSend(cIOUringConnection& connection);
+
+  static ssize_t _TLSPush(gnutls_transport_ptr_t ptr, const void* data, size_t size);
+  static ssize_t _TLSPull(gnutls_transport_ptr_t ptr, void* data, size_t size);
+  static int _TLSPullTimeout(gnutls_transport_ptr_t ptr, unsigned int ms);
+
+  void ProcessRequests(cIOUringConnection& connection);
+  bool ParseRequest(cIOUringConnection& connection, std::string_view head);
+  void HandleRequest(cIOUringConnection& connection, std::string_view path, std::string_view query);
+  void HandleStaticResourceRequest(cIOUringConnection& connection, size_t index);
+  void HandleFeedRequest(cIOUringConnection& connection, std::string_view query);
+  void HandleFeedEventsRequest(cIOUringConnection& connection, std::string_view query);
+
+  void UpdateEventStreams();
+  void EndEventStreams();
+  void SendEventStream(cIOUringConnection& connection);
+  void CloseOverflowedEventStream(cIOUringConnection& connection);
+
+  void QueueResponse(cIOUringConnection& connection, unsigned int status_code, std::string_view headers, std::string_view body, const std::shared_ptr<const void>& body_owner, bool content_length, util::CONTENT_ENCODING encoding);
+  void QueueErrorResponse(cIOUringConnection& connection, unsigned int status_code, const std::string& text);
+  void SetResponsePending(cIOUringConnection& connection, bool response_pending);
+  void OnResponseSent(cIOUringConnection& connection);
+  void WriteAccessLog(const cIOUringConnection& connection, bool completed) const;
+
+  void CloseConnection(cIOUringConnection& connection);
+  void FreeClosedConnections();
+
+  const std::string& GetDate();
+
+  const cFeedRoute& feed_route;
+
+  cWebServerOptions options;
+  bool fuzzing;
+
+  int listen_fd;
+  std::string unix_socket_path; // Removed when the server is destroyed
+  bool per_ip_connection_limit;
+  util::cIPAddressFilter address_filter; // Checked when a client connects, before the TLS handshake
+  int wake_fd;
+  uint64_t wake_value; // The eventfd is read into this
+  struct __kernel_timespec timer_interval;
+
+  bool ring_created;
+  struct io_uring ring;
+  struct io_uring_buf_ring* buffer_ring;
+  std::vector<char> buffers; // BUFFER_COUNT buffers of BUFFER_SIZE bytes
+
+  std::thread event_loop_thread;
+  std::atomic<bool> no_more_connections;
+  std::atomic<bool> handed_off; // Another process is accepting on the listening socket, so it must not be shut down
+  std::atomic<bool> stop;
+  std::atomic<bool> events_published; // Set by the feed event queue's listener, the event loop picks the events up when it is woken
+  size_t events_listener;
+  cInFlightRequests in_flight_requests; // The connections with a response pending
+
+  // Only used on the event loop thread
+  bool accept_pending;
+  bool stopping;
+  std::unordered_set<cIOUringConnection*> connections;
+  std::unordered_set<cIOUringConnection*> event_stream_connections; // The connections that are streaming /feed/events
+  std::vector<cIOUringConnection*> closed_connections; // Closed connections that are waiting for their operations to finish before they are freed
+  std::map<std::string, size_t> connections_per_ip;
+  uint64_t denied_connections; // Clients that address_filter turned away
+  std::string security_headers; // Every response has these
+  std::string security_headers_except_cache_control; // Or these if the response has its own Cache-Control header
+  std::string date; // The Date header, this only changes once a second
+  std::chrono::system_clock::time_point date_time;
+
+  bool tls;
+  gnutls_certificate_credentials_t tls_credentials;
+  gnutls_priority_t tls_priorities;
+  cTLSSessionResumption tls_session_resumption;
+};
+
+cIOUringWebServer::cIOUringWebServer(const cFeedRoute& _feed_route) :
+  feed_route(_feed_route),
+  fuzzing(false),
+  listen_fd(-1),
+  per_ip_connection_limit(false),
+  wake_fd(-1),
+  wake_value(0),
+  timer_interval({ 1, 0 }),
+  ring_created(false),
+  buffer_ring(nullptr),
+  no_more_connections(false),
+  handed_off(false),
+  stop(false),
+  events_published(false),
+  events_listener(0),
+  accept_pending(false),
+  stopping(false),
+  denied_connections(0),
+  tls(false),
+  tls_credentials(nullptr),
+  tls_priorities(nullptr)
+{
+  memset(&ring, 0, sizeof(ring));
+}
+
+cIOUringWebServer::~cIOUringWebServer()
+{
+  Close();
+}
+
+bool cIOUringWebServer::Open(const cListenEndpoint& endpoint, const std::string& private_key, const std::string& public_cert, bool _fuzzing, const cWebServerOptions& _options)
+{
+  options = _options;
+  fuzzing = _fuzzing;
+
+  // NOTE: Every connection on a Unix domain socket comes from the reverse proxy, so there is no per IP limit
+  per_ip_connection_limit = !fuzzing && !endpoint.IsUnixSocket();
+
+  // The same goes for the allowed and denied networks
+  address_filter.Clear();
+  if (!endpoint.IsUnixSocket()) {
+    address_filter.Create(options.allow_networks, options.deny_networks);
+    if (address_filter.IsEnabled()) {
+      LOG_INFO<<"cIOUringWebServer::Open Allowed networks "<<options.allow_networks.size()<<", denied networks "<<options.deny_networks.size();
+    }
+  }
+
+  for (auto&& header : GetSecurityHeaders()) {
+    security_headers += header.first + ": " + header.second + "\r\n";
+  }
+  for (auto&& header : GetSecurityHeadersExceptCacheControl()) {
+    security_headers_except_cache_control += header.first + ": " + header.second + "\r\n";
+  }
+
+  // Ask for the task work to be run when we wait instead of interrupting us, and keep submitting the rest of a batch if one operation fails
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+  int result = io_uring_queue_init_params(QUEUE_DEPTH, &ring, &params);
+  if (result == -EINVAL) {
+    // Older kernels don't have these flags
+    memset(&params, 0, sizeof(params));
+    result = io_uring_queue_init_params(QUEUE_DEPTH, &ring, &params);
+  }
+  if (result < 0) {
+    LOG_ERROR<<"cIOUringWebServer::Open io_uring_queue_init_params failed "<<strerror(-result);
+    return false;
+  }
+  ring_created = true;
+
+  buffer_ring = io_uring_setup_buf_ring(&ring, BUFFER_COUNT, BUFFER_GROUP_ID, 0, &result);
+  if (buffer_ring == nullptr) {
+    LOG_ERROR<<"cIOUringWebServer::Open io_uring_setup_buf_ring failed "<<strerror(-result);
+    Destroy();
+    return false;
+  }
+
+  buffers.resize(size_t(BUFFER_COUNT) * BUFFER_SIZE);
+  for (unsigned int i = 0; i < BUFFER_COUNT; i++) {
+    io_uring_buf_ring_add(buffer_ring, &buffers[size_t(i) * BUFFER_SIZE], BUFFER_SIZE, i, io_uring_buf_ring_mask(BUFFER_COUNT), i);
+  }
+  io_uring_buf_ring_advance(buffer_ring, BUFFER_COUNT);
+
+  wake_fd = eventfd(0, EFD_CLOEXEC);
+  if (wake_fd < 0) {
+    LOG_ERROR<<"cIOUringWebServer::Open eventfd failed "<<strerror(errno);
+    Destroy();
+    return false;
+  }
+
+  if (!private_key.empty() && !public_cert.empty()) {
+    if (!OpenTLS(private_key, public_cert, options)) {
+      Destroy();
+      return false;
+    }
+  }
+
+  if (!OpenListeningSocket(endpoint, options.listen_backlog, options.reuse_port)) {
+    Destroy();
+    return false;
+  }
+
+  LOG_INFO<<"cIOUringWebServer::Open Starting server at "<<(tls ? "https" : "http")<<"://"<<ToString(endpoint)<<"/"<<(endpoint.dual_stack ? " (Dual stack)" : "");
+  LOG_INFO<<"cIOUringWebServer::Open Connection timeout "<<options.connection_timeout_seconds<<" seconds, limit "<<options.connection_limit<<", per IP limit "<<(per_ip_connection_limit ? options.per_ip_connection_limit : 0)<<", memory limit "<<options.connection_memory_limit_bytes<<" bytes, listen backlog "<<options.listen_backlog;
+
+  SubmitAccept();
+  SubmitWakeRead();
+  SubmitTimer();
+
+  no_more_connections = false;
+  handed_off = false;
+  stop = false;
+  events_published = false;
+  event_loop_thread = std::thread(&cIOUringWebServer::Run, this);
+
+  // New feed events wake the event loop
+  events_listener = GetFeedEventQueue().AddListener([this]() {
+    events_published = true;
+    Wake();
+  });
+
+  return true;
+}
+
+bool cIOUringWebServer::OpenListeningSocket(const cListenEndpoint& endpoint, unsigned int backlog, bool reuse_port)
+{
+  if (endpoint.listen_socket >= 0) {
+    // The socket is already bound and listening
+    // NOTE: An inherited Unix domain socket belongs to whoever created it, so we don't remove it
+    listen_fd = endpoint.listen_socket;
+    return true;
+  }
+
+  if (endpoint.IsUnixSocket()) {
+    listen_fd = OpenUnixListeningSocket(endpoint.unix_socket_path, backlog);
+    if (listen_fd < 0) {
+      return false;
+    }
+
+    unix_socket_path = endpoint.unix_socket_path;
+    return true;
+  }
+
+  struct sockaddr_storage sad;
+  const socklen_t sad_length = util::ToSockAddr(endpoint.address, endpoint.port, sad);
+
+  listen_fd = socket(sad.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) {
+    LOG_ERROR<<"cIOUringWebServer::OpenListeningSocket socket failed "<<strerror(errno);
+    return false;
+  }
+
+  // So that we can bind the port again straight after a restart
+  const int enable = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  // Each worker process binds the same port and the kernel spreads the connections between them
+  if (reuse_port) {
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+  }
+
+  // Set this either way rather than relying on the net.ipv6.bindv6only default
+  if (endpoint.address.IsIPv6()) {
+    const int ipv6_only = endpoint.dual_stack ? 0 : 1;
+    setsockopt(listen_fd, IPPROTO_IPV6, IPV6_V6ONLY, &ipv6_only, sizeof(ipv6_only));
+  }
+
+  if (bind(listen_fd, reinterpret_cast<const struct sockaddr*>(&sad), sad_length) != 0) {
+    LOG_ERROR<<"cIOUringWebServer::OpenListeningSocket bind failed "<<strerror(errno);
+    return false;
+  }
+
+  if (listen(listen_fd, backlog) != 0) {
+    LOG_ERROR<<"cIOUringWebServer::OpenListeningSocket listen failed "<<strerror(errno);
+    return false;
+  }
+
+  return true;
+}
+
+bool cIOUringWebServer::OpenTLS(const std::string& private_key, const std::string& public_cert, const cWebServerOptions& web_server_options)
+{
+  int result = gnutls_certificate_allocate_credentials(&tls_credentials);
+  if (result != GNUTLS_E_SUCCESS) {
+    LOG_ERROR<<"cIOUringWebServer::OpenTLS Error allocating credentials "<<gnutls_strerror(result);
+    return false;
+  }
+
+  // Each handshake asks the store for the certificate, so a reload can replace it while we are running
+  if (!GetTLSCertificateStore().Load(private_key, public_cert)) {
+    return false;
+  }
+
+  gnutls_certificate_set_retrieve_function2(tls_credentials, &RetrieveTLSCertificate);
+
+  // Use the same default as libmicrohttpd
+  const std::string priorities = !web_server_options.tls_priorities.empty() ? web_server_options.tls_priorities : "NORMAL";
+  LOG_INFO<<"cIOUringWebServer::OpenTLS TLS priorities \""<<priorities<<"\"";
+  result = gnutls_priority_init(&tls_priorities, priorities.c_str(), nullptr);
+  if (result != GNUTLS_E_SUCCESS) {
+    LOG_ERROR<<"cIOUringWebServer::OpenTLS Invalid TLS priorities \""<<priorities<<"\" "<<gnutls_strerror(result);
+    return false;
+  }
+
+  if (!tls_session_resumption.Create(web_server_options, GetTLSSessionTicketKey())) {
+    return false;
+  }
+
+  LOG_INFO<<"cIOUringWebServer::OpenTLS TLS session tickets "<<(web_server_options.tls_session_tickets ? "enabled" : "disabled");
+
+  tls = true;
+
+  return true;
+}
+
+void cIOUringWebServer::NoMoreConnections()
+{
+  if (event_loop_thread.joinable()) {
+    no_more_connections = true;
+    Wake();
+  }
+}
+
+bool cIOUringWebServer::WaitForInFlightRequests(std::chrono::steady_clock::time_point deadline) const
+{
+  return in_flight_requests.WaitUntilIdle(deadline);
+}
+
+size_t cIOUringWebServer::GetInFlightRequests() const
+{
+  return in_flight_requests.Get();
+}
+
+int cIOUringWebServer::GetListeningSocket() const
+{
+  return no_more_connections ? -1 : listen_fd;
+}
+
+void cIOUringWebServer::HandOffListeningSocket()
+{
+  // The new process is listening on the path now
+  unix_socket_path.clear();
+
+  if (event_loop_thread.joinable()) {
+    handed_off = true;
+    NoMoreConnections();
+  }
+}
+
+bool cIOUringWebServer::Close()
+{
+  if (events_listener != 0) {
+    GetFeedEventQueue().RemoveListener(events_listener);
+    events_listener = 0;
+  }
+
+  // Stop the event loop, it closes every connection before it returns
+  if (event_loop_thread.joinable()) {
+    stop = true;
+    Wake();
+    event_loop_thread.join();
+  }
+
+  if (address_filter.IsEnabled()) {
+    LOG_INFO<<"cIOUringWebServer::Close Denied connections "<<denied_connections;
+    address_filter.Clear();
+  }
+
+  if (tls) {
+    const cTLSSessionCounters counters = tls_session_resumption.GetCounters();
+    const uint64_t total = counters.full_handshakes + counters.resumed_handshakes;
+    LOG_INFO<<"cIOUringWebServer::Close TLS handshakes full="<<counters.full_handshakes<<" resumed="<<counters.resumed_handshakes<<" resumption_rate_percent="<<((total != 0) ? ((100 * counters.resumed_handshakes) / total) : 0);
+  }
+
+  Destroy();
+
+  return true;
+}
+
+void cIOUringWebServer::Destroy()
+{
+  // NOTE: Any connections have already been freed by the event loop
+  if (ring_created) {
+    if (buffer_ring != nullptr) {
+      io_uring_free_buf_ring(&ring, buffer_ring, BUFFER_COUNT, BUFFER_GROUP_ID);
+      buffer_ring = nullptr;
+    }
+
+    io_uring_queue_exit(&ring);
+    ring_created = false;
+  }
+
+  buffers.clear();
+
+  if (listen_fd >= 0) {
+    close(listen_fd);
+    listen_fd = -1;
+  }
+
+  if (!unix_socket_path.empty()) {
+    RemoveUnixListeningSocket(unix_socket_path);
+    unix_socket_path.clear();
+  }
+
+  if (wake_fd >= 0) {
+    close(wake_fd);
+    wake_fd = -1;
+  }
+
+  if (tls_priorities != nullptr) {
+    gnutls_priority_deinit(tls_priorities);
+    tls_priorities = nullptr;
+  }
+
+  if (tls_credentials != nullptr) {
+    gnutls_certificate_free_credentials(tls_credentials);
+    tls_credentials = nullptr;
+  }
+
+  tls_session_resumption.Destroy();
+  tls = false;
+
+  security_headers.clear();
+  security_headers_except_cache_control.clear();
+}
+
+cTLSSessionCounters cIOUringWebServer::GetTLSSessionCounters() const
+{
+  return tls_session_resumption.GetCounters();
+}
+
+util::cWorkerPoolCounters cIOUringWebServer::GetWorkerPoolCounters() const
+{
+  // There is no worker pool, the event loop does everything
+  return util::cWorkerPoolCounters();
+}
+
+void cIOUringWebServer::Wake()
+{
+  const uint64_t value = 1;
+  if (write(wake_fd, &value, sizeof(value)) != sizeof(value)) {
+    LOG_ERROR<<"cIOUringWebServer::Wake write failed "<<strerror(errno);
+  }
+}
+
+void cIOUringWebServer::Run()
+{
+  while (true) {
+    // Submit everything that was queued while handling the last batch of completions, and wait for at least one more
+    const int result = io_uring_submit_and_wait(&ring, 1);
+    if ((result < 0) && (result != -EINTR) && (result != -EAGAIN) && (result != -EBUSY)) {
+      LOG_ERROR<<"cIOUringWebServer::Run io_uring_submit_and_wait failed "<<strerror(-result);
+      break;
+    }
+
+    unsigned int head = 0;
+    unsigned int count = 0;
+    struct io_uring_cqe* cqe = nullptr;
+    io_uring_for_each_cqe(&ring, head, cqe) {
+      OnCompletion(*cqe);
+      count++;
+    }
+    io_uring_cq_advance(&ring, count);
+
+    FreeClosedConnections();
+
+    if (stopping && connections.empty() && !accept_pending) {
+      break;
+    }
+  }
+
+  // If the loop failed then some connections may still be open
+  closed_connections.clear();
+  event_stream_connections.clear();
+  for (auto&& connection : connections) {
+    if (connection->tls_session != nullptr) {
+      gnutls_deinit(connection->tls_session);
+    }
+    close(connection->fd);
+    delete connection;
+  }
+  connections.clear();
+  connections_per_ip.clear();
+}
+
+struct io_uring_sqe* cIOUringWebServer::GetSQE()
+{
+  struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+  if (sqe == nullptr) {
+    // The submission queue is full, submit what we have so far and try again
+    io_uring_submit(&ring);
+    sqe = io_uring_get_sqe(&ring);
+  }
+
+  return sqe;
+}
+
+void cIOUringWebServer::SubmitAccept()
+{
+  struct io_uring_sqe* sqe = GetSQE();
+  if (sqe == nullptr) {
+    LOG_ERROR<<"cIOUringWebServer::SubmitAccept Submission queue is full";
+    return;
+  }
+
+  io_uring_prep_multishot_accept(sqe, listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+  io_uring_sqe_set_data64(sqe, CreateUserData(nullptr, OPERATION::ACCEPT));
+  accept_pending = true;
+}
+
+void cIOUringWebServer::SubmitCancelAccept()
+{
+  struct io_uring_sqe* sqe = GetSQE();
+  if (sqe == nullptr) {
+    LOG_ERROR<<"cIOUringWebServer::SubmitCancelAccept Submission queue is full";
+    return;
+  }
+
+  io_uring_prep_cancel64(sqe, CreateUserData(nullptr, OPERATION::ACCEPT), 0);
+  io_uring_sqe_set_data64(sqe, CreateUserData(nullptr, OPERATION::CANCEL));
+}
+
+void cIOUringWebServer::SubmitWakeRead()
+{
+  struct io_uring_sqe* sqe = GetSQE();
+  if (sqe == nullptr) {
+    LOG_ERROR<<"cIOUringWebServer::SubmitWakeRead Submission queue is full";
+    return;
+  }
+
+  io_uring_prep_read(sqe, wake_fd, &wake_value, sizeof(wake_value), 0);
+  io_uring_sqe_set_data64(sqe, CreateUserData(nullptr, OPERATION::WAKE));
+}
+
+void cIOUringWebServer::SubmitTimer()
+{
+  struct io_uring_sqe* sqe = GetSQE();
+  if (sqe == nullptr) {
+    LOG_ERROR<<"cIOUringWebServer::SubmitTimer Submission queue is full";
+    return;
+  }
+
+  io_uring_prep_timeout(sqe, &timer_interval, 0, 0);
+  io_uring_sqe_set_data64(sqe, CreateUserData(nullptr, OPERATION::TIMER));
+}
+
+void cIOUringWebServer::SubmitReceive(cIOUringConnection& connection)
+{
+  struct io_uring_sqe* sqe = GetSQE();
+  if (sqe == nullptr) {
+    LOG_ERROR<<"cIOUringWebServer::SubmitReceive Submission queue is full";
+    CloseConnection(connection);
+    return;
+  }
+
+  // Keep receiving into buffers from the buffer ring until the connection is closed
+  io_uring_prep_recv_multishot(sqe, connection.fd, nullptr, 0, 0);
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = BUFFER_GROUP_ID;
+  io_uring_sqe_set_data64(sqe, CreateUserData(&connection, OPERATION::RECEIVE));
+  connection.receive_pending = true;
+}
+
+void cIOUringWebServer::SubmitSend(cIOUringConnection& connection)
+{
+  struct io_uring_sqe* sqe = GetSQE();
+  if (sqe == nullptr) {
+    LOG_ERROR<<"cIOUringWebServer::SubmitSend Submission queue is full";
+    CloseConnection(connection);
+    return;
+  }
+
+  // Send whatever is left of the headers and the body
+  size_t offset = connection.send_offset;
+  size_t count = 0;
+  if (offset < connection.send_headers.length()) {
+    connection.send_iov[count].iov_base = connection.send_headers.data() + offset;
+    connection.send_iov[count].iov_len = connection.send_headers.length() - offset;
+    count++;
+    offset = 0;
+  } else {
+    offset -= connection.send_headers.length();
+  }
+  if (offset < connection.send_body.length()) {
+    connection.send_iov[count].iov_base = const_cast<char*>(connection.send_body.data()) + offset;
+    connection.send_iov[count].iov_len = connection.send_body.length() - offset;
+    count++;
+  }
+
+  memset(&connection.send_msg, 0, sizeof(connection.send_msg));
+  connection.send_msg.msg_iov = connection.send_iov;
+  connection.send_msg.msg_iovlen = count;
+
+  io_uring_prep_sendmsg(sqe, connection.fd, &connection.send_msg, MSG_NOSIGNAL);
+  io_uring_sqe_set_data64(sqe, CreateUserData(&connection, OPERATION::SEND));
+  connection.send_pending = true;
+}
+
+void cIOUringWebServer::OnCompletion(const struct io_uring_cqe& cqe)
+{
+  const uint64_t user_data = io_uring_cqe_get_data64(&cqe);
+  const OPERATION operation = static_cast<OPERATION>(user_data & OPERATION_MASK);
+  cIOUringConnection* connection = reinterpret_cast<cIOUringConnection*>(user_data & ~OPERATION_MASK);
+
+  switch (operation) {
+    case OPERATION::ACCEPT: {
+      OnAccept(cqe);
+      break;
+    }
+    case OPERATION::WAKE: {
+      OnWake();
+      break;
+    }
+    case OPERATION::TIMER: {
+      OnTimer();
+      break;
+    }
+    case OPERATION::RECEIVE: {
+      OnReceive(*connection, cqe);
+      break;
+    }
+    case OPERATION::SEND: {
+      OnSend(*connection, cqe.res);
+      break;
+    }
+    case OPERATION::CANCEL: {
+      // The accept reports its own completion
+      break;
+    }
+  }
+}
+
+void cIOUringWebServer::OnAccept(const struct io_uring_cqe& cqe)
+{
+  if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+    // The multishot accept has finished, either we shut the listening socket down or it failed
+    accept_pending = false;
+    if (!stopping && !no_more_connections) {
+      SubmitAccept();
+    }
+  }
+
+  if (cqe.res < 0) {
+    if ((cqe.res != -EINVAL) && (cqe.res != -ECANCELED)) {
+      LOG_WARNING<<"cIOUringWebServer::OnAccept accept failed "<<strerror(-cqe.res);
+    }
+    return;
+  }
+
+  const int fd = cqe.res;
+  if (stopping || (connections.size() >= options.connection_limit)) {
+    close(fd);
+    return;
+  }
+
+  // Remember the client address for the access log, the per IP limit and the rate limits
+  struct sockaddr_storage address;
+  socklen_t address_length = sizeof(address);
+  const bool has_peer_name = (getpeername(fd, reinterpret_cast<struct sockaddr*>(&address), &address_length) == 0);
+
+  util::cIPAddress client_address;
+  const bool has_address = has_peer_name && util::FromSockAddr(reinterpret_cast<const struct sockaddr*>(&address), client_address);
+
+  // Drop clients that aren't allowed before anything is allocated for them or the TLS handshake starts
+  if (address_filter.IsEnabled() && (!has_address || !address_filter.IsAllowed(client_address))) {
+    denied_connections++;
+    close(fd);
+    return;
+  }
+
+  cIOUringConnection* connection = new cIOUringConnection(fd);
+  connection->has_address = has_address;
+  connection->address = client_address;
+
+  if (has_peer_name) {
+    if (address.ss_family == AF_INET) {
+      inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in*>(&address)->sin_addr, connection->client_address, sizeof(connection->client_address));
+    } else if (address.ss_family == AF_INET6) {
+      inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6*>(&address)->sin6_addr, connection->client_address, sizeof(connection->client_address));
+    }
+  }
+
+  if (per_ip_connection_limit) {
+    size_t& count = connections_per_ip[connection->client_address];
+    if (count >= options.per_ip_connection_limit) {
+      close(fd);
+      delete connection;
+      return;
+    }
+    count++;
+  }
+
+  connections.insert(connection);
+
+  if (tls && !TLSStart(*connection)) {
+    CloseConnection(*connection);
+    return;
+  }
+
+  SubmitReceive(*connection);
+}
+
+void cIOUringWebServer::OnWake()
+{
+  if (stop && !stopping) {
+    stopping = true;
+    no_more_connections = true;
+  }
+
+  // Shutting the listening socket down finishes the multishot accept
+  // NOTE: Shutting down a listening Unix domain socket doesn't wake a pending accept, so we cancel it as well
+  // NOTE: A socket that has been handed off is shared with the new process, so we only cancel our accept
+  if (no_more_connections && (listen_fd >= 0)) {
+    if (!handed_off) {
+      shutdown(listen_fd, SHUT_RDWR);
+    }
+    if (accept_pending) {
+      SubmitCancelAccept();
+    }
+  }
+
+  if (stopping) {
+    // Close every connection, they are freed as their operations finish
+    const std::vector<cIOUringConnection*> open_connections(connections.begin(), connections.end());
+    for (auto&& connection : open_connections) {
+      CloseConnection(*connection);
+    }
+  } else {
+    if (events_published.exchange(false)) {
+      UpdateEventStreams();
+    }
+
+    // An event stream never finishes by itself, so end them to let the drain complete
+    if (no_more_connections) {
+      EndEventStreams();
+    }
+
+    SubmitWakeRead();
+  }
+}
+
+void cIOUringWebServer::OnTimer()
+{
+  if (stopping) {
+    return;
+  }
+
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const std::chrono::seconds timeout(options.connection_timeout_seconds);
+
+  const std::vector<cIOUringConnection*> open_connections(connections.begin(), connections.end());
+  for (auto&& connection : open_connections) {
+    if (connection->closing) {
+      continue;
+    }
+
+    // Close idle connections, an event stream is quiet between events so it gets a heartbeat instead
+    if (connection->event_stream != nullptr) {
+      if ((now - connection->last_heartbeat) >= FEED_EVENTS_HEARTBEAT_INTERVAL) {
+        connection->last_heartbeat = now;
+        if (!connection->event_stream->AddHeartbeat()) {
+          CloseOverflowedEventStream(*connection);
+          continue;
+        }
+        SendEventStream(*connection);
+      }
+    } else if ((options.connection_timeout_seconds != 0) && ((now - connection->last_activity) > timeout)) {
+      CloseConnection(*connection);
+      continue;
+    }
+
+    if (!connection->closing && connection->receive_starved) {
+      connection->receive_starved = false;
+      SubmitReceive(*connection);
+    }
+  }
+
+  SubmitTimer();
+}
+
+void cIOUringWebServer::ReturnBuffer(uint16_t buffer_id)
+{
+  io_uring_buf_ring_add(buffer_ring, &buffers[size_t(buffer_id) * BUFFER_SIZE], BUFFER_SIZE, buffer_id, io_uring_buf_ring_mask(BUFFER_COUNT), 0);
+  io_uring_buf_ring_advance(buffer_ring, 1);
+}
+
+void cIOUringWebServer::OnReceive(cIOUringConnection& connection, const struct io_uring_cqe& cqe)
+{
+  const bool more = ((cqe.flags & IORING_CQE_F_MORE) != 0);
+  if (!more) {
+    connection.receive_pending = false;
+  }
+
+  if ((cqe.flags & IORING_CQE_F_BUFFER) != 0) {
+    // Copy the data out and give the buffer straight back to the kernel
+    const uint16_t buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    const std::string_view data(&buffers[size_t(buffer_id) * BUFFER_SIZE], (cqe.res > 0) ? size_t(cqe.res) : 0);
+
+    if (!connection.closing) {
+      connection.last_activity = std::chrono::steady_clock::now();
+
+      if (connection.tls_session != nullptr) {
+        if (!TLSReceive(connection, data)) {
+          ReturnBuffer(buffer_id);
+          CloseConnection(connection);
+          return;
+        }
+      } else {
+        connection.received.append(data);
+      }
+    }
+
+    ReturnBuffer(buffer_id);
+  }
+
+  if (connection.closing) {
+    return;
+  }
+
+  if (cqe.res == -ENOBUFS) {
+    // We ran out of buffers, back off until the next timer tick rather than spinning on receives that fail straight away
+    // NOTE: The data stays in the socket until then
+    connection.receive_starved = !more;
+    return;
+  } else if (cqe.res <= 0) {
+    // The client closed the connection, or it failed
+    if (connection.response_pending) {
+      WriteAccessLog(connection, false);
+      SetResponsePending(connection, false);
+    }
+    CloseConnection(connection);
+    return;
+  }
+
+  if (!more) {
+    SubmitReceive(connection);
+  }
+
+  ProcessRequests(connection);
+}
+
+void cIOUringWebServer::OnSend(cIOUringConnection& connection, int result)
+{
+  connection.send_pending = false;
+
+  if (connection.closing) {
+    return;
+  }
+
+  if (result < 0) {
+    if (connection.response_pending) {
+      WriteAccessLog(connection, false);
+      SetResponsePending(connection, false);
+    }
+    CloseConnection(connection);
+    return;
+  }
+
+  connection.last_activity = std::chrono::steady_clock::now();
+
+  // If the socket buffer filled up then send the rest
+  connection.send_offset += size_t(result);
+  if (connection.send_offset < (connection.send_headers.length() + connection.send_body.length())) {
+    SubmitSend(connection);
+    return;
+  }
+
+  connection.send_headers.clear();
+  connection.send_body = std::string_view();
+  connection.send_body_owner.reset();
+  connection.send_offset = 0;
+
+  // GnuTLS may have written more while we were sending
+  if (!connection.tls_send_queue.empty()) {
+    StartSend(connection);
+    return;
+  }
+
+  // Send the events that were buffered while we were sending
+  if (connection.event_stream != nullptr) {
+    SendEventStream(connection);
+    return;
+  }
+
+  if (connection.response_pending) {
+    OnResponseSent(connection);
+  }
+}
+
+void cIOUringWebServer::StartSend(cIOUringConnection& connection)
+{
+  // Only one send is in flight at a time so that the data stays in order
+  if (connection.send_pending || connection.closing || connection.tls_send_queue.empty()) {
+    return;
+  }
+
+  connection.send_headers.swap(connection.tls_send_queue);
+  connection.tls_send_queue.clear();
+  connection.send_body = std::string_view();
+  connection.send_offset = 0;
+  SubmitSend(connection);
+}
+
+
+// NOTE: GnuTLS reads and writes memory buffers instead of the socket, the event loop moves the cipher text between them and the socket
+ssize_t cIOUringWebServer::_TLSPush(gnutls_transport_ptr_t ptr, const void* data, size_t size)
+{
+  cIOUringConnection* connection = static_cast<cIOUringConnection*>(ptr);
+  connection->tls_send_queue.append(static_cast<const char*>(data), size);
+  return ssize_t(size);
+}
+
+ssize_t cIOUringWebServer::_TLSPull(gnutls_transport_ptr_t ptr, void* data, size_t size)
+{
+  cIOUringConnection* connection = static_cast<cIOUringConnection*>(ptr);
+  const size_t available = connection->tls_received.length() - connection->tls_received_offset;
+  if (available == 0) {
+    gnutls_transport_set_errno(connection->tls_session, EAGAIN);
+    return -1;
+  }
+
+  const size_t length = std::min(available, size);
+  memcpy(data, connection->tls_received.data() + connection->tls_received_offset, length);
+  connection->tls_received_offset += length;
+  return ssize_t(length);
+}
+
+int cIOUringWebServer::_TLSPullTimeout(gnutls_transport_ptr_t ptr, unsigned int ms)
+{
+  (void)ms;
+
+  // We never wait, either the data has been received or it hasn't
+  const cIOUringConnection* connection = static_cast<const cIOUringConnection*>(ptr);
+  return (connection->tls_received.length() > connection->tls_received_offset) ? 1 : 0;
+}
+
+bool cIOUringWebServer::TLSStart(cIOUringConnection& connection)
+{
+  int result = gnutls_init(&connection.tls_session, GNUTLS_SERVER | GNUTLS_NONBLOCK | GNUTLS_NO_SIGNAL);
+  if (result != GNUTLS_E_SUCCESS) {
+    LOG_ERROR<<"cIOUringWebServer::TLSStart gnutls_init failed "<<gnutls_strerror(result);
+    connection.tls_session = nullptr;
+    return false;
+  }
+
+  if (
+    (gnutls_priority_set(connection.tls_session, tls_priorities) != GNUTLS_E_SUCCESS) ||
+    (gnutls_credentials_set(connection.tls_session, GNUTLS_CRD_CERTIFICATE, tls_credentials) != GNUTLS_E_SUCCESS)
+  ) {
+    LOG_ERROR<<"cIOUringWebServer::TLSStart Error setting up the TLS session";
+    return false;
+  }
+
+  gnutls_transport_set_ptr(connection.tls_session, &connection);
+  gnutls_transport_set_push_function(connection.tls_session, &_TLSPush);
+  gnutls_transport_set_pull_function(connection.tls_session, &_TLSPull);
+  gnutls_transport_set_pull_timeout_function(connection.tls_session, &_TLSPullTimeout);
+
+  // The idle connection timeout covers slow handshakes
+  gnutls_handshake_set_timeout(connection.tls_session, 0);
+
+  tls_session_resumption.EnableForSession(connection.tls_session);
+
+  return true;
+}
+
+bool cIOUringWebServer::TLSReceive(cIOUringConnection& connection, std::string_view cipher_text)
+{
+  connection.tls_received.append(cipher_text);
+
+  if (!connection.tls_handshake_done) {
+    const int result = gnutls_handshake(connection.tls_session);
+    if (result == GNUTLS_E_SUCCESS) {
+      connection.tls_handshake_done = true;
+      tls_session_resumption.CountHandshake(connection.tls_session);
+    } else if (gnutls_error_is_fatal(result) != 0) {
+      LOG_WARNING<<"cIOUringWebServer::TLSReceive Handshake failed for "<<connection.client_address<<" "<<gnutls_strerror(result);
+      return false;
+    }
+  }
+
+  if (connection.tls_handshake_done) {
+    // Decrypt everything that has been received so far
+    char plain_text[TLS_RECORD_SIZE];
+    while (true) {
+      const ssize_t result = gnutls_record_recv(connection.tls_session, plain_text, sizeof(plain_text));
+      if (result > 0) {
+        connection.received.append(plain_text, size_t(result));
+      } else if (result == 0) {
+        // The client sent a close notify
+        return false;
+      } else if ((result == GNUTLS_E_AGAIN) || (result == GNUTLS_E_INTERRUPTED)) {
+        break;
+      } else if (gnutls_error_is_fatal(result) != 0) {
+        return false;
+      }
+    }
+  }
+
+  // Throw away the cipher text that GnuTLS has finished with
+  connection.tls_received.erase(0, connection.tls_received_offset);
+  connection.tls_received_offset = 0;
+
+  // Send any handshake messages
+  StartSend(connection);
+
+  return true;
+}
+
+bool cIOUringWebServer::TLSSend(cIOUringConnection& connection, std::string_view plain_text)
+{
+  while (!plain_text.empty()) {
+    const ssize_t result = gnutls_record_send(connection.tls_session, plain_text.data(), std::min(plain_text.length(), TLS_RECORD_SIZE));
+    if (result < 0) {
+      if ((result == GNUTLS_E_AGAIN) || (result == GNUTLS_E_INTERRUPTED)) {
+        continue;
+      }
+
+      LOG_WARNING<<"cIOUringWebServer::TLSSend Error sending to "<<connection.client_address<<" "<<gnutls_strerror(int(result));
+      return false;
+    }
+
+    plain_text.remove_prefix(size_t(result));
+  }
+
+  return true;
+}
+
+
+void cIOUringWebServer::ProcessRequests(cIOUringConnection& connection)
+{
+  // Requests are answered one at a time in order, a pipelined request waits in the buffer until the previous response has been sent
+  while (!connection.closing && !connection.response_pending) {
+    const size_t end = connection.received.find("\r\n\r\n");
+    if (end == std::string::npos) {
+      if (connection.received.length() > options.connection_memory_limit_bytes) {
+        // The headers don't fit in the memory limit
+        connection.request.Clear();
+        connection.request.start_time = std::chrono::steady_clock::now();
+        connection.close_after_response = true;
+        QueueResponse(connection, 431, "", "", nullptr, true, util::CONTENT_ENCODING::IDENTITY);
+      }
+      return;
+    }
+
+    connection.request.Clear();
+    connection.request.start_time = std::chrono::steady_clock::now();
+
+    if (!ParseRequest(connection, std::string_view(connection.received).substr(0, end + 2))) {
+      connection.close_after_response = true;
+      QueueErrorResponse(connection, 400, BAD_REQUEST);
+      return;
+    }
+
+    const std::string_view url(connection.request.url);
+    const size_t question_mark = url.find('?');
+    HandleRequest(connection, url.substr(0, question_mark), (question_mark != std::string_view::npos) ? url.substr(question_mark + 1) : std::string_view());
+
+    connection.received.erase(0, end + 4);
+  }
+
+  if (connection.received.length() > options.connection_memory_limit_bytes) {
+    // The client is sending requests faster than we can answer them
+    CloseConnection(connection);
+  }
+}
+
+bool cIOUringWebServer::ParseRequest(cIOUringConnection& connection, std::string_view head)
+{
+  cIOUringRequest& request = connection.request;
+
+  // The request line, ie. "GET /feed/atom.xml?token=abc HTTP/1.1"
+  const size_t line_end = head.find("\r\n");
+  const std::string_view request_line = head.substr(0, line_end);
+  const size_t method_end = request_line.find(' ');
+  const size_t url_end = request_line.rfind(' ');
+  if ((method_end == std::string_view::npos) || (url_end == method_end)) {
+    return false;
+  }
+
+  request.method = request_line.substr(0, method_end);
+  request.url = request_line.substr(method_end + 1, url_end - (method_end + 1));
+  const std::string_view version = request_line.substr(url_end + 1);
+  if (request.url.empty() || (request.url[0] != '/')) {
+    return false;
+  }
+
+  request.request_method = http::ParseMethod(request.method);
+
+  bool keep_alive = false;
+  if (version == "HTTP/1.1") {
+    keep_alive = true;
+  } else if (version != "HTTP/1.0") {
+    return false;
+  }
+
+  // The headers
+  bool has_body = false;
+  std::string_view headers = head.substr(line_end + 2);
+  while (!headers.empty()) {
+    const size_t end = headers.find("\r\n");
+    const std::string_view line = headers.substr(0, end);
+    headers.remove_prefix((end != std::string_view::npos) ? end + 2 : headers.length());
+
+    const size_t colon = line.find(':');
+    if ((colon == std::string_view::npos) || (colon == 0)) {
+      return false;
+    }
+
+    const std::string_view name = line.substr(0, colon);
+    std::string_view value = line.substr(colon + 1);
+    while (!value.empty() && ((value.front() == ' ') || (value.front() == '\t'))) value.remove_prefix(1);
+    while (!value.empty() && ((value.back() == ' ') || (value.back() == '\t'))) value.remove_suffix(1);
+
+    if (IsHeaderName(name, "accept-encoding")) {
+      request.has_accept_encoding = true;
+      request.accept_encoding = value;
+    } else if (IsHeaderName(name, "if-none-match")) {
+      request.has_if_none_match = true;
+      request.if_none_match = value;
+    } else if (IsHeaderName(name, "if-modified-since")) {
+      request.has_if_modified_since = true;
+      request.if_modified_since = value;
+    } else if (IsHeaderName(name, "last-event-id")) {
+      request.has_last_event_id = true;
+      request.last_event_id = value;
+    } else if (IsHeaderName(name, "connection")) {
+      if (HasConnectionOption(value, "close")) {
+        keep_alive = false;
+      } else if (HasConnectionOption(value, "keep-alive")) {
+        keep_alive = true;
+      }
+    } else if (IsHeaderName(name, "content-length")) {
+      has_body = has_body || (value != "0");
+    } else if (IsHeaderName(name, "transfer-encoding")) {
+      has_body = true;
+    }
+  }
+
+  // None of our routes take a request body, rather than reading past it we answer the request and close the connection
+  connection.close_after_response = !keep_alive || has_body;
+
+  return true;
+}
+
+void cIOUringWebServer::HandleRequest(cIOUringConnection& connection, std::string_view path, std::string_view query)
+{
+  const size_t route = FindRoute(path);
+  if (route == ROUTE_NOT_FOUND) {
+    QueueErrorResponse(connection, 404, PAGE_NOT_FOUND);
+    return;
+  }
+
+  const uint32_t methods = GetRouteMethods(route);
+  if ((methods & http::GetMethodBit(connection.request.request_method)) == 0) {
+    const std::string allow = "Allow: " + http::CreateAllowHeader(methods) + "\r\n";
+    QueueResponse(connection, 405, allow, METHOD_NOT_ALLOWED, nullptr, true, util::CONTENT_ENCODING::IDENTITY);
+    return;
+  }
+
+  if (route == FEED_ROUTE) {
+    HandleFeedRequest(connection, query);
+  } else if (route == FEED_EVENTS_ROUTE) {
+    HandleFeedEventsRequest(connection, query);
+  } else {
+    HandleStaticResourceRequest(connection, route);
+  }
+}
+
+void cIOUringWebServer::HandleStaticResourceRequest(cIOUringConnection& connection, size_t index)
+{
+  const cIOUringRequest& request = connection.request;
+
+  // Pick the best encoding that the client supports
+  const cEmbeddedResource& resource = embedded::resources[index];
+  const util::CONTENT_ENCODING encoding = http::ChooseContentEncoding(request.has_accept_encoding ? request.accept_encoding.c_str() : nullptr, util::CONTENT_ENCODINGS_ALL);
+  const size_t e = static_cast<size_t>(encoding);
+
+  // Check if the client already has the current version
+  if (http::IsNotModified(request.has_if_none_match ? request.if_none_match.c_str() : nullptr, request.has_if_modified_since ? request.if_modified_since.c_str() : nullptr, resource.etags[e], std::nullopt)) {
+    const std::string headers = std::string("ETag: ") + std::string(resource.etags[e]) + "\r\nVary: Accept-Encoding\r\n";
+    QueueResponse(connection, 304, headers, "", nullptr, false, encoding);
+    return;
+  }
+
+  std::string headers = std::string("Content-Type: ") + std::string(resource.mime_type) + "\r\n";
+  if (encoding != util::CONTENT_ENCODING::IDENTITY) {
+    headers += std::string("Content-Encoding: ") + util::GetContentEncodingName(encoding) + "\r\n";
+  }
+  headers += std::string("Vary: Accept-Encoding\r\nETag: ") + std::string(resource.etags[e]) + "\r\n";
+
+  // NOTE: The embedded resources are static so the body is sent straight from them
+  QueueResponse(connection, 200, headers, resource.variants[e], nullptr, true, encoding);
+}
+
+void cIOUringWebServer::HandleFeedRequest(cIOUringConnection& connection, std::string_view query)
+{
+  const cIOUringRequest& request = connection.request;
+
+  std::string token;
+  const bool has_token = GetQueryArgument(query, "token", token);
+
+  // Check the rate limits before anything is rendered
+  uint32_t retry_after_seconds = 0;
+  if (feed_route.IsRateLimited(connection.has_address ? &connection.address : nullptr, has_token ? token.c_str() : nullptr, retry_after_seconds)) {
+    const std::string retry_after = "Retry-After: " + std::to_string(retry_after_seconds) + "\r\n";
+    QueueResponse(connection, 429, retry_after, TOO_MANY_REQUESTS, nullptr, true, util::CONTENT_ENCODING::IDENTITY);
+    return;
+  }
+
+  cFeedResponse response;
+  feed_route.GetResponse(
+    request.request_method,
+    has_token ? token.c_str() : nullptr,
+    request.has_accept_encoding ? request.accept_encoding.c_str() : nullptr,
+    request.has_if_none_match ? request.if_none_match.c_str() : nullptr,
+    request.has_if_modified_since ? request.if_modified_since.c_str() : nullptr,
+    response
+  );
+
+  if (response.status_code == 401) {
+    QueueErrorResponse(connection, 401, UNAUTHORISED);
+    return;
+  }
+
+  std::string headers;
+  if (response.status_code == 200) {
+    headers += "Content-Type: " + ATOM_FEED_MIMETYPE + "\r\n";
+    if (response.encoding != util::CONTENT_ENCODING::IDENTITY) {
+      headers += std::string("Content-Encoding: ") + util::GetContentEncodingName(response.encoding) + "\r\n";
+    }
+  }
+  headers += "Vary: Accept-Encoding\r\nETag: " + response.etag + "\r\n";
+  if (!response.last_modified.empty()) {
+    headers += "Last-Modified: " + response.last_modified + "\r\n";
+  }
+  if (!response.cache_control.empty()) {
+    headers += "Cache-Control: " + response.cache_control + "\r\nExpires: " + response.expires + "\r\n";
+    connection.request.has_cache_control = true;
+  }
+
+  if (response.status_code == 304) {
+    QueueResponse(connection, 304, headers, "", nullptr, false, response.encoding);
+  } else if (response.rendered == nullptr) {
+    // A HEAD request for a feed that hasn't been rendered yet, we don't know the length
+    QueueResponse(connection, 200, headers, "", nullptr, false, response.encoding);
+  } else {
+    // The rendered feed is immutable so the send can share it with the cache
+    QueueResponse(connection, 200, headers, response.content, response.rendered, true, response.encoding);
+  }
+}
+
+void cIOUringWebServer::HandleFeedEventsRequest(cIOUringConnection& connection, std::string_view query)
+{
+  const cIOUringRequest& request = connection.request;
+
+  std::string token;
+  const bool has_token = GetQueryArgument(query, "token", token);
+
+  // The event stream shares the feed's rate limits
+  uint32_t retry_after_seconds = 0;
+  if (feed_route.IsRateLimited(connection.has_address ? &connection.address : nullptr, has_token ? token.c_str() : nullptr, retry_after_seconds)) {
+    const std::string retry_after = "Retry-After: " + std::to_string(retry_after_seconds) + "\r\n";
+    QueueResponse(connection, 429, retry_after, TOO_MANY_REQUESTS, nullptr, true, util::CONTENT_ENCODING::IDENTITY);
+    return;
+  }
+
+  unsigned int status_code = 200;
+  std::unique_ptr<cFeedEventStream> event_stream = feed_route.CreateEventStream(has_token ? token.c_str() : nullptr, request.has_last_event_id ? request.last_event_id.c_str() : nullptr, status_code);
+  if (status_code == 401) {
+    QueueErrorResponse(connection, 401, UNAUTHORISED);
+    return;
+  } else if (event_stream == nullptr) {
+    QueueErrorResponse(connection, 404, PAGE_NOT_FOUND);
+    return;
+  }
+
+  // The stream doesn't have a length, it ends when the connection is closed
+  connection.close_after_response = true;
+  connection.request.has_cache_control = true;
+  const std::string headers = "Content-Type: " + EVENT_STREAM_MIMETYPE + "\r\nCache-Control: no-cache\r\nX-Accel-Buffering: no\r\n";
+  QueueResponse(connection, 200, headers, "", nullptr, false, util::CONTENT_ENCODING::IDENTITY);
+  if (connection.closing) {
+    return;
+  }
+
+  // The events that the client missed are sent once the headers have been sent
+  connection.event_stream = std::move(event_stream);
+  connection.event_stream_ending = no_more_connections;
+  connection.last_heartbeat = std::chrono::steady_clock::now();
+  event_stream_connections.insert(&connection);
+}
+
+void cIOUringWebServer::UpdateEventStreams()
+{
+  const cFeedEventQueue& queue = GetFeedEventQueue();
+
+  const std::vector<cIOUringConnection*> streaming(event_stream_connections.begin(), event_stream_connections.end());
+  for (auto&& connection : streaming) {
+    if (!connection->event_stream->Update(queue)) {
+      CloseOverflowedEventStream(*connection);
+      continue;
+    }
+
+    SendEventStream(*connection);
+  }
+}
+
+void cIOUringWebServer::EndEventStreams()
+{
+  const std::vector<cIOUringConnection*> streaming(event_stream_connections.begin(), event_stream_connections.end());
+  for (auto&& connection : streaming) {
+    connection->event_stream_ending = true;
+    SendEventStream(*connection);
+  }
+}
+
+void cIOUringWebServer::SendEventStream(cIOUringConnection& connection)
+{
+  // Only one send is in flight at a time, the events buffered in the meantime go in the next one
+  if (connection.send_pending || connection.closing) {
+    return;
+  }
+
+  if (connection.event_stream->IsEmpty()) {
+    if (connection.event_stream_ending) {
+      connection.event_stream.reset();
+      event_stream_connections.erase(&connection);
+      OnResponseSent(connection);
+    }
+    return;
+  }
+
+  std::string text = connection.event_stream->Take();
+  connection.request.content_length += text.length();
+
+  if (connection.tls_session != nullptr) {
+    if (!TLSSend(connection, text)) {
+      WriteAccessLog(connection, false);
+      SetResponsePending(connection, false);
+      CloseConnection(connection);
+      return;
+    }
+
+    StartSend(connection);
+    return;
+  }
+
+  connection.send_headers = std::move(text);
+  connection.send_body = std::string_view();
+  connection.send_body_owner.reset();
+  connection.send_offset = 0;
+  SubmitSend(connection);
+}
+
+void cIOUringWebServer::CloseOverflowedEventStream(cIOUringConnection& connection)
+{
+  // The client isn't reading fast enough, it can reconnect with the Last-Event-ID of the last event that it received
+  LOG_WARNING<<"cIOUringWebServer::CloseOverflowedEventStream Event stream buffer is full, disconnecting "<<connection.client_address;
+  WriteAccessLog(connection, false);
+  SetResponsePending(connection, false);
+  CloseConnection(connection);
+}
+
+void cIOUringWebServer::QueueErrorResponse(cIOUringConnection& connection, unsigned int status_code, const std::string& text)
+{
+  // NOTE: text needs to be long lived, static, the body is sent straight from it
+  QueueResponse(connection, status_code, "", text, nullptr, true, util::CONTENT_ENCODING::IDENTITY);
+}
+
+void cIOUringWebServer::QueueResponse(cIOUringConnection& connection, unsigned int status_code, std::string_view headers, std::string_view body, const std::shared_ptr<const void>& body_owner, bool content_length, util::CONTENT_ENCODING encoding)
+{
+  const bool head_only = (connection.request.request_method == http::METHOD::HEAD);
+
+  connection.request.status_code = status_code;
+  connection.request.content_length = head_only ? 0 : body.length();
+  connection.request.encoding = encoding;
+
+  // We are shutting down, so that the client doesn't send another request on this connection it reconnects, to the process that took over our listening socket if there is one
+  if (no_more_connections) {
+    connection.close_after_response = true;
+  }
+
+  const std::string& response_security_headers = connection.request.has_cache_control ? security_headers_except_cache_control : security_headers;
+
+  std::string response_headers;
+  response_headers.reserve(256 + headers.length() + response_security_headers.length());
+  response_headers += "HTTP/1.1 " + std::to_string(status_code) + " " + GetStatusText(status_code) + "\r\n";
+  response_headers += "Date: " + GetDate() + "\r\n";
+  if (content_length) {
+    response_headers += "Content-Length: " + std::to_string(body.length()) + "\r\n";
+  }
+  response_headers += headers;
+  response_headers += response_security_headers;
+  response_headers += connection.close_after_response ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+  response_headers += "\r\n";
+
+  if (head_only) {
+    body = std::string_view();
+  }
+
+  SetResponsePending(connection, true);
+
+  if (connection.tls_session != nullptr) {
+    // Encrypt the response, GnuTLS writes the cipher text to the send queue
+    if (!TLSSend(connection, response_headers) || !TLSSend(connection, body)) {
+      WriteAccessLog(connection, false);
+      SetResponsePending(connection, false);
+      CloseConnection(connection);
+      return;
+    }
+
+    StartSend(connection);
+    return;
+  }
+
+  // Send the headers and the body together without copying the body
+  connection.send_headers = std::move(response_headers);
+  connection.send_body = body;
+  connection.send_body_owner = body_owner;
+  connection.send_offset = 0;
+  SubmitSend(connection);
+}
+
+void cIOUringWebServer::SetResponsePending(cIOUringConnection& connection, bool response_pending)
+{
+  if (connection.response_pending == response_pending) {
+    return;
+  }
+
+  connection.response_pending = response_pending;
+
+  if (response_pending) {
+    in_flight_requests.Started();
+  } else {
+    in_flight_requests.Completed();
+  }
+}
+
+void cIOUringWebServer::OnResponseSent(cIOUringConnection& connection)
+{
+  WriteAccessLog(connection, true);
+  SetResponsePending(connection, false);
+
+  if (connection.close_after_response) {
+    CloseConnection(connection);
+    return;
+  }
+
+  // Answer the next request if it has already arrived
+  ProcessRequests(connection);
+}
+
+void cIOUringWebServer::WriteAccessLog(const cIOUringConnection& connection, bool completed) const
+{
+  const cIOUringRequest& request = connection.request;
+  const uint64_t duration_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - request.start_time).count();
+
+  LOG_INFO<<"access client="<<connection.client_address<<" method="<<logging::quoted(request.method)<<" url="<<logging::quoted(request.url)<<" status="<<request.status_code<<" bytes="<<request.content_length<<" encoding="<<util::GetContentEncodingName(request.encoding)<<" duration_us="<<duration_us<<" completed="<<completed;
+}
+
+void cIOUringWebServer::CloseConnection(cIOUringConnection& connection)
+{
+  if (connection.closing) {
+    return;
+  }
+
+  // Shutting the socket down finishes the receive and any send that is in flight
+  // NOTE: The connection is freed at the end of the batch of completions once its operations have finished, so the caller can keep using it until then
+  connection.closing = true;
+  shutdown(connection.fd, SHUT_RDWR);
+  closed_connections.push_back(&connection);
+
+  if (connection.event_stream != nullptr) {
+    connection.event_stream.reset();
+    event_stream_connections.erase(&connection);
+  }
+}
+
+void cIOUringWebServer::FreeClosedConnections()
+{
+  auto iter = closed_connections.begin();
+  while (iter != closed_connections.end()) {
+    cIOUringConnection* connection = *iter;
+    if (connection->receive_pending || connection->send_pending) {
+      iter++;
+      continue;
+    }
+
+    if (per_ip_connection_limit) {
+      auto count = connections_per_ip.find(connection->client_address);
+      if (count != connections_per_ip.end()) {
+        if (count->second <= 1) {
+          connections_per_ip.erase(count);
+        } else {
+          count->second--;
+        }
+      }
+    }
+
+    // A connection that was closed part way through a response, ie. because we are stopping
+    SetResponsePending(*connection, false);
+
+    if (connection->tls_session != nullptr) {
+      gnutls_deinit(connection->tls_session);
+    }
+
+    close(connection->fd);
+    connections.erase(connection);
+    delete connection;
+
+    iter = closed_connections.erase(iter);
+  }
+}
+
+const std::string& cIOUringWebServer::GetDate()
+{
+  const std::chrono::system_clock::time_point now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+  if (date.empty() || (now != date_time)) {
+    date = util::GetDateTimeHTTP(now);
+    date_time = now;
+  }
+
+  return date;
+}
+
+bool IsIOUringWebServerAvailable()
+{
+  return true;
+}
+
+cWebServerBackend* CreateIOUringWebServer(const cFeedRoute& feed_route)
+{
+  return new cIOUringWebServer(feed_route);
+}
+
+}
+
+#else
+
+namespace tasktracker {
+
+bool IsIOUringWebServerAvailable()
+{
+  return false;
+}
+
+cWebServerBackend* CreateIOUringWebServer(const cFeedRoute& feed_route)
+{
+  (void)feed_route;
+
+  LOG_ERROR<<"CreateIOUringWebServer The io_uring backend is not available, build with -DTASK_TRACKER_IO_URING=ON";
+  return nullptr;
+}
+
+}
+
+#endif
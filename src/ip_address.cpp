@@ -1,70 +1,470 @@
-#include <iostream>
-#include <sstream>
+#include <cstring>
+
+#include <algorithm>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
 
 #include "ip_address.h"
 
 namespace util {
 
+namespace {
+
+// Parses a decimal number of up to max_digits digits that is no larger than max_value
+// NOTE: Leading zeros are rejected so that "010" can't be mistaken for octal
+bool ParseDecimal(std::string_view text, size_t max_digits, uint32_t max_value, uint32_t& out_value)
+{
+  if (text.empty() || (text.size() > max_digits) || ((text.size() > 1) && (text[0] == '0'))) {
+    return false;
+  }
+
+  uint32_t value = 0;
+  for (char c : text) {
+    if ((c < '0') || (c > '9')) {
+      return false;
+    }
+
+    value = (value * 10) + uint32_t(c - '0');
+  }
+
+  if (value > max_value) {
+    return false;
+  }
+
+  out_value = value;
+  return true;
+}
+
+bool ParseIPv4(std::string_view text, uint8_t* out_octets)
+{
+  for (size_t i = 0; i < 4; i++) {
+    const size_t dot = text.find('.');
+    if ((i == 3) != (dot == std::string_view::npos)) {
+      // Too few or too many dots
+      return false;
+    }
+
+    uint32_t value = 0;
+    if (!ParseDecimal(text.substr(0, dot), 3, 255, value)) {
+      return false;
+    }
+
+    out_octets[i] = uint8_t(value);
+
+    if (dot != std::string_view::npos) {
+      text.remove_prefix(dot + 1);
+    }
+  }
+
+  return true;
+}
+
+bool ParseHexWord(std::string_view text, uint16_t& out_value)
+{
+  if (text.empty() || (text.size() > 4)) {
+    return false;
+  }
+
+  uint16_t value = 0;
+  for (char c : text) {
+    uint16_t digit = 0;
+    if ((c >= '0') && (c <= '9')) digit = uint16_t(c - '0');
+    else if ((c >= 'a') && (c <= 'f')) digit = uint16_t(c - 'a' + 10);
+    else if ((c >= 'A') && (c <= 'F')) digit = uint16_t(c - 'A' + 10);
+    else return false;
+
+    value = uint16_t((value << 4) | digit);
+  }
+
+  out_value = value;
+  return true;
+}
+
+bool ParseIPv6(std::string_view text, std::array<uint8_t, 16>& out_bytes)
+{
+  uint16_t words[8] = { 0 };
+  size_t count = 0;
+  size_t compressed_at = SIZE_MAX; // Where the "::" is, the missing words are inserted here
+
+  if (text.starts_with("::")) {
+    compressed_at = 0;
+    text.remove_prefix(2);
+  } else if (text.starts_with(':')) {
+    return false;
+  }
+
+  while (!text.empty()) {
+    if (count == 8) {
+      return false;
+    }
+
+    const size_t colon = text.find(':');
+    const std::string_view part = text.substr(0, colon);
+
+    if ((colon == std::string_view::npos) && (part.find('.') != std::string_view::npos)) {
+      // The last 32 bits may be written as an IPv4 address, ie. "::ffff:192.168.0.3"
+      uint8_t octets[4];
+      if ((count > 6) || !ParseIPv4(part, octets)) {
+        return false;
+      }
+
+      words[count++] = uint16_t((octets[0] << 8) | octets[1]);
+      words[count++] = uint16_t((octets[2] << 8) | octets[3]);
+      break;
+    }
+
+    if (!ParseHexWord(part, words[count])) {
+      return false;
+    }
+    count++;
+
+    if (colon == std::string_view::npos) {
+      break;
+    }
+
+    text.remove_prefix(colon + 1);
+
+    if (text.starts_with(':')) {
+      // Only one "::" is allowed
+      if (compressed_at != SIZE_MAX) {
+        return false;
+      }
+
+      compressed_at = count;
+      text.remove_prefix(1);
+    } else if (text.empty()) {
+      // A trailing single ':'
+      return false;
+    }
+  }
+
+  if (compressed_at == SIZE_MAX) {
+    if (count != 8) {
+      return false;
+    }
+  } else if (count == 8) {
+    // "::" has to stand for at least one word
+    return false;
+  }
+
+  // Expand the "::" by moving the words after it to the end
+  uint16_t expanded[8] = { 0 };
+  if (compressed_at == SIZE_MAX) {
+    std::copy(words, words + 8, expanded);
+  } else {
+    std::copy(words, words + compressed_at, expanded);
+    std::copy(words + compressed_at, words + count, expanded + 8 - (count - compressed_at));
+  }
+
+  for (size_t i = 0; i < 8; i++) {
+    out_bytes[2 * i] = uint8_t(expanded[i] >> 8);
+    out_bytes[(2 * i) + 1] = uint8_t(expanded[i] & 0xff);
+  }
+
+  return true;
+}
+
+}
+
 cIPAddress::cIPAddress() :
-  octet0(0),
-  octet1(0),
-  octet2(0),
-  octet3(0)
+  family(ADDRESS_FAMILY::IPV4),
+  bytes{ 0 }
+{
+}
+
+cIPAddress::cIPAddress(uint8_t octet0, uint8_t octet1, uint8_t octet2, uint8_t octet3) :
+  family(ADDRESS_FAMILY::IPV4),
+  bytes{ octet0, octet1, octet2, octet3 }
 {
 }
 
-cIPAddress::cIPAddress(uint8_t _octet0, uint8_t _octet1, uint8_t _octet2, uint8_t _octet3) :
-  octet0(_octet0),
-  octet1(_octet1),
-  octet2(_octet2),
-  octet3(_octet3)
+cIPAddress::cIPAddress(const std::array<uint8_t, 16>& ipv6_bytes) :
+  family(ADDRESS_FAMILY::IPV6),
+  bytes(ipv6_bytes)
 {
 }
 
 void cIPAddress::Clear()
 {
-  octet0 = 0;
-  octet1 = 0;
-  octet2 = 0;
-  octet3 = 0;
+  family = ADDRESS_FAMILY::IPV4;
+  bytes.fill(0);
+}
+
+
+cIPNetwork::cIPNetwork() :
+  prefix_length(0)
+{
+}
+
+cIPNetwork::cIPNetwork(const cIPAddress& _address, uint8_t _prefix_length) :
+  address(_address),
+  prefix_length(_prefix_length)
+{
+}
+
+bool cIPNetwork::Contains(const cIPAddress& other) const
+{
+  if (other.family != address.family) {
+    return false;
+  }
+
+  const size_t whole_bytes = prefix_length / 8;
+  if (memcmp(other.bytes.data(), address.bytes.data(), whole_bytes) != 0) {
+    return false;
+  }
+
+  const size_t remaining_bits = prefix_length % 8;
+  if (remaining_bits == 0) {
+    return true;
+  }
+
+  const uint8_t mask = uint8_t(0xff << (8 - remaining_bits));
+  return ((other.bytes[whole_bytes] & mask) == address.bytes[whole_bytes]);
 }
 
 
 std::string ToString(const cIPAddress& address)
 {
-  std::ostringstream o;
-  o<<int(address.octet0)<<"."<<int(address.octet1)<<"."<<int(address.octet2)<<"."<<int(address.octet3);
-  return o.str();
+  // Long enough for "ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255"
+  char text[INET6_ADDRSTRLEN];
+  const char* hex = "0123456789abcdef";
+  size_t length = 0;
+
+  auto AppendIPv4 = [&text, &length](const uint8_t* octets) {
+    for (size_t i = 0; i < 4; i++) {
+      if (i != 0) {
+        text[length++] = '.';
+      }
+
+      const uint8_t octet = octets[i];
+      if (octet >= 100) text[length++] = char('0' + (octet / 100));
+      if (octet >= 10) text[length++] = char('0' + ((octet / 10) % 10));
+      text[length++] = char('0' + (octet % 10));
+    }
+  };
+
+  if (address.IsIPv4()) {
+    AppendIPv4(address.bytes.data());
+    return std::string(text, length);
+  }
+
+  uint16_t words[8];
+  for (size_t i = 0; i < 8; i++) {
+    words[i] = uint16_t((address.bytes[2 * i] << 8) | address.bytes[(2 * i) + 1]);
+  }
+
+  // IPv4 mapped addresses are written with the IPv4 address at the end, ie. "::ffff:192.168.0.3"
+  const bool ipv4_mapped = (words[0] == 0) && (words[1] == 0) && (words[2] == 0) && (words[3] == 0) && (words[4] == 0) && (words[5] == 0xffff);
+  const size_t nwords = ipv4_mapped ? 6 : 8;
+
+  // Find the longest run of at least two zero words, the first one wins a tie
+  size_t longest_start = SIZE_MAX;
+  size_t longest_length = 1;
+  for (size_t i = 0; i < nwords;) {
+    if (words[i] != 0) {
+      i++;
+      continue;
+    }
+
+    size_t end = i;
+    while ((end < nwords) && (words[end] == 0)) {
+      end++;
+    }
+
+    if ((end - i) > longest_length) {
+      longest_start = i;
+      longest_length = end - i;
+    }
+
+    i = end;
+  }
+
+  for (size_t i = 0; i < nwords; i++) {
+    if (i == longest_start) {
+      text[length++] = ':';
+      text[length++] = ':';
+      i += longest_length - 1;
+      continue;
+    }
+
+    if ((i != 0) && (i != (longest_start + longest_length))) {
+      text[length++] = ':';
+    }
+
+    // Lower case without leading zeros
+    const uint16_t word = words[i];
+    bool started = false;
+    for (int shift = 12; shift >= 0; shift -= 4) {
+      const uint16_t digit = (word >> shift) & 0xf;
+      if (started || (digit != 0) || (shift == 0)) {
+        text[length++] = hex[digit];
+        started = true;
+      }
+    }
+  }
+
+  if (ipv4_mapped) {
+    if (text[length - 1] != ':') {
+      text[length++] = ':';
+    }
+    AppendIPv4(&address.bytes[12]);
+  }
+
+  return std::string(text, length);
+}
+
+bool ParseAddress(std::string_view text, cIPAddress& out_address)
+{
+  out_address.Clear();
+
+  if (text.find(':') != std::string_view::npos) {
+    std::array<uint8_t, 16> bytes;
+    if (!ParseIPv6(text, bytes)) {
+      return false;
+    }
+
+    out_address = cIPAddress(bytes);
+    return true;
+  }
+
+  uint8_t octets[4];
+  if (!ParseIPv4(text, octets)) {
+    return false;
+  }
+
+  out_address = cIPAddress(octets[0], octets[1], octets[2], octets[3]);
+  return true;
 }
 
-bool ParseAddress(const std::string& text, cIPAddress& out_address)
+bool ParseAddressAndPort(std::string_view text, cIPAddress& out_address, uint16_t& out_port)
 {
   out_address.Clear();
+  out_port = 0;
+
+  std::string_view address;
+  std::string_view port;
 
-  // This isn't the best way of parsing the address, but it works for the straightforward cases at least
-  std::stringstream s(text);
-  int a,b,c,d;
-  char dot0,dot1,dot2;
-  s >> a >> dot0 >> b >> dot1 >> c >> dot2 >> d;
+  if (text.starts_with('[')) {
+    // "[2001:db8::3]:8443"
+    const size_t close = text.find(']');
+    if ((close == std::string_view::npos) || (text.substr(close + 1, 1) != ":")) {
+      return false;
+    }
 
-  if ((a < 0) || (a > 255) || (b < 0) || (b > 255) || (c < 0) || (c > 255) || (d < 0) || (d > 255)) {
-    std::cout<<"Invalid octet"<<std::endl;
+    address = text.substr(1, close - 1);
+    port = text.substr(close + 2);
+
+    // IPv4 addresses don't go in brackets
+    if (address.find(':') == std::string_view::npos) {
+      return false;
+    }
+  } else {
+    // "192.168.0.3:8443"
+    const size_t colon = text.find(':');
+    if ((colon == std::string_view::npos) || (text.find(':', colon + 1) != std::string_view::npos)) {
+      return false;
+    }
+
+    address = text.substr(0, colon);
+    port = text.substr(colon + 1);
+  }
+
+  uint32_t value = 0;
+  if (!ParseDecimal(port, 5, 65535, value) || (value == 0)) {
     return false;
-  } else if ((dot0 != '.') || (dot1 != '.') || (dot2 != '.')) {
-    std::cout<<"Invalid dot"<<std::endl;
+  }
+
+  if (!ParseAddress(address, out_address)) {
     return false;
-  } else if (s.rdbuf()->in_avail() != 0) {
-    std::cout<<"More data in the stringstream"<<std::endl;
-    // There is more after the IP address
+  }
+
+  out_port = uint16_t(value);
+  return true;
+}
+
+std::string ToString(const cIPNetwork& network)
+{
+  return ToString(network.address) + "/" + std::to_string(network.prefix_length);
+}
+
+bool ParseNetwork(std::string_view text, cIPNetwork& out_network)
+{
+  out_network = cIPNetwork();
+
+  const size_t slash = text.find('/');
+
+  cIPAddress address;
+  if (!ParseAddress(text.substr(0, slash), address)) {
+    return false;
+  }
+
+  const uint32_t max_prefix_length = address.IsIPv6() ? 128 : 32;
+  uint32_t prefix_length = max_prefix_length;
+  if ((slash != std::string_view::npos) && !ParseDecimal(text.substr(slash + 1), 3, max_prefix_length, prefix_length)) {
     return false;
   }
 
-  out_address.octet0 = a;
-  out_address.octet1 = b;
-  out_address.octet2 = c;
-  out_address.octet3 = d;
+  // Clear the bits after the prefix
+  for (size_t i = 0; i < address.bytes.size(); i++) {
+    const uint32_t first_bit = uint32_t(i * 8);
+    if (first_bit >= prefix_length) {
+      address.bytes[i] = 0;
+    } else if ((prefix_length - first_bit) < 8) {
+      address.bytes[i] &= uint8_t(0xff << (8 - (prefix_length - first_bit)));
+    }
+  }
 
+  out_network = cIPNetwork(address, uint8_t(prefix_length));
   return true;
 }
 
+socklen_t ToSockAddr(const cIPAddress& address, uint16_t port, struct sockaddr_storage& out_address)
+{
+  memset(&out_address, 0, sizeof(out_address));
+
+  if (address.IsIPv6()) {
+    struct sockaddr_in6* sad = reinterpret_cast<struct sockaddr_in6*>(&out_address);
+    sad->sin6_family = AF_INET6;
+    sad->sin6_port = htons(port);
+    memcpy(&sad->sin6_addr, address.bytes.data(), 16);
+    return sizeof(struct sockaddr_in6);
+  }
+
+  struct sockaddr_in* sad = reinterpret_cast<struct sockaddr_in*>(&out_address);
+  sad->sin_family = AF_INET;
+  sad->sin_port = htons(port);
+  memcpy(&sad->sin_addr, address.bytes.data(), 4);
+  return sizeof(struct sockaddr_in);
+}
+
+bool FromSockAddr(const struct sockaddr* address, cIPAddress& out_address)
+{
+  out_address.Clear();
+
+  if (address == nullptr) {
+    return false;
+  }
+
+  if (address->sa_family == AF_INET) {
+    const uint8_t* octets = reinterpret_cast<const uint8_t*>(&reinterpret_cast<const struct sockaddr_in*>(address)->sin_addr);
+    out_address = cIPAddress(octets[0], octets[1], octets[2], octets[3]);
+    return true;
+  } else if (address->sa_family == AF_INET6) {
+    std::array<uint8_t, 16> bytes;
+    memcpy(bytes.data(), &reinterpret_cast<const struct sockaddr_in6*>(address)->sin6_addr, 16);
+
+    // "::ffff:192.168.0.3"
+    const uint8_t ipv4_mapped_prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+    if (memcmp(bytes.data(), ipv4_mapped_prefix, sizeof(ipv4_mapped_prefix)) == 0) {
+      out_address = cIPAddress(bytes[12], bytes[13], bytes[14], bytes[15]);
+    } else {
+      out_address = cIPAddress(bytes);
+    }
+    return true;
+  }
+
+  return false;
+}
+
 }
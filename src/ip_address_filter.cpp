@@ -0,0 +1,96 @@
+#include "ip_address_filter.h"
+
+namespace util {
+
+namespace {
+
+uint8_t GetBit(const cIPAddress& address, size_t bit)
+{
+  return (address.bytes[bit / 8] >> (7 - (bit % 8))) & 1;
+}
+
+}
+
+cIPAddressFilter::cIPAddressFilter() :
+  default_allowed(true)
+{
+}
+
+void cIPAddressFilter::Create(const std::vector<cIPNetwork>& allow, const std::vector<cIPNetwork>& deny)
+{
+  Clear();
+
+  if (allow.empty() && deny.empty()) {
+    // Disabled, every client is allowed
+    return;
+  }
+
+  default_allowed = allow.empty();
+
+  nodes.push_back({ { 0, 0 }, RULE::NONE }); // IPV4_ROOT
+  nodes.push_back({ { 0, 0 }, RULE::NONE }); // IPV6_ROOT
+
+  for (auto&& network : allow) {
+    Insert(network, RULE::ALLOW);
+  }
+
+  // The deny rules go in last so that they replace an allow rule for the same network
+  for (auto&& network : deny) {
+    Insert(network, RULE::DENY);
+  }
+}
+
+void cIPAddressFilter::Clear()
+{
+  default_allowed = true;
+  nodes.clear();
+}
+
+void cIPAddressFilter::Insert(const cIPNetwork& network, RULE rule)
+{
+  uint32_t index = network.address.IsIPv6() ? IPV6_ROOT : IPV4_ROOT;
+
+  for (size_t bit = 0; bit < network.prefix_length; bit++) {
+    const uint8_t value = GetBit(network.address, bit);
+    if (nodes[index].children[value] == 0) {
+      nodes[index].children[value] = uint32_t(nodes.size());
+      nodes.push_back({ { 0, 0 }, RULE::NONE });
+    }
+
+    index = nodes[index].children[value];
+  }
+
+  nodes[index].rule = rule;
+}
+
+bool cIPAddressFilter::IsAllowed(const cIPAddress& address) const
+{
+  if (!IsEnabled()) {
+    return true;
+  }
+
+  const size_t bit_count = address.IsIPv6() ? 128 : 32;
+
+  uint32_t index = address.IsIPv6() ? IPV6_ROOT : IPV4_ROOT;
+  RULE matched = nodes[index].rule;
+
+  // Follow the address down the trie, remembering the rule of the most specific network it is in
+  for (size_t bit = 0; bit < bit_count; bit++) {
+    index = nodes[index].children[GetBit(address, bit)];
+    if (index == 0) {
+      break;
+    }
+
+    if (nodes[index].rule != RULE::NONE) {
+      matched = nodes[index].rule;
+    }
+  }
+
+  if (matched == RULE::NONE) {
+    return default_allowed;
+  }
+
+  return (matched == RULE::ALLOW);
+}
+
+}
@@ -1,9 +1,9 @@
 #include <climits>
 
 #include <string>
-#include <iostream>
 
 #include "json.h"
+#include "log.h"
 
 namespace json {
 
@@ -13,19 +13,19 @@ bool JSONParseString(const struct json_object* json, const std::string& name, st
 
   struct json_object* obj = json_object_object_get(json, name.c_str());
   if (obj == nullptr) {
-    std::cerr<<name<<" not found"<<std::endl;
+    LOG_ERROR<<name<<" not found";
     return false;
   }
 
   enum json_type type = json_object_get_type(obj);
   if (type != json_type_string) {
-    std::cerr<<name<<" is not a string"<<std::endl;
+    LOG_ERROR<<name<<" is not a string";
     return false;
   }
 
   const char* value = json_object_get_string(obj);
   if (value == nullptr) {
-    std::cerr<<name<<" is not valid"<<std::endl;
+    LOG_ERROR<<name<<" is not valid";
     return false;
   }
 
@@ -40,13 +40,13 @@ bool JSONParseBool(const struct json_object* json, const std::string& name, bool
 
   struct json_object* obj = json_object_object_get(json, name.c_str());
   if (obj == nullptr) {
-    std::cerr<<name<<" not found"<<std::endl;
+    LOG_ERROR<<name<<" not found";
     return false;
   }
 
   enum json_type type = json_object_get_type(obj);
   if (type != json_type_boolean) {
-    std::cerr<<name<<" is not a bool"<<std::endl;
+    LOG_ERROR<<name<<" is not a bool";
     return false;
   }
 
@@ -61,19 +61,19 @@ bool JSONParseUint16(const struct json_object* json, const std::string& name, ui
 
   struct json_object* obj = json_object_object_get(json, name.c_str());
   if (obj == nullptr) {
-    std::cerr<<name<<" not found"<<std::endl;
+    LOG_ERROR<<name<<" not found";
     return false;
   }
 
   enum json_type type = json_object_get_type(obj);
   if (type != json_type_int) {
-    std::cerr<<name<<" is not an int"<<std::endl;
+    LOG_ERROR<<name<<" is not an int";
     return false;
   }
 
   const int value = json_object_get_int(obj);
   if ((value <= 0) || (value > USHRT_MAX)) {
-    std::cerr<<name<<" is not valid"<<std::endl;
+    LOG_ERROR<<name<<" is not valid";
     return false;
   }
 
@@ -87,13 +87,13 @@ bool JSONParseUint64(const struct json_object* json, const std::string& name, ui
 
   struct json_object* obj = json_object_object_get(json, name.c_str());
   if (obj == nullptr) {
-    std::cerr<<name<<" not found"<<std::endl;
+    LOG_ERROR<<name<<" not found";
     return false;
   }
 
   enum json_type type = json_object_get_type(obj);
   if (type != json_type_int) {
-    std::cerr<<name<<" is not an int"<<std::endl;
+    LOG_ERROR<<name<<" is not an int";
     return false;
   }
 
@@ -103,4 +103,35 @@ bool JSONParseUint64(const struct json_object* json, const std::string& name, ui
   return true;
 }
 
+bool JSONParseStringArray(const struct json_object* json, const std::string& name, std::vector<std::string>& out_values)
+{
+  out_values.clear();
+
+  struct json_object* obj = json_object_object_get(json, name.c_str());
+  if (obj == nullptr) {
+    LOG_ERROR<<name<<" not found";
+    return false;
+  }
+
+  enum json_type type = json_object_get_type(obj);
+  if (type != json_type_array) {
+    LOG_ERROR<<name<<" is not an array";
+    return false;
+  }
+
+  const size_t n = json_object_array_length(obj);
+  for (size_t i = 0; i < n; i++) {
+    struct json_object* item = json_object_array_get_idx(obj, i);
+    if (json_object_get_type(item) != json_type_string) {
+      LOG_ERROR<<name<<" contains an item that is not a string";
+      out_values.clear();
+      return false;
+    }
+
+    out_values.push_back(json_object_get_string(item));
+  }
+
+  return true;
+}
+
 }
@@ -0,0 +1,370 @@
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "log.h"
+
+namespace logging {
+
+namespace {
+
+class cLogRecord {
+public:
+  LEVEL level;
+  size_t length;
+  char text[MAX_LINE_LENGTH];
+};
+
+// ** cThreadLogBuffer
+//
+// A single producer single consumer queue of log lines, the thread that owns it is the only producer and the writer thread is the only consumer
+//
+class cThreadLogBuffer {
+public:
+  cThreadLogBuffer();
+
+  // Returns false if the buffer is full, out_half_full is set once the buffer is at least half full so that the writer thread can be woken up
+  bool Push(LEVEL level, std::string_view text, bool& out_half_full);
+  const cLogRecord* Front() const;
+  void Pop();
+
+  std::atomic<bool> thread_exited;
+
+private:
+  static const size_t CAPACITY = 64; // Must be a power of two
+
+  std::array<cLogRecord, CAPACITY> records;
+  std::atomic<size_t> write_index; // Only written by the producer
+  std::atomic<size_t> read_index; // Only written by the consumer
+};
+
+cThreadLogBuffer::cThreadLogBuffer() :
+  thread_exited(false),
+  write_index(0),
+  read_index(0)
+{
+}
+
+bool cThreadLogBuffer::Push(LEVEL level, std::string_view text, bool& out_half_full)
+{
+  const size_t write = write_index.load(std::memory_order_relaxed);
+  const size_t queued = write - read_index.load(std::memory_order_acquire);
+  out_half_full = ((queued + 1) >= (CAPACITY / 2));
+  if (queued >= CAPACITY) {
+    // The buffer is full
+    return false;
+  }
+
+  cLogRecord& record = records[write & (CAPACITY - 1)];
+  record.level = level;
+  record.length = std::min(text.length(), MAX_LINE_LENGTH);
+  memcpy(record.text, text.data(), record.length);
+
+  // Publish the record to the writer thread
+  write_index.store(write + 1, std::memory_order_release);
+  return true;
+}
+
+const cLogRecord* cThreadLogBuffer::Front() const
+{
+  const size_t read = read_index.load(std::memory_order_relaxed);
+  if (read == write_index.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  return &records[read & (CAPACITY - 1)];
+}
+
+void cThreadLogBuffer::Pop()
+{
+  read_index.store(read_index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+
+// Registered buffers, this is only locked when a thread logs for the first time and by the writer thread
+std::mutex mutex_buffers;
+std::vector<std::shared_ptr<cThreadLogBuffer>> buffers;
+
+// Serialises synchronous writes when the writer thread is not running
+std::mutex mutex_output;
+
+std::atomic<bool> writer_running(false);
+std::atomic<bool> writer_stop(false);
+std::thread writer_thread;
+
+// The writer thread wakes up this often to write whatever has been queued, or sooner if a buffer is filling up
+const std::chrono::milliseconds WRITER_INTERVAL(10);
+
+// NOTE: The producers set writer_wake and notify without locking, a notification that is missed just means the writer waits for the rest of the interval
+std::mutex mutex_writer_wake;
+std::condition_variable cv_writer_wake;
+std::atomic<bool> writer_wake(false);
+
+std::atomic<uint64_t> dropped_count(0);
+
+// How often the writer thread reports the lines that have been dropped
+const std::chrono::seconds DROPPED_REPORT_INTERVAL(1);
+
+// Marks the buffer as finished when the thread exits, the writer thread then writes whatever is left and releases it
+class cThreadLogBufferOwner {
+public:
+  cThreadLogBufferOwner();
+  ~cThreadLogBufferOwner();
+
+  std::shared_ptr<cThreadLogBuffer> buffer;
+};
+
+cThreadLogBufferOwner::cThreadLogBufferOwner() :
+  buffer(std::make_shared<cThreadLogBuffer>())
+{
+  std::lock_guard<std::mutex> lock(mutex_buffers);
+  buffers.push_back(buffer);
+}
+
+cThreadLogBufferOwner::~cThreadLogBufferOwner()
+{
+  buffer->thread_exited.store(true, std::memory_order_release);
+}
+
+cThreadLogBuffer& GetThreadLogBuffer()
+{
+  thread_local cThreadLogBufferOwner owner;
+  return *owner.buffer;
+}
+
+FILE* GetOutput(LEVEL level)
+{
+  return (level >= LEVEL::WARNING) ? stderr : stdout;
+}
+
+void WriteLine(LEVEL level, std::string_view text)
+{
+  // Lock the stream so that a line written synchronously can't land in the middle of a line from the writer thread
+  FILE* output = GetOutput(level);
+  flockfile(output);
+  fwrite_unlocked(text.data(), 1, text.length(), output);
+  fputc_unlocked('\n', output);
+  funlockfile(output);
+}
+
+// Write everything that is currently queued, returns true if anything was written
+bool WriteQueuedLines()
+{
+  bool written = false;
+
+  std::lock_guard<std::mutex> lock(mutex_buffers);
+
+  for (auto iter = buffers.begin(); iter != buffers.end();) {
+    cThreadLogBuffer& buffer = **iter;
+
+    // Check this first so that we don't miss any lines that were written just before the thread exited
+    const bool thread_exited = buffer.thread_exited.load(std::memory_order_acquire);
+
+    const cLogRecord* record = buffer.Front();
+    while (record != nullptr) {
+      WriteLine(record->level, std::string_view(record->text, record->length));
+      buffer.Pop();
+      written = true;
+
+      record = buffer.Front();
+    }
+
+    if (thread_exited) {
+      iter = buffers.erase(iter);
+    } else {
+      iter++;
+    }
+  }
+
+  if (written) {
+    // One flush per batch rather than one per line
+    fflush(stdout);
+    fflush(stderr);
+  }
+
+  return written;
+}
+
+// Write a warning with the number of lines that have been dropped since the last report, if there are any
+void ReportDroppedLines(uint64_t& reported_count)
+{
+  const uint64_t count = dropped_count.load(std::memory_order_relaxed);
+  if (count == reported_count) {
+    return;
+  }
+
+  char text[64];
+  const std::to_chars_result result = std::to_chars(text, text + sizeof(text), count - reported_count);
+  const std::string_view suffix = " log lines dropped";
+  memcpy(result.ptr, suffix.data(), suffix.length());
+  WriteLine(LEVEL::WARNING, std::string_view(text, (result.ptr - text) + suffix.length()));
+  fflush(GetOutput(LEVEL::WARNING));
+
+  reported_count = count;
+}
+
+void WriterThreadFunction()
+{
+  uint64_t reported_count = dropped_count.load(std::memory_order_relaxed);
+  std::chrono::steady_clock::time_point next_report = std::chrono::steady_clock::now() + DROPPED_REPORT_INTERVAL;
+
+  while (!writer_stop.load(std::memory_order_acquire)) {
+    // Wait for a little while if there was nothing to write
+    if (!WriteQueuedLines()) {
+      std::unique_lock<std::mutex> lock(mutex_writer_wake);
+      cv_writer_wake.wait_for(lock, WRITER_INTERVAL, []() { return writer_wake.load(std::memory_order_acquire); });
+    }
+    writer_wake.store(false, std::memory_order_release);
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now >= next_report) {
+      ReportDroppedLines(reported_count);
+      next_report = now + DROPPED_REPORT_INTERVAL;
+    }
+  }
+
+  // Write anything that was queued while we were stopping
+  WriteQueuedLines();
+  ReportDroppedLines(reported_count);
+}
+
+void WakeWriterThread()
+{
+  writer_wake.store(true, std::memory_order_release);
+  cv_writer_wake.notify_one();
+}
+
+}
+
+bool Start()
+{
+  if (writer_running.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  writer_stop.store(false, std::memory_order_release);
+  writer_thread = std::thread(&WriterThreadFunction);
+  writer_running.store(true, std::memory_order_release);
+
+  return true;
+}
+
+void Stop()
+{
+  if (!writer_running.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  // Anything logged from here on is written synchronously
+  // NOTE: This pairs with the fence in Write, either we see a line that a thread queued or it sees that we have stopped and writes it itself
+  writer_running.store(false, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  writer_stop.store(true, std::memory_order_release);
+  WakeWriterThread();
+  writer_thread.join();
+
+  // A thread that checked writer_running just before we cleared it may have queued a line after the writer thread finished
+  std::lock_guard<std::mutex> lock(mutex_output);
+  WriteQueuedLines();
+}
+
+uint64_t GetDroppedCount()
+{
+  return dropped_count.load(std::memory_order_relaxed);
+}
+
+void Write(LEVEL level, std::string_view text)
+{
+  if (!writer_running.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(mutex_output);
+    WriteLine(level, text);
+    fflush(GetOutput(level));
+    return;
+  }
+
+  bool half_full = false;
+  if (GetThreadLogBuffer().Push(level, text, half_full)) {
+    // If Stop has started since we checked, it may have already made its final pass over the buffers, so write our line ourselves
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!writer_running.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(mutex_output);
+      WriteQueuedLines();
+      return;
+    }
+
+    if (half_full) {
+      WakeWriterThread();
+    }
+    return;
+  }
+
+  WakeWriterThread();
+
+  if (level >= LEVEL::WARNING) {
+    // Warnings and errors are never dropped, if the writer thread has fallen behind we write them ourselves
+    // NOTE: This line may be written before some of the lines that this thread queued earlier
+    std::lock_guard<std::mutex> lock(mutex_output);
+    WriteLine(level, text);
+    fflush(GetOutput(level));
+    return;
+  }
+
+  // NOTE: We never block for less important lines, if the writer thread has fallen behind we drop the line rather than slowing down the caller
+  dropped_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+cLogLine::cLogLine(LEVEL _level) :
+  level(_level),
+  length(0)
+{
+}
+
+cLogLine::~cLogLine()
+{
+  Write(level, std::string_view(text, length));
+}
+
+void cLogLine::Append(std::string_view value)
+{
+  const size_t n = std::min(value.length(), MAX_LINE_LENGTH - length);
+  memcpy(text + length, value.data(), n);
+  length += n;
+}
+
+cLogLine& cLogLine::operator<<(const quoted& value)
+{
+  const char* hex = "0123456789abcdef";
+
+  Append("\"");
+
+  for (char c : value.value) {
+    const uint8_t u = static_cast<uint8_t>(c);
+    if ((c == '"') || (c == '\\')) {
+      const char escaped[2] = { '\\', c };
+      Append(std::string_view(escaped, sizeof(escaped)));
+    } else if ((u < 0x20) || (u == 0x7f)) {
+      // Control characters could be used to forge log lines
+      const char escaped[4] = { '\\', 'x', hex[u >> 4], hex[u & 0xf] };
+      Append(std::string_view(escaped, sizeof(escaped)));
+    } else {
+      Append(std::string_view(&c, 1));
+    }
+  }
+
+  Append("\"");
+
+  return *this;
+}
+
+}
@@ -1,9 +1,14 @@
 #include <sysexits.h>
 
+#include <charconv>
 #include <iostream>
 #include <sstream>
+#include <string_view>
 
+#include "log.h"
+#include "prefork.h"
 #include "settings.h"
+#include "socket_handoff.h"
 #include "task_tracker.h"
 #include "version.h"
 
@@ -21,10 +26,22 @@ void PrintVersion()
   std::cout<<"task-trackerd version "<<version<<std::endl;
 }
 
+bool ParseFileDescriptor(std::string_view argument, int& out_fd)
+{
+  const std::from_chars_result result = std::from_chars(argument.data(), argument.data() + argument.length(), out_fd);
+  return ((result.ec == std::errc()) && (result.ptr == (argument.data() + argument.length())) && (out_fd >= 0));
+}
+
 }
 
 int main(int argc, char* argv[])
 {
+  // In prefork mode the tracker process starts each worker process with the file descriptor of the feed snapshot
+  int feed_snapshot_fd = -1;
+
+  // On SIGUSR2 the running process starts its replacement with the socket that it passes the listening sockets over
+  int handoff_socket = -1;
+
   if (argc == 2) {
     const std::string argument(argv[1]);
     if ((argument == "-v") || (argument == "--version")) {
@@ -35,6 +52,16 @@ int main(int argc, char* argv[])
       tasktracker::PrintUsage();
       return EX_USAGE;
     }
+  } else if ((argc == 3) && (std::string_view(argv[1]) == tasktracker::PREFORK_WORKER_ARGUMENT)) {
+    if (!tasktracker::ParseFileDescriptor(argv[2], feed_snapshot_fd)) {
+      tasktracker::PrintUsage();
+      return EX_USAGE;
+    }
+  } else if ((argc == 3) && (std::string_view(argv[1]) == tasktracker::HANDOFF_ARGUMENT)) {
+    if (!tasktracker::ParseFileDescriptor(argv[2], handoff_socket)) {
+      tasktracker::PrintUsage();
+      return EX_USAGE;
+    }
   } else if (argc != 1) {
     // Incorrect number of arguments, print the usage and exit
     tasktracker::PrintUsage();
@@ -42,14 +69,20 @@ int main(int argc, char* argv[])
   }
 
 
-  // Parse the configuration file
-  tasktracker::cSettings settings;
-  if (!settings.LoadFromFile("./configuration/configuration.json")) {
-    std::cerr<<"Error parsing configuration/configuration.json"<<std::endl;
+  // Write log lines from a background thread from here on
+  logging::Start();
+
+  // Parse the configuration file, it is parsed again when the settings are reloaded
+  tasktracker::cSettingsStore settings_store("./configuration/configuration.json");
+  if (!settings_store.Load()) {
+    LOG_ERROR<<"Error parsing configuration/configuration.json";
+    logging::Stop();
     return EXIT_FAILURE;
   }
 
-  const bool result = tasktracker::RunServer(settings);
+  const bool result = (feed_snapshot_fd >= 0) ? tasktracker::RunPreforkWorker(settings_store, feed_snapshot_fd) : tasktracker::RunServer(settings_store, handoff_socket);
+
+  logging::Stop();
 
   return (result ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -0,0 +1,354 @@
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "feed_cache.h"
+#include "feed_data.h"
+#include "feed_snapshot.h"
+#include "log.h"
+#include "poll_helper.h"
+#include "prefork.h"
+#include "settings_watcher.h"
+#include "socket_handoff.h"
+#include "task_tracker.h"
+#include "tls_session_resumption.h"
+#include "util.h"
+#include "web_server.h"
+
+namespace tasktracker {
+
+namespace {
+
+// Room for every view of the feed and all of their compressed variants, the feed is limited to MAX_FEED_ENTRIES entries so this is plenty
+// NOTE: The memfd only uses memory for the pages that are written to
+const size_t FEED_SNAPSHOT_DATA_SIZE_BYTES = 16 * 1024 * 1024;
+
+// ** cFeedSnapshotPublisher
+//
+// Renders each view of the feed in the tracker process and publishes them to the snapshot whenever the feed data changes
+//
+class cFeedSnapshotPublisher {
+public:
+  cFeedSnapshotPublisher(const std::vector<cFeedView>& feed_views, cFeedSnapshot& feed_snapshot);
+
+  // Publish the feed if the feed data has changed since the last time, and pass on when the next poll is
+  bool Update();
+
+private:
+  cFeedSnapshot& feed_snapshot;
+  std::vector<std::unique_ptr<cFeedRenderCache>> feed_render_caches; // For each view, in the same order as the settings
+  bool published;
+  uint64_t published_generation;
+};
+
+cFeedSnapshotPublisher::cFeedSnapshotPublisher(const std::vector<cFeedView>& feed_views, cFeedSnapshot& _feed_snapshot) :
+  feed_snapshot(_feed_snapshot),
+  published(false),
+  published_generation(0)
+{
+  for (auto&& feed_view : feed_views) {
+    feed_render_caches.push_back(std::make_unique<cFeedRenderCache>(feed_view.filter));
+  }
+}
+
+bool cFeedSnapshotPublisher::Update()
+{
+  // The next poll moves on even when the feed doesn't change
+  const std::optional<std::chrono::system_clock::time_point> next_update = GetNextFeedUpdate();
+  if (next_update) {
+    feed_snapshot.SetNextUpdate(*next_update);
+  }
+
+  const uint64_t generation = feed_data_generation.load(std::memory_order_acquire);
+  if (published && (generation == published_generation)) {
+    return true;
+  }
+
+  // NOTE: If this fails we don't try again until the feed data changes
+  published = true;
+  published_generation = generation;
+
+  std::vector<std::shared_ptr<const cRenderedFeed>> rendered_views;
+  for (auto&& feed_render_cache : feed_render_caches) {
+    rendered_views.push_back(feed_render_cache->Get());
+  }
+
+  if (!feed_snapshot.Publish(rendered_views)) {
+    LOG_ERROR<<"cFeedSnapshotPublisher::Update Error publishing the feed snapshot";
+    return false;
+  }
+
+  LOG_INFO<<"cFeedSnapshotPublisher::Update Published feed snapshot generation "<<feed_snapshot.GetGeneration();
+  return true;
+}
+
+
+// Start a worker process, it runs this executable again rather than carrying on from fork, we have threads running and the child would only get a copy of this one
+pid_t StartWorkerProcess(int feed_snapshot_fd)
+{
+  // Everything the child needs is prepared before forking, between fork and exec the child can only make async signal safe calls
+  const pid_t parent_pid = getpid();
+  const std::string fd_text = std::to_string(feed_snapshot_fd);
+  char* const arguments[] = { const_cast<char*>("task-trackerd"), const_cast<char*>(PREFORK_WORKER_ARGUMENT), const_cast<char*>(fd_text.c_str()), nullptr };
+
+  const pid_t pid = fork();
+  if (pid < 0) {
+    LOG_ERROR<<"StartWorkerProcess fork failed "<<strerror(errno);
+    return -1;
+  } else if (pid == 0) {
+    // Stop the worker if the tracker process goes away, if it already went away before we got here then give up
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != parent_pid) {
+      _exit(EXIT_FAILURE);
+    }
+
+    execv("/proc/self/exe", arguments);
+    _exit(EX_OSERR);
+  }
+
+  LOG_INFO<<"StartWorkerProcess Started worker process "<<pid;
+  return pid;
+}
+
+// Collect any worker processes that have exited, returns false if a worker failed rather than crashed
+// A worker that crashed is marked as not running so that it is started again, but a worker that failed (ie. it couldn't bind the port) would just fail again
+bool ReapWorkerProcesses(std::vector<pid_t>& workers)
+{
+  bool result = true;
+
+  // NOTE: We only wait for our workers, any other child processes are left for whoever started them
+  for (auto&& worker : workers) {
+    if (worker <= 0) {
+      continue;
+    }
+
+    int status = 0;
+    const pid_t pid = waitpid(worker, &status, WNOHANG);
+    if (pid != worker) {
+      continue;
+    }
+
+    worker = -1;
+
+    if (WIFSIGNALED(status)) {
+      LOG_WARNING<<"ReapWorkerProcesses Worker process "<<pid<<" was killed by signal "<<WTERMSIG(status)<<", restarting it";
+    } else {
+      LOG_ERROR<<"ReapWorkerProcesses Worker process "<<pid<<" exited with status "<<WEXITSTATUS(status);
+      result = false;
+    }
+  }
+
+  return result;
+}
+
+void StopWorkerProcesses(std::vector<pid_t>& workers)
+{
+  // Ask them all to stop first so that they drain their connections at the same time
+  for (auto&& worker : workers) {
+    if (worker > 0) {
+      kill(worker, SIGTERM);
+    }
+  }
+
+  for (auto&& worker : workers) {
+    if (worker > 0) {
+      int status = 0;
+      waitpid(worker, &status, 0);
+      worker = -1;
+    }
+  }
+}
+
+}
+
+bool RunPreforkServer(cSettingsStore& settings_store)
+{
+  const std::shared_ptr<const cSettings> settings = settings_store.Get();
+
+  const size_t worker_processes = settings->GetWebServerOptions().worker_processes;
+  LOG_INFO<<"RunPreforkServer Starting "<<worker_processes<<" worker processes";
+
+  cFeedSnapshot feed_snapshot;
+  if (!feed_snapshot.Create(settings->GetFeedViews().size(), FEED_SNAPSHOT_DATA_SIZE_BYTES)) {
+    LOG_ERROR<<"RunPreforkServer Error creating the feed snapshot";
+    return false;
+  }
+
+  // Generate one session ticket key for all of the workers, otherwise a client could only resume its session if it reached the worker that it got its ticket from
+  if (settings->GetWebServerOptions().tls_session_tickets) {
+    cTLSSessionTicketKey& ticket_key = GetTLSSessionTicketKey();
+    if (!ticket_key.Generate() || !feed_snapshot.SetTLSSessionTicketKey(ticket_key)) {
+      LOG_ERROR<<"RunPreforkServer Error creating the session ticket key";
+      return false;
+    }
+  }
+
+  // Publish the feed before starting the workers so that they always have something to serve
+  std::unique_ptr<cFeedSnapshotPublisher> publisher = std::make_unique<cFeedSnapshotPublisher>(settings->GetFeedViews(), feed_snapshot);
+  if (!publisher->Update()) {
+    return false;
+  }
+
+  if (!settings->GetRunningInContainer()) {
+    LOG_INFO<<"Press enter to shutdown the server";
+  }
+
+  cSettingsWatcher settings_watcher;
+  settings_watcher.Create({ settings_store.GetFilePath(), settings->GetHTTPSPrivateKey(), settings->GetHTTPSPublicCert() });
+
+  InstallShutdownSignalHandler();
+
+  // Otherwise SIGUSR2 would kill us
+  InstallHandOffSignalHandler();
+
+  std::vector<pid_t> workers(worker_processes, -1);
+  poll_read stdin_poll(STDIN_FILENO);
+  bool result = true;
+
+  while (true) {
+    // Start any workers that are not running, this also restarts a worker that crashed
+    for (auto&& worker : workers) {
+      if (worker < 0) {
+        worker = StartWorkerProcess(feed_snapshot.GetFD());
+      }
+    }
+
+    if (settings->GetRunningInContainer()) {
+      util::msleep(500);
+    } else if (stdin_poll.poll(500) == POLL_READ_RESULT::DATA_READY) {
+      (void)getc(stdin);
+      break;
+    }
+
+    if (IsShutdownRequested()) {
+      LOG_INFO<<"Received a signal to shutdown";
+      break;
+    }
+
+    if (IsHandOffRequested()) {
+      LOG_WARNING<<"RunPreforkServer Handing off the listening sockets is not supported in prefork mode, ignoring SIGUSR2";
+    }
+
+    if (settings_watcher.IsReloadRequested() && settings_store.Load()) {
+      const std::shared_ptr<const cSettings> reloaded_settings = settings_store.Get();
+
+      // The snapshot has a fixed number of views
+      if (reloaded_settings->GetFeedViews().size() == feed_snapshot.GetViewCount()) {
+        // Publish the new views, then let the workers pick up the new tokens and certificate
+        publisher = std::make_unique<cFeedSnapshotPublisher>(reloaded_settings->GetFeedViews(), feed_snapshot);
+        publisher->Update();
+
+        for (auto&& worker : workers) {
+          if (worker > 0) {
+            kill(worker, SIGHUP);
+          }
+        }
+      } else {
+        LOG_WARNING<<"RunPreforkServer The number of feed views has changed, restart to apply it";
+      }
+
+      settings_watcher.Create({ settings_store.GetFilePath(), reloaded_settings->GetHTTPSPrivateKey(), reloaded_settings->GetHTTPSPublicCert() });
+    }
+
+    publisher->Update();
+
+    if (!ReapWorkerProcesses(workers)) {
+      result = false;
+      break;
+    }
+  }
+
+  LOG_INFO<<"Shutting down server";
+  StopWorkerProcesses(workers);
+
+  LOG_INFO<<"Server has been shutdown";
+  return result;
+}
+
+bool RunPreforkWorker(cSettingsStore& settings_store, int feed_snapshot_fd)
+{
+  LOG_INFO<<"RunPreforkWorker Running worker process "<<getpid();
+
+  // Block the signals that stop us before starting any threads, they inherit the mask so only the sigwait below sees them
+  // SIGHUP from the tracker process reloads the settings
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGHUP);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  // The worker processes can't hand off their sockets, a stray SIGUSR2 stays blocked rather than killing us
+  sigset_t ignored_signals;
+  sigemptyset(&ignored_signals);
+  sigaddset(&ignored_signals, SIGUSR2);
+  pthread_sigmask(SIG_BLOCK, &ignored_signals, nullptr);
+
+  const std::shared_ptr<const cSettings> settings = settings_store.Get();
+
+  cFeedSnapshot feed_snapshot;
+  if (!feed_snapshot.Open(feed_snapshot_fd)) {
+    LOG_ERROR<<"RunPreforkWorker Error opening the feed snapshot";
+    return false;
+  }
+
+  // The tracker process read the same settings, but check in case they were changed in between
+  if (feed_snapshot.GetViewCount() != settings->GetFeedViews().size()) {
+    LOG_ERROR<<"RunPreforkWorker The feed snapshot has "<<feed_snapshot.GetViewCount()<<" views, but the settings have "<<settings->GetFeedViews().size();
+    return false;
+  }
+
+  cWebServerOptions options = settings->GetWebServerOptions();
+  options.reuse_port = true;
+
+  // Use the session ticket key that the tracker process generated so that the other workers can resume our sessions
+  if (options.tls_session_tickets && !feed_snapshot.GetTLSSessionTicketKey(GetTLSSessionTicketKey())) {
+    LOG_WARNING<<"RunPreforkWorker The feed snapshot doesn't have a session ticket key, sessions can only be resumed with this worker";
+  }
+
+  cWebServerManager web_server_manager;
+  const bool fuzzing = false;
+  if (!web_server_manager.Create(settings->GetListenEndpoints(), settings->GetHTTPSPrivateKey(), settings->GetHTTPSPublicCert(), fuzzing, settings->GetFeedViews(), options, &feed_snapshot)) {
+    LOG_ERROR<<"RunPreforkWorker Error creating web server";
+    return false;
+  }
+
+  while (true) {
+    int signal_number = 0;
+    sigwait(&signals, &signal_number);
+    if (signal_number != SIGHUP) {
+      break;
+    }
+
+    if (settings_store.Load()) {
+      const std::shared_ptr<const cSettings> reloaded_settings = settings_store.Get();
+      if (reloaded_settings->GetFeedViews().size() == feed_snapshot.GetViewCount()) {
+        web_server_manager.Reload(reloaded_settings->GetFeedViews(), reloaded_settings->GetHTTPSPrivateKey(), reloaded_settings->GetHTTPSPublicCert());
+      } else {
+        LOG_WARNING<<"RunPreforkWorker The number of feed views has changed, restart to apply it";
+      }
+    }
+  }
+
+  LOG_INFO<<"RunPreforkWorker Shutting down worker process "<<getpid();
+  if (!web_server_manager.Destroy()) {
+    LOG_ERROR<<"RunPreforkWorker Error destroying web server";
+    return false;
+  }
+
+  return true;
+}
+
+}
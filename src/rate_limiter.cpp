@@ -0,0 +1,132 @@
+#include <algorithm>
+
+#include "log.h"
+#include "rate_limiter.h"
+
+namespace util {
+
+cRateLimiter::cRateLimiter() :
+  requests_per_minute(0),
+  capacity(0)
+{
+}
+
+bool cRateLimiter::Create(uint32_t _requests_per_minute, uint32_t burst, size_t set_count)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+
+  requests_per_minute = 0;
+  capacity = 0;
+  sets.clear();
+  counters = cRateLimiterCounters();
+
+  if (_requests_per_minute == 0) {
+    // Disabled
+    return true;
+  }
+
+  if ((burst == 0) || (burst > (UINT32_MAX / TOKEN))) {
+    LOG_ERROR<<"cRateLimiter::Create Invalid burst "<<burst;
+    return false;
+  }
+
+  size_t rounded_set_count = 1;
+  while (rounded_set_count < set_count) {
+    rounded_set_count *= 2;
+  }
+
+  requests_per_minute = _requests_per_minute;
+  capacity = burst * TOKEN;
+  epoch = std::chrono::steady_clock::now();
+  sets.assign(rounded_set_count, cSet());
+
+  return true;
+}
+
+uint32_t cRateLimiter::GetRefilledTokens(const cBucket& bucket, uint32_t now_ms) const
+{
+  const uint64_t elapsed_ms = uint32_t(now_ms - bucket.updated_ms);
+  return uint32_t(std::min<uint64_t>(capacity, bucket.tokens + (elapsed_ms * requests_per_minute)));
+}
+
+bool cRateLimiter::TryTake(uint64_t key, uint32_t& out_retry_after_seconds)
+{
+  return TryTake(key, std::chrono::steady_clock::now(), out_retry_after_seconds);
+}
+
+bool cRateLimiter::TryTake(uint64_t key, std::chrono::steady_clock::time_point now, uint32_t& out_retry_after_seconds)
+{
+  out_retry_after_seconds = 0;
+
+  if (!IsEnabled()) {
+    return true;
+  }
+
+  // 0 marks an empty bucket
+  if (key == 0) {
+    key = 1;
+  }
+
+  // NOTE: A time from before the limiter was created counts as the moment it was created
+  const uint32_t now_ms = (now > epoch) ? uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(now - epoch).count()) : 0;
+
+  // Mix the key so that the set depends on all of its bits
+  const size_t index = size_t((key * 0x9e3779b97f4a7c15ull) >> 32) & (sets.size() - 1);
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  cSet& set = sets[index];
+  cBucket* bucket = nullptr;
+  cBucket* victim = nullptr;
+  uint64_t victim_score = 0;
+
+  for (auto&& candidate : set.buckets) {
+    if (candidate.key == key) {
+      bucket = &candidate;
+      break;
+    }
+
+    // Prefer an empty bucket or one that has refilled, otherwise the one that has been idle the longest
+    const bool aged_out = (candidate.key == 0) || (GetRefilledTokens(candidate, now_ms) == capacity);
+    const uint64_t score = aged_out ? UINT64_MAX : uint32_t(now_ms - candidate.updated_ms);
+    if ((victim == nullptr) || (score > victim_score)) {
+      victim = &candidate;
+      victim_score = score;
+    }
+  }
+
+  if (bucket != nullptr) {
+    bucket->tokens = GetRefilledTokens(*bucket, now_ms);
+  } else {
+    if (victim_score != UINT64_MAX) {
+      counters.replaced++;
+    }
+
+    // A new client starts with a full bucket
+    bucket = victim;
+    bucket->key = key;
+    bucket->tokens = capacity;
+  }
+
+  bucket->updated_ms = now_ms;
+
+  if (bucket->tokens >= TOKEN) {
+    bucket->tokens -= TOKEN;
+    counters.allowed++;
+    return true;
+  }
+
+  // Work out how long until the rest of the next token has refilled
+  const uint32_t wait_ms = ((TOKEN - bucket->tokens) + (requests_per_minute - 1)) / requests_per_minute;
+  out_retry_after_seconds = std::max<uint32_t>(1, (wait_ms + 999) / 1000);
+  counters.limited++;
+  return false;
+}
+
+cRateLimiterCounters cRateLimiter::GetCounters() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return counters;
+}
+
+}
@@ -1,18 +1,105 @@
 #include <cstring>
 
-#include <iostream>
+#include <algorithm>
 
 #include <json-c/json.h>
 
 #include "json.h"
+#include "log.h"
 #include "settings.h"
 #include "util.h"
 
 namespace tasktracker {
 
+namespace {
+
+// Parse an optional unsigned setting that must be in the range [min_value, max_value], out_value is left unchanged if the setting is not present
+template <class T>
+bool ParseOptionalUint(const struct json_object* json, const std::string& name, uint64_t min_value, uint64_t max_value, T& out_value)
+{
+  if (json_object_object_get(json, name.c_str()) == nullptr) {
+    return true;
+  }
+
+  uint64_t value = 0;
+  if (!json::JSONParseUint64(json, name, value)) {
+    return false;
+  }
+
+  if ((value < min_value) || (value > max_value)) {
+    LOG_ERROR<<"Invalid "<<name<<" "<<value<<", expected "<<min_value<<" to "<<max_value;
+    return false;
+  }
+
+  out_value = T(value);
+  return true;
+}
+
+// Parse an optional list of networks such as "192.168.0.0/16", out_networks is left empty if the setting is not present
+bool ParseOptionalNetworks(const struct json_object* json, const std::string& name, std::vector<util::cIPNetwork>& out_networks)
+{
+  out_networks.clear();
+
+  if (json_object_object_get(json, name.c_str()) == nullptr) {
+    return true;
+  }
+
+  std::vector<std::string> values;
+  if (!json::JSONParseStringArray(json, name, values)) {
+    return false;
+  }
+
+  for (auto&& value : values) {
+    util::cIPNetwork network;
+    if (!util::ParseNetwork(value, network)) {
+      LOG_ERROR<<"Invalid "<<name<<" network \""<<value<<"\", expected \"192.168.0.0/16\" or \"2001:db8::/32\"";
+      return false;
+    }
+
+    out_networks.push_back(network);
+  }
+
+  return true;
+}
+
+bool ParseFeedView(const struct json_object* json, cFeedView& out_feed_view)
+{
+  if (json_object_get_type(json) != json_type_object) {
+    LOG_ERROR<<"tokens contains an item that is not an object";
+    return false;
+  }
+
+  if (!json::JSONParseString(json, "name", out_feed_view.name) || !json::JSONParseString(json, "token", out_feed_view.token)) {
+    return false;
+  }
+
+  if (out_feed_view.token.empty()) {
+    LOG_ERROR<<"Token for view \""<<out_feed_view.name<<"\" is empty";
+    return false;
+  }
+
+  // Parse the filter, every part of it is optional
+  cFeedViewFilter& filter = out_feed_view.filter;
+
+  if ((json_object_object_get(json, "high_priority_only") != nullptr) && !json::JSONParseBool(json, "high_priority_only", filter.high_priority_only)) {
+    return false;
+  }
+
+  if ((json_object_object_get(json, "project") != nullptr) && !json::JSONParseString(json, "project", filter.project)) {
+    return false;
+  }
+
+  if ((json_object_object_get(json, "labels") != nullptr) && !json::JSONParseStringArray(json, "labels", filter.labels)) {
+    return false;
+  }
+
+  return true;
+}
+
+}
+
 cSettings::cSettings() :
-  running_in_container(false),
-  port(0)
+  running_in_container(false)
 {
 }
 
@@ -23,13 +110,13 @@ bool cSettings::LoadFromFile(const std::string& sFilePath)
   const size_t nMaxFileSizeBytes = 20 * 1024;
   std::string contents;
   if (!util::ReadFileIntoString(sFilePath, nMaxFileSizeBytes, contents)) {
-    std::cerr<<"File \""<<sFilePath<<"\" not found"<<std::endl;
+    LOG_ERROR<<"File \""<<sFilePath<<"\" not found";
     return false;
   }
 
   json::cJSONDocument document(json_tokener_parse(contents.c_str()));
   if (!document.IsValid()) {
-    std::cerr<<"Invalid JSON config \""<<sFilePath<<"\""<<std::endl;
+    LOG_ERROR<<"Invalid JSON config \""<<sFilePath<<"\"";
     return false;
   }
 
@@ -39,7 +126,7 @@ bool cSettings::LoadFromFile(const std::string& sFilePath)
   json_object_object_foreach(document.Get(), settings_key, settings_val) {
     enum json_type type_settings = json_object_get_type(settings_val);
     if ((type_settings != json_type_object) || (strcmp(settings_key, "settings") != 0)) {
-      std::cerr<<"settings object not found"<<std::endl;
+      LOG_ERROR<<"settings object not found";
       return false;
     }
 
@@ -51,24 +138,47 @@ bool cSettings::LoadFromFile(const std::string& sFilePath)
       }
     }
 
-    // Parse https address
-    {
+    // Parse https address and port (Optional if "listen" is set)
+    if ((json_object_object_get(settings_val, "ip") != nullptr) || (json_object_object_get(settings_val, "listen") == nullptr)) {
       std::string value;
       if (!json::JSONParseString(settings_val, "ip", value)) {
         return false;
       }
 
-      util::ParseAddress(value, ip);
+      cListenEndpoint endpoint;
+      if (!util::ParseAddress(value, endpoint.address)) {
+        LOG_ERROR<<"Invalid ip \""<<value<<"\"";
+        return false;
+      }
+
+      if (!json::JSONParseUint16(settings_val, "port", endpoint.port)) {
+        return false;
+      }
+
+      listen_endpoints.push_back(endpoint);
     }
 
-    // Parse https port
-    {
-      uint16_t value = 0;
-      if (!json::JSONParseUint16(settings_val, "port", value)) {
+    // Parse the other addresses and ports to listen on (Optional)
+    if (json_object_object_get(settings_val, "listen") != nullptr) {
+      std::vector<std::string> values;
+      if (!json::JSONParseStringArray(settings_val, "listen", values)) {
         return false;
       }
 
-      port = value;
+      for (auto&& value : values) {
+        cListenEndpoint endpoint;
+        if (!ParseListenEndpoint(value, endpoint)) {
+          LOG_ERROR<<"Invalid listen endpoint \""<<value<<"\", expected \"192.168.0.3:8443\", \"[2001:db8::3]:8443\" or \"unix:/run/task-tracker/task-tracker.sock\"";
+          return false;
+        }
+
+        if (std::find(listen_endpoints.begin(), listen_endpoints.end(), endpoint) != listen_endpoints.end()) {
+          LOG_ERROR<<"Duplicate listen endpoint \""<<value<<"\"";
+          return false;
+        }
+
+        listen_endpoints.push_back(endpoint);
+      }
     }
 
     // Parse external URL
@@ -76,17 +186,141 @@ bool cSettings::LoadFromFile(const std::string& sFilePath)
       return false;
     }
 
-    // Parse https private key and certificate
-    if (!json::JSONParseString(settings_val, "https_private_key", https_private_key)) {
+    // Parse https private key and certificate (Optional if every endpoint is a Unix domain socket)
+    if ((json_object_object_get(settings_val, "https_private_key") != nullptr) || (json_object_object_get(settings_val, "https_public_cert") != nullptr)) {
+      if (!json::JSONParseString(settings_val, "https_private_key", https_private_key)) {
+        return false;
+      }
+
+      if (!json::JSONParseString(settings_val, "https_public_cert", https_public_cert)) {
+        return false;
+      }
+    }
+
+    // Parse token (Optional if "tokens" is set)
+    if (json_object_object_get(settings_val, "token") != nullptr) {
+      if (!json::JSONParseString(settings_val, "token", token)) {
+        return false;
+      }
+
+      // The original single token sees the whole feed
+      feed_views.push_back(cFeedView("default", token));
+    }
+
+    // Parse the tokens for the filtered views of the feed (Optional)
+    if (json_object_object_get(settings_val, "tokens") != nullptr) {
+      struct json_object* tokens = json_object_object_get(settings_val, "tokens");
+      if (json_object_get_type(tokens) != json_type_array) {
+        LOG_ERROR<<"tokens is not an array";
+        return false;
+      }
+
+      const size_t n = json_object_array_length(tokens);
+      for (size_t i = 0; i < n; i++) {
+        cFeedView feed_view;
+        if (!ParseFeedView(json_object_array_get_idx(tokens, i), feed_view)) {
+          return false;
+        }
+
+        feed_views.push_back(feed_view);
+      }
+    }
+
+    // Parse the backend (Optional)
+    if (json_object_object_get(settings_val, "backend") != nullptr) {
+      std::string value;
+      if (!json::JSONParseString(settings_val, "backend", value)) {
+        return false;
+      }
+
+      if (!ParseBackend(value, web_server_options.backend)) {
+        LOG_ERROR<<"Invalid backend \""<<value<<"\", expected \"libmicrohttpd\" or \"io_uring\"";
+        return false;
+      }
+    }
+
+    // Parse the threading model (Optional)
+    if (json_object_object_get(settings_val, "threading_model") != nullptr) {
+      std::string value;
+      if (!json::JSONParseString(settings_val, "threading_model", value)) {
+        return false;
+      }
+
+      if (!ParseThreadingModel(value, web_server_options.threading_model)) {
+        LOG_ERROR<<"Invalid threading_model \""<<value<<"\", expected \"single_thread\", \"thread_pool\" or \"thread_per_connection\"";
+        return false;
+      }
+    }
+
+    // Parse the thread pool size (Optional)
+    if (json_object_object_get(settings_val, "thread_pool_size") != nullptr) {
+      uint16_t value = 0;
+      if (!json::JSONParseUint16(settings_val, "thread_pool_size", value)) {
+        return false;
+      }
+
+      web_server_options.thread_pool_size = value;
+    }
+
+    // Parse the GnuTLS priority string (Optional)
+    if (json_object_object_get(settings_val, "https_priorities") != nullptr) {
+      if (!json::JSONParseString(settings_val, "https_priorities", web_server_options.tls_priorities)) {
+        return false;
+      }
+    }
+
+    // Parse the TLS session resumption settings (Optional)
+    if (json_object_object_get(settings_val, "tls_session_tickets") != nullptr) {
+      if (!json::JSONParseBool(settings_val, "tls_session_tickets", web_server_options.tls_session_tickets)) {
+        return false;
+      }
+    }
+
+    if (json_object_object_get(settings_val, "tls_session_lifetime_seconds") != nullptr) {
+      uint64_t value = 0;
+      if (!json::JSONParseUint64(settings_val, "tls_session_lifetime_seconds", value)) {
+        return false;
+      }
+
+      if ((value == 0) || (value > UINT32_MAX)) {
+        LOG_ERROR<<"Invalid tls_session_lifetime_seconds "<<value;
+        return false;
+      }
+
+      web_server_options.tls_session_lifetime_seconds = value;
+    }
+
+    // Parse the connection limits (Optional)
+    if (
+      !ParseOptionalUint(settings_val, "connection_timeout_seconds", 1, 24 * 60 * 60, web_server_options.connection_timeout_seconds) ||
+      !ParseOptionalUint(settings_val, "connection_limit", 1, 65535, web_server_options.connection_limit) ||
+      !ParseOptionalUint(settings_val, "per_ip_connection_limit", 1, 65535, web_server_options.per_ip_connection_limit) ||
+      !ParseOptionalUint(settings_val, "connection_memory_limit_bytes", 4 * 1024, 16 * 1024 * 1024, web_server_options.connection_memory_limit_bytes) ||
+      !ParseOptionalUint(settings_val, "listen_backlog", 1, 65535, web_server_options.listen_backlog) ||
+      !ParseOptionalUint(settings_val, "shutdown_timeout_seconds", 0, 60 * 60, web_server_options.shutdown_timeout_seconds) ||
+      !ParseOptionalUint(settings_val, "worker_threads", 0, 256, web_server_options.worker_threads) ||
+      !ParseOptionalUint(settings_val, "worker_queue_limit", 1, 65535, web_server_options.worker_queue_limit) ||
+      !ParseOptionalUint(settings_val, "worker_processes", 0, 256, web_server_options.worker_processes) ||
+      !ParseOptionalUint(settings_val, "event_stream_buffer_bytes", 1024, 16 * 1024 * 1024, web_server_options.event_stream_buffer_bytes)
+    ) {
       return false;
     }
 
-    if (!json::JSONParseString(settings_val, "https_public_cert", https_public_cert)) {
+    // Parse the networks that clients may connect from (Optional)
+    if (
+      !ParseOptionalNetworks(settings_val, "allow_networks", web_server_options.allow_networks) ||
+      !ParseOptionalNetworks(settings_val, "deny_networks", web_server_options.deny_networks)
+    ) {
       return false;
     }
 
-    // Parse token
-    if (!json::JSONParseString(settings_val, "token", token)) {
+    // Parse the rate limits (Optional)
+    if (
+      !ParseOptionalUint(settings_val, "ip_rate_limit_per_minute", 0, 60 * 60 * 1000, web_server_options.ip_rate_limit_per_minute) ||
+      !ParseOptionalUint(settings_val, "ip_rate_limit_burst", 1, 65535, web_server_options.ip_rate_limit_burst) ||
+      !ParseOptionalUint(settings_val, "token_rate_limit_per_minute", 0, 60 * 60 * 1000, web_server_options.token_rate_limit_per_minute) ||
+      !ParseOptionalUint(settings_val, "token_rate_limit_burst", 1, 65535, web_server_options.token_rate_limit_burst)
+    ) {
       return false;
     }
 
@@ -111,10 +345,14 @@ bool cSettings::LoadFromFile(const std::string& sFilePath)
 constexpr bool cSettings::IsValid() const
 {
   return (
-    (ip.IsValid() || (util::ToString(ip) == "0.0.0.0")) && (port != 0) &&
+    !listen_endpoints.empty() &&
+    std::all_of(listen_endpoints.begin(), listen_endpoints.end(), [](const cListenEndpoint& endpoint) { return endpoint.IsUnixSocket() || ((endpoint.address.IsValid() || endpoint.address.IsAny()) && (endpoint.port != 0)); }) &&
     !external_url.empty() &&
-    !https_private_key.empty() && !https_public_cert.empty() &&
-    !token.empty() &&
+    // TCP endpoints are always HTTPS, Unix domain sockets are plain HTTP for a reverse proxy
+    ((!https_private_key.empty() && !https_public_cert.empty()) || std::all_of(listen_endpoints.begin(), listen_endpoints.end(), [](const cListenEndpoint& endpoint) { return endpoint.IsUnixSocket(); })) &&
+    // Each worker process binds the same ports with SO_REUSEPORT, there is no equivalent for a Unix domain socket path
+    ((web_server_options.worker_processes == 0) || std::none_of(listen_endpoints.begin(), listen_endpoints.end(), [](const cListenEndpoint& endpoint) { return endpoint.IsUnixSocket(); })) &&
+    !feed_views.empty() &&
     !gitlab_url.empty() && !gitlab_api_token.empty() && !gitlab_https_public_cert.empty()
   );
 }
@@ -122,15 +360,57 @@ constexpr bool cSettings::IsValid() const
 void cSettings::Clear()
 {
   running_in_container = false;
-  ip.Clear();
-  port = 0;
+  listen_endpoints.clear();
   external_url.clear();
   https_private_key.clear();
   https_public_cert.clear();
   token.clear();
+  feed_views.clear();
+  web_server_options = cWebServerOptions();
   gitlab_url.clear();
   gitlab_api_token.clear();
   gitlab_https_public_cert.clear();
 }
 
+bool cSettings::RequiresRestartToApply(const cSettings& new_settings) const
+{
+  return (
+    (running_in_container != new_settings.running_in_container) ||
+    (listen_endpoints != new_settings.listen_endpoints) ||
+    (external_url != new_settings.external_url) ||
+    (web_server_options != new_settings.web_server_options) ||
+    (gitlab_url != new_settings.gitlab_url) ||
+    (gitlab_api_token != new_settings.gitlab_api_token) ||
+    (gitlab_https_public_cert != new_settings.gitlab_https_public_cert)
+  );
+}
+
+cSettingsStore::cSettingsStore(const std::string& _file_path) :
+  file_path(_file_path)
+{
+}
+
+bool cSettingsStore::Load()
+{
+  std::shared_ptr<cSettings> loaded = std::make_shared<cSettings>();
+  if (!loaded->LoadFromFile(file_path)) {
+    LOG_ERROR<<"cSettingsStore::Load Error parsing \""<<file_path<<"\", keeping the current settings";
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if ((settings != nullptr) && settings->RequiresRestartToApply(*loaded)) {
+    LOG_WARNING<<"cSettingsStore::Load Only the feed views and the certificate are reloaded, restart to apply the other changes in \""<<file_path<<"\"";
+  }
+
+  settings = loaded;
+  return true;
+}
+
+std::shared_ptr<const cSettings> cSettingsStore::Get() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return settings;
+}
+
 }
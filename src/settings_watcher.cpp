@@ -0,0 +1,142 @@
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <algorithm>
+#include <filesystem>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "settings_watcher.h"
+
+namespace tasktracker {
+
+namespace {
+
+volatile std::sig_atomic_t reload_requested = 0;
+
+void OnReloadSignal(int signal_number)
+{
+  (void)signal_number;
+  reload_requested = 1;
+}
+
+}
+
+cSettingsWatcher::cSettingsWatcher() :
+  inotify_fd(-1)
+{
+}
+
+cSettingsWatcher::~cSettingsWatcher()
+{
+  Destroy();
+}
+
+bool cSettingsWatcher::Create(const std::vector<std::string>& file_paths)
+{
+  Destroy();
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = &OnReloadSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGHUP, &action, nullptr);
+
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0) {
+    LOG_ERROR<<"cSettingsWatcher::Create inotify_init1 failed "<<strerror(errno)<<", only SIGHUP reloads the settings";
+    return false;
+  }
+
+  for (auto&& file_path : file_paths) {
+    if (file_path.empty()) {
+      continue;
+    }
+
+    const std::filesystem::path path = std::filesystem::absolute(file_path).lexically_normal();
+    const std::string directory = path.parent_path().string();
+    const std::string file_name = path.filename().string();
+    watched_files.push_back(std::make_pair(directory, file_name));
+
+    const bool already_watched = std::any_of(watched_directories.begin(), watched_directories.end(), [&directory](const std::pair<int, std::string>& watched) { return (watched.second == directory); });
+    if (already_watched) {
+      continue;
+    }
+
+    // A file is finished once it has been closed after writing or renamed into place
+    const int watch = inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watch < 0) {
+      LOG_WARNING<<"cSettingsWatcher::Create Error watching \""<<directory<<"\" "<<strerror(errno);
+      continue;
+    }
+
+    watched_directories.push_back(std::make_pair(watch, directory));
+  }
+
+  return true;
+}
+
+void cSettingsWatcher::Destroy()
+{
+  if (inotify_fd >= 0) {
+    close(inotify_fd);
+    inotify_fd = -1;
+  }
+
+  watched_directories.clear();
+  watched_files.clear();
+}
+
+bool cSettingsWatcher::IsReloadRequested()
+{
+  bool requested = false;
+
+  if (reload_requested != 0) {
+    reload_requested = 0;
+    LOG_INFO<<"cSettingsWatcher::IsReloadRequested Received SIGHUP";
+    requested = true;
+  }
+
+  if (inotify_fd < 0) {
+    return requested;
+  }
+
+  // Read every event that is waiting, several changes at once only cause one reload
+  alignas(struct inotify_event) char buffer[4096];
+  while (true) {
+    const ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
+
+    for (ssize_t offset = 0; offset < length;) {
+      const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+      offset += sizeof(struct inotify_event) + event->len;
+
+      if (event->len == 0) {
+        continue;
+      }
+
+      const std::string file_name(event->name);
+      for (auto&& watched_directory : watched_directories) {
+        if (watched_directory.first != event->wd) {
+          continue;
+        }
+
+        const std::pair<std::string, std::string> file(watched_directory.second, file_name);
+        if (std::find(watched_files.begin(), watched_files.end(), file) != watched_files.end()) {
+          LOG_INFO<<"cSettingsWatcher::IsReloadRequested \""<<file_name<<"\" changed";
+          requested = true;
+        }
+      }
+    }
+  }
+
+  return requested;
+}
+
+}
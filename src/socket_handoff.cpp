@@ -0,0 +1,376 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+
+#include <charconv>
+#include <string_view>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "poll_helper.h"
+#include "socket_handoff.h"
+
+namespace tasktracker {
+
+namespace {
+
+// systemd passes the sockets starting at this file descriptor
+const int SD_LISTEN_FDS_START = 3;
+
+const size_t MAX_HANDOFF_SOCKETS = 64;
+
+// The new process has to load the settings and the feed data before it is ready, that can take a little while
+const int HANDOFF_READY_TIMEOUT_MS = 60 * 1000;
+
+const char HANDOFF_READY = 'R';
+
+volatile std::sig_atomic_t handoff_requested = 0;
+
+// NOTE: After an upgrade /proc/self/exe is still the old binary, so we remember the path that we were started from and run whatever is there now
+std::string executable_path;
+
+void OnHandOffSignal(int signal_number)
+{
+  (void)signal_number;
+  handoff_requested = 1;
+}
+
+bool ParseInt(const char* text, int& out_value)
+{
+  const std::string_view value(text);
+  const std::from_chars_result result = std::from_chars(value.data(), value.data() + value.length(), out_value);
+  return (result.ec == std::errc()) && (result.ptr == (value.data() + value.length()));
+}
+
+bool IsSocketBoundTo(int fd, const cListenEndpoint& endpoint)
+{
+  struct sockaddr_storage address;
+  socklen_t address_length = sizeof(address);
+  if (getsockname(fd, reinterpret_cast<struct sockaddr*>(&address), &address_length) != 0) {
+    return false;
+  }
+
+  if (address.ss_family == AF_UNIX) {
+    const struct sockaddr_un* unix_address = reinterpret_cast<const struct sockaddr_un*>(&address);
+    const size_t max_length = address_length - offsetof(struct sockaddr_un, sun_path);
+    return endpoint.IsUnixSocket() && (endpoint.unix_socket_path == std::string_view(unix_address->sun_path, strnlen(unix_address->sun_path, max_length)));
+  }
+
+  util::cIPAddress bound_address;
+  if (endpoint.IsUnixSocket() || !util::FromSockAddr(reinterpret_cast<const struct sockaddr*>(&address), bound_address)) {
+    return false;
+  }
+
+  const uint16_t port = ntohs((address.ss_family == AF_INET6) ? reinterpret_cast<const struct sockaddr_in6*>(&address)->sin6_port : reinterpret_cast<const struct sockaddr_in*>(&address)->sin_port);
+  return (bound_address == endpoint.address) && (port == endpoint.port);
+}
+
+bool IsListeningStreamSocket(int fd)
+{
+  int type = 0;
+  socklen_t type_length = sizeof(type);
+  int listening = 0;
+  socklen_t listening_length = sizeof(listening);
+  return (
+    (getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_length) == 0) && (type == SOCK_STREAM) &&
+    (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &listening_length) == 0) && (listening != 0)
+  );
+}
+
+// Start a new process of this executable with its end of the hand off socket
+pid_t StartHandOffProcess(int handoff_socket)
+{
+  // Everything the child needs is prepared before forking, between fork and exec the child can only make async signal safe calls
+  const std::string fd_text = std::to_string(handoff_socket);
+  char* const arguments[] = { const_cast<char*>("task-trackerd"), const_cast<char*>(HANDOFF_ARGUMENT), const_cast<char*>(fd_text.c_str()), nullptr };
+
+  const pid_t pid = fork();
+  if (pid < 0) {
+    LOG_ERROR<<"StartHandOffProcess fork failed "<<strerror(errno);
+    return -1;
+  } else if (pid == 0) {
+    // The hand off socket is the only file descriptor the new process inherits
+    fcntl(handoff_socket, F_SETFD, 0);
+
+    execv(executable_path.c_str(), arguments);
+    _exit(EX_OSERR);
+  }
+
+  return pid;
+}
+
+}
+
+std::vector<int> GetSystemdListenSockets()
+{
+  std::vector<int> sockets;
+
+  const char* listen_pid_text = getenv("LISTEN_PID");
+  const char* listen_fds_text = getenv("LISTEN_FDS");
+  if ((listen_pid_text == nullptr) || (listen_fds_text == nullptr)) {
+    return sockets;
+  }
+
+  // The variables are only meant for the process that systemd started, don't pass them on to any process we start
+  int listen_pid = 0;
+  int listen_fds = 0;
+  const bool valid = ParseInt(listen_pid_text, listen_pid) && ParseInt(listen_fds_text, listen_fds);
+
+  unsetenv("LISTEN_PID");
+  unsetenv("LISTEN_FDS");
+  unsetenv("LISTEN_FDNAMES");
+
+  if (!valid || (listen_pid != getpid()) || (listen_fds <= 0)) {
+    return sockets;
+  }
+
+  for (int fd = SD_LISTEN_FDS_START; fd < (SD_LISTEN_FDS_START + listen_fds); fd++) {
+    // systemd doesn't set close on exec, but the sockets are ours now
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    sockets.push_back(fd);
+  }
+
+  LOG_INFO<<"GetSystemdListenSockets Inherited "<<sockets.size()<<" sockets from systemd";
+  return sockets;
+}
+
+void NotifySystemd(const std::string& state)
+{
+  const char* path = getenv("NOTIFY_SOCKET");
+  if ((path == nullptr) || (path[0] == 0)) {
+    return;
+  }
+
+  struct sockaddr_un sad;
+  memset(&sad, 0, sizeof(sad));
+  sad.sun_family = AF_UNIX;
+
+  const size_t path_length = strlen(path);
+  if (path_length >= sizeof(sad.sun_path)) {
+    LOG_ERROR<<"NotifySystemd Invalid NOTIFY_SOCKET \""<<path<<"\"";
+    return;
+  }
+
+  memcpy(sad.sun_path, path, path_length);
+
+  // "@" is a socket in the abstract namespace
+  if (sad.sun_path[0] == '@') {
+    sad.sun_path[0] = 0;
+  }
+
+  const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    LOG_ERROR<<"NotifySystemd socket failed "<<strerror(errno);
+    return;
+  }
+
+  const socklen_t sad_length = socklen_t(offsetof(struct sockaddr_un, sun_path) + path_length);
+  if (sendto(fd, state.data(), state.length(), MSG_NOSIGNAL, reinterpret_cast<const struct sockaddr*>(&sad), sad_length) < 0) {
+    LOG_ERROR<<"NotifySystemd sendto failed "<<strerror(errno);
+  }
+
+  close(fd);
+}
+
+void AssignListenSockets(std::vector<int>& sockets, std::vector<cListenEndpoint>& endpoints)
+{
+  for (auto&& fd : sockets) {
+    if (!IsListeningStreamSocket(fd)) {
+      LOG_WARNING<<"AssignListenSockets Inherited file descriptor "<<fd<<" is not a listening stream socket, closing it";
+      close(fd);
+      continue;
+    }
+
+    bool assigned = false;
+    for (auto&& endpoint : endpoints) {
+      if ((endpoint.listen_socket < 0) && IsSocketBoundTo(fd, endpoint)) {
+        LOG_INFO<<"AssignListenSockets Using inherited socket for "<<ToString(endpoint);
+        endpoint.listen_socket = fd;
+        assigned = true;
+        break;
+      }
+    }
+
+    if (!assigned) {
+      LOG_WARNING<<"AssignListenSockets Inherited socket "<<fd<<" doesn't match any listen endpoint, closing it";
+      close(fd);
+    }
+  }
+
+  sockets.clear();
+}
+
+bool SendListenSockets(int handoff_socket, const std::vector<int>& sockets)
+{
+  if (sockets.empty() || (sockets.size() > MAX_HANDOFF_SOCKETS)) {
+    LOG_ERROR<<"SendListenSockets Invalid number of sockets "<<sockets.size();
+    return false;
+  }
+
+  uint32_t count = uint32_t(sockets.size());
+  struct iovec iov = { &count, sizeof(count) };
+
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_SOCKETS)];
+  memset(control, 0, sizeof(control));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * sockets.size());
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * sockets.size());
+  memcpy(CMSG_DATA(cmsg), sockets.data(), sizeof(int) * sockets.size());
+
+  if (sendmsg(handoff_socket, &msg, MSG_NOSIGNAL) != ssize_t(sizeof(count))) {
+    LOG_ERROR<<"SendListenSockets sendmsg failed "<<strerror(errno);
+    return false;
+  }
+
+  return true;
+}
+
+bool ReceiveListenSockets(int handoff_socket, std::vector<int>& out_sockets)
+{
+  out_sockets.clear();
+
+  uint32_t count = 0;
+  struct iovec iov = { &count, sizeof(count) };
+
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_HANDOFF_SOCKETS)];
+  memset(control, 0, sizeof(control));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  const ssize_t result = recvmsg(handoff_socket, &msg, MSG_CMSG_CLOEXEC);
+  if (result != ssize_t(sizeof(count))) {
+    LOG_ERROR<<"ReceiveListenSockets recvmsg failed "<<((result < 0) ? strerror(errno) : "short read");
+    return false;
+  }
+
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+      const size_t fd_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (size_t i = 0; i < fd_count; i++) {
+        int fd = -1;
+        memcpy(&fd, CMSG_DATA(cmsg) + (i * sizeof(int)), sizeof(int));
+        out_sockets.push_back(fd);
+      }
+    }
+  }
+
+  if (((msg.msg_flags & MSG_CTRUNC) != 0) || (out_sockets.size() != count)) {
+    LOG_ERROR<<"ReceiveListenSockets Expected "<<count<<" sockets, received "<<out_sockets.size();
+    for (auto&& fd : out_sockets) {
+      close(fd);
+    }
+    out_sockets.clear();
+    return false;
+  }
+
+  LOG_INFO<<"ReceiveListenSockets Received "<<out_sockets.size()<<" sockets from the previous process";
+  return true;
+}
+
+bool SendHandOffReady(int handoff_socket)
+{
+  if (send(handoff_socket, &HANDOFF_READY, 1, MSG_NOSIGNAL) != 1) {
+    LOG_ERROR<<"SendHandOffReady send failed "<<strerror(errno);
+    return false;
+  }
+
+  return true;
+}
+
+void InstallHandOffSignalHandler()
+{
+  char path[PATH_MAX];
+  const ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  SetHandOffExecutablePath((length > 0) ? std::string(path, length) : "/proc/self/exe");
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = &OnHandOffSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGUSR2, &action, nullptr);
+}
+
+void SetHandOffExecutablePath(const std::string& path)
+{
+  executable_path = path;
+}
+
+bool IsHandOffRequested()
+{
+  if (handoff_requested == 0) {
+    return false;
+  }
+
+  handoff_requested = 0;
+  return true;
+}
+
+bool HandOffListenSockets(const std::vector<int>& sockets, const std::function<void()>& before_start)
+{
+  LOG_INFO<<"HandOffListenSockets Starting \""<<executable_path<<"\" to take over "<<sockets.size()<<" listening sockets";
+
+  int pair[2] = { -1, -1 };
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+    LOG_ERROR<<"HandOffListenSockets socketpair failed "<<strerror(errno);
+    return false;
+  }
+
+  // NOTE: Otherwise both processes poll Gitlab for the same due dates and when we exit we overwrite the feed data that the new process has saved since
+  before_start();
+
+  const pid_t pid = StartHandOffProcess(pair[1]);
+  close(pair[1]);
+  if (pid < 0) {
+    close(pair[0]);
+    return false;
+  }
+
+  // Wait for the new process to say that it is accepting connections
+  char ready = 0;
+  const bool result = (
+    SendListenSockets(pair[0], sockets) &&
+    (poll_read(pair[0]).poll(HANDOFF_READY_TIMEOUT_MS) == POLL_READ_RESULT::DATA_READY) &&
+    (recv(pair[0], &ready, 1, 0) == 1) && (ready == HANDOFF_READY)
+  );
+
+  close(pair[0]);
+
+  if (!result) {
+    LOG_ERROR<<"HandOffListenSockets Process "<<pid<<" didn't take over, carrying on serving";
+    kill(pid, SIGTERM);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return false;
+  }
+
+  // NOTE: The new process carries on after we exit, it is inherited by init or systemd
+  LOG_INFO<<"HandOffListenSockets Process "<<pid<<" has taken over";
+  return true;
+}
+
+}
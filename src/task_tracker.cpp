@@ -1,12 +1,25 @@
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
 #include <fstream>
-#include <iostream>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
+
+#include <unistd.h>
 
 #include "atom_feed.h"
 #include "curl_helper.h"
 #include "feed_data.h"
+#include "log.h"
+#include "poll_helper.h"
+#include "prefork.h"
 #include "random.h"
+#include "settings_watcher.h"
+#include "socket_handoff.h"
 #include "task_tracker.h"
 #include "util.h"
 #include "web_server.h"
@@ -22,14 +35,45 @@
 
 namespace tasktracker {
 
+namespace {
+
+volatile std::sig_atomic_t shutdown_requested = 0;
+
+void OnShutdownSignal(int signal_number)
+{
+  (void)signal_number;
+  shutdown_requested = 1;
+}
+
+}
+
 bool LoadTasksFromFile(const std::string& file_path, cTaskList& tasks)
 {
   return true;
 }
 
-bool RunServer(const cSettings& settings)
+void InstallShutdownSignalHandler()
+{
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = &OnShutdownSignal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGTERM, &action, nullptr);
+  sigaction(SIGINT, &action, nullptr);
+}
+
+bool IsShutdownRequested()
 {
-  std::cout<<"Running server"<<std::endl;
+  return (shutdown_requested != 0);
+}
+
+bool RunServer(cSettingsStore& settings_store, int handoff_socket)
+{
+  LOG_INFO<<"Running server";
+
+  // The settings we started with, the task tracker thread and the web server are created from these, a reload publishes new settings to the store
+  const std::shared_ptr<const cSettings> settings_snapshot = settings_store.Get();
+  const cSettings& settings = *settings_snapshot;
 
   // Load the existing feed data from a file
   LoadFeedDataFromFile(settings.GetExternalURL());
@@ -39,42 +83,122 @@ bool RunServer(const cSettings& settings)
   curl::cCurlHelper helper;
 
   // Start the task tracker thread
-  if (!StartTaskTrackerThread(settings)) {
-    std::cerr<<"Error starting task tracker"<<std::endl;
+  // NOTE: This is destroyed after the web server, so the requests in flight finish before the thread is stopped and the feed data is saved
+  cTaskTrackerThread task_tracker_thread(settings);
+  if (!task_tracker_thread.Start()) {
+    LOG_ERROR<<"Error starting task tracker";
     return false;
   }
 #else
   // Start the DebugStartFakeFeedEntriesUpdateThread thread for debugging
   if (!DebugStartFakeFeedEntriesUpdateThread()) {
-    std::cerr<<"Error creating DebugStartFakeFeedEntriesUpdateThread"<<std::endl;
+    LOG_ERROR<<"Error creating DebugStartFakeFeedEntriesUpdateThread";
     return false;
   }
 #endif
 
+  if (settings.GetWebServerOptions().worker_processes != 0) {
+    // The worker processes serve the feed, this process just keeps the snapshot of it up to date
+    return RunPreforkServer(settings_store);
+  }
+
+  // Take over the listening sockets from the process we are replacing, or from systemd socket activation
+  std::vector<int> inherited_sockets;
+  if (handoff_socket >= 0) {
+    if (!ReceiveListenSockets(handoff_socket, inherited_sockets)) {
+      LOG_ERROR<<"Error receiving the listening sockets";
+      return false;
+    }
+  } else {
+    inherited_sockets = GetSystemdListenSockets();
+  }
+
+  std::vector<cListenEndpoint> endpoints = settings.GetListenEndpoints();
+  AssignListenSockets(inherited_sockets, endpoints);
+
   // Now run the web server
   cWebServerManager web_server_manager;
   const bool fuzzing = false;
-  if (!web_server_manager.Create(settings.GetIP(), settings.GetPort(), settings.GetHTTPSPrivateKey(), settings.GetHTTPSPublicCert(), fuzzing, settings.GetToken())) {
-    std::cerr<<"Error creating web server"<<std::endl;
+  if (!web_server_manager.Create(endpoints, settings.GetHTTPSPrivateKey(), settings.GetHTTPSPublicCert(), fuzzing, settings.GetFeedViews(), settings.GetWebServerOptions())) {
+    LOG_ERROR<<"Error creating web server";
     return false;
   }
 
-  if (settings.GetRunningInContainer()) {
-    while (true) {
+  if (handoff_socket >= 0) {
+    // We are the main process of the service now, tell systemd before the previous process exits
+    NotifySystemd("MAINPID=" + std::to_string(getpid()) + "\nREADY=1");
+
+    // We are accepting connections, the previous process can stop accepting and drain
+    SendHandOffReady(handoff_socket);
+    close(handoff_socket);
+  } else {
+    NotifySystemd("READY=1");
+  }
+
+  InstallShutdownSignalHandler();
+  InstallHandOffSignalHandler();
+
+  // SIGHUP or a change to the settings file or the certificate reloads the feed views and the certificate
+  cSettingsWatcher settings_watcher;
+  settings_watcher.Create({ settings_store.GetFilePath(), settings.GetHTTPSPrivateKey(), settings.GetHTTPSPublicCert() });
+
+  if (!settings.GetRunningInContainer()) {
+    LOG_INFO<<"Press enter to shutdown the server";
+  }
+
+  // Before handing off we stop updating the feed data and save it for the new process to load
+#ifndef DEBUG_FAKE_FEED_ENTIES
+  const std::function<void()> stop_feed_updates = [&task_tracker_thread]() { task_tracker_thread.Stop(); };
+#else
+  const std::function<void()> stop_feed_updates = []() { SaveFeedDataToFile(); };
+#endif
+
+  poll_read stdin_poll(STDIN_FILENO);
+
+  while (true) {
+    if (settings.GetRunningInContainer()) {
       util::msleep(500);
+    } else if (stdin_poll.poll(500) == POLL_READ_RESULT::DATA_READY) {
+      (void)getc(stdin);
+      break;
+    }
+
+    if (IsShutdownRequested()) {
+      LOG_INFO<<"Received a signal to shutdown";
+      break;
+    }
+
+    if (settings_watcher.IsReloadRequested() && settings_store.Load()) {
+      const std::shared_ptr<const cSettings> reloaded_settings = settings_store.Get();
+      web_server_manager.Reload(reloaded_settings->GetFeedViews(), reloaded_settings->GetHTTPSPrivateKey(), reloaded_settings->GetHTTPSPublicCert());
+
+      // The certificate may have moved
+      settings_watcher.Create({ settings_store.GetFilePath(), reloaded_settings->GetHTTPSPrivateKey(), reloaded_settings->GetHTTPSPublicCert() });
+    }
+
+    // SIGUSR2 starts a new process to take over from us
+    if (IsHandOffRequested()) {
+      if (HandOffListenSockets(web_server_manager.GetListeningSockets(), stop_feed_updates)) {
+        web_server_manager.HandOffListeningSockets();
+        break;
+      }
+
+#ifndef DEBUG_FAKE_FEED_ENTIES
+      // The new process didn't take over, carry on updating the feed
+      if (!task_tracker_thread.Start()) {
+        LOG_ERROR<<"Error restarting task tracker";
+      }
+#endif
     }
-  } else {
-    std::cout<<"Press enter to shutdown the server"<<std::endl;
-    (void)getc(stdin);
   }
 
-  std::cout<<"Shutting down server"<<std::endl;
+  LOG_INFO<<"Shutting down server";
   if (!web_server_manager.Destroy()) {
-    std::cerr<<"Error destroying web server"<<std::endl;
+    LOG_ERROR<<"Error destroying web server";
     return false;
   }
 
-  std::cout<<"Server has been shutdown"<<std::endl;
+  LOG_INFO<<"Server has been shutdown";
   return true;
 }
 
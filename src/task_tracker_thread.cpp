@@ -1,8 +1,5 @@
 #include <cstring>
-#include <functional>
-#include <iostream>
 #include <string>
-#include <thread>
 
 #include <unistd.h>
 #include <stdlib.h>
@@ -12,7 +9,9 @@
 #include "https_socket.h"
 #include "json.h"
 #include "feed_data.h"
+#include "feed_events.h"
 #include "gitlab_api.h"
+#include "log.h"
 #include "poll_helper.h"
 #include "task_tracker.h"
 #include "task_tracker_thread.h"
@@ -20,24 +19,62 @@
 
 namespace tasktracker {
 
-class cTaskTrackerThread {
-public:
-  explicit cTaskTrackerThread(const cSettings& settings);
+cTaskTrackerThread::cTaskTrackerThread(const cSettings& _settings) :
+  settings(_settings),
+  stop_requested(false)
+{
+}
+
+cTaskTrackerThread::~cTaskTrackerThread()
+{
+  Stop();
+}
 
-  void MainLoop();
+bool cTaskTrackerThread::Start()
+{
+  if (thread.joinable()) {
+    LOG_ERROR<<"cTaskTrackerThread::Start Error already started";
+    return false;
+  }
 
-private:
-  void UpdateTaskListFromGitlabIssues(cTaskList& task_list);
-  void AddFeedEntry(std::vector<cFeedEntry>& entries_to_add, const cTask& task, bool high_priority, const std::string& summary);
-  void CheckTasksAndUpdateFeedEntries(cTaskList& task_list, const std::chrono::system_clock::time_point& start_time, const std::chrono::system_clock::time_point& end_time);
+  LOG_INFO<<"cTaskTrackerThread::Start";
 
-  const cSettings& settings;
-  util::cPseudoRandomNumberGenerator rng;
-};
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop_requested = false;
+  }
 
-cTaskTrackerThread::cTaskTrackerThread(const cSettings& _settings) :
-  settings(_settings)
+  thread = std::thread(&cTaskTrackerThread::MainLoop, this);
+
+  return true;
+}
+
+void cTaskTrackerThread::Stop()
 {
+  if (!thread.joinable()) {
+    return;
+  }
+
+  LOG_INFO<<"cTaskTrackerThread::Stop";
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop_requested = true;
+  }
+  cv_stop.notify_all();
+
+  thread.join();
+
+  // Make sure that everything the thread added is on disk for the next time we start
+  SaveFeedDataToFile();
+
+  LOG_INFO<<"cTaskTrackerThread::Stop Stopped";
+}
+
+bool cTaskTrackerThread::WaitFor(std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  return !cv_stop.wait_for(lock, timeout, [this]() { return stop_requested; });
 }
 
 void cTaskTrackerThread::UpdateTaskListFromGitlabIssues(cTaskList& task_list)
@@ -52,6 +89,8 @@ void cTaskTrackerThread::UpdateTaskListFromGitlabIssues(cTaskList& task_list)
     task.title = issue.title;
     task.date_due = issue.due_date;
     task.link = issue.web_url;
+    task.project = issue.project;
+    task.labels = issue.labels;
 
     task_list.tasks[issue.iid] = task;
   }
@@ -59,13 +98,16 @@ void cTaskTrackerThread::UpdateTaskListFromGitlabIssues(cTaskList& task_list)
 
 void cTaskTrackerThread::AddFeedEntry(std::vector<cFeedEntry>& entries_to_add, const cTask& task, bool high_priority, const std::string& summary)
 {
-  std::cout<<"Adding feed entry \""<<task.title<<"\": "<<summary<<std::endl;
+  LOG_INFO<<"Adding feed entry \""<<task.title<<"\": "<<summary;
   cFeedEntry entry;
   entry.title = (high_priority ? "🚩" : "🔔") + task.title;
   entry.summary = summary;
   entry.date_updated = util::GetTime();
   entry.id = feed::GenerateFeedID(rng);
   entry.link = task.link;
+  entry.high_priority = high_priority;
+  entry.project = task.project;
+  entry.labels = task.labels;
 
   entries_to_add.push_back(entry);
 }
@@ -95,15 +137,19 @@ void cTaskTrackerThread::CheckTasksAndUpdateFeedEntries(cTaskList& task_list, co
       // Update the feed entries
       std::lock_guard<std::mutex> lock(mutex_feed_data);
       feed_data.entries.push_back(std::span<cFeedEntry>(entries_to_add));
+      feed_data_generation++;
     }
 
+    // Push them to the event stream clients
+    GetFeedEventQueue().Publish(entries_to_add);
+
     SaveFeedDataToFile();
   }
 }
 
 void cTaskTrackerThread::MainLoop()
 {
-  std::cout<<"cTaskTrackerThread::MainLoop"<<std::endl;
+  LOG_INFO<<"cTaskTrackerThread::MainLoop";
 
   cTaskList task_list;
   LoadTasksFromFile("./tasks.json", task_list);
@@ -114,56 +160,33 @@ void cTaskTrackerThread::MainLoop()
   // We update soon after start up and then every half an hour after that
   const uint64_t minutes_between_updates = 30;
 
-  // Sleep for 30 seconds before the first update
-  util::msleep(30 * 1000);
+  {
+    // Tell feed readers how often the feed can change
+    std::lock_guard<std::mutex> lock(mutex_feed_data);
+    feed_data.properties.update_period_minutes = uint32_t(minutes_between_updates);
+    feed_data_generation++;
+  }
+
+  // Wait for 30 seconds before the first update, Stop wakes us up early
+  std::chrono::milliseconds time_until_next_update = std::chrono::seconds(30);
 
   while (true) {
+    // The feed route uses this to tell clients how long they can cache the feed for
+    SetNextFeedUpdate(util::GetTime() + time_until_next_update);
+
+    if (!WaitFor(time_until_next_update)) {
+      break;
+    }
+
     const std::chrono::system_clock::time_point start_time = previous_update;
     const std::chrono::system_clock::time_point end_time = util::GetTime();
     CheckTasksAndUpdateFeedEntries(task_list, start_time, end_time);
     previous_update = end_time;
 
-    const uint64_t time_until_next_update_ms = minutes_between_updates * 60 * 1000;
-    util::msleep(time_until_next_update_ms);
-  }
-}
-
-// Not the most elegant method, but it works
-int RunThreadFunction(void* pData)
-{
-  if (pData == nullptr) {
-    return 1;
+    time_until_next_update = std::chrono::minutes(minutes_between_updates);
   }
 
-  cTaskTrackerThread* pThis = static_cast<cTaskTrackerThread*>(pData);
-  if (pThis == nullptr) {
-    return 1;
-  }
-
-  std::cout<<"RunThreadFunction Calling MainLoop"<<std::endl;
-  pThis->MainLoop();
-  std::cout<<"RunThreadFunction MainLoop returned"<<std::endl;
-
-  return 0;
-}
-
-bool StartTaskTrackerThread(const cSettings& settings)
-{
-  std::cout<<"StartTaskTrackerThread Running server "<<std::endl;
-
-  // Ok we have successfully connected and subscribed so now we can start the thread to read updates
-  cTaskTrackerThread* pTaskTrackerThread = new cTaskTrackerThread(settings);
-  if (pTaskTrackerThread == nullptr) {
-    std::cerr<<"StartTaskTrackerThread Error creating task tracker thread, returning false"<<std::endl;
-    return false;
-  }
-
-  // Start the thread
-  // NOTE: We never release this, it is ugly, but we don't shut down gracefully. We could create a regular object, then give the thread a signal to stop, then have the thread exit gracefully
-  std::thread* pThread = new std::thread(std::bind(&RunThreadFunction, pTaskTrackerThread));
-  (void)pThread;
-
-  return true;
+  LOG_INFO<<"cTaskTrackerThread::MainLoop Stopping";
 }
 
 }
@@ -0,0 +1,172 @@
+#include <cstring>
+
+#include "log.h"
+#include "tls_certificate_store.h"
+#include "util.h"
+
+namespace tasktracker {
+
+namespace {
+
+// A full chain is a few certificates, the private key is much smaller
+const size_t MAX_PUBLIC_CERT_SIZE_BYTES = 64 * 1024;
+const size_t MAX_PRIVATE_KEY_SIZE_BYTES = 10 * 1024;
+
+gnutls_datum_t ToDatum(const std::string& value)
+{
+  return { reinterpret_cast<unsigned char*>(const_cast<char*>(value.data())), static_cast<unsigned int>(value.length()) };
+}
+
+// Returns true if the private key belongs to the certificate
+bool IsKeyForCertificate(gnutls_privkey_t private_key, const gnutls_pcert_st& certificate)
+{
+  gnutls_pubkey_t public_key = nullptr;
+  if (gnutls_pubkey_init(&public_key) != GNUTLS_E_SUCCESS) {
+    return false;
+  }
+
+  unsigned char key_id[64];
+  size_t key_id_size = sizeof(key_id);
+  unsigned char certificate_key_id[64];
+  size_t certificate_key_id_size = sizeof(certificate_key_id);
+
+  const bool result = (
+    (gnutls_pubkey_import_privkey(public_key, private_key, 0, 0) == GNUTLS_E_SUCCESS) &&
+    (gnutls_pubkey_get_key_id(public_key, 0, key_id, &key_id_size) == GNUTLS_E_SUCCESS) &&
+    (gnutls_pubkey_get_key_id(certificate.pubkey, 0, certificate_key_id, &certificate_key_id_size) == GNUTLS_E_SUCCESS) &&
+    (key_id_size == certificate_key_id_size) && (memcmp(key_id, certificate_key_id, key_id_size) == 0)
+  );
+
+  gnutls_pubkey_deinit(public_key);
+
+  return result;
+}
+
+}
+
+cTLSCertificate::cTLSCertificate() :
+  chain_length(0),
+  private_key(nullptr)
+{
+}
+
+cTLSCertificate::~cTLSCertificate()
+{
+  for (unsigned int i = 0; i < chain_length; i++) {
+    gnutls_pcert_deinit(&chain[i]);
+  }
+
+  if (private_key != nullptr) {
+    gnutls_privkey_deinit(private_key);
+  }
+}
+
+bool cTLSCertificate::Load(const std::string& _private_key_pem, const std::string& _public_cert_pem)
+{
+  private_key_pem = _private_key_pem;
+  public_cert_pem = _public_cert_pem;
+
+  chain_length = MAX_CHAIN_LENGTH;
+  const gnutls_datum_t public_cert_datum = ToDatum(public_cert_pem);
+  int result = gnutls_pcert_list_import_x509_raw(chain, &chain_length, &public_cert_datum, GNUTLS_X509_FMT_PEM, 0);
+  if (result < 0) {
+    chain_length = 0;
+    LOG_ERROR<<"cTLSCertificate::Load Error importing the certificate "<<gnutls_strerror(result);
+    return false;
+  }
+
+  // NOTE: Any private key that GnuTLS understands is supported, RSA, ECDSA or Ed25519 in PEM format
+  result = gnutls_privkey_init(&private_key);
+  if (result != GNUTLS_E_SUCCESS) {
+    LOG_ERROR<<"cTLSCertificate::Load Error creating the private key "<<gnutls_strerror(result);
+    return false;
+  }
+
+  const gnutls_datum_t private_key_datum = ToDatum(private_key_pem);
+  result = gnutls_privkey_import_x509_raw(private_key, &private_key_datum, GNUTLS_X509_FMT_PEM, nullptr, 0);
+  if (result != GNUTLS_E_SUCCESS) {
+    LOG_ERROR<<"cTLSCertificate::Load Error importing the private key "<<gnutls_strerror(result);
+    return false;
+  }
+
+  // A certificate and key that are replaced one after the other don't match in between, every handshake would fail if we used them
+  if ((chain_length == 0) || !IsKeyForCertificate(private_key, chain[0])) {
+    LOG_ERROR<<"cTLSCertificate::Load The private key doesn't match the certificate";
+    return false;
+  }
+
+  return true;
+}
+
+bool cTLSCertificateStore::Load(const std::string& private_key, const std::string& public_cert)
+{
+  std::string private_key_pem;
+  if (!util::ReadFileIntoString(private_key, MAX_PRIVATE_KEY_SIZE_BYTES, private_key_pem)) {
+    LOG_ERROR<<"cTLSCertificateStore::Load Error reading private key \""<<private_key<<"\"";
+    return false;
+  }
+
+  std::string public_cert_pem;
+  if (!util::ReadFileIntoString(public_cert, MAX_PUBLIC_CERT_SIZE_BYTES, public_cert_pem)) {
+    LOG_ERROR<<"cTLSCertificateStore::Load Error reading certificate \""<<public_cert<<"\"";
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if ((certificate != nullptr) && (certificate->private_key_pem == private_key_pem) && (certificate->public_cert_pem == public_cert_pem)) {
+      // Nothing has changed
+      return true;
+    }
+  }
+
+  std::shared_ptr<cTLSCertificate> loaded = std::make_shared<cTLSCertificate>();
+  if (!loaded->Load(private_key_pem, public_cert_pem)) {
+    LOG_ERROR<<"cTLSCertificateStore::Load Error loading certificate \""<<public_cert<<"\" and private key \""<<private_key<<"\"";
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (certificate != nullptr) {
+    replaced_certificates.push_back(certificate);
+    LOG_INFO<<"cTLSCertificateStore::Load Replaced the certificate with \""<<public_cert<<"\"";
+  }
+
+  certificate = loaded;
+  return true;
+}
+
+std::shared_ptr<const cTLSCertificate> cTLSCertificateStore::Get() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return certificate;
+}
+
+cTLSCertificateStore& GetTLSCertificateStore()
+{
+  static cTLSCertificateStore store;
+  return store;
+}
+
+int RetrieveTLSCertificate(gnutls_session_t session, const gnutls_datum_t* req_ca_rdn, int nreqs, const gnutls_pk_algorithm_t* pk_algos, int pk_algos_length, gnutls_pcert_st** pcert, unsigned int* pcert_length, gnutls_privkey_t* pkey)
+{
+  (void)session;
+  (void)req_ca_rdn;
+  (void)nreqs;
+  (void)pk_algos;
+  (void)pk_algos_length;
+
+  // NOTE: The store keeps the certificate alive after it has been replaced, so the pointers stay valid for the rest of the handshake
+  const std::shared_ptr<const cTLSCertificate> certificate = GetTLSCertificateStore().Get();
+  if (certificate == nullptr) {
+    return -1;
+  }
+
+  *pcert = const_cast<gnutls_pcert_st*>(certificate->chain);
+  *pcert_length = certificate->chain_length;
+  *pkey = certificate->private_key;
+
+  return 0;
+}
+
+}
@@ -0,0 +1,159 @@
+#include <cstring>
+
+#include "log.h"
+#include "tls_session_resumption.h"
+
+namespace tasktracker {
+
+// GnuTLS generates 64 byte keys, anything else didn't come from another task-trackerd
+const size_t TLS_SESSION_TICKET_KEY_SIZE = 64;
+
+cTLSSessionTicketKey::cTLSSessionTicketKey() :
+  key({ nullptr, 0 })
+{
+}
+
+cTLSSessionTicketKey::~cTLSSessionTicketKey()
+{
+  Clear();
+}
+
+bool cTLSSessionTicketKey::Generate()
+{
+  Clear();
+
+  const int result = gnutls_session_ticket_key_generate(&key);
+  if (result != GNUTLS_E_SUCCESS) {
+    LOG_ERROR<<"cTLSSessionTicketKey::Generate Error generating session ticket key "<<gnutls_strerror(result);
+    return false;
+  }
+
+  return true;
+}
+
+bool cTLSSessionTicketKey::Set(const unsigned char* data, size_t size)
+{
+  Clear();
+
+  if ((data == nullptr) || (size != TLS_SESSION_TICKET_KEY_SIZE)) {
+    LOG_ERROR<<"cTLSSessionTicketKey::Set Invalid session ticket key size "<<size;
+    return false;
+  }
+
+  key.data = static_cast<unsigned char*>(gnutls_malloc(size));
+  if (key.data == nullptr) {
+    LOG_ERROR<<"cTLSSessionTicketKey::Set Error allocating the session ticket key";
+    return false;
+  }
+
+  memcpy(key.data, data, size);
+  key.size = static_cast<unsigned int>(size);
+
+  return true;
+}
+
+void cTLSSessionTicketKey::Clear()
+{
+  if (key.data != nullptr) {
+    // Don't leave the key lying around in memory
+    gnutls_memset(key.data, 0, key.size);
+    gnutls_free(key.data);
+    key.data = nullptr;
+    key.size = 0;
+  }
+}
+
+cTLSSessionTicketKey& GetTLSSessionTicketKey()
+{
+  static cTLSSessionTicketKey key;
+  return key;
+}
+
+
+cTLSSessionResumption::cTLSSessionResumption() :
+  enabled(false),
+  ticket_key({ nullptr, 0 }),
+  lifetime_seconds(0),
+  full_handshakes(0),
+  resumed_handshakes(0)
+{
+}
+
+cTLSSessionResumption::~cTLSSessionResumption()
+{
+  Destroy();
+}
+
+bool cTLSSessionResumption::Create(const cWebServerOptions& options, const cTLSSessionTicketKey& shared_ticket_key)
+{
+  Destroy();
+
+  if (!options.tls_session_tickets) {
+    return true;
+  }
+
+  if (!shared_ticket_key.IsValid()) {
+    LOG_ERROR<<"cTLSSessionResumption::Create No session ticket key";
+    return false;
+  }
+
+  ticket_key.data = static_cast<unsigned char*>(gnutls_malloc(shared_ticket_key.Get().size));
+  if (ticket_key.data == nullptr) {
+    LOG_ERROR<<"cTLSSessionResumption::Create Error allocating the session ticket key";
+    return false;
+  }
+
+  memcpy(ticket_key.data, shared_ticket_key.Get().data, shared_ticket_key.Get().size);
+  ticket_key.size = shared_ticket_key.Get().size;
+
+  lifetime_seconds = options.tls_session_lifetime_seconds;
+  enabled = true;
+
+  return true;
+}
+
+void cTLSSessionResumption::Destroy()
+{
+  if (ticket_key.data != nullptr) {
+    // Don't leave the key lying around in memory
+    gnutls_memset(ticket_key.data, 0, ticket_key.size);
+    gnutls_free(ticket_key.data);
+    ticket_key.data = nullptr;
+    ticket_key.size = 0;
+  }
+
+  enabled = false;
+}
+
+void cTLSSessionResumption::EnableForSession(gnutls_session_t session) const
+{
+  if (!enabled) {
+    return;
+  }
+
+  if (gnutls_session_ticket_enable_server(session, &ticket_key) != GNUTLS_E_SUCCESS) {
+    LOG_WARNING<<"cTLSSessionResumption::EnableForSession Error enabling session tickets";
+    return;
+  }
+
+  gnutls_db_set_cache_expiration(session, lifetime_seconds);
+}
+
+void cTLSSessionResumption::CountHandshake(gnutls_session_t session)
+{
+  if (gnutls_session_is_resumed(session) != 0) {
+    resumed_handshakes.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    full_handshakes.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+cTLSSessionCounters cTLSSessionResumption::GetCounters() const
+{
+  cTLSSessionCounters counters;
+  counters.full_handshakes = full_handshakes.load(std::memory_order_relaxed);
+  counters.resumed_handshakes = resumed_handshakes.load(std::memory_order_relaxed);
+  return counters;
+}
+
+}
@@ -0,0 +1,96 @@
+#include "log.h"
+#include "token_table.h"
+#include "util.h"
+
+namespace tasktracker {
+
+namespace {
+
+// Compare two tokens in a time that only depends on the length of the expected token, so a client can't work out how much of a token it guessed correctly
+bool IsTokenEqual(std::string_view expected, std::string_view token)
+{
+  if (expected.length() != token.length()) {
+    return false;
+  }
+
+  uint8_t difference = 0;
+  for (size_t i = 0; i < expected.length(); i++) {
+    difference |= static_cast<uint8_t>(expected[i] ^ token[i]);
+  }
+
+  return (difference == 0);
+}
+
+}
+
+cTokenTable::cTokenTable() :
+  mask(0)
+{
+}
+
+bool cTokenTable::Create(const std::vector<std::string>& _tokens)
+{
+  Clear();
+
+  // Keep the table at most half full so that probe sequences stay short
+  size_t nslots = 2;
+  while (nslots < (2 * _tokens.size())) {
+    nslots *= 2;
+  }
+
+  mask = nslots - 1;
+  slots.assign(nslots, EMPTY);
+
+  for (auto&& token : _tokens) {
+    if (token.empty()) {
+      LOG_ERROR<<"cTokenTable::Create Empty token";
+      Clear();
+      return false;
+    }
+
+    if (Find(token) != npos) {
+      LOG_ERROR<<"cTokenTable::Create Duplicate token";
+      Clear();
+      return false;
+    }
+
+    // Linear probing from the home slot
+    size_t slot = util::HashFNV1a64(token) & mask;
+    while (slots[slot] != EMPTY) {
+      slot = (slot + 1) & mask;
+    }
+
+    slots[slot] = static_cast<uint32_t>(tokens.size());
+    tokens.push_back(token);
+  }
+
+  return true;
+}
+
+void cTokenTable::Clear()
+{
+  mask = 0;
+  tokens.clear();
+  slots.clear();
+}
+
+size_t cTokenTable::Find(std::string_view token) const
+{
+  if (slots.empty()) {
+    return npos;
+  }
+
+  size_t slot = util::HashFNV1a64(token) & mask;
+  while (slots[slot] != EMPTY) {
+    const uint32_t index = slots[slot];
+    if (IsTokenEqual(tokens[index], token)) {
+      return index;
+    }
+
+    slot = (slot + 1) & mask;
+  }
+
+  return npos;
+}
+
+}
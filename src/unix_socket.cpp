@@ -0,0 +1,72 @@
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "unix_socket.h"
+
+namespace tasktracker {
+
+int OpenUnixListeningSocket(const std::string& path, unsigned int backlog)
+{
+  struct sockaddr_un sad;
+  memset(&sad, 0, sizeof(sad));
+  sad.sun_family = AF_UNIX;
+
+  if (path.empty() || (path.length() >= sizeof(sad.sun_path))) {
+    LOG_ERROR<<"OpenUnixListeningSocket Invalid path \""<<path<<"\"";
+    return -1;
+  }
+
+  strcpy(sad.sun_path, path.c_str());
+
+  // Remove the socket from a previous run, but don't delete anything that isn't a socket
+  struct stat s;
+  if (lstat(path.c_str(), &s) == 0) {
+    if (!S_ISSOCK(s.st_mode)) {
+      LOG_ERROR<<"OpenUnixListeningSocket \""<<path<<"\" exists and is not a socket";
+      return -1;
+    }
+
+    unlink(path.c_str());
+  }
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    LOG_ERROR<<"OpenUnixListeningSocket socket failed "<<strerror(errno);
+    return -1;
+  }
+
+  if (bind(fd, reinterpret_cast<const struct sockaddr*>(&sad), sizeof(sad)) != 0) {
+    LOG_ERROR<<"OpenUnixListeningSocket bind \""<<path<<"\" failed "<<strerror(errno);
+    close(fd);
+    return -1;
+  }
+
+  // NOTE: The mode depends on the umask when the socket is bound, so set it explicitly
+  if (chmod(path.c_str(), 0660) != 0) {
+    LOG_WARNING<<"OpenUnixListeningSocket chmod \""<<path<<"\" failed "<<strerror(errno);
+  }
+
+  if (listen(fd, backlog) != 0) {
+    LOG_ERROR<<"OpenUnixListeningSocket listen failed "<<strerror(errno);
+    close(fd);
+    unlink(path.c_str());
+    return -1;
+  }
+
+  return fd;
+}
+
+void RemoveUnixListeningSocket(const std::string& path)
+{
+  if (unlink(path.c_str()) != 0) {
+    LOG_WARNING<<"RemoveUnixListeningSocket unlink \""<<path<<"\" failed "<<strerror(errno);
+  }
+}
+
+}
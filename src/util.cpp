@@ -1,11 +1,11 @@
 #include <cerrno>
+#include <cstdio>
 #include <ctime>
 
 #include <chrono>
 #include <filesystem>
 #include <format>
 #include <iomanip>
-#include <iostream>
 #include <fstream>
 #include <string>
 #include <sstream>
@@ -14,6 +14,31 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "log.h"
+#include "util.h"
+
+namespace {
+
+const char* const http_day_names[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+const char* const http_month_names[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+bool ParseDigits(std::string_view buffer, size_t offset, size_t count, int& out_value)
+{
+  out_value = 0;
+
+  for (size_t i = offset; i < offset + count; i++) {
+    if ((buffer[i] < '0') || (buffer[i] > '9')) {
+      return false;
+    }
+
+    out_value = (out_value * 10) + (buffer[i] - '0');
+  }
+
+  return true;
+}
+
+}
+
 namespace util {
 
 // From: https://stackoverflow.com/a/1157217/1074390
@@ -53,6 +78,59 @@ std::string GetDateTimeUTCISO8601(std::chrono::system_clock::time_point time) no
   return raw.substr(0, std::min<size_t>(std::max<size_t>(raw.length(), 1) - 1, 23)) + "Z";
 }
 
+// Get a HTTP date string (RFC 9110 IMF-fixdate)
+// ie. "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string GetDateTimeHTTP(std::chrono::system_clock::time_point time) noexcept
+{
+  const std::chrono::sys_days days = std::chrono::floor<std::chrono::days>(time);
+  const std::chrono::year_month_day ymd(days);
+  const std::chrono::weekday weekday(days);
+  const std::chrono::hh_mm_ss hms(std::chrono::floor<std::chrono::seconds>(time - days));
+
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%s, %02u %s %04d %02d:%02d:%02d GMT",
+    http_day_names[weekday.c_encoding()], unsigned(ymd.day()), http_month_names[unsigned(ymd.month()) - 1], int(ymd.year()),
+    int(hms.hours().count()), int(hms.minutes().count()), int(hms.seconds().count())
+  );
+
+  return buffer;
+}
+
+bool ParseDateTimeHTTP(std::string_view buffer, std::chrono::system_clock::time_point& value) noexcept
+{
+  // NOTE: We only accept the IMF-fixdate format, the obsolete RFC 850 and asctime formats are allowed to be ignored
+  // "Sun, 06 Nov 1994 08:49:37 GMT"
+  if ((buffer.length() != 29) || (buffer.substr(3, 2) != ", ") || (buffer[7] != ' ') || (buffer[11] != ' ') || (buffer[16] != ' ') || (buffer[19] != ':') || (buffer[22] != ':') || (buffer.substr(25) != " GMT")) {
+    return false;
+  }
+
+  int day = 0;
+  int year = 0;
+  int hours = 0;
+  int minutes = 0;
+  int seconds = 0;
+  if (!ParseDigits(buffer, 5, 2, day) || !ParseDigits(buffer, 12, 4, year) || !ParseDigits(buffer, 17, 2, hours) || !ParseDigits(buffer, 20, 2, minutes) || !ParseDigits(buffer, 23, 2, seconds)) {
+    return false;
+  }
+
+  unsigned int month = 0;
+  const std::string_view month_name = buffer.substr(8, 3);
+  for (unsigned int i = 0; i < 12; i++) {
+    if (month_name == http_month_names[i]) {
+      month = i + 1;
+      break;
+    }
+  }
+
+  const std::chrono::year_month_day ymd{std::chrono::year(year), std::chrono::month(month), std::chrono::day(day)};
+  if (!ymd.ok() || (hours > 23) || (minutes > 59) || (seconds > 60)) {
+    return false;
+  }
+
+  value = std::chrono::sys_days(ymd) + std::chrono::hours(hours) + std::chrono::minutes(minutes) + std::chrono::seconds(seconds);
+  return true;
+}
+
 bool IsDateWithinRange(const std::chrono::system_clock::time_point& date, const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end) noexcept
 {
   return ((date >= start) && (date < end));
@@ -99,16 +177,16 @@ size_t GetFileSizeBytes(const std::string& sFilePath) noexcept
 bool ReadFileIntoString(const std::string& sFilePath, size_t nMaxFileSizeBytes, std::string& contents) noexcept
 {
   if (!TestFileExists(sFilePath)) {
-    std::cerr<<"File \""<<sFilePath<<"\" not found"<<std::endl;
+    LOG_ERROR<<"File \""<<sFilePath<<"\" not found";
     return false;
   }
 
   const size_t nFileSizeBytes = GetFileSizeBytes(sFilePath);
   if (nFileSizeBytes == 0) {
-    std::cerr<<"Empty file \""<<sFilePath<<"\""<<std::endl;
+    LOG_ERROR<<"Empty file \""<<sFilePath<<"\"";
     return false;
   } else if (nFileSizeBytes > nMaxFileSizeBytes) {
-    std::cerr<<"File \""<<sFilePath<<"\" is too large"<<std::endl;
+    LOG_ERROR<<"File \""<<sFilePath<<"\" is too large";
     return false;
   }
 
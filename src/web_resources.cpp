@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <optional>
+
+#include <strings.h>
+
+#include <security_headers.h>
+
+#include "feed_data.h"
+#include "feed_snapshot.h"
+#include "log.h"
+#include "perfect_hash.h"
+#include "util.h"
+#include "web_resources.h"
+
+namespace tasktracker {
+
+const std::string ATOM_FEED_MIMETYPE = "application/rss+xml";
+
+const std::string BAD_REQUEST = "400 Bad Request";
+const std::string UNAUTHORISED = "401 Unauthorized";
+const std::string PAGE_NOT_FOUND = "404 Not Found";
+const std::string METHOD_NOT_ALLOWED = "405 Method Not Allowed";
+const std::string TOO_MANY_REQUESTS = "429 Too Many Requests";
+const std::string SERVICE_UNAVAILABLE = "503 Service Unavailable";
+
+const std::vector<std::pair<std::string, std::string>>& GetSecurityHeaders()
+{
+  static const std::vector<std::pair<std::string, std::string>> headers = []() {
+    security_headers::policy p;
+    p.strict_transport_security_max_age_days = 365;
+
+    std::vector<std::pair<std::string, std::string>> result;
+    for (auto&& header : security_headers::GetSecurityHeaders(p)) {
+      result.push_back(std::make_pair(header.name, header.value));
+    }
+    return result;
+  }();
+
+  return headers;
+}
+
+const std::vector<std::pair<std::string, std::string>>& GetSecurityHeadersExceptCacheControl()
+{
+  static const std::vector<std::pair<std::string, std::string>> headers = []() {
+    std::vector<std::pair<std::string, std::string>> result;
+    for (auto&& header : GetSecurityHeaders()) {
+      if ((strcasecmp(header.first.c_str(), "Cache-Control") != 0)) {
+        result.push_back(header);
+      }
+    }
+    return result;
+  }();
+
+  return headers;
+}
+
+
+namespace {
+
+consteval std::array<std::string_view, ROUTE_COUNT> GetRoutePaths()
+{
+  std::array<std::string_view, ROUTE_COUNT> paths;
+  std::copy(embedded::request_paths.begin(), embedded::request_paths.end(), paths.begin());
+  paths[FEED_ROUTE] = "/feed/atom.xml";
+  paths[FEED_EVENTS_ROUTE] = "/feed/events";
+  return paths;
+}
+
+}
+
+size_t FindRoute(std::string_view path)
+{
+  static constexpr util::perfect_hash_table route_table(GetRoutePaths());
+
+  const size_t index = route_table.find(path);
+  return (index != route_table.npos) ? index : ROUTE_NOT_FOUND;
+}
+
+uint32_t GetRouteMethods(size_t route)
+{
+  // An event stream doesn't have headers to check without opening one
+  if (route == FEED_EVENTS_ROUTE) {
+    return http::GetMethodBit(http::METHOD::GET);
+  }
+
+  // Every route is read only at the moment
+  return http::GetMethodBit(http::METHOD::GET) | http::GetMethodBit(http::METHOD::HEAD);
+}
+
+
+namespace {
+
+uint64_t GetRateLimitKey(const util::cIPAddress& address)
+{
+  // An IPv6 client usually has a whole /64 to itself, so limit the /64 instead of letting each address in it have its own bucket
+  const size_t length = address.IsIPv6() ? 8 : 4;
+  const uint64_t offset_basis = address.IsIPv6() ? 0x6666666666666666ull : 0x4444444444444444ull;
+  return util::HashFNV1a64(std::string_view(reinterpret_cast<const char*>(address.bytes.data()), length), offset_basis);
+}
+
+// Clients can cache the feed until the tracker next polls Gitlab, the feed can't change before then
+void SetCacheHeaders(const std::optional<std::chrono::system_clock::time_point>& next_update, cFeedResponse& out_response)
+{
+  if (!next_update) {
+    return;
+  }
+
+  const std::chrono::system_clock::time_point now = util::GetTime();
+  const std::chrono::seconds max_age = (*next_update > now) ? std::chrono::ceil<std::chrono::seconds>(*next_update - now) : std::chrono::seconds(0);
+
+  out_response.cache_control = "max-age=" + std::to_string(max_age.count()) + ", must-revalidate";
+  out_response.expires = util::GetDateTimeHTTP(now + max_age);
+}
+
+}
+
+cFeedResponse::cFeedResponse() :
+  status_code(0),
+  encoding(util::CONTENT_ENCODING::IDENTITY)
+{
+}
+
+cFeedRoute::cFeedRoute() :
+  feed_snapshot(nullptr),
+  event_stream_buffer_bytes(0),
+  token_rate_limit_per_minute(0),
+  token_rate_limit_burst(0)
+{
+}
+
+bool cFeedRoute::Create(const std::vector<cFeedView>& feed_views, const cWebServerOptions& options, const cFeedSnapshot* _feed_snapshot)
+{
+  feed_snapshot = _feed_snapshot;
+  event_stream_buffer_bytes = options.event_stream_buffer_bytes;
+  token_rate_limit_per_minute = options.token_rate_limit_per_minute;
+  token_rate_limit_burst = options.token_rate_limit_burst;
+
+  ip_rate_limiter = std::make_unique<util::cRateLimiter>();
+  if (!ip_rate_limiter->Create(options.ip_rate_limit_per_minute, options.ip_rate_limit_burst)) {
+    LOG_ERROR<<"cFeedRoute::Create Error creating rate limiters";
+    return false;
+  }
+
+  if (!SetFeedViews(feed_views)) {
+    return false;
+  }
+
+  if (ip_rate_limiter->IsEnabled() || (token_rate_limit_per_minute != 0)) {
+    LOG_INFO<<"cFeedRoute::Create Rate limits per IP "<<options.ip_rate_limit_per_minute<<" per minute (Burst "<<options.ip_rate_limit_burst<<"), per token "<<options.token_rate_limit_per_minute<<" per minute (Burst "<<options.token_rate_limit_burst<<")";
+  }
+
+  return true;
+}
+
+bool cFeedRoute::SetFeedViews(const std::vector<cFeedView>& feed_views)
+{
+  std::shared_ptr<cFeedViews> new_views = std::make_shared<cFeedViews>();
+
+  std::vector<std::string> tokens;
+  for (auto&& feed_view : feed_views) {
+    tokens.push_back(feed_view.token);
+  }
+
+  if (!new_views->token_table.Create(tokens)) {
+    LOG_ERROR<<"cFeedRoute::SetFeedViews Error creating token table";
+    return false;
+  }
+
+  // Each view has its own cache so that a view is only rendered when someone asks for it
+  for (size_t i = 0; i < feed_views.size(); i++) {
+    const cFeedView& feed_view = feed_views[i];
+    LOG_INFO<<"cFeedRoute::SetFeedViews Adding feed view \""<<feed_view.name<<"\"";
+    if (feed_snapshot != nullptr) {
+      // The views in the snapshot are in the same order as the settings
+      new_views->feed_render_caches.push_back(std::make_shared<cFeedRenderCache>(feed_view.filter, *feed_snapshot, i));
+    } else {
+      new_views->feed_render_caches.push_back(std::make_shared<cFeedRenderCache>(feed_view.filter));
+    }
+  }
+
+  // There are only a few tokens, so their table can be small
+  new_views->token_rate_limiter = std::make_unique<util::cRateLimiter>();
+  if (!new_views->token_rate_limiter->Create(token_rate_limit_per_minute, token_rate_limit_burst, feed_views.size())) {
+    LOG_ERROR<<"cFeedRoute::SetFeedViews Error creating rate limiters";
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  views = new_views;
+
+  return true;
+}
+
+std::shared_ptr<const cFeedRoute::cFeedViews> cFeedRoute::GetFeedViews() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return views;
+}
+
+bool cFeedRoute::IsRateLimited(const util::cIPAddress* address, const char* token, uint32_t& out_retry_after_seconds) const
+{
+  out_retry_after_seconds = 0;
+
+  if ((address != nullptr) && !ip_rate_limiter->TryTake(GetRateLimitKey(*address), out_retry_after_seconds)) {
+    return true;
+  }
+
+  // Each token has its own bucket, so a leaked token can't use up the limit for everyone else
+  // NOTE: The key is the view plus one because the rate limiter can't tell a key of 0 apart from 1
+  const std::shared_ptr<const cFeedViews> feed_views = GetFeedViews();
+  const size_t view = ((token != nullptr) && feed_views->token_rate_limiter->IsEnabled()) ? feed_views->token_table.Find(token) : cTokenTable::npos;
+  if ((view != cTokenTable::npos) && !feed_views->token_rate_limiter->TryTake(view + 1, out_retry_after_seconds)) {
+    return true;
+  }
+
+  return false;
+}
+
+std::shared_ptr<cFeedRenderCache> cFeedRoute::GetFeedRenderCache(const char* token) const
+{
+  if (token == nullptr) {
+    return nullptr;
+  }
+
+  const std::shared_ptr<const cFeedViews> feed_views = GetFeedViews();
+  const size_t view = feed_views->token_table.Find(token);
+  return (view != cTokenTable::npos) ? feed_views->feed_render_caches[view] : nullptr;
+}
+
+std::shared_ptr<cFeedRenderCache> cFeedRoute::GetFeedRenderCacheIfRenderRequired(http::METHOD method, const char* token, const char* accept_encoding, const char* if_none_match, const char* if_modified_since) const
+{
+  // HEAD requests never render, and an invalid token is answered straight away
+  std::shared_ptr<cFeedRenderCache> feed_render_cache = (method == http::METHOD::GET) ? GetFeedRenderCache(token) : nullptr;
+  if ((feed_render_cache == nullptr) || (feed_render_cache->GetIfCurrent() != nullptr)) {
+    return nullptr;
+  }
+
+  // The client may already have this version, ie. from a HEAD request or from before the settings were reloaded, in which case GetResponse answers 304 without rendering
+  if ((if_none_match != nullptr) || (if_modified_since != nullptr)) {
+    const util::CONTENT_ENCODING encoding = http::ChooseContentEncoding(accept_encoding, util::CONTENT_ENCODINGS_ALL);
+    const cFeedValidators validators = feed_render_cache->GetValidators();
+    if (http::IsNotModified(if_none_match, if_modified_since, http::CreateETagForEncoding(validators.etag, encoding), validators.last_modified)) {
+      return nullptr;
+    }
+  }
+
+  return feed_render_cache;
+}
+
+void cFeedRoute::GetResponse(http::METHOD method, const char* token, const char* accept_encoding, const char* if_none_match, const char* if_modified_since, cFeedResponse& out_response) const
+{
+  out_response = cFeedResponse();
+
+  // The token selects the view of the feed
+  const std::shared_ptr<cFeedRenderCache> feed_render_cache = GetFeedRenderCache(token);
+  if (feed_render_cache == nullptr) {
+    out_response.status_code = 401;
+    return;
+  }
+
+  SetCacheHeaders((feed_snapshot != nullptr) ? feed_snapshot->GetNextUpdate() : GetNextFeedUpdate(), out_response);
+
+  // The user has supplied a valid token, check if they already have the current version of the feed before we render anything
+  // NOTE: Every encoding is created for the feed so we can pick one before rendering
+  const util::CONTENT_ENCODING encoding = http::ChooseContentEncoding(accept_encoding, util::CONTENT_ENCODINGS_ALL);
+  const cFeedValidators validators = feed_render_cache->GetValidators();
+  const std::string etag = http::CreateETagForEncoding(validators.etag, encoding);
+  if (http::IsNotModified(if_none_match, if_modified_since, etag, validators.last_modified)) {
+    out_response.status_code = 304;
+    out_response.encoding = encoding;
+    out_response.etag = etag;
+    out_response.last_modified = validators.last_modified_text;
+    return;
+  }
+
+  std::shared_ptr<const cRenderedFeed> rendered;
+  if (method == http::METHOD::HEAD) {
+    // Monitoring probes the feed with HEAD requests, only use the rendered feed if it is already up to date
+    rendered = feed_render_cache->GetIfCurrent();
+    if (rendered == nullptr) {
+      out_response.status_code = 200;
+      out_response.encoding = encoding;
+      out_response.etag = etag;
+      out_response.last_modified = validators.last_modified_text;
+      return;
+    }
+  } else {
+    // Show the feed, this is only rendered if the feed data has changed since the last request
+    // NOTE: If a worker rendered the feed for this request then this is already up to date, unless the feed data changed again in the mean time
+    rendered = feed_render_cache->Get();
+  }
+
+  // If compressing failed then fall back to the uncompressed feed
+  const util::CONTENT_ENCODING rendered_encoding = ((rendered->content.GetAvailableEncodings() & util::GetContentEncodingBit(encoding)) != 0) ? encoding : util::CONTENT_ENCODING::IDENTITY;
+
+  out_response.status_code = 200;
+  out_response.encoding = rendered_encoding;
+  out_response.etag = http::CreateETagForEncoding(rendered->validators.etag, rendered_encoding);
+  out_response.last_modified = rendered->validators.last_modified_text;
+  out_response.content = rendered->content.Get(rendered_encoding);
+  out_response.rendered = rendered;
+}
+
+std::unique_ptr<cFeedEventStream> cFeedRoute::CreateEventStream(const char* token, const char* last_event_id, unsigned int& out_status_code) const
+{
+  // The token selects the view of the feed
+  const std::shared_ptr<cFeedRenderCache> feed_render_cache = GetFeedRenderCache(token);
+  if (feed_render_cache == nullptr) {
+    out_status_code = 401;
+    return nullptr;
+  }
+
+  // The events are published by the tracker thread in the tracker process
+  if (feed_snapshot != nullptr) {
+    out_status_code = 404;
+    return nullptr;
+  }
+
+  const cFeedEventQueue& queue = GetFeedEventQueue();
+  std::unique_ptr<cFeedEventStream> stream = std::make_unique<cFeedEventStream>(feed_render_cache->GetFilter(), ParseLastEventID(last_event_id, queue), event_stream_buffer_bytes);
+
+  // A client that is resuming gets the events that it missed straight away
+  if (!stream->Update(queue)) {
+    LOG_WARNING<<"cFeedRoute::CreateEventStream The missed events don't fit in the event stream buffer, starting from the latest event";
+    stream = std::make_unique<cFeedEventStream>(feed_render_cache->GetFilter(), queue.GetLastEventID(), event_stream_buffer_bytes);
+  }
+
+  out_status_code = 200;
+  return stream;
+}
+
+}
@@ -5,230 +5,926 @@
 #include <cstring>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <netinet/in.h>
 
-#include <microhttpd.h>
+#include <gnutls/gnutls.h>
 
-#include <security_headers.h>
+#include <microhttpd.h>
 
-#include "atom_feed.h"
-#include "feed_data.h"
+#include "compression.h"
+#include "embedded_resources.h"
+#include "feed_cache.h"
+#include "feed_events.h"
+#include "http_headers.h"
+#include "in_flight_requests.h"
+#include "io_uring_web_server.h"
+#include "ip_address_filter.h"
+#include "log.h"
+#include "tls_certificate_store.h"
+#include "tls_session_resumption.h"
+#include "unix_socket.h"
 #include "util.h"
+#include "web_resources.h"
 #include "web_server.h"
+#include "worker_pool.h"
 
 // For "ms" literal suffix
 using namespace std::chrono_literals;
 
-namespace {
+namespace tasktracker {
+
+// ** cRequestLog
+//
+// What we know about the current request on a connection, this is written to the access log when the request completes
+//
+class cRequestLog {
+public:
+  cRequestLog();
+
+  void Start(const char* method, const char* url);
+  void Clear();
 
-const std::string HTML_MIMETYPE = "text/html";
-const std::string CSS_MIMETYPE = "text/css";
-const std::string SVG_XML_MIMETYPE = "image/svg+xml";
-const std::string ATOM_FEED_MIMETYPE = "application/rss+xml";
+  bool started;
+  std::chrono::steady_clock::time_point start_time;
+  std::string method; // NOTE: These are copied because libmicrohttpd may have reused its buffers by the time the request completes, the strings keep their capacity between requests on the same connection
+  std::string url;
+  unsigned int status_code;
+  size_t content_length;
+  util::CONTENT_ENCODING encoding;
+};
 
+cRequestLog::cRequestLog()
+{
+  Clear();
 }
 
-namespace tasktracker {
+void cRequestLog::Start(const char* _method, const char* _url)
+{
+  started = true;
+  start_time = std::chrono::steady_clock::now();
+  method = _method;
+  url = _url;
+  status_code = 0;
+  content_length = 0;
+  encoding = util::CONTENT_ENCODING::IDENTITY;
+}
 
-class cStaticResource {
-public:
-  void Clear();
+void cRequestLog::Clear()
+{
+  started = false;
+  method.clear();
+  url.clear();
+  status_code = 0;
+  content_length = 0;
+  encoding = util::CONTENT_ENCODING::IDENTITY;
+}
 
-  std::string request_path;
-  std::string response_mime_type;
-  std::string response_text;
+// ** cConnectionContext
+//
+// Created when a client connects and destroyed when the connection is closed, requests on a keep-alive connection reuse it
+//
+// Where the current request is up to with handing its slow work to the worker pool
+enum class SLOW_WORK_STATE {
+  NONE,
+  SUSPENDED, // The connection is suspended while a worker does the slow work, when it is resumed the response can be queued straight away
+  REJECTED, // The worker pool queue was full
 };
 
+class cConnectionContext {
+public:
+  cConnectionContext();
+
+  char client_address[INET6_ADDRSTRLEN];
+  bool has_address; // False for a Unix domain socket
+  util::cIPAddress address; // For the rate limits
+  bool tls_handshake_counted; // The handshake happens once per connection, so we count it on the first request
+  SLOW_WORK_STATE slow_work_state;
+  cRequestLog request;
+};
+
+cConnectionContext::cConnectionContext() :
+  has_address(false),
+  tls_handshake_counted(false),
+  slow_work_state(SLOW_WORK_STATE::NONE)
+{
+  strcpy(client_address, "-");
+}
 
-const std::string UNAUTHORISED = "401 Unauthorized";
-const std::string PAGE_NOT_FOUND = "404 Not Found";
+cConnectionContext* GetConnectionContext(struct MHD_Connection* connection)
+{
+  const union MHD_ConnectionInfo* info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_SOCKET_CONTEXT);
+  return (info != nullptr) ? static_cast<cConnectionContext*>(info->socket_context) : nullptr;
+}
 
+void WriteAccessLog(const cConnectionContext& context, enum MHD_RequestTerminationCode toe)
+{
+  const cRequestLog& request = context.request;
+  const uint64_t duration_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - request.start_time).count();
+
+  LOG_INFO<<"access client="<<context.client_address<<" method="<<logging::quoted(request.method)<<" url="<<logging::quoted(request.url)<<" status="<<request.status_code<<" bytes="<<request.content_length<<" encoding="<<util::GetContentEncodingName(request.encoding)<<" duration_us="<<duration_us<<" completed="<<(toe == MHD_REQUEST_TERMINATED_COMPLETED_OK);
+}
+
+// Queue a response and remember what we sent for the access log
+enum MHD_Result QueueResponse(struct MHD_Connection* connection, unsigned int status_code, struct MHD_Response* response, size_t content_length, util::CONTENT_ENCODING encoding)
+{
+  cConnectionContext* context = GetConnectionContext(connection);
+  if (context != nullptr) {
+    context->request.status_code = status_code;
+    context->request.content_length = (context->request.method == "HEAD") ? 0 : content_length; // libmicrohttpd doesn't send the body for HEAD requests
+    context->request.encoding = encoding;
+  }
+
+  return MHD_queue_response(connection, status_code, response);
+}
 
 
 void ServerAddSecurityHeaders(struct MHD_Response* response)
 {
-  security_headers::policy p;
-  p.strict_transport_security_max_age_days = 365;
-  static const auto&& headers = security_headers::GetSecurityHeaders(p);
+  for (auto&& header : GetSecurityHeaders()) {
+    MHD_add_response_header(response, header.first.c_str(), header.second.c_str());
+  }
+}
+
+// Add the security headers, but with our own Cache-Control and Expires headers if cache_control isn't empty, Expires is left out if it is empty
+void ServerAddSecurityHeaders(struct MHD_Response* response, const char* cache_control, const char* expires)
+{
+  if (cache_control[0] == 0) {
+    ServerAddSecurityHeaders(response);
+    return;
+  }
+
+  for (auto&& header : GetSecurityHeadersExceptCacheControl()) {
+    MHD_add_response_header(response, header.first.c_str(), header.second.c_str());
+  }
+
+  MHD_add_response_header(response, MHD_HTTP_HEADER_CACHE_CONTROL, cache_control);
+  if (expires[0] != 0) {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_EXPIRES, expires);
+  }
+}
+
+void ServerAddContentEncodingHeaders(struct MHD_Response* response, util::CONTENT_ENCODING encoding)
+{
+  if (encoding != util::CONTENT_ENCODING::IDENTITY) {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, util::GetContentEncodingName(encoding));
+  }
+
+  // Tell any caches between us and the client that the response depends on the Accept-Encoding header
+  MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+}
+
+struct MHD_Response* CreateErrorResponse(const std::string& text)
+{
+  // NOTE: text needs to be long lived, static, libmicrohttpd keeps a reference to it
+  struct MHD_Response* response = MHD_create_response_from_buffer_static(text.length(), text.c_str());
+  if (response != nullptr) {
+    ServerAddSecurityHeaders(response);
+  }
+  return response;
+}
+
+struct MHD_Response* CreateNotModifiedResponse(const char* etag, const char* last_modified, const char* cache_control, const char* expires)
+{
+  struct MHD_Response* response = MHD_create_response_from_buffer_static(0, "");
+  if (response != nullptr) {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, etag);
+    if (last_modified[0] != 0) {
+      MHD_add_response_header(response, MHD_HTTP_HEADER_LAST_MODIFIED, last_modified);
+    }
+    MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+    ServerAddSecurityHeaders(response, cache_control, expires);
+  }
+  return response;
+}
+
+struct MHD_Response* CreateStaticResponse(std::string_view content, std::string_view mime_type, util::CONTENT_ENCODING encoding, std::string_view etag)
+{
+  // NOTE: content needs to be long lived, static, libmicrohttpd keeps a reference to it
+  // NOTE: mime_type and etag must be null terminated, the embedded resources are all string literals
+  struct MHD_Response* response = MHD_create_response_from_buffer_static(content.length(), content.data());
+  if (response != nullptr) {
+    MHD_add_response_header(response, "Content-Type", mime_type.data());
+    ServerAddContentEncodingHeaders(response, encoding);
+    MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, etag.data());
+    ServerAddSecurityHeaders(response);
+  }
+  return response;
+}
+
+
+// ** cPrebuiltResponses
+//
+// Responses that are the same every time, these are created once along with all of their headers and queued for every request that needs them
+// NOTE: libmicrohttpd reference counts responses, so the same response can be queued on any number of connections at once and we release our reference when we are destroyed
+//
+class cPrebuiltResponses {
+public:
+  cPrebuiltResponses();
+  ~cPrebuiltResponses();
+
+  bool Create();
+
+  class cStaticResourceResponses {
+  public:
+    std::array<struct MHD_Response*, util::CONTENT_ENCODING_COUNT> ok; // For each encoding
+    std::array<struct MHD_Response*, util::CONTENT_ENCODING_COUNT> not_modified; // For each encoding
+  };
+
+  struct MHD_Response* unauthorised;
+  struct MHD_Response* not_found;
+  struct MHD_Response* service_unavailable;
+  std::array<cStaticResourceResponses, embedded::resources.size()> static_resources; // For each embedded resource
+
+private:
+  void Destroy();
+};
+
+cPrebuiltResponses::cPrebuiltResponses() :
+  unauthorised(nullptr),
+  not_found(nullptr),
+  service_unavailable(nullptr)
+{
+  for (auto&& responses : static_resources) {
+    responses.ok.fill(nullptr);
+    responses.not_modified.fill(nullptr);
+  }
+}
+
+cPrebuiltResponses::~cPrebuiltResponses()
+{
+  Destroy();
+}
+
+bool cPrebuiltResponses::Create()
+{
+  Destroy();
+
+  unauthorised = CreateErrorResponse(UNAUTHORISED);
+  not_found = CreateErrorResponse(PAGE_NOT_FOUND);
+  service_unavailable = CreateErrorResponse(SERVICE_UNAVAILABLE);
+  if ((unauthorised == nullptr) || (not_found == nullptr) || (service_unavailable == nullptr)) {
+    LOG_ERROR<<"cPrebuiltResponses::Create Error creating error responses";
+    return false;
+  }
+
+  // Ask clients that are turned away because we are busy to try again shortly
+  MHD_add_response_header(service_unavailable, MHD_HTTP_HEADER_RETRY_AFTER, "1");
+
+  for (size_t i = 0; i < embedded::resources.size(); i++) {
+    const cEmbeddedResource& resource = embedded::resources[i];
+
+    for (size_t e = 0; e < util::CONTENT_ENCODING_COUNT; e++) {
+      const util::CONTENT_ENCODING encoding = static_cast<util::CONTENT_ENCODING>(e);
+
+      static_resources[i].ok[e] = CreateStaticResponse(resource.variants[e], resource.mime_type, encoding, resource.etags[e]);
+      static_resources[i].not_modified[e] = CreateNotModifiedResponse(resource.etags[e].data(), "", "", "");
+      if ((static_resources[i].ok[e] == nullptr) || (static_resources[i].not_modified[e] == nullptr)) {
+        LOG_ERROR<<"cPrebuiltResponses::Create Error creating responses for \""<<resource.request_path<<"\"";
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void cPrebuiltResponses::Destroy()
+{
+  auto release = [](struct MHD_Response*& response) {
+    if (response != nullptr) {
+      MHD_destroy_response(response);
+      response = nullptr;
+    }
+  };
 
-  for (auto&& header : headers) {
-    MHD_add_response_header(response, header.name.c_str(), header.value.c_str());
+  release(unauthorised);
+  release(not_found);
+  release(service_unavailable);
+
+  for (auto&& responses : static_resources) {
+    for (auto&& response : responses.ok) {
+      release(response);
+    }
+    for (auto&& response : responses.not_modified) {
+      release(response);
+    }
   }
 }
 
-bool Server401Unauthorised(struct MHD_Connection* connection)
+
+bool Server401Unauthorised(struct MHD_Connection* connection, const cPrebuiltResponses& prebuilt_responses)
+{
+  return (QueueResponse(connection, MHD_HTTP_UNAUTHORIZED, prebuilt_responses.unauthorised, UNAUTHORISED.length(), util::CONTENT_ENCODING::IDENTITY) == MHD_YES);
+}
+
+enum MHD_Result Server404NotFoundResponse(struct MHD_Connection* connection, const cPrebuiltResponses& prebuilt_responses)
+{
+  return QueueResponse(connection, MHD_HTTP_NOT_FOUND, prebuilt_responses.not_found, PAGE_NOT_FOUND.length(), util::CONTENT_ENCODING::IDENTITY);
+}
+
+enum MHD_Result Server405MethodNotAllowedResponse(struct MHD_Connection* connection, uint32_t allowed_methods)
 {
-  struct MHD_Response* response = MHD_create_response_from_buffer_static(UNAUTHORISED.length(), UNAUTHORISED.c_str());
-  const enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_UNAUTHORIZED, response);
-  const char* mime = nullptr;
-  MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, mime);
+  // NOTE: This is rare, and the Allow header depends on the route, so it is created each time
+  struct MHD_Response* response = MHD_create_response_from_buffer_static(METHOD_NOT_ALLOWED.length(), METHOD_NOT_ALLOWED.c_str());
+  if (response == nullptr) {
+    return MHD_NO;
+  }
+
+  MHD_add_response_header(response, MHD_HTTP_HEADER_ALLOW, http::CreateAllowHeader(allowed_methods).c_str());
   ServerAddSecurityHeaders(response);
+  const enum MHD_Result result = QueueResponse(connection, MHD_HTTP_METHOD_NOT_ALLOWED, response, METHOD_NOT_ALLOWED.length(), util::CONTENT_ENCODING::IDENTITY);
   MHD_destroy_response(response);
-  return (ret == MHD_YES);;
+  return result;
 }
 
-enum MHD_Result Server404NotFoundResponse(struct MHD_Connection* connection)
+enum MHD_Result Server429TooManyRequestsResponse(struct MHD_Connection* connection, uint32_t retry_after_seconds)
 {
-  struct MHD_Response* response = MHD_create_response_from_buffer_static(PAGE_NOT_FOUND.length(), PAGE_NOT_FOUND.c_str());
-  const enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_NOT_FOUND, response);
-  const char* mime = nullptr;
-  MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, mime);
+  // NOTE: The Retry-After header depends on the client's bucket, so it is created each time
+  struct MHD_Response* response = MHD_create_response_from_buffer_static(TOO_MANY_REQUESTS.length(), TOO_MANY_REQUESTS.c_str());
+  if (response == nullptr) {
+    return MHD_NO;
+  }
+
+  MHD_add_response_header(response, MHD_HTTP_HEADER_RETRY_AFTER, std::to_string(retry_after_seconds).c_str());
   ServerAddSecurityHeaders(response);
+  const enum MHD_Result result = QueueResponse(connection, MHD_HTTP_TOO_MANY_REQUESTS, response, TOO_MANY_REQUESTS.length(), util::CONTENT_ENCODING::IDENTITY);
   MHD_destroy_response(response);
-  return ret;
+  return result;
 }
 
-bool ServerRegularResponse(struct MHD_Connection* connection, std::string_view content, std::string_view mime_type)
+enum MHD_Result Server503ServiceUnavailableResponse(struct MHD_Connection* connection, const cPrebuiltResponses& prebuilt_responses)
 {
-  // NOTE: content needs to be long lived, static, libmicrohttpd keeps a reference to it
-  struct MHD_Response* response = MHD_create_response_from_buffer_static(content.length(), content.data());
-  MHD_add_response_header(response, "Content-Type", mime_type.data());
-  ServerAddSecurityHeaders(response);
-  const int result = MHD_queue_response(connection, MHD_HTTP_OK, response);
+  return QueueResponse(connection, MHD_HTTP_SERVICE_UNAVAILABLE, prebuilt_responses.service_unavailable, SERVICE_UNAVAILABLE.length(), util::CONTENT_ENCODING::IDENTITY);
+}
+
+bool ServerNotModifiedResponse(struct MHD_Connection* connection, const std::string& etag, const std::string& last_modified, const std::string& cache_control, const std::string& expires)
+{
+  struct MHD_Response* response = CreateNotModifiedResponse(etag.c_str(), last_modified.c_str(), cache_control.c_str(), expires.c_str());
+  const int result = QueueResponse(connection, MHD_HTTP_NOT_MODIFIED, response, 0, util::CONTENT_ENCODING::IDENTITY);
   MHD_destroy_response(response);
   return (result == MHD_YES);
 }
 
-bool ServerRegularDynamicResponse(struct MHD_Connection* connection, std::string_view content, std::string_view mime_type)
+bool IsRequestNotModified(struct MHD_Connection* connection, std::string_view etag, const std::optional<std::chrono::system_clock::time_point>& last_modified)
 {
-  // NOTE: We have to use MHD_RESPMEM_MUST_COPY so that libmicrohttpd makes a copy of the content
-  struct MHD_Response* response = MHD_create_response_from_buffer(content.length(), (void*)content.data(), MHD_RESPMEM_MUST_COPY);
+  const char* if_none_match = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH);
+  const char* if_modified_since = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_MODIFIED_SINCE);
+  return http::IsNotModified(if_none_match, if_modified_since, etag, last_modified);
+}
+
+util::CONTENT_ENCODING ChooseContentEncoding(struct MHD_Connection* connection, uint32_t available_encodings)
+{
+  const char* accept_encoding = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  return http::ChooseContentEncoding(accept_encoding, available_encodings);
+}
+
+// Called by libmicrohttpd when the last connection using a dynamic response has finished with it
+void ReleaseDynamicResponseContent(void* cls)
+{
+  delete static_cast<std::shared_ptr<const void>*>(cls);
+}
+
+// NOTE: content must point into memory owned by content_owner, the response holds a reference to content_owner instead of copying the content so large feeds go straight from the render cache to the socket
+bool ServerRegularDynamicResponse(struct MHD_Connection* connection, const std::shared_ptr<const void>& content_owner, std::string_view content, std::string_view mime_type, util::CONTENT_ENCODING encoding, const std::string& etag, const std::string& last_modified, const std::string& cache_control, const std::string& expires)
+{
+  std::shared_ptr<const void>* owner = new std::shared_ptr<const void>(content_owner);
+  struct MHD_Response* response = MHD_create_response_from_buffer_with_free_content_cls(content.length(), content.data(), &ReleaseDynamicResponseContent, owner);
+  if (response == nullptr) {
+    LOG_ERROR<<"ServerRegularDynamicResponse Error creating response";
+    delete owner;
+    return false;
+  }
+
   MHD_add_response_header(response, "Content-Type", mime_type.data());
-  ServerAddSecurityHeaders(response);
-  const int result = MHD_queue_response(connection, MHD_HTTP_OK, response);
+  ServerAddContentEncodingHeaders(response, encoding);
+  MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, etag.c_str());
+  MHD_add_response_header(response, MHD_HTTP_HEADER_LAST_MODIFIED, last_modified.c_str());
+  ServerAddSecurityHeaders(response, cache_control.c_str(), expires.c_str());
+  const int result = QueueResponse(connection, MHD_HTTP_OK, response, content.length(), encoding);
   MHD_destroy_response(response);
   return (result == MHD_YES);
 }
 
+
+// Respond to a HEAD request with the headers of a dynamic resource that hasn't been generated yet, the body and its length are left out
+// NOTE: MHD_RF_HEAD_ONLY_RESPONSE stops libmicrohttpd from adding "Content-Length: 0"
+bool ServerHeadOnlyDynamicResponse(struct MHD_Connection* connection, std::string_view mime_type, util::CONTENT_ENCODING encoding, const std::string& etag, const std::string& last_modified, const std::string& cache_control, const std::string& expires)
+{
+  struct MHD_Response* response = MHD_create_response_empty(MHD_RF_HEAD_ONLY_RESPONSE);
+  if (response == nullptr) {
+    LOG_ERROR<<"ServerHeadOnlyDynamicResponse Error creating response";
+    return false;
+  }
+
+  MHD_add_response_header(response, "Content-Type", mime_type.data());
+  ServerAddContentEncodingHeaders(response, encoding);
+  MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, etag.c_str());
+  MHD_add_response_header(response, MHD_HTTP_HEADER_LAST_MODIFIED, last_modified.c_str());
+  ServerAddSecurityHeaders(response, cache_control.c_str(), expires.c_str());
+  const int result = QueueResponse(connection, MHD_HTTP_OK, response, 0, encoding);
+  MHD_destroy_response(response);
+  return (result == MHD_YES);
 }
 
-namespace tasktracker {
 
-class cStaticResourcesRequestHandler {
+// ** cEventStreams
+//
+// The /feed/events streams on one web server, new events and heartbeats are added to each stream's buffer and libmicrohttpd reads them out as the socket takes them
+// A stream with nothing to send suspends its connection so that it doesn't keep the event loop busy, it is resumed when there is something to send
+// NOTE: With a thread per connection the connection's own thread waits for something to send instead
+//
+class cEventStreams {
 public:
-  bool LoadStaticResources();
+  cEventStreams();
+  ~cEventStreams();
+
+  // Start listening for new events, blocking is true for a thread per connection
+  bool Create(bool blocking);
+  void Destroy();
+
+  // Send what has already been buffered and then end every stream, new streams end straight away
+  void EndAll();
 
-  bool HandleRequest(struct MHD_Connection* connection, std::string_view url);
+  // Queue a response that sends the stream's events to the connection until the client goes away
+  bool QueueEventStreamResponse(struct MHD_Connection* connection, std::unique_ptr<cFeedEventStream> event_stream);
 
 private:
-  bool LoadStaticResource(const std::string& request_path, const std::string& response_mime_type, const std::string& file_path);
+  class cStream {
+  public:
+    cEventStreams* owner;
+    struct MHD_Connection* connection;
+    std::unique_ptr<cFeedEventStream> event_stream;
+    bool suspended;
+    bool overflowed; // The client isn't reading fast enough, it is disconnected once the buffered events have been sent
+  };
+
+  static ssize_t _OnRead(void* cls, uint64_t pos, char* buf, size_t max);
+  static void _OnFree(void* cls);
+
+  void OnPublish();
+  void HeartbeatThread();
+
+  // Resume the connection if it is waiting and there is something to do, called with the mutex locked
+  void Wake(cStream& stream);
 
-  // Yes, this could have been a map of std::string to std::pair<std::string, std::string>
-  std::vector<cStaticResource> static_resources;
+  bool blocking;
+  size_t listener;
+  std::thread heartbeat_thread;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::set<cStream*> streams;
+  bool ending;
+  bool stopping;
 };
 
-bool cStaticResourcesRequestHandler::LoadStaticResource(const std::string& request_path, const std::string& response_mime_type, const std::string& file_path)
+cEventStreams::cEventStreams() :
+  blocking(false),
+  listener(0),
+  ending(false),
+  stopping(false)
+{
+}
+
+cEventStreams::~cEventStreams()
+{
+  Destroy();
+}
+
+bool cEventStreams::Create(bool _blocking)
 {
-  cStaticResource resource;
+  Destroy();
 
-  const size_t nMaxFileSizeBytes = 20 * 1024;
-  if (!util::ReadFileIntoString(file_path, nMaxFileSizeBytes, resource.response_text)) {
-    std::cerr<<"File \""<<file_path<<"\" not found"<<std::endl;
+  blocking = _blocking;
+  ending = false;
+  stopping = false;
+
+  heartbeat_thread = std::thread(&cEventStreams::HeartbeatThread, this);
+  listener = GetFeedEventQueue().AddListener([this]() { OnPublish(); });
+
+  return true;
+}
+
+void cEventStreams::Destroy()
+{
+  if (listener != 0) {
+    GetFeedEventQueue().RemoveListener(listener);
+    listener = 0;
+  }
+
+  if (heartbeat_thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    heartbeat_thread.join();
+  }
+}
+
+void cEventStreams::EndAll()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  ending = true;
+
+  for (auto&& stream : streams) {
+    Wake(*stream);
+  }
+
+  cv.notify_all();
+}
+
+bool cEventStreams::QueueEventStreamResponse(struct MHD_Connection* connection, std::unique_ptr<cFeedEventStream> event_stream)
+{
+  cStream* stream = new cStream;
+  stream->owner = this;
+  stream->connection = connection;
+  stream->event_stream = std::move(event_stream);
+  stream->suspended = false;
+  stream->overflowed = false;
+
+  // NOTE: The block size is the most that libmicrohttpd asks for at once, the stream's buffer limit is what bounds the memory for each client
+  struct MHD_Response* response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4 * 1024, &_OnRead, stream, &_OnFree);
+  if (response == nullptr) {
+    LOG_ERROR<<"cEventStreams::QueueEventStreamResponse Error creating response";
+    delete stream;
     return false;
   }
 
-  resource.request_path = request_path;
-  resource.response_mime_type = response_mime_type;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    streams.insert(stream);
+
+    // Pick up anything that was published after the stream was created but before OnPublish could see it
+    if (!stream->event_stream->Update(GetFeedEventQueue())) {
+      LOG_WARNING<<"cEventStreams::QueueEventStreamResponse Event stream buffer is full, disconnecting the client";
+      stream->overflowed = true;
+    }
+  }
+
+  MHD_add_response_header(response, "Content-Type", EVENT_STREAM_MIMETYPE.c_str());
+  MHD_add_response_header(response, "X-Accel-Buffering", "no"); // Ask nginx to pass each event on straight away
+  ServerAddSecurityHeaders(response, "no-cache", "");
 
-  static_resources.push_back(resource);
+  // The stream is quiet between events, the heartbeats tell us when the client has gone
+  MHD_set_connection_option(connection, MHD_CONNECTION_OPTION_TIMEOUT, 0u);
 
-  return true;
+  // NOTE: The length in the access log is counted as the events are sent
+  const enum MHD_Result result = QueueResponse(connection, MHD_HTTP_OK, response, 0, util::CONTENT_ENCODING::IDENTITY);
+  MHD_destroy_response(response);
+  return (result == MHD_YES);
 }
 
-bool cStaticResourcesRequestHandler::LoadStaticResources()
+ssize_t cEventStreams::_OnRead(void* cls, uint64_t pos, char* buf, size_t max)
 {
-  static_resources.clear();
+  (void)pos;
 
-  // A bit of a hack, this will find the resources folder either from the main folder, or from the fuzz folder
-  const std::string resources_folder = util::TestFolderExists("resources") ? "./resources" : "../resources";
+  cStream* stream = static_cast<cStream*>(cls);
+  cEventStreams* pThis = stream->owner;
 
-  return (
-    LoadStaticResource("/", HTML_MIMETYPE, resources_folder + "/index.html") &&
-    LoadStaticResource("/style.css", CSS_MIMETYPE, resources_folder + "/style.css") &&
-    LoadStaticResource("/favicon.svg", SVG_XML_MIMETYPE, resources_folder + "/favicon.svg")
-  );
+  std::unique_lock<std::mutex> lock(pThis->mutex);
+
+  if (pThis->blocking) {
+    pThis->cv.wait(lock, [pThis, stream]() { return !stream->event_stream->IsEmpty() || stream->overflowed || pThis->ending; });
+  }
+
+  if (!stream->event_stream->IsEmpty()) {
+    const size_t length = stream->event_stream->Read(buf, max);
+
+    cConnectionContext* context = GetConnectionContext(stream->connection);
+    if (context != nullptr) {
+      context->request.content_length += length;
+    }
+
+    return static_cast<ssize_t>(length);
+  } else if (stream->overflowed) {
+    // The client can reconnect with the Last-Event-ID of the last event that it received
+    return MHD_CONTENT_READER_END_WITH_ERROR;
+  } else if (pThis->ending) {
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  }
+
+  // Nothing to send yet, libmicrohttpd calls us again when the connection is resumed
+  MHD_suspend_connection(stream->connection);
+  stream->suspended = true;
+  return 0;
+}
+
+void cEventStreams::_OnFree(void* cls)
+{
+  cStream* stream = static_cast<cStream*>(cls);
+
+  {
+    std::lock_guard<std::mutex> lock(stream->owner->mutex);
+    stream->owner->streams.erase(stream);
+  }
+
+  delete stream;
 }
 
-bool cStaticResourcesRequestHandler::HandleRequest(struct MHD_Connection* connection, std::string_view url)
+void cEventStreams::OnPublish()
 {
-  // Handle static resources
-  if (!url.empty() && (url[0] == '/')) {
-    for (auto&& resource : static_resources) {
-      if (url == resource.request_path) {
-        // This is the requested resource so create a response
-        std::cout<<"Serving: 200 \""<<url<<"\" static"<<std::endl;
-        return ServerRegularResponse(connection, resource.response_text, resource.response_mime_type);
+  const cFeedEventQueue& queue = GetFeedEventQueue();
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (auto&& stream : streams) {
+    if (!stream->overflowed && !stream->event_stream->Update(queue)) {
+      LOG_WARNING<<"cEventStreams::OnPublish Event stream buffer is full, disconnecting the client";
+      stream->overflowed = true;
+    }
+
+    Wake(*stream);
+  }
+
+  cv.notify_all();
+}
+
+void cEventStreams::HeartbeatThread()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (!cv.wait_for(lock, FEED_EVENTS_HEARTBEAT_INTERVAL, [this]() { return stopping; })) {
+    for (auto&& stream : streams) {
+      if (!stream->overflowed && !stream->event_stream->AddHeartbeat()) {
+        stream->overflowed = true;
       }
+
+      Wake(*stream);
     }
+
+    cv.notify_all();
   }
+}
 
-  return false;
+void cEventStreams::Wake(cStream& stream)
+{
+  if (!stream.suspended || (stream.event_stream->IsEmpty() && !stream.overflowed && !ending)) {
+    return;
+  }
+
+  stream.suspended = false;
+  MHD_resume_connection(stream.connection);
 }
 
+}
 
-class cDynamicResourcesRequestHandler {
+namespace tasktracker {
+
+// ** cRouteHandler
+//
+// Handles the requests for one route, the router has already checked that the route allows the method
+// NOTE: HEAD requests use the same responses as GET, libmicrohttpd leaves the body out
+//
+class cRouteHandler {
 public:
-  explicit cDynamicResourcesRequestHandler(const std::string& token);
+  virtual ~cRouteHandler() {}
+
+  // Returns true with out_retry_after_seconds set if the client has made too many requests, this is checked once for each request before any slow work
+  virtual bool IsRateLimited(struct MHD_Connection* connection, uint32_t& out_retry_after_seconds) { (void)connection; out_retry_after_seconds = 0; return false; }
 
-  bool HandleRequest(struct MHD_Connection* connection, std::string_view url);
+  // Returns slow work that has to be done before this request can be answered, such as rendering, or nullptr if HandleRequest can answer it straight away
+  // The work is run on a worker thread, HandleRequest is then called on the libmicrohttpd thread to queue the response
+  virtual std::function<void()> GetSlowWork(struct MHD_Connection* connection, http::METHOD method) { (void)connection; (void)method; return nullptr; }
+
+  virtual bool HandleRequest(struct MHD_Connection* connection, http::METHOD method) = 0;
+};
+
+
+class cStaticResourceRouteHandler : public cRouteHandler {
+public:
+  cStaticResourceRouteHandler(const cPrebuiltResponses& prebuilt_responses, size_t index);
+
+  bool HandleRequest(struct MHD_Connection* connection, http::METHOD method) override;
 
 private:
-  bool IsTokenMatch(const char* user_token) const;
+  const cPrebuiltResponses& prebuilt_responses;
+  const size_t index; // The index of the embedded resource
+};
+
+cStaticResourceRouteHandler::cStaticResourceRouteHandler(const cPrebuiltResponses& _prebuilt_responses, size_t _index) :
+  prebuilt_responses(_prebuilt_responses),
+  index(_index)
+{
+}
+
+bool cStaticResourceRouteHandler::HandleRequest(struct MHD_Connection* connection, http::METHOD method)
+{
+  (void)method;
+
+  // Pick the best encoding that the client supports
+  const cEmbeddedResource& resource = embedded::resources[index];
+  const util::CONTENT_ENCODING encoding = ChooseContentEncoding(connection, util::CONTENT_ENCODINGS_ALL);
+  const size_t e = static_cast<size_t>(encoding);
+
+  // Check if the client already has the current version
+  if (IsRequestNotModified(connection, resource.etags[e], std::nullopt)) {
+    return (QueueResponse(connection, MHD_HTTP_NOT_MODIFIED, prebuilt_responses.static_resources[index].not_modified[e], 0, encoding) == MHD_YES);
+  }
+
+  // Queue the prebuilt response
+  return (QueueResponse(connection, MHD_HTTP_OK, prebuilt_responses.static_resources[index].ok[e], resource.variants[e].length(), encoding) == MHD_YES);
+}
+
+
+// The feed and its event stream share the rate limits for the client's address and token
+bool IsFeedRateLimited(struct MHD_Connection* connection, const cFeedRoute& feed_route, uint32_t& out_retry_after_seconds)
+{
+  const cConnectionContext* context = GetConnectionContext(connection);
+  const util::cIPAddress* address = ((context != nullptr) && context->has_address) ? &context->address : nullptr;
+  const char* user_token = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "token");
+  return feed_route.IsRateLimited(address, user_token, out_retry_after_seconds);
+}
+
+class cFeedRouteHandler : public cRouteHandler {
+public:
+  cFeedRouteHandler(const cPrebuiltResponses& prebuilt_responses, const cFeedRoute& feed_route);
+
+  bool IsRateLimited(struct MHD_Connection* connection, uint32_t& out_retry_after_seconds) override;
+  std::function<void()> GetSlowWork(struct MHD_Connection* connection, http::METHOD method) override;
+  bool HandleRequest(struct MHD_Connection* connection, http::METHOD method) override;
 
-  std::string expected_token;
+private:
+  const cPrebuiltResponses& prebuilt_responses;
+  const cFeedRoute& feed_route;
 };
 
-cDynamicResourcesRequestHandler::cDynamicResourcesRequestHandler(const std::string& token) :
-  expected_token(token)
+cFeedRouteHandler::cFeedRouteHandler(const cPrebuiltResponses& _prebuilt_responses, const cFeedRoute& _feed_route) :
+  prebuilt_responses(_prebuilt_responses),
+  feed_route(_feed_route)
 {
 }
 
-bool cDynamicResourcesRequestHandler::IsTokenMatch(const char* user_token) const
+bool cFeedRouteHandler::IsRateLimited(struct MHD_Connection* connection, uint32_t& out_retry_after_seconds)
 {
-  if (user_token == nullptr) return false;
+  return IsFeedRateLimited(connection, feed_route, out_retry_after_seconds);
+}
 
-  const std::string user_token_str(user_token);
+std::function<void()> cFeedRouteHandler::GetSlowWork(struct MHD_Connection* connection, http::METHOD method)
+{
+  const char* user_token = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "token");
+  const char* accept_encoding = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  const char* if_none_match = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH);
+  const char* if_modified_since = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_MODIFIED_SINCE);
+  std::shared_ptr<cFeedRenderCache> feed_render_cache = feed_route.GetFeedRenderCacheIfRenderRequired(method, user_token, accept_encoding, if_none_match, if_modified_since);
+  if (feed_render_cache == nullptr) {
+    return nullptr;
+  }
 
-  return (user_token_str == expected_token);
+  // The feed needs rendering, once it has been rendered HandleRequest picks it up from the cache
+  return [feed_render_cache]() {
+    feed_render_cache->Get();
+  };
 }
 
-bool cDynamicResourcesRequestHandler::HandleRequest(struct MHD_Connection* connection, std::string_view url)
+bool cFeedRouteHandler::HandleRequest(struct MHD_Connection* connection, http::METHOD method)
 {
-  // Handle dynamic resources
-  if (url == "/feed/atom.xml") {
-    const char* user_token = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "token");
-    if (!IsTokenMatch(user_token)) {
-      std::cout<<"Serving: 401 \""<<url<<"\" dynamic"<<std::endl;
-      return Server401Unauthorised(connection);
-    } else {
-      // The user has supplied the expected token, show the feed
-      std::ostringstream output;
-      {
-        std::lock_guard<std::mutex> lock(mutex_feed_data);
-        feed::WriteFeedXML(feed_data, output);
-      }
+  const char* user_token = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "token");
+  const char* accept_encoding = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  const char* if_none_match = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH);
+  const char* if_modified_since = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_MODIFIED_SINCE);
+
+  cFeedResponse response;
+  feed_route.GetResponse(method, user_token, accept_encoding, if_none_match, if_modified_since, response);
+
+  if (response.status_code == MHD_HTTP_UNAUTHORIZED) {
+    return Server401Unauthorised(connection, prebuilt_responses);
+  } else if (response.status_code == MHD_HTTP_NOT_MODIFIED) {
+    return ServerNotModifiedResponse(connection, response.etag, response.last_modified, response.cache_control, response.expires);
+  } else if (response.rendered == nullptr) {
+    return ServerHeadOnlyDynamicResponse(connection, ATOM_FEED_MIMETYPE, response.encoding, response.etag, response.last_modified, response.cache_control, response.expires);
+  }
 
-      const std::string content = output.str();
+  // This is the requested resource so create a response, the rendered feed is immutable so the response can share it with the cache
+  return ServerRegularDynamicResponse(connection, response.rendered, response.content, ATOM_FEED_MIMETYPE, response.encoding, response.etag, response.last_modified, response.cache_control, response.expires);
+}
 
-      // This is the requested resource so create a response
-      std::cout<<"Serving: 200 \""<<url<<"\" dynamic"<<std::endl;
-      return ServerRegularDynamicResponse(connection, content, ATOM_FEED_MIMETYPE);
-    }
+
+class cFeedEventsRouteHandler : public cRouteHandler {
+public:
+  cFeedEventsRouteHandler(const cPrebuiltResponses& prebuilt_responses, const cFeedRoute& feed_route, cEventStreams& event_streams);
+
+  bool IsRateLimited(struct MHD_Connection* connection, uint32_t& out_retry_after_seconds) override;
+  bool HandleRequest(struct MHD_Connection* connection, http::METHOD method) override;
+
+private:
+  const cPrebuiltResponses& prebuilt_responses;
+  const cFeedRoute& feed_route;
+  cEventStreams& event_streams;
+};
+
+cFeedEventsRouteHandler::cFeedEventsRouteHandler(const cPrebuiltResponses& _prebuilt_responses, const cFeedRoute& _feed_route, cEventStreams& _event_streams) :
+  prebuilt_responses(_prebuilt_responses),
+  feed_route(_feed_route),
+  event_streams(_event_streams)
+{
+}
+
+bool cFeedEventsRouteHandler::IsRateLimited(struct MHD_Connection* connection, uint32_t& out_retry_after_seconds)
+{
+  return IsFeedRateLimited(connection, feed_route, out_retry_after_seconds);
+}
+
+bool cFeedEventsRouteHandler::HandleRequest(struct MHD_Connection* connection, http::METHOD method)
+{
+  (void)method;
+
+  const char* user_token = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "token");
+  const char* last_event_id = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Last-Event-ID");
+
+  unsigned int status_code = MHD_HTTP_OK;
+  std::unique_ptr<cFeedEventStream> event_stream = feed_route.CreateEventStream(user_token, last_event_id, status_code);
+  if (status_code == MHD_HTTP_UNAUTHORIZED) {
+    return Server401Unauthorised(connection, prebuilt_responses);
+  } else if (event_stream == nullptr) {
+    return (Server404NotFoundResponse(connection, prebuilt_responses) == MHD_YES);
+  }
+
+  return event_streams.QueueEventStreamResponse(connection, std::move(event_stream));
+}
+
+
+// ** cRouter
+//
+// Maps a request path to its route with one perfect hash lookup, the paths are known at compile time so dispatching doesn't get slower as routes are added
+// Each route has a mask of the methods it allows and its own handler object
+//
+class cRouter {
+public:
+  class cRoute {
+  public:
+    uint32_t methods; // A mask of http::GetMethodBit values
+    cRouteHandler* handler;
+  };
+
+  cRouter(const cPrebuiltResponses& prebuilt_responses, const cFeedRoute& feed_route, cEventStreams& event_streams);
+
+  bool Create();
+
+  // Returns the route for url, or nullptr if there isn't one
+  const cRoute* Find(std::string_view url) const;
+
+private:
+  const cPrebuiltResponses& prebuilt_responses;
+
+  std::vector<cStaticResourceRouteHandler> static_resource_handlers; // For each embedded resource
+  cFeedRouteHandler feed_handler;
+  cFeedEventsRouteHandler feed_events_handler;
+
+  std::array<cRoute, ROUTE_COUNT> routes; // In the same order as the route paths
+};
+
+cRouter::cRouter(const cPrebuiltResponses& _prebuilt_responses, const cFeedRoute& feed_route, cEventStreams& event_streams) :
+  prebuilt_responses(_prebuilt_responses),
+  feed_handler(_prebuilt_responses, feed_route),
+  feed_events_handler(_prebuilt_responses, feed_route, event_streams)
+{
+  routes.fill({ 0, nullptr });
+}
+
+bool cRouter::Create()
+{
+  // NOTE: The routes point at the handlers, so we reserve space up front to stop the vector from moving them
+  static_resource_handlers.clear();
+  static_resource_handlers.reserve(embedded::resources.size());
+  for (size_t i = 0; i < embedded::resources.size(); i++) {
+    static_resource_handlers.emplace_back(prebuilt_responses, i);
+    routes[i] = { GetRouteMethods(i), &static_resource_handlers.back() };
+  }
+
+  routes[FEED_ROUTE] = { GetRouteMethods(FEED_ROUTE), &feed_handler };
+  routes[FEED_EVENTS_ROUTE] = { GetRouteMethods(FEED_EVENTS_ROUTE), &feed_events_handler };
+
+  return true;
+}
+
+const cRouter::cRoute* cRouter::Find(std::string_view url) const
+{
+  const size_t index = FindRoute(url);
+  if ((index == ROUTE_NOT_FOUND) || (routes[index].handler == nullptr)) {
+    return nullptr;
   }
 
-  return false;
+  return &routes[index];
 }
 
 }
@@ -236,16 +932,44 @@ bool cDynamicResourcesRequestHandler::HandleRequest(struct MHD_Connection* conne
 
 namespace tasktracker {
 
-class cWebServer {
+// NOTE: libmicrohttpd doesn't have an option for session tickets, so we get the GnuTLS session for each connection and enable them ourselves
+gnutls_session_t GetTLSSession(struct MHD_Connection* connection)
+{
+  const union MHD_ConnectionInfo* info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_GNUTLS_SESSION);
+  return (info != nullptr) ? static_cast<gnutls_session_t>(info->tls_session) : nullptr;
+}
+
+}
+
+namespace tasktracker {
+
+// ** cWebServer
+//
+// The libmicrohttpd backend
+//
+class cWebServer : public cWebServerBackend {
 public:
-  cWebServer(cStaticResourcesRequestHandler& static_resources_request_handler, cDynamicResourcesRequestHandler& dynamic_resources_request_handler);
+  explicit cWebServer(const cFeedRoute& feed_route);
   ~cWebServer();
 
-  bool Open(const util::cIPAddress& host, uint16_t port, const std::string& private_key, const std::string& public_cert, bool fuzzing);
-  void NoMoreConnections();
-  bool Close();
+  bool Open(const cListenEndpoint& endpoint, const std::string& private_key, const std::string& public_cert, bool fuzzing, const cWebServerOptions& options) override;
+  void NoMoreConnections() override;
+  bool Close() override;
+
+  bool WaitForInFlightRequests(std::chrono::steady_clock::time_point deadline) const override;
+  size_t GetInFlightRequests() const override;
+
+  int GetListeningSocket() const override;
+  void HandOffListeningSocket() override;
+
+  cTLSSessionCounters GetTLSSessionCounters() const override;
+  util::cWorkerPoolCounters GetWorkerPoolCounters() const override;
 
 private:
+  static enum MHD_Result _OnAcceptPolicy(void* cls, const struct sockaddr* address, socklen_t address_length);
+  static void _OnConnectionNotify(void* cls, struct MHD_Connection* connection, void** socket_context, enum MHD_ConnectionNotificationCode toe);
+  static void _OnRequestCompleted(void* cls, struct MHD_Connection* connection, void** req_cls, enum MHD_RequestTerminationCode toe);
+
   static enum MHD_Result _OnRequest(
     void* cls,
     struct MHD_Connection* connection,
@@ -258,15 +982,26 @@ private:
   );
 
   struct MHD_Daemon* daemon;
-
-  cStaticResourcesRequestHandler& static_resources_request_handler;
-  cDynamicResourcesRequestHandler& dynamic_resources_request_handler;
+  int quiesced_listen_socket; // MHD_quiesce_daemon returns the listening socket for us to close
+  std::string unix_socket_path; // Removed when the server is closed
+  bool tls;
+  util::cIPAddressFilter address_filter; // Checked when a client connects, before the TLS handshake
+  std::atomic<uint64_t> denied_connections;
+  cInFlightRequests in_flight_requests; // Started on the first call for each request and completed by libmicrohttpd's completed notification
+  cTLSSessionResumption tls_session_resumption;
+  util::cWorkerPool worker_pool; // Runs slow work such as rendering the feed so that the libmicrohttpd threads keep servicing connections
+  cEventStreams event_streams;
+
+  cPrebuiltResponses prebuilt_responses;
+  cRouter router;
 };
 
-cWebServer::cWebServer(cStaticResourcesRequestHandler& _static_resources_request_handler, cDynamicResourcesRequestHandler& _dynamic_resources_request_handler) :
+cWebServer::cWebServer(const cFeedRoute& feed_route) :
   daemon(nullptr),
-  static_resources_request_handler(_static_resources_request_handler),
-  dynamic_resources_request_handler(_dynamic_resources_request_handler)
+  quiesced_listen_socket(-1),
+  tls(false),
+  denied_connections(0),
+  router(prebuilt_responses, feed_route, event_streams)
 {
 }
 
@@ -276,89 +1011,351 @@ cWebServer::~cWebServer()
   Close();
 }
 
-bool cWebServer::Open(const util::cIPAddress& host, uint16_t port, const std::string& private_key, const std::string& public_cert, bool fuzzing)
+bool cWebServer::Open(const cListenEndpoint& endpoint, const std::string& private_key, const std::string& public_cert, bool fuzzing, const cWebServerOptions& web_server_options)
 {
-  const std::string address(util::ToString(host));
-
-  struct sockaddr_in sad;
-  memset(&sad, 0, sizeof(sad));
-  if (inet_pton(AF_INET, address.c_str(), &(sad.sin_addr.s_addr)) != 1) {
-    std::cerr<<"V4 inet_pton fail for "<<address<<std::endl;
+  // Build the responses that are the same for every request once up front
+  if (!prebuilt_responses.Create() || !router.Create()) {
     return false;
   }
 
-  sad.sin_family = AF_INET;
-  sad.sin_port   = htons(port);
+  const std::string address(ToString(endpoint));
+
+  struct sockaddr_storage sad;
+  util::ToSockAddr(endpoint.address, endpoint.port, sad);
 
   std::vector<struct MHD_OptionItem> options = {
-    { MHD_OPTION_CONNECTION_TIMEOUT, static_cast<intptr_t>((unsigned int)120), nullptr },
-    { MHD_OPTION_SOCK_ADDR, reinterpret_cast<intptr_t>((const struct sockaddr*)&sad), nullptr },
+    { MHD_OPTION_CONNECTION_TIMEOUT, static_cast<intptr_t>(web_server_options.connection_timeout_seconds), nullptr },
+    { MHD_OPTION_CONNECTION_LIMIT, static_cast<intptr_t>(web_server_options.connection_limit), nullptr },
+    { MHD_OPTION_CONNECTION_MEMORY_LIMIT, static_cast<intptr_t>(web_server_options.connection_memory_limit_bytes), nullptr },
+    { MHD_OPTION_LISTEN_BACKLOG_SIZE, static_cast<intptr_t>(web_server_options.listen_backlog), nullptr },
+    { MHD_OPTION_NOTIFY_CONNECTION, reinterpret_cast<intptr_t>(&_OnConnectionNotify), this },
+    { MHD_OPTION_NOTIFY_COMPLETED, reinterpret_cast<intptr_t>(&_OnRequestCompleted), this },
   };
 
-  if (fuzzing) {
-    options.push_back({ MHD_OPTION_LISTENING_ADDRESS_REUSE, static_cast<intptr_t>(1), nullptr }); // So that we can bind the port repeatedly in quick succession
+  // NOTE: Every connection on a Unix domain socket comes from the reverse proxy, so there is no per IP limit
+  const bool per_ip_connection_limit = !fuzzing && !endpoint.IsUnixSocket();
+
+  if (endpoint.listen_socket >= 0) {
+    // The socket is already bound and listening
+    // NOTE: An inherited Unix domain socket belongs to whoever created it, so we don't remove it
+    options.push_back({ MHD_OPTION_LISTEN_SOCKET, static_cast<intptr_t>(endpoint.listen_socket), nullptr });
+  } else if (endpoint.IsUnixSocket()) {
+    // NOTE: The socket is created just before starting the daemon, below
   } else {
-    options.push_back({ MHD_OPTION_CONNECTION_LIMIT, static_cast<intptr_t>(10), nullptr }); // Rate limit to 10 simultaneous connections per IP
+    options.push_back({ MHD_OPTION_SOCK_ADDR, reinterpret_cast<intptr_t>((const struct sockaddr*)&sad), nullptr });
+
+    if (fuzzing || web_server_options.reuse_port) {
+      options.push_back({ MHD_OPTION_LISTENING_ADDRESS_REUSE, static_cast<intptr_t>(1), nullptr }); // So that we can bind the port repeatedly in quick succession, and so that each worker process can bind the same port
+    }
   }
 
+  if (per_ip_connection_limit) {
+    options.push_back({ MHD_OPTION_PER_IP_CONNECTION_LIMIT, static_cast<intptr_t>(web_server_options.per_ip_connection_limit), nullptr }); // Rate limit simultaneous connections per IP
+  }
+
+  // NOTE: Every connection on a Unix domain socket comes from the reverse proxy, so there is nothing to filter
+  address_filter.Clear();
+  if (!endpoint.IsUnixSocket()) {
+    address_filter.Create(web_server_options.allow_networks, web_server_options.deny_networks);
+    if (address_filter.IsEnabled()) {
+      LOG_INFO<<"cWebServer::Open Allowed networks "<<web_server_options.allow_networks.size()<<", denied networks "<<web_server_options.deny_networks.size();
+    }
+  }
+
+  LOG_INFO<<"cWebServer::Open Connection timeout "<<web_server_options.connection_timeout_seconds<<" seconds, limit "<<web_server_options.connection_limit<<", per IP limit "<<(per_ip_connection_limit ? web_server_options.per_ip_connection_limit : 0)<<", memory limit "<<web_server_options.connection_memory_limit_bytes<<" bytes, listen backlog "<<web_server_options.listen_backlog;
+
+  // Select the threading model
+  unsigned int flags = MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG;
+
+  // NOTE: Without MHD_USE_DUAL_STACK libmicrohttpd sets IPV6_V6ONLY on IPv6 sockets, an inherited socket already has it set
+  if (!endpoint.IsUnixSocket() && endpoint.address.IsIPv6() && (endpoint.listen_socket < 0)) {
+    flags |= (endpoint.dual_stack ? MHD_USE_DUAL_STACK : MHD_USE_IPv6);
+  }
+
+  switch (web_server_options.threading_model) {
+    case THREADING_MODEL::SINGLE_THREAD: {
+      flags |= MHD_USE_AUTO;
+      break;
+    }
+    case THREADING_MODEL::THREAD_POOL: {
+      // NOTE: libmicrohttpd doesn't support a thread pool with thread per connection, each thread in the pool runs its own event loop
+#ifdef __linux__
+      flags |= MHD_USE_EPOLL;
+#else
+      flags |= MHD_USE_AUTO;
+#endif
+
+      const unsigned int thread_pool_size = (web_server_options.thread_pool_size != 0) ? web_server_options.thread_pool_size : std::max(1u, std::thread::hardware_concurrency());
+      options.push_back({ MHD_OPTION_THREAD_POOL_SIZE, static_cast<intptr_t>(thread_pool_size), nullptr });
+      break;
+    }
+    case THREADING_MODEL::THREAD_PER_CONNECTION: {
+      // NOTE: Thread per connection can't use epoll, MHD_USE_AUTO picks poll or select
+      flags |= MHD_USE_THREAD_PER_CONNECTION | MHD_USE_AUTO;
+      break;
+    }
+  }
+
+  // The inter thread communication channel lets MHD_quiesce_daemon wake up each thread in the other threading models
+  if (web_server_options.threading_model != THREADING_MODEL::SINGLE_THREAD) {
+    flags |= MHD_USE_ITC;
+  }
+
+  LOG_INFO<<"cWebServer::Open Threading model "<<GetThreadingModelName(web_server_options.threading_model);
+
+  // Event streams and slow work suspend their connections while they wait
+  // NOTE: With a thread per connection waiting only holds up its own connection, so they wait on the connection's thread instead
+  const bool thread_per_connection = (web_server_options.threading_model == THREADING_MODEL::THREAD_PER_CONNECTION);
+  if (!thread_per_connection) {
+    flags |= MHD_ALLOW_SUSPEND_RESUME;
+  }
+
+  if (!event_streams.Create(thread_per_connection)) {
+    return false;
+  }
+
+  // Slow work is handed to the worker pool while the connection is suspended
+  if ((web_server_options.worker_threads != 0) && !thread_per_connection) {
+    if (!worker_pool.Create(web_server_options.worker_threads, web_server_options.worker_queue_limit)) {
+      return false;
+    }
+
+    LOG_INFO<<"cWebServer::Open Worker pool threads "<<web_server_options.worker_threads<<", queue limit "<<web_server_options.worker_queue_limit;
+  }
 
   if (!private_key.empty() && !public_cert.empty()) {
-    std::cout<<"cWebServer::Run Starting server at https://"<<address<<":"<<port<<"/"<<std::endl;
-    std::string server_key;
-    util::ReadFileIntoString(private_key, 10 * 1024, server_key);
-    std::string server_cert;
-    util::ReadFileIntoString(public_cert, 10 * 1024, server_cert);
-
-    options.push_back({ MHD_OPTION_HTTPS_MEM_KEY, 0, static_cast<void*>(const_cast<char*>(server_key.c_str())) });
-    options.push_back({ MHD_OPTION_HTTPS_MEM_CERT, 0, static_cast<void*>(const_cast<char*>(server_cert.c_str())) });
-
-    options.push_back({ MHD_OPTION_END, 0, nullptr });
-
-    daemon = MHD_start_daemon(MHD_USE_AUTO
-                          | MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG
-                          | MHD_USE_TLS,
-                          port,
-                          nullptr, nullptr,
-                          &_OnRequest, this,
-                          MHD_OPTION_ARRAY,
-                          options.data(),
-                          MHD_OPTION_END);
+    LOG_INFO<<"cWebServer::Run Starting server at https://"<<address<<"/"<<(endpoint.dual_stack ? " (Dual stack)" : "");
+    // Each handshake asks the store for the certificate, so a reload can replace it while we are running
+    if (!GetTLSCertificateStore().Load(private_key, public_cert)) {
+      return false;
+    }
+
+    options.push_back({ MHD_OPTION_HTTPS_CERT_CALLBACK, 0, reinterpret_cast<void*>(&RetrieveTLSCertificate) });
+
+    if (!web_server_options.tls_priorities.empty()) {
+      LOG_INFO<<"cWebServer::Open TLS priorities \""<<web_server_options.tls_priorities<<"\"";
+      options.push_back({ MHD_OPTION_HTTPS_PRIORITIES, 0, static_cast<void*>(const_cast<char*>(web_server_options.tls_priorities.c_str())) });
+    }
+
+    if (!tls_session_resumption.Create(web_server_options, GetTLSSessionTicketKey())) {
+      return false;
+    }
+
+    LOG_INFO<<"cWebServer::Open TLS session tickets "<<(web_server_options.tls_session_tickets ? "enabled" : "disabled");
+
+    tls = true;
+    flags |= MHD_USE_TLS;
   } else {
-    std::cout<<"cWebServer::Run Starting server at http://"<<address<<":"<<port<<"/"<<std::endl;
+    LOG_INFO<<"cWebServer::Run Starting server at http://"<<address<<"/"<<(endpoint.dual_stack ? " (Dual stack)" : "");
+  }
+
+  // libmicrohttpd only binds TCP sockets itself, so we create the Unix domain socket and hand it over
+  // NOTE: This is done last so that starting the daemon is the only thing that can fail while we own the socket
+  int created_listen_socket = -1;
+  if ((endpoint.listen_socket < 0) && endpoint.IsUnixSocket()) {
+    created_listen_socket = OpenUnixListeningSocket(endpoint.unix_socket_path, web_server_options.listen_backlog);
+    if (created_listen_socket < 0) {
+      return false;
+    }
+
+    options.push_back({ MHD_OPTION_LISTEN_SOCKET, static_cast<intptr_t>(created_listen_socket), nullptr });
+  }
+
+  options.push_back({ MHD_OPTION_END, 0, nullptr });
+
+  daemon = MHD_start_daemon(flags,
+                        endpoint.port,
+                        address_filter.IsEnabled() ? &_OnAcceptPolicy : nullptr, this,
+                        &_OnRequest, this,
+                        MHD_OPTION_ARRAY,
+                        options.data(),
+                        MHD_OPTION_END);
+  if (daemon == nullptr) {
+    LOG_ERROR<<"cWebServer::Open Error starting the server";
+
+    // libmicrohttpd only closes the listening socket that it was given when it is stopped, so clean up the one that we created
+    if (created_listen_socket >= 0) {
+      close(created_listen_socket);
+      RemoveUnixListeningSocket(endpoint.unix_socket_path);
+    }
 
-    options.push_back({ MHD_OPTION_END, 0, nullptr });
+    return false;
+  }
 
-    daemon = MHD_start_daemon(MHD_USE_AUTO
-                          | MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG,
-                          port,
-                          nullptr, nullptr,
-                          &_OnRequest, this,
-                          MHD_OPTION_ARRAY,
-                          options.data(),
-                          MHD_OPTION_END);
+  if (created_listen_socket >= 0) {
+    unix_socket_path = endpoint.unix_socket_path;
   }
 
-  return (daemon != nullptr);
+  return true;
 }
 
 void cWebServer::NoMoreConnections()
 {
-  if (daemon != nullptr) {
-    MHD_quiesce_daemon(daemon);
+  if ((daemon != nullptr) && (quiesced_listen_socket < 0)) {
+    // NOTE: libmicrohttpd hands the listening socket back to us, it is closed when the daemon stops
+    quiesced_listen_socket = MHD_quiesce_daemon(daemon);
   }
+
+  // An event stream never finishes by itself, so end them to let the drain complete
+  event_streams.EndAll();
+}
+
+bool cWebServer::WaitForInFlightRequests(std::chrono::steady_clock::time_point deadline) const
+{
+  return in_flight_requests.WaitUntilIdle(deadline);
+}
+
+size_t cWebServer::GetInFlightRequests() const
+{
+  return in_flight_requests.Get();
+}
+
+int cWebServer::GetListeningSocket() const
+{
+  if ((daemon == nullptr) || (quiesced_listen_socket >= 0)) {
+    return -1;
+  }
+
+  const union MHD_DaemonInfo* info = MHD_get_daemon_info(daemon, MHD_DAEMON_INFO_LISTEN_FD);
+  return (info != nullptr) ? info->listen_fd : -1;
+}
+
+void cWebServer::HandOffListeningSocket()
+{
+  // The new process is listening on the path now
+  unix_socket_path.clear();
+
+  // NOTE: MHD_quiesce_daemon only stops polling the socket, so the new process keeps accepting on it after we close our copy
+  NoMoreConnections();
 }
 
 bool cWebServer::Close()
 {
+  // Finish the slow work first, each job resumes its connection so that none are left suspended when the daemon stops
+  // NOTE: The daemon is still servicing connections while the pool is destroyed, from then on their slow work runs on the libmicrohttpd threads instead
+  if (worker_pool.IsRunning()) {
+    worker_pool.Destroy();
+
+    const util::cWorkerPoolCounters counters = worker_pool.GetCounters();
+    LOG_INFO<<"cWebServer::Close Worker pool completed="<<counters.completed<<" rejected="<<counters.rejected<<" peak_queue_depth="<<counters.peak_queue_depth;
+  }
+
+  // Likewise resume the event streams and stop adding to them
+  event_streams.EndAll();
+  event_streams.Destroy();
+
   // Stop the server
   if (daemon != nullptr) {
     MHD_stop_daemon(daemon);
     daemon = nullptr;
   }
 
+  if (quiesced_listen_socket >= 0) {
+    close(quiesced_listen_socket);
+    quiesced_listen_socket = -1;
+  }
+
+  if (!unix_socket_path.empty()) {
+    RemoveUnixListeningSocket(unix_socket_path);
+    unix_socket_path.clear();
+  }
+
+  if (address_filter.IsEnabled()) {
+    LOG_INFO<<"cWebServer::Close Denied connections "<<denied_connections.load();
+    address_filter.Clear();
+  }
+
+  if (tls) {
+    const cTLSSessionCounters counters = tls_session_resumption.GetCounters();
+    const uint64_t total = counters.full_handshakes + counters.resumed_handshakes;
+    LOG_INFO<<"cWebServer::Close TLS handshakes full="<<counters.full_handshakes<<" resumed="<<counters.resumed_handshakes<<" resumption_rate_percent="<<((total != 0) ? ((100 * counters.resumed_handshakes) / total) : 0);
+
+    tls_session_resumption.Destroy();
+    tls = false;
+  }
+
   return true;
 }
 
+util::cWorkerPoolCounters cWebServer::GetWorkerPoolCounters() const
+{
+  return worker_pool.GetCounters();
+}
+
+cTLSSessionCounters cWebServer::GetTLSSessionCounters() const
+{
+  return tls_session_resumption.GetCounters();
+}
+
+
+// Called by libmicrohttpd straight after accept, a client that isn't allowed is closed before the TLS handshake or anything is allocated for it
+enum MHD_Result cWebServer::_OnAcceptPolicy(void* cls, const struct sockaddr* address, socklen_t address_length)
+{
+  (void)address_length;
+
+  cWebServer* pThis = static_cast<cWebServer*>(cls);
+
+  util::cIPAddress client_address;
+  if (util::FromSockAddr(address, client_address) && pThis->address_filter.IsAllowed(client_address)) {
+    return MHD_YES;
+  }
+
+  pThis->denied_connections++;
+  return MHD_NO;
+}
+
+void cWebServer::_OnConnectionNotify(void* cls, struct MHD_Connection* connection, void** socket_context, enum MHD_ConnectionNotificationCode toe)
+{
+  cWebServer* pThis = static_cast<cWebServer*>(cls);
+
+  if (toe == MHD_CONNECTION_NOTIFY_STARTED) {
+    cConnectionContext* context = new cConnectionContext;
+
+    // The GnuTLS session has been created but the handshake hasn't started yet, so this is our chance to let the client resume a previous session
+    if (pThis->tls) {
+      gnutls_session_t session = GetTLSSession(connection);
+      if (session != nullptr) {
+        pThis->tls_session_resumption.EnableForSession(session);
+      }
+    }
+
+    // Remember the client address for the access log
+    const union MHD_ConnectionInfo* info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+    if ((info != nullptr) && (info->client_addr != nullptr)) {
+      const struct sockaddr* address = info->client_addr;
+      if (address->sa_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in*>(address)->sin_addr, context->client_address, sizeof(context->client_address));
+      } else if (address->sa_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6*>(address)->sin6_addr, context->client_address, sizeof(context->client_address));
+      }
+
+      context->has_address = util::FromSockAddr(address, context->address);
+    }
+
+    *socket_context = context;
+  } else if (toe == MHD_CONNECTION_NOTIFY_CLOSED) {
+    delete static_cast<cConnectionContext*>(*socket_context);
+    *socket_context = nullptr;
+  }
+}
+
+void cWebServer::_OnRequestCompleted(void* cls, struct MHD_Connection* connection, void** req_cls, enum MHD_RequestTerminationCode toe)
+{
+  (void)req_cls;
+
+  // NOTE: libmicrohttpd only notifies us about requests that it called _OnRequest for, whether they finished or the connection was closed part way through
+  cWebServer* pThis = static_cast<cWebServer*>(cls);
+  pThis->in_flight_requests.Completed();
+
+  cConnectionContext* context = GetConnectionContext(connection);
+  if ((context == nullptr) || !context->request.started) {
+    return;
+  }
+
+  WriteAccessLog(*context, toe);
+  context->request.Clear();
+  context->slow_work_state = SLOW_WORK_STATE::NONE;
+}
 
 
 /**
@@ -393,8 +1390,25 @@ enum MHD_Result cWebServer::_OnRequest(
 
   static int aptr = 0;
 
-  if (0 != strcmp(method, "GET")) {
-    return MHD_NO;              /* unexpected method */
+  if (&aptr != *req_cls) {
+    // This is a new request, it is in flight until libmicrohttpd tells us that it has completed
+    cWebServer* pThis = static_cast<cWebServer*>(cls);
+    pThis->in_flight_requests.Started();
+
+    // Start timing it for the access log
+    cConnectionContext* context = GetConnectionContext(connection);
+    if (context != nullptr) {
+      context->request.Start(method, url);
+
+      // The handshake has finished by the time the first request arrives, count whether it was resumed
+      if (pThis->tls && !context->tls_handshake_counted) {
+        gnutls_session_t session = GetTLSSession(connection);
+        if (session != nullptr) {
+          pThis->tls_session_resumption.CountHandshake(session);
+        }
+        context->tls_handshake_counted = true;
+      }
+    }
   }
 
   if (&aptr != *req_cls) {
@@ -402,102 +1416,271 @@ enum MHD_Result cWebServer::_OnRequest(
     *req_cls = &aptr;
     return MHD_YES;
   }
-  // We have handled a request before
-  *req_cls = nullptr;
+  // NOTE: req_cls stays set until the request completes so that we are not treated as a new request when a suspended connection is resumed, libmicrohttpd clears it for the next request
 
 
   cWebServer* pThis = static_cast<cWebServer*>(cls);
   if (pThis == nullptr) {
-    std::cerr<<"Error pThis is NULL"<<std::endl;
+    LOG_ERROR<<"Error pThis is NULL";
     return MHD_NO;
   }
 
-  // Handle static resources
-  if (pThis->static_resources_request_handler.HandleRequest(connection, url)) {
-    return MHD_YES;
+  // Find the route for this resource
+  const cRouter::cRoute* route = pThis->router.Find(url);
+  if (route == nullptr) {
+    // Unknown resource
+    return Server404NotFoundResponse(connection, pThis->prebuilt_responses);
   }
 
-  // Handle dynamic resources
-  if (pThis->dynamic_resources_request_handler.HandleRequest(connection, url)) {
-    return MHD_YES;
+  const http::METHOD request_method = http::ParseMethod(method);
+  if ((route->methods & http::GetMethodBit(request_method)) == 0) {
+    return Server405MethodNotAllowedResponse(connection, route->methods);
   }
 
-  // Unknown resource
-  std::cout<<"Serving: 404 \""<<url<<"\""<<std::endl;
-  return Server404NotFoundResponse(connection);
+  cConnectionContext* context = GetConnectionContext(connection);
+
+  // Check the rate limits once, before any slow work, a request that was suspended for slow work has already been checked
+  if ((context == nullptr) || (context->slow_work_state == SLOW_WORK_STATE::NONE)) {
+    uint32_t retry_after_seconds = 0;
+    if (route->handler->IsRateLimited(connection, retry_after_seconds)) {
+      return Server429TooManyRequestsResponse(connection, retry_after_seconds);
+    }
+  }
+
+  if ((context != nullptr) && pThis->worker_pool.IsRunning()) {
+    switch (context->slow_work_state) {
+      case SLOW_WORK_STATE::NONE: {
+        std::function<void()> work = route->handler->GetSlowWork(connection, request_method);
+        if (work == nullptr) {
+          break;
+        }
+
+        // Suspend the connection while a worker does the slow work, libmicrohttpd calls us again when it is resumed
+        // NOTE: The connection is suspended before the job is queued so that the worker can't resume it first
+        MHD_suspend_connection(connection);
+        context->slow_work_state = SLOW_WORK_STATE::SUSPENDED;
+
+        if (!pThis->worker_pool.TrySubmit([work, connection]() {
+          work();
+          MHD_resume_connection(connection);
+        })) {
+          // The queue is full or the pool is being destroyed, resume straight away and turn the client away
+          context->slow_work_state = SLOW_WORK_STATE::REJECTED;
+          MHD_resume_connection(connection);
+        }
+
+        return MHD_YES;
+      }
+      case SLOW_WORK_STATE::SUSPENDED: {
+        // The slow work is done
+        context->slow_work_state = SLOW_WORK_STATE::NONE;
+        break;
+      }
+      case SLOW_WORK_STATE::REJECTED: {
+        context->slow_work_state = SLOW_WORK_STATE::NONE;
+        return Server503ServiceUnavailableResponse(connection, pThis->prebuilt_responses);
+      }
+    }
+  }
+
+  return route->handler->HandleRequest(connection, request_method) ? MHD_YES : MHD_NO;
 }
 
 
 cWebServerManager::cWebServerManager() :
-  static_resources_request_handler(nullptr),
-  dynamic_resources_request_handler(nullptr),
-  webserver(nullptr)
+  feed_route(nullptr),
+  tls(false),
+  shutdown_timeout(0)
 {
 }
 
 cWebServerManager::~cWebServerManager()
 {
-  if (webserver != nullptr) {
+  for (auto&& webserver : webservers) {
     delete webserver;
-    webserver = nullptr;
   }
+  webservers.clear();
 
-  if (static_resources_request_handler != nullptr) {
-    delete static_resources_request_handler;
-    static_resources_request_handler = nullptr;
+  // NOTE: This is last because the web servers serve the feed from it
+  if (feed_route != nullptr) {
+    delete feed_route;
+    feed_route = nullptr;
   }
+}
 
-  if (dynamic_resources_request_handler != nullptr) {
-    delete dynamic_resources_request_handler;
-    dynamic_resources_request_handler = nullptr;
-  }
+bool cWebServerManager::Create(const util::cIPAddress& host, uint16_t port, const std::string& private_key, const std::string& public_cert, bool fuzzing, const std::vector<cFeedView>& feed_views, const cWebServerOptions& options)
+{
+  return Create({ cListenEndpoint(host, port) }, private_key, public_cert, fuzzing, feed_views, options);
 }
 
-bool cWebServerManager::Create(const util::cIPAddress& host, uint16_t port, const std::string& private_key, const std::string& public_cert, bool fuzzing, const std::string& token)
+bool cWebServerManager::Create(const std::vector<cListenEndpoint>& _endpoints, const std::string& private_key, const std::string& public_cert, bool fuzzing, const std::vector<cFeedView>& feed_views, const cWebServerOptions& options, const cFeedSnapshot* feed_snapshot)
 {
   if (
-    (static_resources_request_handler != nullptr) ||
-    (dynamic_resources_request_handler != nullptr) ||
-    (webserver != nullptr)
+    (feed_route != nullptr) ||
+    !webservers.empty()
   ) {
-    std::cerr<<"Error already created"<<std::endl;
+    LOG_ERROR<<"Error already created";
     return false;
   }
 
-  static_resources_request_handler = new cStaticResourcesRequestHandler;
+  if (_endpoints.empty()) {
+    LOG_ERROR<<"Error no endpoints to listen on";
+    return false;
+  }
 
-  // Load the static resources
-  if (!static_resources_request_handler->LoadStaticResources()) {
+  feed_route = new cFeedRoute;
+  if (!feed_route->Create(feed_views, options, feed_snapshot)) {
     return false;
   }
 
-  dynamic_resources_request_handler = new cDynamicResourcesRequestHandler(token);
+  LOG_INFO<<"cWebServerManager::Create Backend "<<GetBackendName(options.backend);
+
+  shutdown_timeout = std::chrono::seconds(options.shutdown_timeout_seconds);
 
-  webserver = new cWebServer(*static_resources_request_handler, *dynamic_resources_request_handler);
-  if (!webserver->Open(host, port, private_key, public_cert, fuzzing)) {
-    std::cerr<<"Error opening web server"<<std::endl;
+  // Every endpoint shares one session ticket key so that a client can resume its session on any of them, a prefork worker has already been given the tracker process's key
+  if (options.tls_session_tickets && !GetTLSSessionTicketKey().IsValid() && !GetTLSSessionTicketKey().Generate()) {
     return false;
   }
 
-  std::cout<<"Server is running"<<std::endl;
+  std::vector<cListenEndpoint> endpoints = _endpoints;
+  SetDualStack(endpoints);
+
+  for (auto&& endpoint : endpoints) {
+    cWebServerBackend* webserver = nullptr;
+
+    switch (options.backend) {
+      case BACKEND::LIBMICROHTTPD: {
+        webserver = new cWebServer(*feed_route);
+        break;
+      }
+      case BACKEND::IO_URING: {
+        webserver = CreateIOUringWebServer(*feed_route);
+        break;
+      }
+    }
+
+    if (webserver == nullptr) {
+      LOG_ERROR<<"Error creating web server";
+      return false;
+    }
+
+    webservers.push_back(webserver);
+
+    // Unix domain sockets are behind a reverse proxy that terminates TLS
+    const std::string endpoint_private_key = endpoint.IsUnixSocket() ? "" : private_key;
+    const std::string endpoint_public_cert = endpoint.IsUnixSocket() ? "" : public_cert;
+
+    if (!webserver->Open(endpoint, endpoint_private_key, endpoint_public_cert, fuzzing, options)) {
+      LOG_ERROR<<"Error opening web server on "<<ToString(endpoint);
+      return false;
+    }
+
+    if (!endpoint_private_key.empty() && !endpoint_public_cert.empty()) {
+      tls = true;
+    }
+  }
+
+  LOG_INFO<<"Server is running";
 
   return true;
 };
 
+bool cWebServerManager::Reload(const std::vector<cFeedView>& feed_views, const std::string& private_key, const std::string& public_cert)
+{
+  if (feed_route == nullptr) {
+    LOG_ERROR<<"cWebServerManager::Reload Error not created";
+    return false;
+  }
+
+  LOG_INFO<<"cWebServerManager::Reload Reloading the feed views"<<(tls ? " and the certificate" : "");
+
+  bool result = feed_route->SetFeedViews(feed_views);
+
+  // The next handshake picks up the new certificate, connections that have already finished their handshake keep the old one
+  if (tls && !GetTLSCertificateStore().Load(private_key, public_cert)) {
+    result = false;
+  }
+
+  return result;
+}
+
+std::vector<int> cWebServerManager::GetListeningSockets() const
+{
+  std::vector<int> sockets;
+
+  for (auto&& webserver : webservers) {
+    const int fd = webserver->GetListeningSocket();
+    if (fd >= 0) {
+      sockets.push_back(fd);
+    }
+  }
+
+  return sockets;
+}
+
+void cWebServerManager::HandOffListeningSockets()
+{
+  for (auto&& webserver : webservers) {
+    webserver->HandOffListeningSocket();
+  }
+}
+
+cTLSSessionCounters cWebServerManager::GetTLSSessionCounters() const
+{
+  cTLSSessionCounters total;
+
+  for (auto&& webserver : webservers) {
+    const cTLSSessionCounters counters = webserver->GetTLSSessionCounters();
+    total.full_handshakes += counters.full_handshakes;
+    total.resumed_handshakes += counters.resumed_handshakes;
+  }
+
+  return total;
+}
+
+util::cWorkerPoolCounters cWebServerManager::GetWorkerPoolCounters() const
+{
+  util::cWorkerPoolCounters total;
+
+  for (auto&& webserver : webservers) {
+    const util::cWorkerPoolCounters counters = webserver->GetWorkerPoolCounters();
+    total.queue_depth += counters.queue_depth;
+    total.peak_queue_depth = std::max(total.peak_queue_depth, counters.peak_queue_depth);
+    total.completed += counters.completed;
+    total.rejected += counters.rejected;
+  }
+
+  return total;
+}
+
 bool cWebServerManager::Destroy()
 {
-  std::cout<<"Shutting down the server"<<std::endl;
+  LOG_INFO<<"Shutting down the server";
 
-  webserver->NoMoreConnections();
+  for (auto&& webserver : webservers) {
+    webserver->NoMoreConnections();
+  }
 
-  // Wait for the connection threads to respond
-  std::cout<<"Waiting for the connection threads to respond"<<std::endl;
-  sleep(2);
+  // Let the requests that have already started finish, we stop waiting as soon as the last one completes
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const std::chrono::steady_clock::time_point deadline = start + shutdown_timeout;
 
-  /* usually we should wait here in a safe way for all threads to disconnect, */
-  /* but we skip this in the example */
+  bool drained = true;
+  for (auto&& webserver : webservers) {
+    if (!webserver->WaitForInFlightRequests(deadline)) {
+      LOG_WARNING<<"cWebServerManager::Destroy Timed out with "<<webserver->GetInFlightRequests()<<" requests still in flight, closing their connections";
+      drained = false;
+      break;
+    }
+  }
 
-  webserver->Close();
+  if (drained) {
+    LOG_INFO<<"cWebServerManager::Destroy Requests finished in "<<std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()<<" ms";
+  }
+
+  for (auto&& webserver : webservers) {
+    webserver->Close();
+  }
 
   return true;
 }
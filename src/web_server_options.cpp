@@ -0,0 +1,148 @@
+#include "web_server_options.h"
+
+namespace tasktracker {
+
+cListenEndpoint::cListenEndpoint() :
+  port(0),
+  dual_stack(false),
+  listen_socket(-1)
+{
+}
+
+cListenEndpoint::cListenEndpoint(const util::cIPAddress& _address, uint16_t _port) :
+  address(_address),
+  port(_port),
+  dual_stack(false),
+  listen_socket(-1)
+{
+}
+
+cListenEndpoint::cListenEndpoint(const std::string& _unix_socket_path) :
+  port(0),
+  dual_stack(false),
+  unix_socket_path(_unix_socket_path),
+  listen_socket(-1)
+{
+}
+
+bool ParseListenEndpoint(std::string_view text, cListenEndpoint& out_endpoint)
+{
+  out_endpoint = cListenEndpoint();
+
+  if (text.starts_with("unix:")) {
+    // The path has to fit in sockaddr_un::sun_path
+    const std::string_view path = text.substr(5);
+    if (!path.starts_with('/') || (path.length() >= 108)) {
+      return false;
+    }
+
+    out_endpoint.unix_socket_path = path;
+    return true;
+  }
+
+  return util::ParseAddressAndPort(text, out_endpoint.address, out_endpoint.port);
+}
+
+void SetDualStack(std::vector<cListenEndpoint>& endpoints)
+{
+  for (auto&& endpoint : endpoints) {
+    endpoint.dual_stack = false;
+    if (endpoint.IsUnixSocket() || !endpoint.address.IsIPv6() || !endpoint.address.IsAny()) {
+      continue;
+    }
+
+    endpoint.dual_stack = true;
+    for (auto&& other : endpoints) {
+      if (!other.IsUnixSocket() && other.address.IsIPv4() && (other.port == endpoint.port)) {
+        endpoint.dual_stack = false;
+        break;
+      }
+    }
+  }
+}
+
+std::string ToString(const cListenEndpoint& endpoint)
+{
+  if (endpoint.IsUnixSocket()) {
+    return "unix:" + endpoint.unix_socket_path;
+  }
+
+  const std::string address = util::ToString(endpoint.address);
+  return (endpoint.address.IsIPv6() ? ("[" + address + "]") : address) + ":" + std::to_string(endpoint.port);
+}
+
+
+bool ParseBackend(std::string_view text, BACKEND& out_backend)
+{
+  if (text == "libmicrohttpd") {
+    out_backend = BACKEND::LIBMICROHTTPD;
+  } else if (text == "io_uring") {
+    out_backend = BACKEND::IO_URING;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+const char* GetBackendName(BACKEND backend)
+{
+  switch (backend) {
+    case BACKEND::LIBMICROHTTPD: return "libmicrohttpd";
+    case BACKEND::IO_URING: return "io_uring";
+  }
+
+  return "unknown";
+}
+
+bool ParseThreadingModel(std::string_view text, THREADING_MODEL& out_threading_model)
+{
+  if (text == "single_thread") {
+    out_threading_model = THREADING_MODEL::SINGLE_THREAD;
+  } else if (text == "thread_pool") {
+    out_threading_model = THREADING_MODEL::THREAD_POOL;
+  } else if (text == "thread_per_connection") {
+    out_threading_model = THREADING_MODEL::THREAD_PER_CONNECTION;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+const char* GetThreadingModelName(THREADING_MODEL threading_model)
+{
+  switch (threading_model) {
+    case THREADING_MODEL::SINGLE_THREAD: return "single_thread";
+    case THREADING_MODEL::THREAD_POOL: return "thread_pool";
+    case THREADING_MODEL::THREAD_PER_CONNECTION: return "thread_per_connection";
+  }
+
+  return "unknown";
+}
+
+cWebServerOptions::cWebServerOptions() :
+  backend(BACKEND::LIBMICROHTTPD),
+  threading_model(THREADING_MODEL::SINGLE_THREAD),
+  thread_pool_size(0),
+  tls_session_tickets(true),
+  tls_session_lifetime_seconds(6 * 60 * 60),
+  connection_timeout_seconds(30),
+  connection_limit(256),
+  per_ip_connection_limit(10),
+  connection_memory_limit_bytes(16 * 1024),
+  listen_backlog(511),
+  shutdown_timeout_seconds(10),
+  worker_threads(2),
+  worker_queue_limit(64),
+  worker_processes(0),
+  reuse_port(false),
+  ip_rate_limit_per_minute(0),
+  ip_rate_limit_burst(10),
+  token_rate_limit_per_minute(0),
+  token_rate_limit_burst(10),
+  event_stream_buffer_bytes(64 * 1024)
+{
+}
+
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include "log.h"
+#include "worker_pool.h"
+
+namespace util {
+
+cWorkerPool::cWorkerPool() :
+  max_queue_depth(0),
+  stopping(false),
+  running(false)
+{
+}
+
+cWorkerPool::~cWorkerPool()
+{
+  Destroy();
+}
+
+bool cWorkerPool::Create(size_t nthreads, size_t _max_queue_depth)
+{
+  Destroy();
+
+  if ((nthreads == 0) || (_max_queue_depth == 0)) {
+    LOG_ERROR<<"cWorkerPool::Create Invalid number of threads "<<nthreads<<" or queue depth "<<_max_queue_depth;
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_queue_depth = _max_queue_depth;
+    stopping = false;
+    counters = cWorkerPoolCounters();
+  }
+
+  for (size_t i = 0; i < nthreads; i++) {
+    threads.push_back(std::thread(&cWorkerPool::Run, this));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = true;
+  }
+
+  return true;
+}
+
+void cWorkerPool::Destroy()
+{
+  if (threads.empty()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    running = false;
+  }
+  cv_job_queued.notify_all();
+
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  threads.clear();
+}
+
+bool cWorkerPool::TrySubmit(std::function<void()>&& job)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping || !running || (queue.size() >= max_queue_depth)) {
+      counters.rejected++;
+      return false;
+    }
+
+    queue.push_back(std::move(job));
+    counters.queue_depth = queue.size();
+    counters.peak_queue_depth = std::max(counters.peak_queue_depth, counters.queue_depth);
+  }
+
+  cv_job_queued.notify_one();
+
+  return true;
+}
+
+cWorkerPoolCounters cWorkerPool::GetCounters() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return counters;
+}
+
+void cWorkerPool::Run()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  while (true) {
+    cv_job_queued.wait(lock, [this]() { return (stopping || !queue.empty()); });
+
+    // NOTE: We keep going until the queue is empty even when stopping, the jobs may be holding on to something that is waiting for them
+    if (queue.empty()) {
+      break;
+    }
+
+    std::function<void()> job = std::move(queue.front());
+    queue.pop_front();
+    counters.queue_depth = queue.size();
+
+    // Run the job without holding the lock so that the other workers and TrySubmit are not blocked
+    lock.unlock();
+    job();
+    lock.lock();
+
+    counters.completed++;
+  }
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A minimal HTTPS client for talking to a task-trackerd running on this machine, this is used by the unit tests and the benchmarks
+// NOTE: Requests are sent to 127.0.0.1, GnuTLSPerformRequest sends one request per connection and cHTTPSConnection keeps the connection open for more requests
+
+class cHTTPHeaders {
+public:
+  cHTTPHeaders() :
+    response_code(0),
+    content_length(0)
+  {
+  }
+
+  void Clear()
+  {
+    response_code = 0;
+    content_type.clear();
+    content_length = 0;
+  }
+
+  uint16_t response_code;
+  std::string content_type;
+  size_t content_length;
+  std::map<std::string, std::string> raw_headers;
+};
+
+class cHTTPResponse {
+public:
+  void Clear()
+  {
+    headers.Clear();
+    content.clear();
+  }
+
+  cHTTPHeaders headers;
+  std::vector<char> content;
+};
+
+// The TLS session from a previous connection, passing it to the next request lets the client resume the session instead of performing a full handshake
+class cTLSSession {
+public:
+  cTLSSession() :
+    resumed(false)
+  {
+  }
+
+  std::vector<char> data; // Empty until a connection has been made
+  bool resumed; // True if the last handshake resumed the previous session
+};
+
+bool ParseHeaders(std::string_view text, cHTTPHeaders& headers);
+
+// Send a raw request and read the response until the server closes the connection
+bool GnuTLSPerformRequest(std::string_view request, uint16_t port, std::string_view user_agent, std::string_view server_certificate_path, cHTTPResponse& out_response);
+
+// Send a raw request, resuming tls_session if it has data, and then store the session so that the next request can resume it
+bool GnuTLSPerformRequest(std::string_view request, uint16_t port, std::string_view user_agent, std::string_view server_certificate_path, cTLSSession& tls_session, cHTTPResponse& out_response);
+
+// Create a HTTP/1.0 GET request for url
+std::string HTTPSCreateRequest(std::string_view url);
+
+class tcp_connection;
+
+namespace gnutlsmm {
+class certificate_credentials;
+class client_session;
+}
+
+// ** cHTTPSConnection
+//
+// A keep-alive connection, each request is sent as HTTP/1.1 and the response is read using its Content-Length so that the next request can reuse the connection
+// If the server certificate path is empty then the connection is plain HTTP instead of HTTPS
+//
+class cHTTPSConnection {
+public:
+  cHTTPSConnection();
+  ~cHTTPSConnection();
+
+  bool Open(uint16_t port, std::string_view server_certificate_path);
+  void Close();
+
+  bool IsOpen() const { return (connection != nullptr); }
+
+  // Send a GET request for url and read one response, returns false and closes the connection if the server closed it or the response timed out
+  bool PerformGetRequest(std::string_view url, cHTTPResponse& out_response);
+
+private:
+  bool ReadResponse(cHTTPResponse& out_response);
+
+  std::unique_ptr<tcp_connection> connection;
+  std::unique_ptr<gnutlsmm::certificate_credentials> credentials;
+  std::unique_ptr<gnutlsmm::client_session> session; // nullptr for plain HTTP
+  std::vector<char> received; // Bytes that have been received but not used by a response yet
+};
+
+bool PerformHTTPSGetRequest(std::span<const char> const url, uint16_t port, std::string_view server_certificate_path, cHTTPResponse& out_response);
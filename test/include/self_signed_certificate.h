@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+// Generates throwaway self signed certificates for "localhost" so that the unit tests and benchmarks can try each type of key
+
+enum class KEY_TYPE {
+  RSA_2048,
+  ECDSA_P256,
+  ED25519,
+};
+
+const char* GetKeyTypeName(KEY_TYPE key_type);
+
+// Write a new PEM private key and a certificate signed with it
+bool GenerateSelfSignedCertificate(KEY_TYPE key_type, const std::string& private_key_path, const std::string& public_cert_path);
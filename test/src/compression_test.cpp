@@ -0,0 +1,75 @@
+#include <zlib.h>
+
+// Application headers
+#include "compression.h"
+
+// gtest headers
+#include <gtest/gtest.h>
+
+namespace {
+
+bool DecompressGzip(const std::string& input, std::string& output)
+{
+  z_stream stream {};
+
+  // NOTE: Adding 16 to the window bits expects a gzip header
+  if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+    return false;
+  }
+
+  output.resize(64 * 1024);
+
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  stream.avail_in = input.length();
+  stream.next_out = reinterpret_cast<Bytef*>(output.data());
+  stream.avail_out = output.length();
+
+  const int result = inflate(&stream, Z_FINISH);
+  output.resize(stream.total_out);
+  inflateEnd(&stream);
+
+  return (result == Z_STREAM_END);
+}
+
+}
+
+TEST(Util, TestCompression)
+{
+  std::string content;
+  for (size_t i = 0; i < 100; i++) {
+    content += "<entry><title>Task is due in 1 week</title></entry>\n";
+  }
+
+  util::cEncodedContent encoded;
+  EXPECT_EQ(util::GetContentEncodingBit(util::CONTENT_ENCODING::IDENTITY), encoded.GetAvailableEncodings());
+
+  EXPECT_TRUE(encoded.Create(content));
+  EXPECT_EQ(util::CONTENT_ENCODINGS_ALL, encoded.GetAvailableEncodings());
+
+  // The identity encoding is the original content
+  EXPECT_EQ(content, encoded.Get(util::CONTENT_ENCODING::IDENTITY));
+
+  // Each compressed variant is much smaller than the original
+  EXPECT_LT(encoded.Get(util::CONTENT_ENCODING::GZIP).length(), content.length() / 10);
+  EXPECT_LT(encoded.Get(util::CONTENT_ENCODING::BROTLI).length(), content.length() / 10);
+  EXPECT_LT(encoded.Get(util::CONTENT_ENCODING::ZSTD).length(), content.length() / 10);
+
+  // The gzip variant decompresses back to the original
+  std::string decompressed;
+  EXPECT_TRUE(DecompressGzip(encoded.Get(util::CONTENT_ENCODING::GZIP), decompressed));
+  EXPECT_EQ(content, decompressed);
+
+  // Moving the content in gives the same variants
+  std::string moved_content = content;
+  util::cEncodedContent moved_encoded;
+  EXPECT_TRUE(moved_encoded.Create(std::move(moved_content)));
+  EXPECT_EQ(util::CONTENT_ENCODINGS_ALL, moved_encoded.GetAvailableEncodings());
+  EXPECT_EQ(content, moved_encoded.Get(util::CONTENT_ENCODING::IDENTITY));
+  EXPECT_EQ(encoded.Get(util::CONTENT_ENCODING::GZIP), moved_encoded.Get(util::CONTENT_ENCODING::GZIP));
+
+  // Names used in the headers
+  EXPECT_STREQ("br", util::GetContentEncodingName(util::CONTENT_ENCODING::BROTLI));
+  EXPECT_STREQ("zstd", util::GetContentEncodingName(util::CONTENT_ENCODING::ZSTD));
+  EXPECT_STREQ("gzip", util::GetContentEncodingName(util::CONTENT_ENCODING::GZIP));
+  EXPECT_STREQ("identity", util::GetContentEncodingName(util::CONTENT_ENCODING::IDENTITY));
+}
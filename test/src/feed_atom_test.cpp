@@ -51,3 +51,35 @@ TEST(TaskTracker, TestAtomFeed)
 
   EXPECT_STREQ(expected_output.c_str(), output.str().c_str());
 }
+
+TEST(TaskTracker, TestAtomFeedUpdatePeriod)
+{
+  tasktracker::cFeedData feed_data;
+
+  util::cPseudoRandomNumberGenerator rng(12345);
+
+  feed_data.properties.title = "Example Feed";
+  feed_data.properties.link = "http://example.org/";
+  feed_data.properties.author_name = "John Doe";
+  feed_data.properties.id = feed::GenerateFeedID(rng);
+
+  // No hint by default
+  std::ostringstream output;
+  feed::WriteFeedXML(feed_data, output);
+  EXPECT_EQ(std::string::npos, output.str().find("sy:"));
+
+  // Polled every half an hour
+  feed_data.properties.update_period_minutes = 30;
+  output.str("");
+  feed::WriteFeedXML(feed_data, output);
+  EXPECT_NE(std::string::npos, output.str().find("xmlns:sy=\"http://purl.org/rss/1.0/modules/syndication/\""));
+  EXPECT_NE(std::string::npos, output.str().find("<sy:updatePeriod>hourly</sy:updatePeriod>"));
+  EXPECT_NE(std::string::npos, output.str().find("<sy:updateFrequency>2</sy:updateFrequency>"));
+
+  // Polled every 4 hours
+  feed_data.properties.update_period_minutes = 4 * 60;
+  output.str("");
+  feed::WriteFeedXML(feed_data, output);
+  EXPECT_NE(std::string::npos, output.str().find("<sy:updatePeriod>daily</sy:updatePeriod>"));
+  EXPECT_NE(std::string::npos, output.str().find("<sy:updateFrequency>6</sy:updateFrequency>"));
+}
@@ -0,0 +1,180 @@
+#include <thread>
+#include <vector>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "feed_cache.h"
+#include "feed_data.h"
+#include "feed_view.h"
+#include "util.h"
+
+namespace {
+
+void AddFeedEntry(const std::string& title, bool high_priority = false, const std::string& project = "", const std::vector<std::string>& labels = {})
+{
+  tasktracker::cFeedEntry entry;
+  entry.title = title;
+  entry.high_priority = high_priority;
+  entry.project = project;
+  entry.labels = labels;
+  entry.link = "http://example.org/";
+  entry.summary = "Summary";
+  entry.date_updated = util::GetTime();
+  entry.id = "urn:uuid:1225c695-cfb8-4ebb-aaaa-80da344efa6a";
+
+  std::lock_guard<std::mutex> lock(tasktracker::mutex_feed_data);
+  tasktracker::feed_data.entries.push_back(entry);
+  tasktracker::feed_data_generation++;
+}
+
+}
+
+TEST(TaskTracker, TestFeedRenderCache)
+{
+  tasktracker::cFeedRenderCache cache;
+
+  // Nothing has been rendered yet, and checking doesn't render anything
+  EXPECT_TRUE(cache.GetIfCurrent() == nullptr);
+  EXPECT_EQ(0, cache.GetRenderCount());
+
+  // The first request renders the feed
+  const std::shared_ptr<const tasktracker::cRenderedFeed> first = cache.Get();
+  ASSERT_TRUE(first != nullptr);
+  EXPECT_EQ(first, cache.GetIfCurrent());
+  EXPECT_FALSE(first->content.Get(util::CONTENT_ENCODING::IDENTITY).empty());
+  EXPECT_EQ(util::CONTENT_ENCODINGS_ALL, first->content.GetAvailableEncodings());
+  EXPECT_FALSE(first->content.Get(util::CONTENT_ENCODING::GZIP).empty());
+  EXPECT_EQ(1, cache.GetRenderCount());
+
+  // Further requests get the same rendered feed without rendering again
+  EXPECT_EQ(first, cache.Get());
+  EXPECT_EQ(first, cache.Get());
+  EXPECT_EQ(1, cache.GetRenderCount());
+
+  // Modifying the feed data invalidates the rendered feed
+  AddFeedEntry("Render cache entry");
+  EXPECT_TRUE(cache.GetIfCurrent() == nullptr);
+
+  const std::shared_ptr<const tasktracker::cRenderedFeed> second = cache.Get();
+  ASSERT_TRUE(second != nullptr);
+  EXPECT_NE(first, second);
+  EXPECT_GT(second->validators.generation, first->validators.generation);
+  EXPECT_NE(first->validators.etag, second->validators.etag);
+  EXPECT_NE(std::string::npos, second->content.Get(util::CONTENT_ENCODING::IDENTITY).find("Render cache entry"));
+  EXPECT_EQ(2, cache.GetRenderCount());
+
+  // Concurrent requests after an update only render the feed once
+  AddFeedEntry("Concurrent entry");
+
+  std::vector<std::shared_ptr<const tasktracker::cRenderedFeed>> results(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); i++) {
+    threads.push_back(std::thread([&cache, &results, i]() { results[i] = cache.Get(); }));
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  for (auto&& result : results) {
+    EXPECT_EQ(results[0], result);
+  }
+  EXPECT_EQ(3, cache.GetRenderCount());
+}
+
+TEST(TaskTracker, TestFeedViewFilter)
+{
+  tasktracker::cFeedEntry entry;
+  entry.high_priority = false;
+  entry.project = "home/garden";
+  entry.labels = { "outside", "weekly" };
+
+  // An empty filter matches everything
+  tasktracker::cFeedViewFilter filter;
+  EXPECT_TRUE(filter.IsEmpty());
+  EXPECT_TRUE(filter.IsMatch(entry));
+
+  filter.high_priority_only = true;
+  EXPECT_FALSE(filter.IsEmpty());
+  EXPECT_FALSE(filter.IsMatch(entry));
+  entry.high_priority = true;
+  EXPECT_TRUE(filter.IsMatch(entry));
+
+  filter.project = "home/kitchen";
+  EXPECT_FALSE(filter.IsMatch(entry));
+  filter.project = "home/garden";
+  EXPECT_TRUE(filter.IsMatch(entry));
+
+  // Any one of the labels is enough
+  filter.labels = { "inside", "urgent" };
+  EXPECT_FALSE(filter.IsMatch(entry));
+  filter.labels = { "inside", "weekly" };
+  EXPECT_TRUE(filter.IsMatch(entry));
+
+  // The key doesn't depend on the order of the labels
+  tasktracker::cFeedViewFilter other(filter);
+  other.labels = { "weekly", "inside" };
+  EXPECT_EQ(filter.GetKey(), other.GetKey());
+  other.high_priority_only = false;
+  EXPECT_NE(filter.GetKey(), other.GetKey());
+
+  // The fields can't run into each other
+  tasktracker::cFeedViewFilter project_with_colon;
+  project_with_colon.project = "a:b";
+  tasktracker::cFeedViewFilter project_and_label;
+  project_and_label.project = "a";
+  project_and_label.labels = { "b" };
+  EXPECT_NE(project_with_colon.GetKey(), project_and_label.GetKey());
+
+  tasktracker::cFeedViewFilter one_label;
+  one_label.labels = { "a:b" };
+  tasktracker::cFeedViewFilter two_labels;
+  two_labels.labels = { "a", "b" };
+  EXPECT_NE(one_label.GetKey(), two_labels.GetKey());
+}
+
+TEST(TaskTracker, TestFeedRenderCacheViews)
+{
+  tasktracker::cFeedViewFilter urgent_filter;
+  urgent_filter.high_priority_only = true;
+
+  tasktracker::cFeedViewFilter garden_filter;
+  garden_filter.project = "home/garden";
+
+  tasktracker::cFeedRenderCache all_cache;
+  tasktracker::cFeedRenderCache urgent_cache(urgent_filter);
+  tasktracker::cFeedRenderCache garden_cache(garden_filter);
+
+  AddFeedEntry("View urgent kitchen entry", true, "home/kitchen");
+  AddFeedEntry("View normal garden entry", false, "home/garden");
+
+  const std::shared_ptr<const tasktracker::cRenderedFeed> all = all_cache.Get();
+  const std::shared_ptr<const tasktracker::cRenderedFeed> urgent = urgent_cache.Get();
+  const std::shared_ptr<const tasktracker::cRenderedFeed> garden = garden_cache.Get();
+  ASSERT_TRUE((all != nullptr) && (urgent != nullptr) && (garden != nullptr));
+
+  // Each view only contains the entries that match its filter
+  const std::string_view all_content = all->content.Get(util::CONTENT_ENCODING::IDENTITY);
+  EXPECT_NE(std::string::npos, all_content.find("View urgent kitchen entry"));
+  EXPECT_NE(std::string::npos, all_content.find("View normal garden entry"));
+
+  const std::string_view urgent_content = urgent->content.Get(util::CONTENT_ENCODING::IDENTITY);
+  EXPECT_NE(std::string::npos, urgent_content.find("View urgent kitchen entry"));
+  EXPECT_EQ(std::string::npos, urgent_content.find("View normal garden entry"));
+
+  const std::string_view garden_content = garden->content.Get(util::CONTENT_ENCODING::IDENTITY);
+  EXPECT_EQ(std::string::npos, garden_content.find("View urgent kitchen entry"));
+  EXPECT_NE(std::string::npos, garden_content.find("View normal garden entry"));
+
+  // The views have different ETags for the same generation
+  EXPECT_EQ(all->validators.generation, urgent->validators.generation);
+  EXPECT_NE(all->validators.etag, urgent->validators.etag);
+  EXPECT_NE(urgent->validators.etag, garden->validators.etag);
+
+  // Each view is cached separately
+  EXPECT_EQ(urgent, urgent_cache.Get());
+  EXPECT_EQ(1, all_cache.GetRenderCount());
+  EXPECT_EQ(1, urgent_cache.GetRenderCount());
+  EXPECT_EQ(1, garden_cache.GetRenderCount());
+}
@@ -0,0 +1,160 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "feed_data.h"
+#include "feed_events.h"
+#include "feed_view.h"
+
+namespace {
+
+tasktracker::cFeedEntry CreateFeedEntry(const std::string& title, uint64_t date_updated_ms, const std::string& project = "home/garden")
+{
+  tasktracker::cFeedEntry entry;
+  entry.title = title;
+  entry.link = "https://gitlab.example.com/" + project + "/-/issues/1";
+  entry.summary = "Due soon";
+  entry.date_updated = std::chrono::system_clock::time_point(std::chrono::milliseconds(date_updated_ms));
+  entry.id = title;
+  entry.project = project;
+  return entry;
+}
+
+}
+
+TEST(TaskTracker, TestFeedEventQueue)
+{
+  tasktracker::cFeedEventQueue queue;
+
+  // Nothing has been published yet
+  EXPECT_EQ(0, queue.GetLastEventID());
+  EXPECT_TRUE(queue.GetEventsAfter(0).empty());
+
+  // The event IDs are the publish times, entries published in the same millisecond still get increasing IDs
+  queue.Publish({ CreateFeedEntry("First", 1700000000000), CreateFeedEntry("Second", 1700000000000) });
+  EXPECT_EQ(1700000000001, queue.GetLastEventID());
+
+  std::vector<std::shared_ptr<const tasktracker::cFeedEvent>> events = queue.GetEventsAfter(0);
+  ASSERT_EQ(2, events.size());
+  EXPECT_EQ(1700000000000, events[0]->id);
+  EXPECT_EQ("First", events[0]->entry.title);
+  EXPECT_EQ(1700000000001, events[1]->id);
+  EXPECT_EQ("Second", events[1]->entry.title);
+
+  events = queue.GetEventsAfter(1700000000000);
+  ASSERT_EQ(1, events.size());
+  EXPECT_EQ("Second", events[0]->entry.title);
+
+  EXPECT_TRUE(queue.GetEventsAfter(1700000000001).empty());
+
+  // A clock that went backwards doesn't make the IDs go backwards
+  queue.Publish({ CreateFeedEntry("Third", 1600000000000) });
+  EXPECT_EQ(1700000000002, queue.GetLastEventID());
+
+  // Only the latest events are kept
+  for (size_t i = 0; i < tasktracker::MAX_FEED_EVENTS; i++) {
+    queue.Publish({ CreateFeedEntry("Later", 1800000000000 + i) });
+  }
+  events = queue.GetEventsAfter(0);
+  ASSERT_EQ(tasktracker::MAX_FEED_EVENTS, events.size());
+  EXPECT_EQ(1800000000000, events.front()->id);
+  EXPECT_EQ(queue.GetLastEventID(), events.back()->id);
+
+  queue.Clear();
+  EXPECT_EQ(0, queue.GetLastEventID());
+  EXPECT_TRUE(queue.GetEventsAfter(0).empty());
+}
+
+TEST(TaskTracker, TestFeedEventQueueListeners)
+{
+  tasktracker::cFeedEventQueue queue;
+
+  size_t calls = 0;
+  const size_t listener = queue.AddListener([&calls]() { calls++; });
+
+  queue.Publish({ CreateFeedEntry("First", 1700000000000) });
+  EXPECT_EQ(1, calls);
+
+  // Nothing to publish
+  queue.Publish({});
+  EXPECT_EQ(1, calls);
+
+  queue.RemoveListener(listener);
+  queue.Publish({ CreateFeedEntry("Second", 1700000001000) });
+  EXPECT_EQ(1, calls);
+}
+
+TEST(TaskTracker, TestFeedEventStream)
+{
+  tasktracker::cFeedEventQueue queue;
+
+  tasktracker::cFeedViewFilter filter;
+  filter.project = "home/garden";
+
+  tasktracker::cFeedEventStream stream(filter, 0, 64 * 1024);
+  ASSERT_TRUE(stream.Update(queue));
+  EXPECT_TRUE(stream.IsEmpty());
+
+  // Only the entries in the view are sent, and the data is on one line even if the entry has new lines in it
+  queue.Publish({ CreateFeedEntry("Water the\nplants", 1700000000000), CreateFeedEntry("Fix the car", 1700000001000, "home/car") });
+  ASSERT_TRUE(stream.Update(queue));
+  const std::string text = stream.Take();
+  EXPECT_TRUE(stream.IsEmpty());
+
+  EXPECT_EQ(0, text.find("id: 1700000000000\nevent: entry\ndata: {"));
+  EXPECT_NE(std::string::npos, text.find("\"title\":\"Water the\\nplants\""));
+  EXPECT_NE(std::string::npos, text.find("\"project\":\"home/garden\""));
+  EXPECT_EQ(std::string::npos, text.find("Fix the car"));
+  EXPECT_EQ(text.length() - 2, text.find("\n\n"));
+
+  // The events are only sent once
+  ASSERT_TRUE(stream.Update(queue));
+  EXPECT_TRUE(stream.IsEmpty());
+
+  // A heartbeat is a comment
+  ASSERT_TRUE(stream.AddHeartbeat());
+  char buffer[2];
+  EXPECT_EQ(2, stream.Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(":\n", std::string(buffer, 2));
+  EXPECT_EQ(1, stream.Read(buffer, sizeof(buffer)));
+  EXPECT_TRUE(stream.IsEmpty());
+}
+
+TEST(TaskTracker, TestFeedEventStreamResume)
+{
+  tasktracker::cFeedEventQueue queue;
+  queue.Publish({ CreateFeedEntry("First", 1700000000000), CreateFeedEntry("Second", 1700000001000), CreateFeedEntry("Third", 1700000002000) });
+
+  // A client that reconnects gets the events after the last one it received
+  tasktracker::cFeedEventStream stream(tasktracker::cFeedViewFilter(), 1700000000000, 64 * 1024);
+  ASSERT_TRUE(stream.Update(queue));
+  const std::string text = stream.Take();
+  EXPECT_EQ(std::string::npos, text.find("\"First\""));
+  EXPECT_NE(std::string::npos, text.find("id: 1700000001000\n"));
+  EXPECT_NE(std::string::npos, text.find("id: 1700000002000\n"));
+
+  // A client that falls too far behind overflows its buffer
+  tasktracker::cFeedEventStream small_stream(tasktracker::cFeedViewFilter(), 0, 1024);
+  queue.Publish({ CreateFeedEntry(std::string(2000, 'a'), 1700000003000) });
+  EXPECT_FALSE(small_stream.Update(queue));
+}
+
+TEST(TaskTracker, TestParseLastEventID)
+{
+  tasktracker::cFeedEventQueue queue;
+  queue.Publish({ CreateFeedEntry("First", 1700000000000) });
+
+  EXPECT_EQ(1234, tasktracker::ParseLastEventID("1234", queue));
+  EXPECT_EQ(0, tasktracker::ParseLastEventID("0", queue));
+
+  // A new client, or one that sent something we don't understand, starts from the latest event
+  EXPECT_EQ(1700000000000, tasktracker::ParseLastEventID(nullptr, queue));
+  EXPECT_EQ(1700000000000, tasktracker::ParseLastEventID("", queue));
+  EXPECT_EQ(1700000000000, tasktracker::ParseLastEventID("abc", queue));
+  EXPECT_EQ(1700000000000, tasktracker::ParseLastEventID("12x", queue));
+  EXPECT_EQ(1700000000000, tasktracker::ParseLastEventID("-1", queue));
+}
@@ -0,0 +1,204 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "feed_cache.h"
+#include "feed_snapshot.h"
+#include "feed_view.h"
+#include "tls_session_resumption.h"
+#include "util.h"
+
+namespace {
+
+std::shared_ptr<const tasktracker::cRenderedFeed> CreateRenderedFeed(const std::string& etag, const std::string& content)
+{
+  std::shared_ptr<tasktracker::cRenderedFeed> rendered = std::make_shared<tasktracker::cRenderedFeed>();
+  rendered->validators.etag = etag;
+  rendered->validators.last_modified = std::chrono::system_clock::time_point(std::chrono::milliseconds(1700000000123));
+  rendered->validators.last_modified_text = util::GetDateTimeHTTP(rendered->validators.last_modified);
+  rendered->content.Create(content);
+  return rendered;
+}
+
+}
+
+TEST(TaskTracker, TestFeedSnapshot)
+{
+  tasktracker::cFeedSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Create(2, 64 * 1024));
+  EXPECT_EQ(2, snapshot.GetViewCount());
+
+  // Nothing has been published yet
+  EXPECT_EQ(0, snapshot.GetGeneration());
+  EXPECT_TRUE(snapshot.Read(0) == nullptr);
+
+  const std::shared_ptr<const tasktracker::cRenderedFeed> first = CreateRenderedFeed("\"first\"", std::string(1000, 'a'));
+  const std::shared_ptr<const tasktracker::cRenderedFeed> second = CreateRenderedFeed("\"second\"", std::string(2000, 'b'));
+
+  // There has to be one rendered feed for each view
+  EXPECT_FALSE(snapshot.Publish({ first }));
+  ASSERT_TRUE(snapshot.Publish({ first, second }));
+  EXPECT_EQ(1, snapshot.GetGeneration());
+
+  // A worker process maps the same memfd read only
+  tasktracker::cFeedSnapshot worker_snapshot;
+  ASSERT_TRUE(worker_snapshot.Open(dup(snapshot.GetFD())));
+  EXPECT_EQ(2, worker_snapshot.GetViewCount());
+  EXPECT_EQ(1, worker_snapshot.GetGeneration());
+  EXPECT_FALSE(worker_snapshot.Publish({ first, second }));
+
+  const std::shared_ptr<const tasktracker::cRenderedFeed> copied = worker_snapshot.Read(1);
+  ASSERT_TRUE(copied != nullptr);
+  EXPECT_EQ(1, copied->validators.generation);
+  EXPECT_STREQ("\"second\"", copied->validators.etag.c_str());
+  EXPECT_TRUE(second->validators.last_modified == copied->validators.last_modified);
+  EXPECT_STREQ(second->validators.last_modified_text.c_str(), copied->validators.last_modified_text.c_str());
+
+  // Every compressed variant is copied as it is
+  EXPECT_EQ(second->content.GetAvailableEncodings(), copied->content.GetAvailableEncodings());
+  for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+    const util::CONTENT_ENCODING encoding = static_cast<util::CONTENT_ENCODING>(i);
+    EXPECT_TRUE(second->content.Get(encoding) == copied->content.Get(encoding));
+  }
+
+  tasktracker::cFeedValidators validators;
+  ASSERT_TRUE(worker_snapshot.ReadValidators(0, validators));
+  EXPECT_STREQ("\"first\"", validators.etag.c_str());
+  EXPECT_FALSE(worker_snapshot.ReadValidators(2, validators));
+  EXPECT_TRUE(worker_snapshot.Read(2) == nullptr);
+
+  // A feed that doesn't fit is rejected and the previous generation is left in place
+  const std::shared_ptr<const tasktracker::cRenderedFeed> too_big = CreateRenderedFeed("\"too big\"", std::string(128 * 1024, 'c'));
+  EXPECT_FALSE(snapshot.Publish({ first, too_big }));
+  EXPECT_EQ(1, worker_snapshot.GetGeneration());
+  EXPECT_STREQ("\"second\"", worker_snapshot.Read(1)->validators.etag.c_str());
+
+  // The next generation replaces it
+  ASSERT_TRUE(snapshot.Publish({ second, first }));
+  EXPECT_EQ(2, worker_snapshot.GetGeneration());
+  EXPECT_STREQ("\"first\"", worker_snapshot.Read(1)->validators.etag.c_str());
+}
+
+TEST(TaskTracker, TestFeedSnapshotRenderCache)
+{
+  tasktracker::cFeedSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Create(1, 64 * 1024));
+  ASSERT_TRUE(snapshot.Publish({ CreateRenderedFeed("\"first\"", "first feed") }));
+
+  // In a worker process the render cache copies the feed out of the snapshot instead of rendering it
+  tasktracker::cFeedRenderCache cache(tasktracker::cFeedViewFilter(), snapshot, 0);
+  EXPECT_TRUE(cache.GetIfCurrent() == nullptr);
+  EXPECT_STREQ("\"first\"", cache.GetValidators().etag.c_str());
+
+  std::shared_ptr<const tasktracker::cRenderedFeed> rendered = cache.Get();
+  EXPECT_STREQ("first feed", rendered->content.Get(util::CONTENT_ENCODING::IDENTITY).c_str());
+  EXPECT_TRUE(cache.GetIfCurrent() == rendered);
+  EXPECT_EQ(1, cache.GetRenderCount());
+
+  // Publishing a new generation makes the cached copy stale
+  ASSERT_TRUE(snapshot.Publish({ CreateRenderedFeed("\"second\"", "second feed") }));
+  EXPECT_TRUE(cache.GetIfCurrent() == nullptr);
+  EXPECT_STREQ("\"second\"", cache.GetValidators().etag.c_str());
+  EXPECT_STREQ("second feed", cache.Get()->content.Get(util::CONTENT_ENCODING::IDENTITY).c_str());
+  EXPECT_EQ(2, cache.GetRenderCount());
+}
+
+TEST(TaskTracker, TestFeedSnapshotNextUpdate)
+{
+  tasktracker::cFeedSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Create(1, 64 * 1024));
+
+  tasktracker::cFeedSnapshot worker_snapshot;
+  ASSERT_TRUE(worker_snapshot.Open(dup(snapshot.GetFD())));
+
+  // Unknown until the tracker process sets it
+  EXPECT_FALSE(worker_snapshot.GetNextUpdate());
+
+  // It doesn't wait for the feed to be published
+  const std::chrono::system_clock::time_point next_update(std::chrono::milliseconds(1700000600123));
+  snapshot.SetNextUpdate(next_update);
+  ASSERT_TRUE(worker_snapshot.GetNextUpdate());
+  EXPECT_TRUE(*worker_snapshot.GetNextUpdate() == next_update);
+  EXPECT_EQ(0, worker_snapshot.GetGeneration());
+}
+
+TEST(TaskTracker, TestFeedSnapshotTLSSessionTicketKey)
+{
+  tasktracker::cFeedSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Create(1, 64 * 1024));
+
+  tasktracker::cFeedSnapshot worker_snapshot;
+  ASSERT_TRUE(worker_snapshot.Open(dup(snapshot.GetFD())));
+
+  // Nothing until the tracker process sets it
+  tasktracker::cTLSSessionTicketKey worker_key;
+  EXPECT_FALSE(worker_snapshot.GetTLSSessionTicketKey(worker_key));
+  EXPECT_FALSE(worker_key.IsValid());
+
+  tasktracker::cTLSSessionTicketKey key;
+  ASSERT_TRUE(key.Generate());
+  ASSERT_TRUE(snapshot.SetTLSSessionTicketKey(key));
+
+  // Every worker gets the same key
+  ASSERT_TRUE(worker_snapshot.GetTLSSessionTicketKey(worker_key));
+  ASSERT_EQ(key.Get().size, worker_key.Get().size);
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(key.Get().data), key.Get().size), std::string(reinterpret_cast<const char*>(worker_key.Get().data), worker_key.Get().size));
+
+  // The workers can't change it
+  EXPECT_FALSE(worker_snapshot.SetTLSSessionTicketKey(key));
+}
+
+TEST(TaskTracker, TestFeedSnapshotConcurrentReaders)
+{
+  tasktracker::cFeedSnapshot snapshot;
+  ASSERT_TRUE(snapshot.Create(1, 1024 * 1024));
+
+  // Each feed is a different length and made of a single character, so a torn copy would be easy to spot
+  std::vector<std::shared_ptr<const tasktracker::cRenderedFeed>> feeds;
+  for (char c = 'a'; c <= 'h'; c++) {
+    feeds.push_back(CreateRenderedFeed(std::string("\"") + c + "\"", std::string(1000 * size_t(c - 'a' + 1), c)));
+  }
+
+  ASSERT_TRUE(snapshot.Publish({ feeds[0] }));
+
+  std::atomic<bool> stop(false);
+  std::atomic<size_t> inconsistent(0);
+  std::atomic<size_t> reads(0);
+
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < 4; i++) {
+    readers.emplace_back([&]() {
+      while (!stop.load()) {
+        const std::shared_ptr<const tasktracker::cRenderedFeed> copied = snapshot.Read(0);
+        const std::string& content = copied->content.Get(util::CONTENT_ENCODING::IDENTITY);
+        const char c = copied->validators.etag[1];
+        if ((content.length() != (1000 * size_t(c - 'a' + 1))) || (content.find_first_not_of(c) != std::string::npos)) {
+          inconsistent++;
+        }
+        reads++;
+      }
+    });
+  }
+
+  for (size_t i = 0; i < 2000; i++) {
+    ASSERT_TRUE(snapshot.Publish({ feeds[i % feeds.size()] }));
+  }
+
+  stop.store(true);
+  for (auto&& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(2001, snapshot.GetGeneration());
+  EXPECT_EQ(0, inconsistent.load());
+  EXPECT_LT(0, reads.load());
+}
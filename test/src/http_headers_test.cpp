@@ -0,0 +1,120 @@
+// Application headers
+#include "http_headers.h"
+#include "util.h"
+
+// gtest headers
+#include <gtest/gtest.h>
+
+TEST(HTTP, TestMethods)
+{
+  EXPECT_EQ(http::METHOD::GET, http::ParseMethod("GET"));
+  EXPECT_EQ(http::METHOD::HEAD, http::ParseMethod("HEAD"));
+  EXPECT_EQ(http::METHOD::POST, http::ParseMethod("POST"));
+  EXPECT_EQ(http::METHOD::DELETE, http::ParseMethod("DELETE"));
+  EXPECT_EQ(http::METHOD::OPTIONS, http::ParseMethod("OPTIONS"));
+  EXPECT_EQ(http::METHOD::UNKNOWN, http::ParseMethod("get"));
+  EXPECT_EQ(http::METHOD::UNKNOWN, http::ParseMethod("BREW"));
+  EXPECT_EQ(http::METHOD::UNKNOWN, http::ParseMethod(""));
+
+  EXPECT_STREQ("HEAD", http::GetMethodName(http::METHOD::HEAD));
+
+  EXPECT_EQ("", http::CreateAllowHeader(0));
+  EXPECT_EQ("GET", http::CreateAllowHeader(http::GetMethodBit(http::METHOD::GET)));
+  EXPECT_EQ("GET, HEAD", http::CreateAllowHeader(http::GetMethodBit(http::METHOD::HEAD) | http::GetMethodBit(http::METHOD::GET)));
+  EXPECT_EQ("GET, POST, OPTIONS", http::CreateAllowHeader(http::GetMethodBit(http::METHOD::GET) | http::GetMethodBit(http::METHOD::POST) | http::GetMethodBit(http::METHOD::OPTIONS)));
+}
+
+TEST(HTTP, TestETags)
+{
+  EXPECT_STREQ("\"0000000000000000\"", http::CreateETag(0).c_str());
+  EXPECT_STREQ("\"0123456789abcdef\"", http::CreateETag(0x0123456789abcdef).c_str());
+
+  const std::string etag = http::CreateETag(0x0123456789abcdef);
+
+  // Single etags
+  EXPECT_TRUE(http::IsETagInList("\"0123456789abcdef\"", etag));
+  EXPECT_TRUE(http::IsETagInList("W/\"0123456789abcdef\"", etag));
+  EXPECT_TRUE(http::IsETagInList("*", etag));
+  EXPECT_FALSE(http::IsETagInList("\"0123456789abcdee\"", etag));
+  EXPECT_FALSE(http::IsETagInList("0123456789abcdef", etag));
+  EXPECT_FALSE(http::IsETagInList("", etag));
+
+  // Lists of etags
+  EXPECT_TRUE(http::IsETagInList("\"aaa\", \"0123456789abcdef\"", etag));
+  EXPECT_TRUE(http::IsETagInList("\"aaa\",W/\"0123456789abcdef\" , \"bbb\"", etag));
+  EXPECT_FALSE(http::IsETagInList("\"aaa\", \"bbb\"", etag));
+  EXPECT_FALSE(http::IsETagInList(",,", etag));
+}
+
+TEST(HTTP, TestETagsForEncodings)
+{
+  const std::string etag = http::CreateETag(0x0123456789abcdef);
+  EXPECT_STREQ("\"0123456789abcdef\"", http::CreateETagForEncoding(etag, util::CONTENT_ENCODING::IDENTITY).c_str());
+  EXPECT_STREQ("\"0123456789abcdef-gzip\"", http::CreateETagForEncoding(etag, util::CONTENT_ENCODING::GZIP).c_str());
+  EXPECT_STREQ("\"0123456789abcdef-br\"", http::CreateETagForEncoding(etag, util::CONTENT_ENCODING::BROTLI).c_str());
+  EXPECT_STREQ("\"0123456789abcdef-zstd\"", http::CreateETagForEncoding(etag, util::CONTENT_ENCODING::ZSTD).c_str());
+
+  // Each variant only matches its own etag
+  EXPECT_FALSE(http::IsETagInList(etag, http::CreateETagForEncoding(etag, util::CONTENT_ENCODING::GZIP)));
+  EXPECT_TRUE(http::IsETagInList(http::CreateETagForEncoding(etag, util::CONTENT_ENCODING::GZIP), http::CreateETagForEncoding(etag, util::CONTENT_ENCODING::GZIP)));
+}
+
+TEST(HTTP, TestConditionalRequests)
+{
+  const std::string etag = http::CreateETag(1234);
+  const std::chrono::system_clock::time_point last_modified = std::chrono::system_clock::time_point(std::chrono::milliseconds(1738497894544));
+  const std::string last_modified_text = util::GetDateTimeHTTP(last_modified);
+
+  // No conditional headers
+  EXPECT_FALSE(http::IsNotModified(nullptr, nullptr, etag, last_modified));
+
+  // If-None-Match
+  EXPECT_TRUE(http::IsNotModified(etag.c_str(), nullptr, etag, last_modified));
+  EXPECT_FALSE(http::IsNotModified("\"stale\"", nullptr, etag, last_modified));
+
+  // If-Modified-Since
+  EXPECT_TRUE(http::IsNotModified(nullptr, last_modified_text.c_str(), etag, last_modified));
+  EXPECT_TRUE(http::IsNotModified(nullptr, "Sat, 01 Jan 2050 00:00:00 GMT", etag, last_modified));
+  EXPECT_FALSE(http::IsNotModified(nullptr, "Sat, 01 Jan 2000 00:00:00 GMT", etag, last_modified));
+  EXPECT_FALSE(http::IsNotModified(nullptr, "garbage", etag, last_modified));
+  EXPECT_FALSE(http::IsNotModified(nullptr, last_modified_text.c_str(), etag, std::nullopt));
+
+  // If-None-Match takes precedence over If-Modified-Since
+  EXPECT_FALSE(http::IsNotModified("\"stale\"", last_modified_text.c_str(), etag, last_modified));
+}
+
+TEST(HTTP, TestChooseContentEncoding)
+{
+  const uint32_t all = util::CONTENT_ENCODINGS_ALL;
+  const uint32_t gzip_only = util::GetContentEncodingBit(util::CONTENT_ENCODING::GZIP) | util::GetContentEncodingBit(util::CONTENT_ENCODING::IDENTITY);
+
+  // No header or an empty header means no compression
+  EXPECT_EQ(util::CONTENT_ENCODING::IDENTITY, http::ChooseContentEncoding(nullptr, all));
+  EXPECT_EQ(util::CONTENT_ENCODING::IDENTITY, http::ChooseContentEncoding("", all));
+
+  // Single encodings
+  EXPECT_EQ(util::CONTENT_ENCODING::GZIP, http::ChooseContentEncoding("gzip", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::GZIP, http::ChooseContentEncoding("x-gzip", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::BROTLI, http::ChooseContentEncoding("br", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::ZSTD, http::ChooseContentEncoding("zstd", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::IDENTITY, http::ChooseContentEncoding("deflate", all));
+
+  // Typical browser headers, we prefer brotli when everything is equal
+  EXPECT_EQ(util::CONTENT_ENCODING::BROTLI, http::ChooseContentEncoding("gzip, deflate, br, zstd", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::ZSTD, http::ChooseContentEncoding("gzip, deflate, zstd", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::GZIP, http::ChooseContentEncoding("gzip, deflate, br, zstd", gzip_only));
+  EXPECT_EQ(util::CONTENT_ENCODING::GZIP, http::ChooseContentEncoding("GZIP , Deflate", all));
+
+  // Quality values
+  EXPECT_EQ(util::CONTENT_ENCODING::GZIP, http::ChooseContentEncoding("br;q=0.5, gzip;q=0.8", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::GZIP, http::ChooseContentEncoding("br;q=0, gzip", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::BROTLI, http::ChooseContentEncoding("br;q=1.0, gzip;q=0.999", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::IDENTITY, http::ChooseContentEncoding("gzip;q=0", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::IDENTITY, http::ChooseContentEncoding("gzip;q=invalid", all));
+
+  // Wildcards
+  EXPECT_EQ(util::CONTENT_ENCODING::BROTLI, http::ChooseContentEncoding("*", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::GZIP, http::ChooseContentEncoding("*", gzip_only));
+  EXPECT_EQ(util::CONTENT_ENCODING::GZIP, http::ChooseContentEncoding("gzip, *;q=0", all));
+  EXPECT_EQ(util::CONTENT_ENCODING::IDENTITY, http::ChooseContentEncoding("identity, *;q=0", all));
+}
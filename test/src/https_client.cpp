@@ -0,0 +1,491 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+
+#include <sys/socket.h>
+
+#include "gnutlsmm.h"
+#include "https_client.h"
+#include "poll_helper.h"
+#include "tcp_connection.h"
+#include "util.h"
+
+namespace {
+
+const util::cIPAddress host(127, 0, 0, 1);
+
+const size_t BUFFER_LENGTH = 4 * 1024; // 4k read buffer
+
+bool string_to_int(const std::string& s, unsigned long int& out_value, int base = 0)
+{
+  if (s.empty()) {
+    return false;
+  }
+
+  char* end = nullptr;
+  out_value = std::strtoul(s.c_str(), &end, base);
+
+  if (errno == ERANGE) {
+    // Invalid number
+    return false;
+  }
+
+  if (*end != '\0') {
+    // Invalid string
+    return false;
+  }
+
+  return true;
+}
+
+int GnuTLSPullTimeOutCallback(gnutls_transport_ptr_t, unsigned int ms)
+{
+  (void)ms;
+  return 0;
+}
+
+
+bool GnuTLSConnect(uint16_t port, std::string_view server_certificate_path, cTLSSession& tls_session, tcp_connection& connection, gnutlsmm::certificate_credentials& credentials, gnutlsmm::client_session& session)
+{
+  session.init(GNUTLS_NONBLOCK);
+
+  // X509 stuff
+  credentials.init();
+
+  // Set the trusted ca file
+  credentials.set_x509_trust_file(server_certificate_path.data(), GNUTLS_X509_FMT_PEM);
+
+  // Put the x509 credentials to the current session
+  session.set_credentials(credentials);
+
+  // Set TLS version and cypher priorities
+  // https://gnutls.org/manual/html_node/Priority-Strings.html
+  // NOTE: No SSL, only TLS1.2
+  // TODO: TLS1.3 didn't seem to work, server dependent?
+  //session.set_priority ("NORMAL:+SRP:+SRP-RSA:+SRP-DSS:-DHE-RSA:-VERS-SSL3.0:%SAFE_RENEGOTIATION:%LATEST_RECORD_VERSION", nullptr);
+  session.set_priority("SECURE128:+SECURE192:-VERS-ALL:+VERS-TLS1.2:%SAFE_RENEGOTIATION", nullptr);
+
+  // Try to resume the previous session if we have one
+  if (!tls_session.data.empty()) {
+    session.set_data(tls_session.data.data(), tls_session.data.size());
+  }
+
+  // connect to the peer
+  connection.connect(host, port);
+  session.set_transport_ptr((gnutls_transport_ptr_t)(ptrdiff_t)connection.get_sd());
+
+  // NOTE: TO use a timeout we need to provide a callback function, but becuase we pass GNUTLS_NONBLOCK to init above, then the callback is not called
+  session.set_transport_timeout_with_pull_timeout_function(500, GnuTLSPullTimeOutCallback);
+
+  // Perform the TLS handshake
+  //std::cout<<"GnuTLSPerformRequestPerforming handshake" << std::endl;
+  const int result = session.handshake();
+  if (result < 0) {
+    std::cerr<<"GnuTLSPerformRequest Handshake failed, error "<<std::to_string(result)<<std::endl;
+    return false;
+  }
+
+  tls_session.resumed = session.is_resumed();
+
+  return true;
+}
+
+}
+
+bool ParseHeaders(std::string_view text, cHTTPHeaders& headers)
+{
+  //std::cout<<"ParseHeaders"<<std::endl;
+
+  headers.Clear();
+
+  if (text.empty()) {
+    return false;
+  }
+
+  // Parse the HTTP header
+  // Headers: HTTP/1.1 200 OK
+  {
+    //std::cout<<"a"<<std::endl;
+    const size_t new_line = text.find("\r\n");
+    if (new_line == std::string_view::npos) {
+      return false;
+    }
+
+    //std::cout<<"b"<<std::endl;
+    const size_t space1 = text.find(' ');
+    if (space1 == std::string_view::npos) {
+      return false;
+    }
+
+    //std::cout<<"c"<<std::endl;
+    const size_t space2 = text.find(' ', space1 + 1);
+    if (space2 == std::string_view::npos) {
+      return false;
+    }
+
+    //std::cout<<"d space1: "<<space1<<", space2: "<<space2<<std::endl;
+    // Parse the response code
+    const std::string_view str_value(text.substr(space1, space2 - space1));
+    //std::cout<<"Response code text: "<<str_value<<std::endl;
+    unsigned long int value = 0;
+    if (!string_to_int(std::string(str_value), value)) {
+      return false;
+    }
+
+    if (value > UINT16_MAX) {
+      return false;
+    }
+
+    headers.response_code = uint16_t(value);
+
+    text.remove_prefix(new_line + 2);
+  }
+
+  // Parse the remaining headers
+  // Date: Sat, 06 Apr 2024 04:55:51 GMT
+  // Connection: close
+  // Content-Type: text/html
+  // Content-Length: 2330
+  while (!text.empty()) {
+    const size_t new_line = text.find("\r\n");
+    if (new_line == std::string_view::npos) {
+      break;
+    }
+
+    const size_t colon = text.find(':');
+    if (colon == std::string_view::npos) {
+      return false;
+    }
+
+    const std::string_view key{text.substr(0, colon)};
+    const std::string_view str_value{text.substr(colon + 2, new_line - (colon + 2))};
+    //std::cout<<"key: "<<key<<", str_value: "<<str_value<<std::endl;
+    if (key == "Content-Type") {
+      headers.content_type = str_value;
+    } else if (key == "Content-Length") {
+      unsigned long int value = 0;
+      if (!string_to_int(std::string(str_value), value)) {
+        return false;
+      }
+
+      headers.content_length = value;
+    } else {
+      headers.raw_headers[std::string(key)] = std::string(str_value);
+    }
+
+    text.remove_prefix(new_line + 2);
+  }
+
+  return (
+    (headers.response_code != 0) &&
+    !headers.content_type.empty()
+  );
+}
+
+
+bool GnuTLSPerformRequest(std::string_view request, uint16_t port, std::string_view user_agent, std::string_view server_certificate_path, cHTTPResponse& out_response)
+{
+  // Always use a new session
+  cTLSSession tls_session;
+  return GnuTLSPerformRequest(request, port, user_agent, server_certificate_path, tls_session, out_response);
+}
+
+bool GnuTLSPerformRequest(std::string_view request, uint16_t port, std::string_view user_agent, std::string_view server_certificate_path, cTLSSession& tls_session, cHTTPResponse& out_response)
+{
+  //std::cout<<"GnuTLSPerformRequest Connecting to "<<util::ToString(host)<<":"<<port<<std::endl;
+
+  out_response.Clear();
+
+  tcp_connection connection;
+  gnutlsmm::certificate_credentials credentials;
+  gnutlsmm::client_session session;
+
+  if (!GnuTLSConnect(port, server_certificate_path, tls_session, connection, credentials, session)) {
+    return false;
+  }
+
+  //std::cout<<"GnuTLSPerformRequest Handshake completed" << std::endl;
+
+  //std::cout<<"GnuTLSPerformRequest Sending HTTP request" << std::endl;
+  session.send(request.data(), request.length());
+
+  //std::cout<<"GnuTLSPerformRequest Reading response" << std::endl;
+
+  // For debugging
+  //std::ofstream ofs("output.html", std::ofstream::trunc);
+
+  char buffer[BUFFER_LENGTH + 1];
+
+  poll_read p(connection.get_sd());
+
+  const int timeout_ms = 2000;
+
+  // Once we start not receiving data we retry 10 times in 100ms and then exit
+  size_t no_bytes_retries = 0;
+  const size_t max_no_bytes_retries = 10;
+  const size_t retries_timeout_ms = 10;
+
+  std::vector<char> received_so_far;
+
+  bool reading_headers = true;
+
+  // NOTE: gnutls_record_recv may return GNUTLS_E_PREMATURE_TERMINATION
+  // https://lists.gnupg.org/pipermail/gnutls-help/2014-May/003455.html
+  // This means the peer has terminated the TLS session using a TCP RST (i.e., called close()).
+  // Since gnutls cannot distinguish that termination from an attacker terminating the session it warns you with this error code.
+
+  while (no_bytes_retries < max_no_bytes_retries) {
+    // Check if there is already something in the gnutls buffers
+    if (session.check_pending() == 0) {
+      // There was no gnutls data ready, check the socket
+      switch (p.poll(timeout_ms)) {
+        case POLL_READ_RESULT::DATA_READY: {
+          // Check if bytes are actually available (Otherwise if we try to read again the gnutls session object goes into a bad state and gnutlsxx throws an exception)
+          if (connection.get_bytes_available() == 0) {
+            //std::cout<<"but no bytes available"<<std::endl;
+            no_bytes_retries++;
+            // Don't hog the CPU
+            util::msleep(retries_timeout_ms);
+            continue;
+          }
+        }
+        case POLL_READ_RESULT::ERROR: {
+          break;
+        }
+        case POLL_READ_RESULT::TIMED_OUT: {
+          // We hit the 2 second timeout, we are probably done
+          break;
+        }
+      }
+    }
+
+    const ssize_t result = session.recv(buffer, BUFFER_LENGTH);
+    if (result == 0) {
+      //std::cout<<"GnuTLSPerformRequest Peer has closed the TLS connection"<<std::endl;
+      break;
+    } else if (result < 0) {
+      std::cout<<"GnuTLSPerformRequest Read error: "<<gnutls_strerror_name(result)<<" "<<gnutls_strerror(result)<<std::endl;
+      break;
+    }
+
+    const size_t bytes_read = result;
+    //std::cout<<"Received "<<bytes_read<<" bytes"<<std::endl;
+    if (reading_headers) {
+      received_so_far.insert(received_so_far.end(), buffer, buffer + bytes_read);
+
+      std::string_view sv(received_so_far.data(), received_so_far.size());
+      const size_t delimiter = sv.find("\r\n\r\n");
+      if (delimiter != std::string::npos) {
+        //std::cout<<"Headers received"<<std::endl;
+        std::string_view str_headers = sv.substr(0, delimiter);
+        ParseHeaders(str_headers, out_response.headers);
+
+        // Anything after this was file content
+        const size_t content_start = delimiter + strlen("\r\n\r\n");
+
+        // We are now up to the content
+        reading_headers = false;
+
+        //std::cout<<"Reading content"<<std::endl;
+
+        // Add to the file content
+        out_response.content.insert(out_response.content.end(), received_so_far.begin() + content_start, received_so_far.end());
+      }
+    } else {
+      // Everything else is content
+      out_response.content.insert(out_response.content.end(), buffer, buffer + bytes_read);
+    }
+  }
+
+  // Remember the session so that the next request can resume it
+  // NOTE: This is done after reading the response because with TLS 1.3 the session ticket is sent after the handshake
+  gnutls_datum_t session_data = { nullptr, 0 };
+  if (session.get_data(session.ptr(), session_data) == GNUTLS_E_SUCCESS) {
+    tls_session.data.assign(session_data.data, session_data.data + session_data.size);
+    gnutls_free(session_data.data);
+  }
+
+  session.bye(GNUTLS_SHUT_RDWR);
+
+  //std::cout<<"Finished"<<std::endl;
+
+  return true;
+}
+
+std::string HTTPSCreateRequest(std::string_view url)
+{
+  return "GET " + std::string(url.data(), url.size()) + " HTTP/1.0\r\n\r\n";
+}
+
+bool PerformHTTPSGetRequest(std::span<const char> const url, uint16_t port, std::string_view server_certificate_path, cHTTPResponse& out_response)
+{
+  //std::cout<<"PerformHTTPSGetRequest"<<std::endl;
+
+  std::string user_agent("UnitTest");
+  const std::string request = HTTPSCreateRequest(std::string_view{url.data(), url.size()});
+  if (!GnuTLSPerformRequest(request, port, user_agent, server_certificate_path, out_response)) {
+    return false;
+  }
+
+  //std::cout<<"Headers: "<<out_response.headers.response_code<<", "<<out_response.headers.content_type<<", "<<out_response.headers.content_length<<std::endl;
+  //std::cout<<"Content: "<<std::string(out_response.content.data(), out_response.content.size())<<std::endl;
+
+  //std::cout<<"PerformHTTPSGetRequest returning true"<<std::endl;
+  return true;
+}
+
+cHTTPSConnection::cHTTPSConnection()
+{
+}
+
+cHTTPSConnection::~cHTTPSConnection()
+{
+  Close();
+}
+
+bool cHTTPSConnection::Open(uint16_t port, std::string_view server_certificate_path)
+{
+  Close();
+
+  connection.reset(new tcp_connection);
+
+  if (server_certificate_path.empty()) {
+    // Plain HTTP
+    if (!connection->connect(host, port)) {
+      Close();
+      return false;
+    }
+
+    return true;
+  }
+
+  credentials.reset(new gnutlsmm::certificate_credentials);
+  session.reset(new gnutlsmm::client_session);
+
+  cTLSSession tls_session;
+  if (!GnuTLSConnect(port, server_certificate_path, tls_session, *connection, *credentials, *session)) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void cHTTPSConnection::Close()
+{
+  if (session != nullptr) {
+    session->bye(GNUTLS_SHUT_RDWR);
+  }
+
+  // NOTE: The session has to go before the credentials it uses
+  session.reset();
+  credentials.reset();
+  connection.reset();
+  received.clear();
+}
+
+bool cHTTPSConnection::PerformGetRequest(std::string_view url, cHTTPResponse& out_response)
+{
+  out_response.Clear();
+
+  if (!IsOpen()) {
+    return false;
+  }
+
+  const std::string request = "GET " + std::string(url) + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+  size_t sent = 0;
+  while (sent < request.length()) {
+    const ssize_t result = (session != nullptr) ? session->send(request.data() + sent, request.length() - sent) : ::send(connection->get_sd(), request.data() + sent, request.length() - sent, MSG_NOSIGNAL);
+    if ((session == nullptr) && (result < 0)) {
+      std::cerr<<"cHTTPSConnection::PerformGetRequest Send error: "<<strerror(errno)<<std::endl;
+      Close();
+      return false;
+    } else if ((result == GNUTLS_E_AGAIN) || (result == GNUTLS_E_INTERRUPTED)) {
+      continue;
+    } else if (result < 0) {
+      std::cerr<<"cHTTPSConnection::PerformGetRequest Send error: "<<gnutls_strerror(result)<<std::endl;
+      Close();
+      return false;
+    }
+
+    sent += size_t(result);
+  }
+
+  if (!ReadResponse(out_response)) {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool cHTTPSConnection::ReadResponse(cHTTPResponse& out_response)
+{
+  const int timeout_ms = 2000;
+
+  poll_read p(connection->get_sd());
+
+  char buffer[BUFFER_LENGTH];
+
+  size_t headers_length = 0; // The length of the headers including the blank line, 0 until they have been received
+  size_t content_length = 0;
+
+  while (true) {
+    // Parse the headers once they have all arrived
+    if (headers_length == 0) {
+      const std::string_view sv(received.data(), received.size());
+      const size_t delimiter = sv.find("\r\n\r\n");
+      if (delimiter != std::string_view::npos) {
+        // NOTE: ParseHeaders fails if there is no Content-Type, which is normal for a 304 so we only check the response code
+        // NOTE: The last header's line ending is included so that it is parsed too
+        ParseHeaders(sv.substr(0, delimiter + strlen("\r\n")), out_response.headers);
+        if (out_response.headers.response_code == 0) {
+          return false;
+        }
+
+        headers_length = delimiter + strlen("\r\n\r\n");
+
+        // Responses without a body don't send a Content-Length
+        const uint16_t code = out_response.headers.response_code;
+        content_length = ((code == 204) || (code == 304) || (code < 200)) ? 0 : out_response.headers.content_length;
+      }
+    }
+
+    // Check if we have the whole response
+    if ((headers_length != 0) && (received.size() >= headers_length + content_length)) {
+      const auto content_begin = received.begin() + headers_length;
+      const auto content_end = content_begin + content_length;
+      out_response.content.assign(content_begin, content_end);
+
+      // Keep anything after the response for the next one
+      received.erase(received.begin(), content_end);
+      return true;
+    }
+
+    // Check if there is already something in the gnutls buffers, otherwise wait for the socket
+    if (((session == nullptr) || (session->check_pending() == 0)) && (p.poll(timeout_ms) != POLL_READ_RESULT::DATA_READY)) {
+      std::cerr<<"cHTTPSConnection::ReadResponse Timed out waiting for the response"<<std::endl;
+      return false;
+    }
+
+    const ssize_t result = (session != nullptr) ? session->recv(buffer, sizeof(buffer)) : ::recv(connection->get_sd(), buffer, sizeof(buffer), 0);
+    if ((session == nullptr) && (result < 0)) {
+      std::cerr<<"cHTTPSConnection::ReadResponse Read error: "<<strerror(errno)<<std::endl;
+      return false;
+    } else if ((result == GNUTLS_E_AGAIN) || (result == GNUTLS_E_INTERRUPTED)) {
+      // Only part of a record has arrived so far
+      continue;
+    } else if (result == 0) {
+      // The server closed the connection
+      return false;
+    } else if (result < 0) {
+      std::cerr<<"cHTTPSConnection::ReadResponse Read error: "<<gnutls_strerror_name(result)<<" "<<gnutls_strerror(result)<<std::endl;
+      return false;
+    }
+
+    received.insert(received.end(), buffer, buffer + result);
+  }
+}
@@ -0,0 +1,40 @@
+#include <chrono>
+#include <thread>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "in_flight_requests.h"
+
+TEST(InFlightRequests, TestWaitUntilIdle)
+{
+  tasktracker::cInFlightRequests requests;
+  EXPECT_EQ(0, requests.Get());
+
+  // Nothing in flight returns straight away, even if the deadline has passed
+  EXPECT_TRUE(requests.WaitUntilIdle(std::chrono::steady_clock::now()));
+
+  requests.Started();
+  requests.Started();
+  EXPECT_EQ(2, requests.Get());
+
+  // Times out while there are requests in flight
+  EXPECT_FALSE(requests.WaitUntilIdle(std::chrono::steady_clock::now() + std::chrono::milliseconds(20)));
+
+  requests.Completed();
+  EXPECT_EQ(1, requests.Get());
+
+  // Wakes up as soon as the last request completes rather than at the deadline
+  std::thread completer([&requests]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    requests.Completed();
+  });
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(requests.WaitUntilIdle(start + std::chrono::seconds(30)));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+  EXPECT_EQ(0, requests.Get());
+
+  completer.join();
+}
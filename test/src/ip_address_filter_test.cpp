@@ -0,0 +1,76 @@
+#include <string>
+#include <vector>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "ip_address_filter.h"
+
+namespace {
+
+std::vector<util::cIPNetwork> ParseNetworks(const std::vector<std::string>& values)
+{
+  std::vector<util::cIPNetwork> networks;
+  for (auto&& value : values) {
+    util::cIPNetwork network;
+    EXPECT_TRUE(util::ParseNetwork(value, network)) << value;
+    networks.push_back(network);
+  }
+  return networks;
+}
+
+util::cIPAddress Parse(const std::string& text)
+{
+  util::cIPAddress address;
+  EXPECT_TRUE(util::ParseAddress(text, address)) << text;
+  return address;
+}
+
+}
+
+TEST(Util, TestIPAddressFilter)
+{
+  util::cIPAddressFilter filter;
+
+  // With no networks every client is allowed
+  filter.Create({}, {});
+  EXPECT_FALSE(filter.IsEnabled());
+  EXPECT_TRUE(filter.IsAllowed(Parse("8.8.8.8")));
+
+  // An allow list only lets in the clients on it, the most specific network wins
+  filter.Create(ParseNetworks({ "192.168.0.0/16", "10.0.0.1", "2001:db8::/32" }), ParseNetworks({ "192.168.5.0/24", "2001:db8:1::/48" }));
+  EXPECT_TRUE(filter.IsEnabled());
+  EXPECT_TRUE(filter.IsAllowed(Parse("192.168.0.3")));
+  EXPECT_TRUE(filter.IsAllowed(Parse("192.168.4.255")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("192.168.5.1")));
+  EXPECT_TRUE(filter.IsAllowed(Parse("192.168.6.0")));
+  EXPECT_TRUE(filter.IsAllowed(Parse("10.0.0.1")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("10.0.0.2")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("8.8.8.8")));
+
+  EXPECT_TRUE(filter.IsAllowed(Parse("2001:db8::3")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("2001:db8:1::3")));
+  EXPECT_TRUE(filter.IsAllowed(Parse("2001:db8:2::3")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("2001:db9::3")));
+
+  // The address families are separate, 2001:db8::/32 has nothing to do with 32.1.13.184
+  EXPECT_FALSE(filter.IsAllowed(util::cIPAddress(32, 1, 13, 184)));
+
+  // A deny list on its own lets in everyone else
+  filter.Create({}, ParseNetworks({ "203.0.113.0/24", "::/0" }));
+  EXPECT_TRUE(filter.IsAllowed(Parse("192.168.0.3")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("203.0.113.7")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("2001:db8::3")));
+
+  // A more specific allowed network makes a hole in a denied network, the same network on both lists is denied
+  filter.Create(ParseNetworks({ "0.0.0.0/0", "10.1.0.0/16", "10.2.0.0/16" }), ParseNetworks({ "10.0.0.0/8", "10.2.0.0/16" }));
+  EXPECT_TRUE(filter.IsAllowed(Parse("8.8.8.8")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("10.0.0.1")));
+  EXPECT_TRUE(filter.IsAllowed(Parse("10.1.2.3")));
+  EXPECT_FALSE(filter.IsAllowed(Parse("10.2.2.3")));
+
+  filter.Clear();
+  EXPECT_FALSE(filter.IsEnabled());
+  EXPECT_TRUE(filter.IsAllowed(Parse("10.2.2.3")));
+}
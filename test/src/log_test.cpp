@@ -0,0 +1,163 @@
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "log.h"
+
+namespace {
+
+size_t CountLinesContaining(const std::string& output, const std::string& text)
+{
+  size_t count = 0;
+
+  std::istringstream i(output);
+  std::string line;
+  while (std::getline(i, line)) {
+    if (line.find(text) != std::string::npos) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+}
+
+TEST(Log, TestFormatting)
+{
+  // Without the writer thread the lines are written straight away
+  testing::internal::CaptureStdout();
+  LOG_INFO<<"Number "<<42<<" "<<-7<<" "<<uint64_t(18446744073709551615ull)<<" "<<true<<" "<<'c'<<" "<<std::string("string");
+  LOG_INFO<<"Quoted "<<logging::quoted("a \"b\"\r\n\\c");
+  const std::string output = testing::internal::GetCapturedStdout();
+
+  EXPECT_EQ("Number 42 -7 18446744073709551615 true c string\nQuoted \"a \\\"b\\\"\\x0d\\x0a\\\\c\"\n", output);
+
+  // Errors go to stderr
+  testing::internal::CaptureStderr();
+  LOG_ERROR<<"Error line";
+  EXPECT_EQ("Error line\n", testing::internal::GetCapturedStderr());
+
+  // Long lines are truncated
+  testing::internal::CaptureStdout();
+  LOG_INFO<<std::string(logging::MAX_LINE_LENGTH + 100, 'a');
+  EXPECT_EQ(std::string(logging::MAX_LINE_LENGTH, 'a') + "\n", testing::internal::GetCapturedStdout());
+}
+
+TEST(Log, TestWriterThread)
+{
+  testing::internal::CaptureStdout();
+
+  ASSERT_TRUE(logging::Start());
+  EXPECT_FALSE(logging::Start());
+
+  const uint64_t dropped_before = logging::GetDroppedCount();
+
+  // Log from several threads at once, each thread has its own buffer
+  const size_t nthreads = 4;
+  const size_t nlines = 20;
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < nthreads; t++) {
+    threads.push_back(std::thread([t]() {
+      for (size_t i = 0; i < nlines; i++) {
+        LOG_INFO<<"Writer thread test "<<t<<" "<<i;
+      }
+    }));
+  }
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  // Stopping writes whatever is still queued, including lines from threads that have already exited
+  logging::Stop();
+
+  const std::string output = testing::internal::GetCapturedStdout();
+
+  // Every line was either written or counted as dropped
+  const uint64_t dropped = logging::GetDroppedCount() - dropped_before;
+  EXPECT_EQ(nthreads * nlines, CountLinesContaining(output, "Writer thread test ") + dropped);
+
+  // The lines from each thread are written in order
+  for (size_t t = 0; t < nthreads; t++) {
+    size_t previous_position = 0;
+    for (size_t i = 0; i < nlines; i++) {
+      const size_t position = output.find("Writer thread test " + std::to_string(t) + " " + std::to_string(i) + "\n");
+      if (position != std::string::npos) {
+        EXPECT_GE(position, previous_position);
+        previous_position = position;
+      }
+    }
+  }
+}
+
+TEST(Log, TestWriterThreadNeverDropsWarnings)
+{
+  testing::internal::CaptureStderr();
+  testing::internal::CaptureStdout();
+
+  ASSERT_TRUE(logging::Start());
+
+  const uint64_t dropped_before = logging::GetDroppedCount();
+
+  // Far more lines than fit in the buffer, so the writer thread can't keep up
+  const size_t nlines = 5000;
+  for (size_t i = 0; i < nlines; i++) {
+    LOG_WARNING<<"Warning test "<<i;
+  }
+  for (size_t i = 0; i < nlines; i++) {
+    LOG_INFO<<"Info test "<<i;
+  }
+
+  logging::Stop();
+
+  (void)testing::internal::GetCapturedStdout();
+  const std::string errors = testing::internal::GetCapturedStderr();
+
+  // Every warning was written, only the info lines may have been dropped
+  EXPECT_EQ(nlines, CountLinesContaining(errors, "Warning test "));
+
+  // Any lines that were dropped are reported
+  const uint64_t dropped = logging::GetDroppedCount() - dropped_before;
+  if (dropped != 0) {
+    EXPECT_NE(std::string::npos, errors.find(" log lines dropped\n"));
+  }
+}
+
+TEST(Log, TestStopWhileLogging)
+{
+  testing::internal::CaptureStdout();
+
+  const uint64_t dropped_before = logging::GetDroppedCount();
+
+  // Keep logging while the writer thread is stopped, a line queued as it stops must still be written
+  const size_t nthreads = 4;
+  const size_t nlines = 2000;
+
+  ASSERT_TRUE(logging::Start());
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < nthreads; t++) {
+    threads.push_back(std::thread([t]() {
+      for (size_t i = 0; i < nlines; i++) {
+        LOG_INFO<<"Stop test "<<t<<" "<<i;
+      }
+    }));
+  }
+
+  logging::Stop();
+
+  for (auto&& thread : threads) {
+    thread.join();
+  }
+
+  const std::string output = testing::internal::GetCapturedStdout();
+
+  const uint64_t dropped = logging::GetDroppedCount() - dropped_before;
+  EXPECT_EQ(nthreads * nlines, CountLinesContaining(output, "Stop test ") + dropped);
+}
@@ -0,0 +1,75 @@
+#include <array>
+#include <string_view>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "embedded_resources.h"
+#include "perfect_hash.h"
+
+namespace {
+
+constexpr std::array<std::string_view, 5> keys = {
+  "/",
+  "/style.css",
+  "/favicon.svg",
+  "/feed/atom.xml",
+  "/robots.txt",
+};
+
+constexpr util::perfect_hash_table table(keys);
+
+// The lookups can happen at compile time too
+static_assert(table.find("/") == 0);
+static_assert(table.find("/robots.txt") == 4);
+static_assert(table.find("/missing") == table.npos);
+
+}
+
+TEST(Util, TestPerfectHashTable)
+{
+  // Every key is found at its own index
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(i, table.find(keys[i]));
+  }
+
+  // Keys that are not in the table are not found, even if they hash to an occupied slot
+  EXPECT_EQ(table.npos, table.find(""));
+  EXPECT_EQ(table.npos, table.find("/style.cs"));
+  EXPECT_EQ(table.npos, table.find("/style.css "));
+  EXPECT_EQ(table.npos, table.find("/STYLE.CSS"));
+  EXPECT_EQ(table.npos, table.find("/feed/atom.xml/"));
+
+  // A single key and an empty table
+  constexpr util::perfect_hash_table single(std::array<std::string_view, 1>{ "/" });
+  EXPECT_EQ(0, single.find("/"));
+  EXPECT_EQ(single.npos, single.find("/index.html"));
+
+  constexpr util::perfect_hash_table empty(std::array<std::string_view, 0>{});
+  EXPECT_EQ(empty.npos, empty.find("/"));
+}
+
+TEST(TaskTracker, TestEmbeddedResources)
+{
+  constexpr util::perfect_hash_table table(tasktracker::embedded::request_paths);
+
+  // Each embedded resource can be found by its request path
+  for (size_t i = 0; i < tasktracker::embedded::resources.size(); i++) {
+    const tasktracker::cEmbeddedResource& resource = tasktracker::embedded::resources[i];
+    EXPECT_EQ(i, table.find(resource.request_path));
+    EXPECT_FALSE(resource.mime_type.empty());
+
+    // Each encoding has some content and its own etag
+    for (size_t encoding = 0; encoding < util::CONTENT_ENCODING_COUNT; encoding++) {
+      EXPECT_FALSE(resource.variants[encoding].empty());
+      EXPECT_FALSE(resource.etags[encoding].empty());
+    }
+  }
+
+  // index.html is served as the root
+  const size_t index = table.find("/");
+  ASSERT_NE(table.npos, index);
+  EXPECT_EQ("text/html", tasktracker::embedded::resources[index].mime_type);
+  EXPECT_EQ(table.npos, table.find("/index.html"));
+}
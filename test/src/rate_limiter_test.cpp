@@ -0,0 +1,113 @@
+#include <chrono>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "rate_limiter.h"
+
+TEST(Util, TestRateLimiter)
+{
+  uint32_t retry_after_seconds = 0;
+
+  // A rate of 0 disables the limiter
+  util::cRateLimiter disabled;
+  ASSERT_TRUE(disabled.Create(0, 1));
+  EXPECT_FALSE(disabled.IsEnabled());
+  for (size_t i = 0; i < 100; i++) {
+    EXPECT_TRUE(disabled.TryTake(1, retry_after_seconds));
+  }
+
+  util::cRateLimiter limiter;
+  EXPECT_FALSE(limiter.Create(60, 0));
+  ASSERT_TRUE(limiter.Create(60, 3, 16)); // One request a second with a burst of 3
+  EXPECT_TRUE(limiter.IsEnabled());
+
+  // The times are relative to when the limiter was created
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // A new client can make a burst of requests
+  EXPECT_TRUE(limiter.TryTake(1, start, retry_after_seconds));
+  EXPECT_TRUE(limiter.TryTake(1, start, retry_after_seconds));
+  EXPECT_TRUE(limiter.TryTake(1, start, retry_after_seconds));
+  EXPECT_FALSE(limiter.TryTake(1, start, retry_after_seconds));
+  EXPECT_EQ(1, retry_after_seconds);
+
+  // Other clients have their own buckets
+  EXPECT_TRUE(limiter.TryTake(2, start, retry_after_seconds));
+  EXPECT_EQ(0, retry_after_seconds);
+
+  // Half a token isn't enough
+  EXPECT_FALSE(limiter.TryTake(1, start + std::chrono::milliseconds(500), retry_after_seconds));
+  EXPECT_EQ(1, retry_after_seconds);
+
+  // The bucket refills at the steady rate
+  EXPECT_TRUE(limiter.TryTake(1, start + std::chrono::milliseconds(1000), retry_after_seconds));
+  EXPECT_FALSE(limiter.TryTake(1, start + std::chrono::milliseconds(1000), retry_after_seconds));
+
+  // But only up to the burst size
+  EXPECT_TRUE(limiter.TryTake(1, start + std::chrono::seconds(60), retry_after_seconds));
+  EXPECT_TRUE(limiter.TryTake(1, start + std::chrono::seconds(60), retry_after_seconds));
+  EXPECT_TRUE(limiter.TryTake(1, start + std::chrono::seconds(60), retry_after_seconds));
+  EXPECT_FALSE(limiter.TryTake(1, start + std::chrono::seconds(60), retry_after_seconds));
+
+  const util::cRateLimiterCounters counters = limiter.GetCounters();
+  EXPECT_EQ(8, counters.allowed);
+  EXPECT_EQ(4, counters.limited);
+  EXPECT_EQ(0, counters.replaced);
+}
+
+TEST(Util, TestRateLimiterRetryAfter)
+{
+  uint32_t retry_after_seconds = 0;
+
+  // One request every 20 seconds
+  util::cRateLimiter limiter;
+  ASSERT_TRUE(limiter.Create(3, 1, 16));
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  EXPECT_TRUE(limiter.TryTake(1, start, retry_after_seconds));
+  EXPECT_FALSE(limiter.TryTake(1, start, retry_after_seconds));
+  EXPECT_EQ(20, retry_after_seconds);
+
+  // The wait is rounded up to whole seconds
+  EXPECT_FALSE(limiter.TryTake(1, start + std::chrono::milliseconds(14500), retry_after_seconds));
+  EXPECT_EQ(6, retry_after_seconds);
+
+  EXPECT_TRUE(limiter.TryTake(1, start + std::chrono::seconds(20), retry_after_seconds));
+}
+
+TEST(Util, TestRateLimiterAging)
+{
+  uint32_t retry_after_seconds = 0;
+
+  // One set, so every client shares the same 4 buckets
+  util::cRateLimiter limiter;
+  ASSERT_TRUE(limiter.Create(60, 1, 1));
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for (uint64_t key = 1; key <= 4; key++) {
+    EXPECT_TRUE(limiter.TryTake(key, start + std::chrono::milliseconds(key), retry_after_seconds));
+  }
+
+  // A fifth active client replaces the least recently used one, which starts again with a full bucket
+  EXPECT_TRUE(limiter.TryTake(5, start + std::chrono::milliseconds(10), retry_after_seconds));
+  EXPECT_EQ(1, limiter.GetCounters().replaced);
+  EXPECT_FALSE(limiter.TryTake(2, start + std::chrono::milliseconds(20), retry_after_seconds));
+  EXPECT_TRUE(limiter.TryTake(1, start + std::chrono::milliseconds(30), retry_after_seconds));
+  EXPECT_EQ(2, limiter.GetCounters().replaced);
+
+  // Once the buckets have refilled they age out, so new clients take them without replacing anyone
+  const std::chrono::steady_clock::time_point later = start + std::chrono::seconds(10);
+  for (uint64_t key = 10; key < 14; key++) {
+    EXPECT_TRUE(limiter.TryTake(key, later, retry_after_seconds));
+  }
+  EXPECT_EQ(2, limiter.GetCounters().replaced);
+
+  // Those clients are all still limited
+  for (uint64_t key = 10; key < 14; key++) {
+    EXPECT_FALSE(limiter.TryTake(key, later, retry_after_seconds));
+  }
+}
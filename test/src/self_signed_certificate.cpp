@@ -0,0 +1,93 @@
+#include <ctime>
+
+#include <fstream>
+#include <iostream>
+
+#include <gnutls/gnutls.h>
+#include <gnutls/x509.h>
+
+#include "self_signed_certificate.h"
+
+namespace {
+
+bool WriteDatumToFile(const gnutls_datum_t& datum, const std::string& file_path)
+{
+  std::ofstream f(file_path, std::ofstream::trunc | std::ofstream::binary);
+  f.write(reinterpret_cast<const char*>(datum.data), datum.size);
+  return f.good();
+}
+
+}
+
+const char* GetKeyTypeName(KEY_TYPE key_type)
+{
+  switch (key_type) {
+    case KEY_TYPE::RSA_2048: return "rsa_2048";
+    case KEY_TYPE::ECDSA_P256: return "ecdsa_p256";
+    case KEY_TYPE::ED25519: return "ed25519";
+  }
+
+  return "unknown";
+}
+
+bool GenerateSelfSignedCertificate(KEY_TYPE key_type, const std::string& private_key_path, const std::string& public_cert_path)
+{
+  gnutls_pk_algorithm_t algorithm = GNUTLS_PK_RSA;
+  unsigned int bits = 2048;
+  gnutls_digest_algorithm_t digest = GNUTLS_DIG_SHA256;
+
+  switch (key_type) {
+    case KEY_TYPE::RSA_2048: {
+      break;
+    }
+    case KEY_TYPE::ECDSA_P256: {
+      algorithm = GNUTLS_PK_ECDSA;
+      bits = GNUTLS_CURVE_TO_BITS(GNUTLS_ECC_CURVE_SECP256R1);
+      break;
+    }
+    case KEY_TYPE::ED25519: {
+      algorithm = GNUTLS_PK_EDDSA_ED25519;
+      bits = GNUTLS_CURVE_TO_BITS(GNUTLS_ECC_CURVE_ED25519);
+      digest = GNUTLS_DIG_UNKNOWN; // EdDSA signs the whole message itself
+      break;
+    }
+  }
+
+  gnutls_x509_privkey_t key = nullptr;
+  gnutls_x509_crt_t crt = nullptr;
+  gnutls_datum_t key_pem = { nullptr, 0 };
+  gnutls_datum_t crt_pem = { nullptr, 0 };
+
+  bool result = false;
+
+  // NOTE: The certificate is only valid for a day, it is regenerated each time it is needed
+  const time_t now = time(nullptr);
+  const unsigned char serial[] = { 1 };
+
+  if (
+    (gnutls_x509_privkey_init(&key) < 0) ||
+    (gnutls_x509_privkey_generate(key, algorithm, bits, 0) < 0) ||
+    (gnutls_x509_crt_init(&crt) < 0) ||
+    (gnutls_x509_crt_set_version(crt, 3) < 0) ||
+    (gnutls_x509_crt_set_serial(crt, serial, sizeof(serial)) < 0) ||
+    (gnutls_x509_crt_set_activation_time(crt, now - 60) < 0) ||
+    (gnutls_x509_crt_set_expiration_time(crt, now + (24 * 60 * 60)) < 0) ||
+    (gnutls_x509_crt_set_dn(crt, "CN=localhost", nullptr) < 0) ||
+    (gnutls_x509_crt_set_key(crt, key) < 0) ||
+    (gnutls_x509_crt_sign2(crt, crt, key, digest, 0) < 0) ||
+    // NOTE: PKCS#8 is the only PEM format that can hold every type of key
+    (gnutls_x509_privkey_export2_pkcs8(key, GNUTLS_X509_FMT_PEM, nullptr, GNUTLS_PKCS_PLAIN, &key_pem) < 0) ||
+    (gnutls_x509_crt_export2(crt, GNUTLS_X509_FMT_PEM, &crt_pem) < 0)
+  ) {
+    std::cerr<<"GenerateSelfSignedCertificate Error generating "<<GetKeyTypeName(key_type)<<" certificate"<<std::endl;
+  } else {
+    result = WriteDatumToFile(key_pem, private_key_path) && WriteDatumToFile(crt_pem, public_cert_path);
+  }
+
+  gnutls_free(crt_pem.data);
+  gnutls_free(key_pem.data);
+  if (crt != nullptr) gnutls_x509_crt_deinit(crt);
+  if (key != nullptr) gnutls_x509_privkey_deinit(key);
+
+  return result;
+}
@@ -11,20 +11,106 @@ TEST(TaskTracker, TestSettings)
 
   EXPECT_TRUE(settings.GetRunningInContainer());
 
-  const util::cIPAddress ip = settings.GetIP();
-  EXPECT_EQ(192, ip.octet0);
-  EXPECT_EQ(168, ip.octet1);
-  EXPECT_EQ(0, ip.octet2);
-  EXPECT_EQ(3, ip.octet3);
-
-  EXPECT_EQ(8443, settings.GetPort());
+  // "ip" and "port" followed by the "listen" endpoints
+  const std::vector<tasktracker::cListenEndpoint>& endpoints = settings.GetListenEndpoints();
+  ASSERT_EQ(4, endpoints.size());
+  EXPECT_EQ(util::cIPAddress(192, 168, 0, 3), endpoints[0].address);
+  EXPECT_EQ(8443, endpoints[0].port);
+  EXPECT_STREQ("[2001:db8::3]:8443", tasktracker::ToString(endpoints[1]).c_str());
+  EXPECT_STREQ("[::]:9443", tasktracker::ToString(endpoints[2]).c_str());
+  EXPECT_TRUE(endpoints[3].IsUnixSocket());
+  EXPECT_STREQ("/run/task-tracker/task-tracker.sock", endpoints[3].unix_socket_path.c_str());
 
   EXPECT_EQ("https://tasktracker.mydomain.home:8443/", settings.GetExternalURL());
   EXPECT_STREQ("./test/configuration/unit_test_server.key", settings.GetHTTPSPrivateKey().c_str());
   EXPECT_STREQ("./test/configuration/unit_test_server.crt", settings.GetHTTPSPublicCert().c_str());
   EXPECT_EQ("u5ekFC43AFJMl1uidPJYM9P0D8uibgnvZxbk0QsAlPgoeSDxivonEL1NZ3DXQzzB", settings.GetToken());
 
+  // The single token sees the whole feed, followed by the filtered views
+  const std::vector<tasktracker::cFeedView>& feed_views = settings.GetFeedViews();
+  ASSERT_EQ(3, feed_views.size());
+  EXPECT_EQ("default", feed_views[0].name);
+  EXPECT_EQ("u5ekFC43AFJMl1uidPJYM9P0D8uibgnvZxbk0QsAlPgoeSDxivonEL1NZ3DXQzzB", feed_views[0].token);
+  EXPECT_TRUE(feed_views[0].filter.IsEmpty());
+  EXPECT_EQ("urgent", feed_views[1].name);
+  EXPECT_EQ("Q3AFJMl1uidPJYM9P0D8uibgnvZxbk0QsAlPgoeSDxivonEL1NZ3DXQzzBu5ekFC4", feed_views[1].token);
+  EXPECT_TRUE(feed_views[1].filter.high_priority_only);
+  EXPECT_TRUE(feed_views[1].filter.project.empty());
+  EXPECT_TRUE(feed_views[1].filter.labels.empty());
+  EXPECT_EQ("garden", feed_views[2].name);
+  EXPECT_FALSE(feed_views[2].filter.high_priority_only);
+  EXPECT_EQ("home/garden", feed_views[2].filter.project);
+  EXPECT_EQ((std::vector<std::string>{ "outside", "weekly" }), feed_views[2].filter.labels);
+
+  EXPECT_EQ(tasktracker::BACKEND::IO_URING, settings.GetWebServerOptions().backend);
+  EXPECT_EQ(tasktracker::THREADING_MODEL::THREAD_POOL, settings.GetWebServerOptions().threading_model);
+  EXPECT_EQ(4, settings.GetWebServerOptions().thread_pool_size);
+  EXPECT_EQ("NORMAL:-VERS-ALL:+VERS-TLS1.3:+VERS-TLS1.2", settings.GetWebServerOptions().tls_priorities);
+  EXPECT_TRUE(settings.GetWebServerOptions().tls_session_tickets);
+  EXPECT_EQ(3600, settings.GetWebServerOptions().tls_session_lifetime_seconds);
+  EXPECT_EQ(60, settings.GetWebServerOptions().connection_timeout_seconds);
+  EXPECT_EQ(128, settings.GetWebServerOptions().connection_limit);
+  EXPECT_EQ(8, settings.GetWebServerOptions().per_ip_connection_limit);
+  EXPECT_EQ(32768, settings.GetWebServerOptions().connection_memory_limit_bytes);
+  EXPECT_EQ(128, settings.GetWebServerOptions().listen_backlog);
+  EXPECT_EQ(5, settings.GetWebServerOptions().shutdown_timeout_seconds);
+  ASSERT_EQ(2, settings.GetWebServerOptions().allow_networks.size());
+  EXPECT_STREQ("192.168.0.0/16", util::ToString(settings.GetWebServerOptions().allow_networks[0]).c_str());
+  EXPECT_STREQ("2001:db8::/32", util::ToString(settings.GetWebServerOptions().allow_networks[1]).c_str());
+  ASSERT_EQ(1, settings.GetWebServerOptions().deny_networks.size());
+  EXPECT_STREQ("192.168.5.0/24", util::ToString(settings.GetWebServerOptions().deny_networks[0]).c_str());
+  EXPECT_EQ(4, settings.GetWebServerOptions().worker_threads);
+  EXPECT_EQ(32, settings.GetWebServerOptions().worker_queue_limit);
+  EXPECT_EQ(131072, settings.GetWebServerOptions().event_stream_buffer_bytes);
+  EXPECT_EQ(0, settings.GetWebServerOptions().worker_processes); // The default, worker processes can't listen on a Unix domain socket
+  EXPECT_EQ(30, settings.GetWebServerOptions().ip_rate_limit_per_minute);
+  EXPECT_EQ(5, settings.GetWebServerOptions().ip_rate_limit_burst);
+  EXPECT_EQ(120, settings.GetWebServerOptions().token_rate_limit_per_minute);
+  EXPECT_EQ(10, settings.GetWebServerOptions().token_rate_limit_burst); // The default
+
   EXPECT_STREQ("https://gitlab.mydomain.home:2443/", settings.GetGitlabURL().c_str());
   EXPECT_STREQ("glfgi-ijcxzvZXCJIO58FD348s", settings.GetGitlabAPIToken().c_str());
   EXPECT_STREQ("./test/configuration/gitlab_server.crt", settings.GetGitlabHTTPSPublicCert().c_str());
 }
+
+TEST(TaskTracker, TestListenEndpointDualStack)
+{
+  util::cIPAddress ipv6_any;
+  ASSERT_TRUE(util::ParseAddress("::", ipv6_any));
+
+  util::cIPAddress ipv6_address;
+  ASSERT_TRUE(util::ParseAddress("2001:db8::3", ipv6_address));
+
+  std::vector<tasktracker::cListenEndpoint> endpoints = {
+    tasktracker::cListenEndpoint(ipv6_any, 8443), // Also accepts IPv4
+    tasktracker::cListenEndpoint(ipv6_any, 9443), // There is an IPv4 endpoint on this port so it is IPv6 only
+    tasktracker::cListenEndpoint(util::cIPAddress(192, 168, 0, 3), 9443),
+    tasktracker::cListenEndpoint(ipv6_address, 8443), // Only the any address can be dual stack
+  };
+  tasktracker::SetDualStack(endpoints);
+
+  EXPECT_TRUE(endpoints[0].dual_stack);
+  EXPECT_FALSE(endpoints[1].dual_stack);
+  EXPECT_FALSE(endpoints[2].dual_stack);
+  EXPECT_FALSE(endpoints[3].dual_stack);
+}
+
+TEST(TaskTracker, TestParseListenEndpoint)
+{
+  tasktracker::cListenEndpoint endpoint;
+
+  EXPECT_FALSE(tasktracker::ParseListenEndpoint("", endpoint));
+  EXPECT_FALSE(tasktracker::ParseListenEndpoint("unix:", endpoint));
+  EXPECT_FALSE(tasktracker::ParseListenEndpoint("unix:relative.sock", endpoint));
+  EXPECT_FALSE(tasktracker::ParseListenEndpoint("unix:/" + std::string(200, 'a'), endpoint));
+  EXPECT_FALSE(tasktracker::ParseListenEndpoint("192.168.0.3", endpoint));
+
+  ASSERT_TRUE(tasktracker::ParseListenEndpoint("unix:/run/task-tracker.sock", endpoint));
+  EXPECT_TRUE(endpoint.IsUnixSocket());
+  EXPECT_STREQ("unix:/run/task-tracker.sock", tasktracker::ToString(endpoint).c_str());
+
+  ASSERT_TRUE(tasktracker::ParseListenEndpoint("192.168.0.3:8443", endpoint));
+  EXPECT_FALSE(endpoint.IsUnixSocket());
+  EXPECT_EQ(util::cIPAddress(192, 168, 0, 3), endpoint.address);
+  EXPECT_EQ(8443, endpoint.port);
+}
@@ -0,0 +1,67 @@
+#include <csignal>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "settings_watcher.h"
+
+namespace {
+
+void WriteFile(const std::filesystem::path& file_path, const std::string& contents)
+{
+  std::ofstream f(file_path, std::ios::trunc);
+  f<<contents;
+}
+
+}
+
+TEST(SettingsWatcher, TestFileChanges)
+{
+  const std::filesystem::path directory = std::filesystem::temp_directory_path() / "task_tracker_settings_watcher_unit_test";
+  std::filesystem::remove_all(directory);
+  ASSERT_TRUE(std::filesystem::create_directories(directory));
+
+  const std::filesystem::path settings_path = directory / "configuration.json";
+  const std::filesystem::path certificate_path = directory / "server.crt";
+  WriteFile(settings_path, "{}");
+
+  tasktracker::cSettingsWatcher watcher;
+  ASSERT_TRUE(watcher.Create({ settings_path.string(), certificate_path.string(), "" }));
+  EXPECT_FALSE(watcher.IsReloadRequested());
+
+  // Writing a watched file
+  WriteFile(settings_path, "{ \"container\": false }");
+  EXPECT_TRUE(watcher.IsReloadRequested());
+  EXPECT_FALSE(watcher.IsReloadRequested());
+
+  // Another file in the same directory
+  WriteFile(directory / "unrelated.txt", "unrelated");
+  EXPECT_FALSE(watcher.IsReloadRequested());
+
+  // Renaming a new file over a watched file, and a watched file that didn't exist when we started watching
+  const std::filesystem::path temporary_path = directory / "server.crt.tmp";
+  WriteFile(temporary_path, "certificate");
+  EXPECT_FALSE(watcher.IsReloadRequested());
+  std::filesystem::rename(temporary_path, certificate_path);
+  EXPECT_TRUE(watcher.IsReloadRequested());
+  EXPECT_FALSE(watcher.IsReloadRequested());
+
+  watcher.Destroy();
+  std::filesystem::remove_all(directory);
+}
+
+TEST(SettingsWatcher, TestSignal)
+{
+  tasktracker::cSettingsWatcher watcher;
+  ASSERT_TRUE(watcher.Create({}));
+  EXPECT_FALSE(watcher.IsReloadRequested());
+
+  ASSERT_EQ(0, raise(SIGHUP));
+  EXPECT_TRUE(watcher.IsReloadRequested());
+  EXPECT_FALSE(watcher.IsReloadRequested());
+}
@@ -0,0 +1,174 @@
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "socket_handoff.h"
+#include "unix_socket.h"
+
+namespace {
+
+int OpenTCPListeningSocket(const util::cIPAddress& address, uint16_t port)
+{
+  struct sockaddr_storage sad;
+  const socklen_t sad_length = util::ToSockAddr(address, port, sad);
+
+  const int fd = socket(sad.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  EXPECT_NE(-1, fd);
+
+  const int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  EXPECT_EQ(0, bind(fd, reinterpret_cast<const struct sockaddr*>(&sad), sad_length));
+  EXPECT_EQ(0, listen(fd, 16));
+  return fd;
+}
+
+bool IsOpen(int fd)
+{
+  return (fcntl(fd, F_GETFD) != -1);
+}
+
+}
+
+TEST(SocketHandOff, TestSendAndReceiveListenSockets)
+{
+  const util::cIPAddress host(127, 0, 0, 1);
+  const int listen_socket = OpenTCPListeningSocket(host, 18340);
+
+  int pair[2] = { -1, -1 };
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair));
+
+  EXPECT_TRUE(tasktracker::SendListenSockets(pair[0], { listen_socket }));
+
+  std::vector<int> received;
+  EXPECT_TRUE(tasktracker::ReceiveListenSockets(pair[1], received));
+  ASSERT_EQ(1u, received.size());
+
+  // We get a new file descriptor for the same socket
+  EXPECT_NE(listen_socket, received[0]);
+  std::vector<tasktracker::cListenEndpoint> endpoints = { tasktracker::cListenEndpoint(host, 18340) };
+  tasktracker::AssignListenSockets(received, endpoints);
+  EXPECT_TRUE(received.empty());
+  EXPECT_NE(-1, endpoints[0].listen_socket);
+
+  // The ready message
+  EXPECT_TRUE(tasktracker::SendHandOffReady(pair[1]));
+  char ready = 0;
+  EXPECT_EQ(1, recv(pair[0], &ready, 1, 0));
+
+  // The peer going away without sending anything is an error
+  close(pair[1]);
+  EXPECT_FALSE(tasktracker::ReceiveListenSockets(pair[0], received));
+  EXPECT_TRUE(received.empty());
+
+  close(pair[0]);
+  close(endpoints[0].listen_socket);
+  close(listen_socket);
+}
+
+TEST(SocketHandOff, TestAssignListenSockets)
+{
+  const util::cIPAddress host(127, 0, 0, 1);
+  const std::string path = (std::filesystem::temp_directory_path() / "task_tracker_handoff_unit_test.sock").string();
+
+  const int tcp_socket = OpenTCPListeningSocket(host, 18341);
+  const int unix_socket = tasktracker::OpenUnixListeningSocket(path, 16);
+  ASSERT_NE(-1, unix_socket);
+  const int unmatched_socket = OpenTCPListeningSocket(host, 18342);
+  const int not_listening_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  std::vector<tasktracker::cListenEndpoint> endpoints = {
+    tasktracker::cListenEndpoint(path),
+    tasktracker::cListenEndpoint(host, 18343),
+    tasktracker::cListenEndpoint(host, 18341),
+  };
+
+  std::vector<int> sockets = { tcp_socket, unix_socket, unmatched_socket, not_listening_socket };
+  tasktracker::AssignListenSockets(sockets, endpoints);
+  EXPECT_TRUE(sockets.empty());
+
+  EXPECT_EQ(unix_socket, endpoints[0].listen_socket);
+  EXPECT_EQ(-1, endpoints[1].listen_socket); // Nothing was inherited for this endpoint so it creates its own socket
+  EXPECT_EQ(tcp_socket, endpoints[2].listen_socket);
+
+  // The sockets that didn't match an endpoint are closed
+  EXPECT_TRUE(IsOpen(tcp_socket));
+  EXPECT_TRUE(IsOpen(unix_socket));
+  EXPECT_FALSE(IsOpen(unmatched_socket));
+  EXPECT_FALSE(IsOpen(not_listening_socket));
+
+  close(tcp_socket);
+  close(unix_socket);
+  tasktracker::RemoveUnixListeningSocket(path);
+}
+
+TEST(SocketHandOff, TestGetSystemdListenSockets)
+{
+  // Not socket activated
+  unsetenv("LISTEN_PID");
+  unsetenv("LISTEN_FDS");
+  EXPECT_TRUE(tasktracker::GetSystemdListenSockets().empty());
+
+  // The sockets were meant for another process, the variables are removed either way
+  const std::string other_pid = std::to_string(getpid() + 1);
+  setenv("LISTEN_PID", other_pid.c_str(), 1);
+  setenv("LISTEN_FDS", "1", 1);
+  EXPECT_TRUE(tasktracker::GetSystemdListenSockets().empty());
+  EXPECT_EQ(nullptr, getenv("LISTEN_PID"));
+  EXPECT_EQ(nullptr, getenv("LISTEN_FDS"));
+
+  // Invalid values
+  const std::string pid = std::to_string(getpid());
+  setenv("LISTEN_PID", pid.c_str(), 1);
+  setenv("LISTEN_FDS", "one", 1);
+  EXPECT_TRUE(tasktracker::GetSystemdListenSockets().empty());
+}
+
+TEST(SocketHandOff, TestHandOffStopsFeedUpdatesFirst)
+{
+  const util::cIPAddress host(127, 0, 0, 1);
+  const int listen_socket = OpenTCPListeningSocket(host, 18344);
+
+  const std::filesystem::path folder = std::filesystem::temp_directory_path() / "task_tracker_handoff_unit_test";
+  std::filesystem::remove_all(folder);
+  ASSERT_TRUE(std::filesystem::create_directory(folder));
+  const std::filesystem::path saved_path = folder / "saved";
+  const std::filesystem::path seen_path = folder / "seen";
+
+  // The "new process" records whether the feed data had been saved by the time it started, then exits without taking over
+  const std::filesystem::path executable_path = folder / "task-trackerd";
+  {
+    std::ofstream executable(executable_path);
+    executable<<"#!/bin/sh\n[ -f \""<<saved_path.string()<<"\" ] && touch \""<<seen_path.string()<<"\"\nexit 0\n";
+  }
+  std::filesystem::permissions(executable_path, std::filesystem::perms::owner_all);
+  tasktracker::SetHandOffExecutablePath(executable_path.string());
+
+  size_t calls = 0;
+  const auto before_start = [&calls, &saved_path]() {
+    calls++;
+    std::ofstream saved(saved_path);
+  };
+
+  // The new process didn't take over so we keep our listening socket
+  EXPECT_FALSE(tasktracker::HandOffListenSockets({ listen_socket }, before_start));
+  EXPECT_EQ(1, calls);
+  EXPECT_TRUE(std::filesystem::exists(seen_path));
+  EXPECT_TRUE(IsOpen(listen_socket));
+
+  close(listen_socket);
+  std::filesystem::remove_all(folder);
+}
@@ -0,0 +1,56 @@
+#include <string>
+#include <vector>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "token_table.h"
+
+TEST(TaskTracker, TestTokenTable)
+{
+  tasktracker::cTokenTable table;
+
+  // An empty table doesn't match anything
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find("anything"));
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find(""));
+
+  const std::vector<std::string> tokens = {
+    "u5ekFC43AFJMl1uidPJYM9P0D8uibgnvZxbk0QsAlPgoeSDxivonEL1NZ3DXQzzB",
+    "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB",
+    "short",
+    "a",
+    "b",
+  };
+  ASSERT_TRUE(table.Create(tokens));
+  EXPECT_EQ(tokens.size(), table.size());
+
+  // Each token maps to its index in the list
+  for (size_t i = 0; i < tokens.size(); i++) {
+    EXPECT_EQ(i, table.Find(tokens[i]));
+  }
+
+  // Prefixes, extensions and near misses don't match
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find(""));
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find("shor"));
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find("shortt"));
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find("Short"));
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find("u5ekFC43AFJMl1uidPJYM9P0D8uibgnvZxbk0QsAlPgoeSDxivonEL1NZ3DXQzzC"));
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find("c"));
+
+  // Duplicate and empty tokens are rejected
+  EXPECT_FALSE(table.Create({ "a", "b", "a" }));
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find("a"));
+  EXPECT_FALSE(table.Create({ "a", "" }));
+
+  // Lots of tokens still all map to the right index
+  std::vector<std::string> many_tokens;
+  for (size_t i = 0; i < 1000; i++) {
+    many_tokens.push_back("token" + std::to_string(i));
+  }
+  ASSERT_TRUE(table.Create(many_tokens));
+  for (size_t i = 0; i < many_tokens.size(); i++) {
+    EXPECT_EQ(i, table.Find(many_tokens[i]));
+  }
+  EXPECT_EQ(tasktracker::cTokenTable::npos, table.Find("token1000"));
+}
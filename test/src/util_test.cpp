@@ -10,32 +10,47 @@ TEST(Util, TestIPAddress)
   {
     // Test default constructor
     util::cIPAddress address;
-    EXPECT_EQ(0, address.octet0);
-    EXPECT_EQ(0, address.octet1);
-    EXPECT_EQ(0, address.octet2);
-    EXPECT_EQ(0, address.octet3);
+    EXPECT_TRUE(address.IsIPv4());
+    EXPECT_EQ(0, address.bytes[0]);
+    EXPECT_EQ(0, address.bytes[1]);
+    EXPECT_EQ(0, address.bytes[2]);
+    EXPECT_EQ(0, address.bytes[3]);
   }
   {
     // Test constructor and clear
     util::cIPAddress address(1,2,3,4);
-    EXPECT_EQ(1, address.octet0);
-    EXPECT_EQ(2, address.octet1);
-    EXPECT_EQ(3, address.octet2);
-    EXPECT_EQ(4, address.octet3);
+    EXPECT_TRUE(address.IsIPv4());
+    EXPECT_EQ(1, address.bytes[0]);
+    EXPECT_EQ(2, address.bytes[1]);
+    EXPECT_EQ(3, address.bytes[2]);
+    EXPECT_EQ(4, address.bytes[3]);
 
     address.Clear();
-    EXPECT_EQ(0, address.octet0);
-    EXPECT_EQ(0, address.octet1);
-    EXPECT_EQ(0, address.octet2);
-    EXPECT_EQ(0, address.octet3);
+    EXPECT_EQ(0, address.bytes[0]);
+    EXPECT_EQ(0, address.bytes[1]);
+    EXPECT_EQ(0, address.bytes[2]);
+    EXPECT_EQ(0, address.bytes[3]);
+  }
+  {
+    // Test the IPv6 constructor
+    util::cIPAddress address(std::array<uint8_t, 16>{ 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 });
+    EXPECT_TRUE(address.IsIPv6());
+    EXPECT_EQ(0x20, address.bytes[0]);
+    EXPECT_EQ(1, address.bytes[15]);
+
+    address.Clear();
+    EXPECT_TRUE(address.IsIPv4());
+    EXPECT_TRUE(address.IsAny());
   }
   {
     // Test IsValid
     util::cIPAddress all_zeroes(0,0,0,0);
     EXPECT_FALSE(all_zeroes.IsValid());
+    EXPECT_TRUE(all_zeroes.IsAny());
 
     util::cIPAddress valid_10_range(10,1,2,3);
     EXPECT_TRUE(valid_10_range.IsValid());
+    EXPECT_FALSE(valid_10_range.IsAny());
 
     util::cIPAddress valid_172_16_range(172,16,2,3);
     EXPECT_TRUE(valid_172_16_range.IsValid());
@@ -45,6 +60,21 @@ TEST(Util, TestIPAddress)
 
     util::cIPAddress valid_127_0_0_1(127,0,0,1);
     EXPECT_TRUE(valid_127_0_0_1.IsValid());
+
+    util::cIPAddress address;
+    ASSERT_TRUE(util::ParseAddress("::", address));
+    EXPECT_FALSE(address.IsValid());
+    EXPECT_TRUE(address.IsAny());
+    ASSERT_TRUE(util::ParseAddress("::1", address));
+    EXPECT_TRUE(address.IsValid());
+    ASSERT_TRUE(util::ParseAddress("2001:db8::3", address));
+    EXPECT_TRUE(address.IsValid());
+    ASSERT_TRUE(util::ParseAddress("fd12:3456::3", address));
+    EXPECT_TRUE(address.IsValid());
+    ASSERT_TRUE(util::ParseAddress("fe80::1", address));
+    EXPECT_FALSE(address.IsValid());
+    ASSERT_TRUE(util::ParseAddress("ff02::1", address));
+    EXPECT_FALSE(address.IsValid());
   }
 
   {
@@ -60,25 +90,80 @@ TEST(Util, TestIPAddress)
     EXPECT_FALSE(util::ParseAddress("1,2,3,4", address));
     EXPECT_FALSE(util::ParseAddress("1024.1024.1024.1024", address));
     EXPECT_FALSE(util::ParseAddress("-1024.-1024.-1024.-1024", address));
+    EXPECT_FALSE(util::ParseAddress("1.2.3.4 ", address));
+    EXPECT_FALSE(util::ParseAddress("01.2.3.4", address));
+    EXPECT_FALSE(util::ParseAddress("1.2.3", address));
+
+    EXPECT_FALSE(util::ParseAddress(":", address));
+    EXPECT_FALSE(util::ParseAddress(":::", address));
+    EXPECT_FALSE(util::ParseAddress("1::2::3", address));
+    EXPECT_FALSE(util::ParseAddress(":1::2", address));
+    EXPECT_FALSE(util::ParseAddress("1::2:", address));
+    EXPECT_FALSE(util::ParseAddress("12345::1", address));
+    EXPECT_FALSE(util::ParseAddress("1:2:3:4:5:6:7", address));
+    EXPECT_FALSE(util::ParseAddress("1:2:3:4:5:6:7:8:9", address));
+    EXPECT_FALSE(util::ParseAddress("1:2:3:4:5:6:7::8", address));
+    EXPECT_FALSE(util::ParseAddress("g::1", address));
+    EXPECT_FALSE(util::ParseAddress("[::1]", address));
+    EXPECT_FALSE(util::ParseAddress("::ffff:1.2.3", address));
+    EXPECT_FALSE(util::ParseAddress("1:2:3:4:5:6:7:1.2.3.4", address));
 
     // Valid addresses
     EXPECT_TRUE(util::ParseAddress("1.2.3.4", address));
-    EXPECT_EQ(1, address.octet0);
-    EXPECT_EQ(2, address.octet1);
-    EXPECT_EQ(3, address.octet2);
-    EXPECT_EQ(4, address.octet3);
+    EXPECT_EQ(util::cIPAddress(1, 2, 3, 4), address);
 
     EXPECT_TRUE(util::ParseAddress("192.168.1.2", address));
-    EXPECT_EQ(192, address.octet0);
-    EXPECT_EQ(168, address.octet1);
-    EXPECT_EQ(1, address.octet2);
-    EXPECT_EQ(2, address.octet3);
+    EXPECT_EQ(util::cIPAddress(192, 168, 1, 2), address);
 
     EXPECT_TRUE(util::ParseAddress("252.253.254.255", address));
-    EXPECT_EQ(252, address.octet0);
-    EXPECT_EQ(253, address.octet1);
-    EXPECT_EQ(254, address.octet2);
-    EXPECT_EQ(255, address.octet3);
+    EXPECT_EQ(util::cIPAddress(252, 253, 254, 255), address);
+
+    EXPECT_TRUE(util::ParseAddress("::", address));
+    EXPECT_EQ(util::cIPAddress(std::array<uint8_t, 16>{ 0 }), address);
+
+    EXPECT_TRUE(util::ParseAddress("::1", address));
+    EXPECT_EQ(util::cIPAddress(std::array<uint8_t, 16>{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }), address);
+
+    EXPECT_TRUE(util::ParseAddress("2001:DB8::8:800:200C:417A", address));
+    EXPECT_EQ(util::cIPAddress(std::array<uint8_t, 16>{ 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0x08, 0x08, 0x00, 0x20, 0x0c, 0x41, 0x7a }), address);
+
+    EXPECT_TRUE(util::ParseAddress("1:2:3:4:5:6:7:8", address));
+    EXPECT_EQ(util::cIPAddress(std::array<uint8_t, 16>{ 0, 1, 0, 2, 0, 3, 0, 4, 0, 5, 0, 6, 0, 7, 0, 8 }), address);
+
+    EXPECT_TRUE(util::ParseAddress("1::", address));
+    EXPECT_EQ(util::cIPAddress(std::array<uint8_t, 16>{ 0, 1 }), address);
+
+    EXPECT_TRUE(util::ParseAddress("::ffff:192.168.0.3", address));
+    EXPECT_EQ(util::cIPAddress(std::array<uint8_t, 16>{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 192, 168, 0, 3 }), address);
+  }
+
+  {
+    // Test ParseAddressAndPort
+    util::cIPAddress address;
+    uint16_t port = 0;
+
+    EXPECT_FALSE(util::ParseAddressAndPort("", address, port));
+    EXPECT_FALSE(util::ParseAddressAndPort("1.2.3.4", address, port));
+    EXPECT_FALSE(util::ParseAddressAndPort("1.2.3.4:", address, port));
+    EXPECT_FALSE(util::ParseAddressAndPort("1.2.3.4:0", address, port));
+    EXPECT_FALSE(util::ParseAddressAndPort("1.2.3.4:65536", address, port));
+    EXPECT_FALSE(util::ParseAddressAndPort("::1:8443", address, port));
+    EXPECT_FALSE(util::ParseAddressAndPort("[::1]", address, port));
+    EXPECT_FALSE(util::ParseAddressAndPort("[::1]8443", address, port));
+    EXPECT_FALSE(util::ParseAddressAndPort("[1.2.3.4]:8443", address, port));
+
+    EXPECT_TRUE(util::ParseAddressAndPort("192.168.0.3:8443", address, port));
+    EXPECT_EQ(util::cIPAddress(192, 168, 0, 3), address);
+    EXPECT_EQ(8443, port);
+
+    EXPECT_TRUE(util::ParseAddressAndPort("[::]:443", address, port));
+    EXPECT_TRUE(address.IsIPv6());
+    EXPECT_TRUE(address.IsAny());
+    EXPECT_EQ(443, port);
+
+    EXPECT_TRUE(util::ParseAddressAndPort("[2001:db8::3]:65535", address, port));
+    EXPECT_STREQ("2001:db8::3", util::ToString(address).c_str());
+    EXPECT_EQ(65535, port);
   }
 
   {
@@ -87,5 +172,122 @@ TEST(Util, TestIPAddress)
     EXPECT_STREQ("192.168.12.34", util::ToString(util::cIPAddress(192, 168, 12, 34)).c_str());
     EXPECT_STREQ("252.253.254.255", util::ToString(util::cIPAddress(252, 253, 254, 255)).c_str());
     EXPECT_STREQ("0.0.0.0", util::ToString(util::cIPAddress(0, 0, 0, 0)).c_str());
+
+    // IPv6 addresses are written in the RFC 5952 form
+    const char* canonical[] = {
+      "::",
+      "::1",
+      "1::",
+      "2001:db8::1",
+      "2001:db8:0:1:1:1:1:1", // A single zero word isn't compressed
+      "2001:0:0:1::1", // The longest run is compressed
+      "2001:db8::1:0:0:1", // The first run wins a tie
+      "1:2:3:4:5:6:7:8",
+      "fe80::abcd:ef01",
+      "::ffff:192.168.0.3",
+    };
+    for (const char* text : canonical) {
+      util::cIPAddress address;
+      ASSERT_TRUE(util::ParseAddress(text, address)) << text;
+      EXPECT_STREQ(text, util::ToString(address).c_str());
+    }
+
+    util::cIPAddress address;
+    ASSERT_TRUE(util::ParseAddress("2001:0DB8:0000:0000:0000:0000:0000:0001", address));
+    EXPECT_STREQ("2001:db8::1", util::ToString(address).c_str());
+  }
+
+  {
+    // Test FromSockAddr, it is the reverse of ToSockAddr
+    struct sockaddr_storage sad;
+    util::cIPAddress address;
+
+    util::ToSockAddr(util::cIPAddress(192, 168, 0, 3), 8443, sad);
+    ASSERT_TRUE(util::FromSockAddr(reinterpret_cast<const struct sockaddr*>(&sad), address));
+    EXPECT_EQ(util::cIPAddress(192, 168, 0, 3), address);
+
+    util::cIPAddress ipv6;
+    ASSERT_TRUE(util::ParseAddress("2001:db8::3", ipv6));
+    util::ToSockAddr(ipv6, 8443, sad);
+    ASSERT_TRUE(util::FromSockAddr(reinterpret_cast<const struct sockaddr*>(&sad), address));
+    EXPECT_EQ(ipv6, address);
+
+    // IPv4 mapped addresses from a dual stack socket become IPv4 addresses
+    ASSERT_TRUE(util::ParseAddress("::ffff:192.168.0.3", ipv6));
+    util::ToSockAddr(ipv6, 8443, sad);
+    ASSERT_TRUE(util::FromSockAddr(reinterpret_cast<const struct sockaddr*>(&sad), address));
+    EXPECT_EQ(util::cIPAddress(192, 168, 0, 3), address);
+
+    sad.ss_family = AF_UNIX;
+    EXPECT_FALSE(util::FromSockAddr(reinterpret_cast<const struct sockaddr*>(&sad), address));
+    EXPECT_FALSE(util::FromSockAddr(nullptr, address));
   }
+
+  {
+    // Test ParseNetwork
+    util::cIPNetwork network;
+    ASSERT_TRUE(util::ParseNetwork("192.168.0.0/16", network));
+    EXPECT_EQ(util::cIPAddress(192, 168, 0, 0), network.address);
+    EXPECT_EQ(16, network.prefix_length);
+    EXPECT_STREQ("192.168.0.0/16", util::ToString(network).c_str());
+
+    // The bits after the prefix are cleared
+    ASSERT_TRUE(util::ParseNetwork("172.16.5.3/12", network));
+    EXPECT_STREQ("172.16.0.0/12", util::ToString(network).c_str());
+
+    // An address on its own is a network of one address
+    ASSERT_TRUE(util::ParseNetwork("10.0.0.1", network));
+    EXPECT_STREQ("10.0.0.1/32", util::ToString(network).c_str());
+
+    ASSERT_TRUE(util::ParseNetwork("2001:db8:abcd::1/33", network));
+    EXPECT_TRUE(network.address.IsIPv6());
+    EXPECT_STREQ("2001:db8:8000::/33", util::ToString(network).c_str());
+    ASSERT_TRUE(util::ParseNetwork("::/0", network));
+    EXPECT_STREQ("::/0", util::ToString(network).c_str());
+
+    EXPECT_FALSE(util::ParseNetwork("", network));
+    EXPECT_FALSE(util::ParseNetwork("192.168.0.0/", network));
+    EXPECT_FALSE(util::ParseNetwork("192.168.0.0/33", network));
+    EXPECT_FALSE(util::ParseNetwork("192.168.0.0/016", network));
+    EXPECT_FALSE(util::ParseNetwork("192.168.0.0/-1", network));
+    EXPECT_FALSE(util::ParseNetwork("2001:db8::/129", network));
+    EXPECT_FALSE(util::ParseNetwork("[2001:db8::]/32", network));
+    EXPECT_FALSE(util::ParseNetwork("/8", network));
+
+    // Test Contains
+    ASSERT_TRUE(util::ParseNetwork("172.16.0.0/12", network));
+    EXPECT_TRUE(network.Contains(util::cIPAddress(172, 16, 0, 1)));
+    EXPECT_TRUE(network.Contains(util::cIPAddress(172, 31, 255, 255)));
+    EXPECT_FALSE(network.Contains(util::cIPAddress(172, 32, 0, 0)));
+
+    util::cIPAddress ipv6;
+    ASSERT_TRUE(util::ParseAddress("2001:db8::1", ipv6));
+    EXPECT_FALSE(network.Contains(ipv6));
+    ASSERT_TRUE(util::ParseNetwork("2001:db8::/32", network));
+    EXPECT_TRUE(network.Contains(ipv6));
+    EXPECT_FALSE(network.Contains(util::cIPAddress(32, 1, 13, 184)));
+  }
+}
+
+TEST(Util, TestDateTimeHTTP)
+{
+  // Test GetDateTimeHTTP
+  EXPECT_STREQ("Thu, 01 Jan 1970 00:00:00 GMT", util::GetDateTimeHTTP(std::chrono::system_clock::time_point()).c_str());
+  EXPECT_STREQ("Sun, 02 Feb 2025 12:04:54 GMT", util::GetDateTimeHTTP(std::chrono::system_clock::time_point(std::chrono::milliseconds(1738497894544))).c_str());
+
+  // Test ParseDateTimeHTTP
+  std::chrono::system_clock::time_point value;
+  EXPECT_TRUE(util::ParseDateTimeHTTP("Sun, 06 Nov 1994 08:49:37 GMT", value));
+  EXPECT_EQ(784111777, std::chrono::duration_cast<std::chrono::seconds>(value.time_since_epoch()).count());
+  EXPECT_TRUE(util::ParseDateTimeHTTP("Sun, 02 Feb 2025 12:04:54 GMT", value));
+  EXPECT_EQ(1738497894, std::chrono::duration_cast<std::chrono::seconds>(value.time_since_epoch()).count());
+
+  // Obsolete and invalid formats
+  EXPECT_FALSE(util::ParseDateTimeHTTP("", value));
+  EXPECT_FALSE(util::ParseDateTimeHTTP("Sunday, 06-Nov-94 08:49:37 GMT", value));
+  EXPECT_FALSE(util::ParseDateTimeHTTP("Sun Nov  6 08:49:37 1994", value));
+  EXPECT_FALSE(util::ParseDateTimeHTTP("Sun, 06 Abc 1994 08:49:37 GMT", value));
+  EXPECT_FALSE(util::ParseDateTimeHTTP("Sun, 32 Nov 1994 08:49:37 GMT", value));
+  EXPECT_FALSE(util::ParseDateTimeHTTP("Sun, 06 Nov 1994 25:49:37 GMT", value));
+  EXPECT_FALSE(util::ParseDateTimeHTTP("Sun, 06 Nov 1994 08:49:37 UTC", value));
 }
@@ -1,5 +1,12 @@
 #include <memory.h>
-
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -8,13 +15,21 @@
 #include <string>
 #include <thread>
 
+#include <gnutls/gnutls.h>
+#include <gnutls/x509.h>
+
 // gtest headers
 #include <gtest/gtest.h>
 
 // Application headers
-#include "gnutlsmm.h"
-#include "poll_helper.h"
+#include "feed_data.h"
+#include "feed_events.h"
+#include "https_client.h"
+#include "io_uring_web_server.h"
+#include "self_signed_certificate.h"
+#include "socket_handoff.h"
 #include "tcp_connection.h"
+#include "unix_socket.h"
 #include "util.h"
 #include "web_server.h"
 
@@ -23,28 +38,15 @@ namespace {
 const util::cIPAddress host(127, 0, 0, 1);
 const uint16_t port = 18302;
 
-const size_t BUFFER_LENGTH = 4 * 1024; // 4k read buffer
-
-bool string_to_int(const std::string& s, unsigned long int& out_value, int base = 0)
+// The web server backends that can run here, io_uring may be disabled in the kernel or not compiled in
+std::vector<tasktracker::BACKEND> GetAvailableBackends()
 {
-  if (s.empty()) {
-    return false;
-  }
-
-  char* end = nullptr;
-  out_value = std::strtoul(s.c_str(), &end, base);
-
-  if (errno == ERANGE) {
-    // Invalid number
-    return false;
-  }
-
-  if (*end != '\0') {
-    // Invalid string
-    return false;
+  std::vector<tasktracker::BACKEND> backends = { tasktracker::BACKEND::LIBMICROHTTPD };
+  if (tasktracker::IsIOUringWebServerAvailable()) {
+    backends.push_back(tasktracker::BACKEND::IO_URING);
   }
 
-  return true;
+  return backends;
 }
 
 size_t GetFileSizeBytes(const std::string& sFilePath)
@@ -77,332 +79,184 @@ bool ReadFileIntoVector(const std::string& sFilePath, std::vector<char>& content
   return true;
 }
 
-}
-
+// Returns the DER encoded certificate that the server presents in the TLS handshake, or an empty string if the handshake failed
+std::string GetServerCertificate(uint16_t port)
+{
+  tcp_connection connection;
+  if (!connection.connect(host, port)) {
+    return "";
+  }
 
-class WebServerTest : public testing::Test {
-protected:
-  void SetUp() override;
-  void TearDown() override;
+  gnutls_certificate_credentials_t credentials = nullptr;
+  gnutls_certificate_allocate_credentials(&credentials);
+
+  gnutls_session_t session = nullptr;
+  gnutls_init(&session, GNUTLS_CLIENT);
+  gnutls_set_default_priority(session);
+  gnutls_credentials_set(session, GNUTLS_CRD_CERTIFICATE, credentials);
+  gnutls_transport_set_int(session, connection.get_sd());
+  gnutls_handshake_set_timeout(session, 2000);
+
+  std::string certificate;
+  if (gnutls_handshake(session) == GNUTLS_E_SUCCESS) {
+    unsigned int count = 0;
+    const gnutls_datum_t* certificates = gnutls_certificate_get_peers(session, &count);
+    if ((certificates != nullptr) && (count != 0)) {
+      certificate.assign(reinterpret_cast<const char*>(certificates[0].data), certificates[0].size);
+    }
+    gnutls_bye(session, GNUTLS_SHUT_WR);
+  }
 
-  tasktracker::cWebServerManager web_server_manager;
-};
+  gnutls_deinit(session);
+  gnutls_certificate_free_credentials(credentials);
 
-void WebServerTest::SetUp()
-{
-  // Create the web server
-  const bool fuzzing = false;
-  if (!web_server_manager.Create(host, port, "./test/configuration/unit_test_server.key", "./test/configuration/unit_test_server.crt", fuzzing, "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB")) {
-    std::cerr<<"Error creating web server"<<std::endl;
-  }
+  return certificate;
 }
 
-void WebServerTest::TearDown()
+// Returns the DER encoding of the certificate in a PEM file
+std::string ReadCertificate(const std::string& public_cert)
 {
-  std::cout<<"Shutting down server"<<std::endl;
-  if (!web_server_manager.Destroy()) {
-    std::cerr<<"Error destroying web server"<<std::endl;
+  std::vector<char> contents;
+  if (!ReadFileIntoVector(public_cert, contents)) {
+    return "";
   }
-}
 
+  gnutls_x509_crt_t crt = nullptr;
+  gnutls_x509_crt_init(&crt);
 
+  std::string certificate;
+  const gnutls_datum_t pem = { reinterpret_cast<unsigned char*>(contents.data()), static_cast<unsigned int>(contents.size()) };
+  gnutls_datum_t der = { nullptr, 0 };
+  if ((gnutls_x509_crt_import(crt, &pem, GNUTLS_X509_FMT_PEM) == GNUTLS_E_SUCCESS) && (gnutls_x509_crt_export2(crt, GNUTLS_X509_FMT_DER, &der) == GNUTLS_E_SUCCESS)) {
+    certificate.assign(reinterpret_cast<const char*>(der.data), der.size);
+    gnutls_free(der.data);
+  }
 
-int GnuTLSPullTimeOutCallback(gnutls_transport_ptr_t, unsigned int ms)
-{
-  (void)ms;
-  return 0;
-}
+  gnutls_x509_crt_deinit(crt);
 
-class cHTTPHeaders {
-public:
-  cHTTPHeaders() :
-    response_code(0),
-    content_length(0)
-  {
-  }
+  return certificate;
+}
 
-  void Clear()
-  {
-    response_code = 0;
-    content_type.clear();
-    content_length = 0;
+// Send a plain HTTP/1.0 request on a connected socket and return the status code, or 0 if there was no response
+uint16_t PerformPlainGetRequest(int sd, std::string_view url)
+{
+  const std::string request = "GET " + std::string(url) + " HTTP/1.0\r\n\r\n";
+  if (::send(sd, request.data(), request.size(), 0) != ssize_t(request.size())) {
+    return 0;
   }
 
-  uint16_t response_code;
-  std::string content_type;
-  size_t content_length;
-  std::map<std::string, std::string> raw_headers;
-};
-
-class cHTTPResponse {
-public:
-  void Clear()
-  {
-    headers.Clear();
-    content.clear();
+  // The server closes the connection after the response
+  std::string received;
+  char buffer[4096];
+  ssize_t length = 0;
+  while ((length = ::recv(sd, buffer, sizeof(buffer), 0)) > 0) {
+    received.append(buffer, length);
   }
 
   cHTTPHeaders headers;
-  std::vector<char> content;
-};
+  return ParseHeaders(received, headers) ? headers.response_code : 0;
+}
 
-bool ParseHeaders(std::string_view text, cHTTPHeaders& headers)
+uint16_t PerformPlainGetRequest(const util::cIPAddress& address, uint16_t port, std::string_view url)
 {
-  //std::cout<<"ParseHeaders"<<std::endl;
-
-  headers.Clear();
-
-  if (text.empty()) {
-    return false;
+  tcp_connection connection;
+  if (!connection.connect(address, port)) {
+    return 0;
   }
 
-  // Parse the HTTP header
-  // Headers: HTTP/1.1 200 OK
-  {
-    //std::cout<<"a"<<std::endl;
-    const size_t new_line = text.find("\r\n");
-    if (new_line == std::string_view::npos) {
-      return false;
-    }
-
-    //std::cout<<"b"<<std::endl;
-    const size_t space1 = text.find(' ');
-    if (space1 == std::string_view::npos) {
-      return false;
-    }
-
-    //std::cout<<"c"<<std::endl;
-    const size_t space2 = text.find(' ', space1 + 1);
-    if (space2 == std::string_view::npos) {
-      return false;
-    }
-
-    //std::cout<<"d space1: "<<space1<<", space2: "<<space2<<std::endl;
-    // Parse the response code
-    const std::string_view str_value(text.substr(space1, space2 - space1));
-    //std::cout<<"Response code text: "<<str_value<<std::endl;
-    unsigned long int value = 0;
-    if (!string_to_int(std::string(str_value), value)) {
-      return false;
-    }
-
-    if (value > UINT16_MAX) {
-      return false;
-    }
-
-    headers.response_code = uint16_t(value);
-
-    text.remove_prefix(new_line + 2);
-  }
+  return PerformPlainGetRequest(connection.get_sd(), url);
+}
 
-  // Parse the remaining headers
-  // Date: Sat, 06 Apr 2024 04:55:51 GMT
-  // Connection: close
-  // Content-Type: text/html
-  // Content-Length: 2330
-  while (!text.empty()) {
-    const size_t new_line = text.find("\r\n");
-    if (new_line == std::string_view::npos) {
-      break;
-    }
+// Keep receiving until text arrives, the connection is closed, or nothing arrives for 5 seconds
+bool ReceiveUntil(int sd, std::string_view text, std::string& out_received)
+{
+  struct timeval timeout = { 5, 0 };
+  setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 
-    const size_t colon = text.find(':');
-    if (colon == std::string_view::npos) {
+  char buffer[4096];
+  while (out_received.find(text) == std::string::npos) {
+    const ssize_t length = ::recv(sd, buffer, sizeof(buffer), 0);
+    if (length <= 0) {
       return false;
     }
-
-    const std::string_view key{text.substr(0, colon)};
-    const std::string_view str_value{text.substr(colon + 2, new_line - (colon + 2))};
-    //std::cout<<"key: "<<key<<", str_value: "<<str_value<<std::endl;
-    if (key == "Content-Type") {
-      headers.content_type = str_value;
-    } else if (key == "Content-Length") {
-      unsigned long int value = 0;
-      if (!string_to_int(std::string(str_value), value)) {
-        return false;
-      }
-
-      headers.content_length = value;
-    } else {
-      headers.raw_headers[std::string(key)] = std::string(str_value);
-    }
-
-    text.remove_prefix(new_line + 2);
+    out_received.append(buffer, length);
   }
 
-  return (
-    (headers.response_code != 0) &&
-    !headers.content_type.empty()
-  );
+  return true;
 }
 
-
-bool GnuTLSPerformRequest(std::string_view request, uint16_t port, std::string_view user_agent, std::string_view server_certificate_path, cHTTPResponse& out_response)
+// Start an event stream on a connected socket, the headers are left in out_received
+bool OpenEventStream(int sd, std::string_view url, std::string_view last_event_id, std::string& out_received)
 {
-  //std::cout<<"GnuTLSPerformRequest Connecting to "<<util::ToString(host)<<":"<<port<<std::endl;
-
-  out_response.Clear();
-
-  tcp_connection connection;
-
-  gnutlsmm::client_session session;
-
-  session.init(GNUTLS_NONBLOCK);
-
-  // X509 stuff
-  gnutlsmm::certificate_credentials credentials;
-
-  credentials.init();
-
-  // Set the trusted ca file
-  credentials.set_x509_trust_file(server_certificate_path.data(), GNUTLS_X509_FMT_PEM);
-
-  // Put the x509 credentials to the current session
-  session.set_credentials(credentials);
-
-  // Set TLS version and cypher priorities
-  // https://gnutls.org/manual/html_node/Priority-Strings.html
-  // NOTE: No SSL, only TLS1.2
-  // TODO: TLS1.3 didn't seem to work, server dependent?
-  //session.set_priority ("NORMAL:+SRP:+SRP-RSA:+SRP-DSS:-DHE-RSA:-VERS-SSL3.0:%SAFE_RENEGOTIATION:%LATEST_RECORD_VERSION", nullptr);
-  session.set_priority("SECURE128:+SECURE192:-VERS-ALL:+VERS-TLS1.2:%SAFE_RENEGOTIATION", nullptr);
-
-  // connect to the peer
-  connection.connect(host, port);
-  session.set_transport_ptr((gnutls_transport_ptr_t)(ptrdiff_t)connection.get_sd());
-
-  // NOTE: TO use a timeout we need to provide a callback function, but becuase we pass GNUTLS_NONBLOCK to init above, then the callback is not called
-  session.set_transport_timeout_with_pull_timeout_function(500, GnuTLSPullTimeOutCallback);
-
-  // Perform the TLS handshake
-  //std::cout<<"GnuTLSPerformRequestPerforming handshake" << std::endl;
-  const int result = session.handshake();
-  if (result < 0) {
-    std::cerr<<"GnuTLSPerformRequest Handshake failed, error "<<std::to_string(result)<<std::endl;
+  // NOTE: HTTP/1.0 so that the stream isn't chunked
+  std::string request = "GET " + std::string(url) + " HTTP/1.0\r\n";
+  if (!last_event_id.empty()) {
+    request += "Last-Event-ID: " + std::string(last_event_id) + "\r\n";
+  }
+  request += "\r\n";
+  if (::send(sd, request.data(), request.size(), 0) != ssize_t(request.size())) {
     return false;
   }
 
-  //std::cout<<"GnuTLSPerformRequest Handshake completed" << std::endl;
-
-  //std::cout<<"GnuTLSPerformRequest Sending HTTP request" << std::endl;
-  session.send(request.data(), request.length());
-
-  //std::cout<<"GnuTLSPerformRequest Reading response" << std::endl;
-
-  // For debugging
-  //std::ofstream ofs("output.html", std::ofstream::trunc);
-
-  char buffer[BUFFER_LENGTH + 1];
-
-  poll_read p(connection.get_sd());
-
-  const int timeout_ms = 2000;
-
-  // Once we start not receiving data we retry 10 times in 100ms and then exit
-  size_t no_bytes_retries = 0;
-  const size_t max_no_bytes_retries = 10;
-  const size_t retries_timeout_ms = 10;
-
-  std::vector<char> received_so_far;
-
-  bool reading_headers = true;
+  return ReceiveUntil(sd, "\r\n\r\n", out_received);
+}
 
-  // NOTE: gnutls_record_recv may return GNUTLS_E_PREMATURE_TERMINATION
-  // https://lists.gnupg.org/pipermail/gnutls-help/2014-May/003455.html
-  // This means the peer has terminated the TLS session using a TCP RST (i.e., called close()).
-  // Since gnutls cannot distinguish that termination from an attacker terminating the session it warns you with this error code.
+uint16_t PerformUnixSocketGetRequest(const std::string& path, std::string_view url)
+{
+  struct sockaddr_un sad;
+  memset(&sad, 0, sizeof(sad));
+  sad.sun_family = AF_UNIX;
+  strncpy(sad.sun_path, path.c_str(), sizeof(sad.sun_path) - 1);
+
+  const int sd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (::connect(sd, reinterpret_cast<const struct sockaddr*>(&sad), sizeof(sad)) != 0) {
+    ::close(sd);
+    return 0;
+  }
 
-  while (no_bytes_retries < max_no_bytes_retries) {
-    // Check if there is already something in the gnutls buffers
-    if (session.check_pending() == 0) {
-      // There was no gnutls data ready, check the socket
-      switch (p.poll(timeout_ms)) {
-        case POLL_READ_RESULT::DATA_READY: {
-          // Check if bytes are actually available (Otherwise if we try to read again the gnutls session object goes into a bad state and gnutlsxx throws an exception)
-          if (connection.get_bytes_available() == 0) {
-            //std::cout<<"but no bytes available"<<std::endl;
-            no_bytes_retries++;
-            // Don't hog the CPU
-            util::msleep(retries_timeout_ms);
-            continue;
-          }
-        }
-        case POLL_READ_RESULT::ERROR: {
-          break;
-        }
-        case POLL_READ_RESULT::TIMED_OUT: {
-          // We hit the 2 second timeout, we are probably done
-          break;
-        }
-      }
-    }
+  const uint16_t status = PerformPlainGetRequest(sd, url);
+  ::close(sd);
+  return status;
+}
 
-    const ssize_t result = session.recv(buffer, BUFFER_LENGTH);
-    if (result == 0) {
-      //std::cout<<"GnuTLSPerformRequest Peer has closed the TLS connection"<<std::endl;
-      break;
-    } else if (result < 0) {
-      std::cout<<"GnuTLSPerformRequest Read error: "<<gnutls_strerror_name(result)<<" "<<gnutls_strerror(result)<<std::endl;
-      break;
-    }
+}
 
-    const size_t bytes_read = result;
-    //std::cout<<"Received "<<bytes_read<<" bytes"<<std::endl;
-    if (reading_headers) {
-      received_so_far.insert(received_so_far.end(), buffer, buffer + bytes_read);
 
-      std::string_view sv(received_so_far.data(), received_so_far.size());
-      const size_t delimiter = sv.find("\r\n\r\n");
-      if (delimiter != std::string::npos) {
-        //std::cout<<"Headers received"<<std::endl;
-        std::string_view str_headers = sv.substr(0, delimiter);
-        ParseHeaders(str_headers, out_response.headers);
+class WebServerTest : public testing::Test {
+protected:
+  void SetUp() override;
+  void TearDown() override;
 
-        // Anything after this was file content
-        const size_t content_start = delimiter + strlen("\r\n\r\n");
+  tasktracker::cWebServerManager web_server_manager;
+};
 
-        // We are now up to the content
-        reading_headers = false;
+void WebServerTest::SetUp()
+{
+  // The whole feed, and a view that only has the high priority entries
+  tasktracker::cFeedViewFilter urgent_filter;
+  urgent_filter.high_priority_only = true;
 
-        //std::cout<<"Reading content"<<std::endl;
+  const std::vector<tasktracker::cFeedView> feed_views = {
+    tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB"),
+    tasktracker::cFeedView("urgent", "FC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkBPJYM9sAlPgoeSDu5ek", urgent_filter),
+  };
 
-        // Add to the file content
-        out_response.content.insert(out_response.content.end(), received_so_far.begin() + content_start, received_so_far.end());
-      }
-    } else {
-      // Everything else is content
-      out_response.content.insert(out_response.content.end(), buffer, buffer + bytes_read);
-    }
+  // Create the web server
+  const bool fuzzing = false;
+  if (!web_server_manager.Create(host, port, "./test/configuration/unit_test_server.key", "./test/configuration/unit_test_server.crt", fuzzing, feed_views)) {
+    std::cerr<<"Error creating web server"<<std::endl;
   }
-
-  session.bye(GNUTLS_SHUT_RDWR);
-
-  //std::cout<<"Finished"<<std::endl;
-
-  return true;
 }
 
-std::string HTTPSCreateRequest(std::string_view url)
-{
-  return "GET " + std::string(url.data(), url.size()) + " HTTP/1.0\r\n\r\n";
-}
-
-bool PerformHTTPSGetRequest(std::span<const char> const url, uint16_t port, std::string_view server_certificate_path, cHTTPResponse& out_response)
+void WebServerTest::TearDown()
 {
-  //std::cout<<"PerformHTTPSGetRequest"<<std::endl;
-
-  std::string user_agent("UnitTest");
-  const std::string request = HTTPSCreateRequest(std::string_view{url.data(), url.size()});
-  if (!GnuTLSPerformRequest(request, port, user_agent, server_certificate_path, out_response)) {
-    return false;
+  std::cout<<"Shutting down server"<<std::endl;
+  if (!web_server_manager.Destroy()) {
+    std::cerr<<"Error destroying web server"<<std::endl;
   }
+}
 
-  //std::cout<<"Headers: "<<out_response.headers.response_code<<", "<<out_response.headers.content_type<<", "<<out_response.headers.content_length<<std::endl;
-  //std::cout<<"Content: "<<std::string(out_response.content.data(), out_response.content.size())<<std::endl;
 
-  //std::cout<<"PerformHTTPSGetRequest returning true"<<std::endl;
-  return true;
-}
 
 bool PerformHTTPSGetRequestSpan(std::span<const char> const request, cHTTPResponse& out_response)
 {
@@ -495,4 +349,818 @@ TEST_F(WebServerTest, TestResources)
   EXPECT_STREQ(response.headers.raw_headers["Cross-Origin-Opener-Policy"].c_str(), "same-origin; report-to=\"default\"");
   EXPECT_STREQ(response.headers.raw_headers["Cross-Origin-Resource-Policy"].c_str(), "same-origin");
   EXPECT_STREQ(response.headers.raw_headers["Cache-Control"].c_str(), "must-revalidate, max-age=600");
+
+  // The prebuilt responses are reused, each request still gets the full set of headers
+  for (size_t i = 0; i < 2; i++) {
+    EXPECT_TRUE(PerformHTTPSGetRequestString("/missing_missing.txt", response));
+    EXPECT_EQ(404, response.headers.response_code);
+    EXPECT_STREQ("nosniff", response.headers.raw_headers["X-Content-Type-Options"].c_str());
+
+    EXPECT_TRUE(PerformHTTPSGetRequestString("/feed/atom.xml?token=wrong", response));
+    EXPECT_EQ(401, response.headers.response_code);
+    EXPECT_STREQ("nosniff", response.headers.raw_headers["X-Content-Type-Options"].c_str());
+
+    EXPECT_TRUE(PerformHTTPSGetRequestString("/style.css", response));
+    EXPECT_EQ(200, response.headers.response_code);
+    EXPECT_STREQ("nosniff", response.headers.raw_headers["X-Content-Type-Options"].c_str());
+    EXPECT_TRUE(response.content == expected_content_style_css);
+  }
+
+
+  // Conditional requests for static resources
+  EXPECT_TRUE(PerformHTTPSGetRequestString("/style.css", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  const std::string style_css_etag = response.headers.raw_headers["ETag"];
+  EXPECT_FALSE(style_css_etag.empty());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("GET /style.css HTTP/1.0\r\nIf-None-Match: " + style_css_etag + "\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(304, response.headers.response_code);
+  EXPECT_TRUE(response.content.empty());
+  EXPECT_STREQ(style_css_etag.c_str(), response.headers.raw_headers["ETag"].c_str());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("GET /style.css HTTP/1.0\r\nIf-None-Match: \"stale\"\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_TRUE(response.content == expected_content_style_css);
+
+  // Compressed responses
+  EXPECT_TRUE(GnuTLSPerformRequest("GET /style.css HTTP/1.0\r\nAccept-Encoding: gzip\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_STREQ("text/css", response.headers.content_type.c_str());
+  EXPECT_STREQ("gzip", response.headers.raw_headers["Content-Encoding"].c_str());
+  EXPECT_STREQ("Accept-Encoding", response.headers.raw_headers["Vary"].c_str());
+  EXPECT_LT(response.content.size(), expected_content_style_css.size());
+  EXPECT_STRNE(style_css_etag.c_str(), response.headers.raw_headers["ETag"].c_str());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("GET /style.css HTTP/1.0\r\nAccept-Encoding: gzip, deflate, br, zstd\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_STREQ("br", response.headers.raw_headers["Content-Encoding"].c_str());
+
+  // Conditional requests for the feed
+  const std::string feed_url = "/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB";
+  EXPECT_TRUE(PerformHTTPSGetRequestString(feed_url, response));
+  EXPECT_EQ(200, response.headers.response_code);
+  const std::string feed_etag = response.headers.raw_headers["ETag"];
+  const std::string feed_last_modified = response.headers.raw_headers["Last-Modified"];
+  EXPECT_FALSE(feed_etag.empty());
+  EXPECT_FALSE(feed_last_modified.empty());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("GET " + feed_url + " HTTP/1.0\r\nIf-None-Match: " + feed_etag + "\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(304, response.headers.response_code);
+  EXPECT_TRUE(response.content.empty());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("GET " + feed_url + " HTTP/1.0\r\nIf-Modified-Since: " + feed_last_modified + "\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(304, response.headers.response_code);
+
+  // The etag for a compressed variant of the feed doesn't match the uncompressed feed
+  EXPECT_TRUE(GnuTLSPerformRequest("GET " + feed_url + " HTTP/1.0\r\nAccept-Encoding: zstd\r\nIf-None-Match: " + feed_etag + "\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_STREQ("zstd", response.headers.raw_headers["Content-Encoding"].c_str());
+
+  // The token is still checked for conditional requests
+  EXPECT_TRUE(GnuTLSPerformRequest("GET /feed/atom.xml?token=wrong HTTP/1.0\r\nIf-None-Match: " + feed_etag + "\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(401, response.headers.response_code);
+
+  // Each token has its own view of the feed with its own ETag
+  EXPECT_TRUE(PerformHTTPSGetRequestString("/feed/atom.xml?token=FC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkBPJYM9sAlPgoeSDu5ek", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_FALSE(response.headers.raw_headers["ETag"].empty());
+  EXPECT_STRNE(feed_etag.c_str(), response.headers.raw_headers["ETag"].c_str());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("GET /feed/atom.xml?token=FC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkBPJYM9sAlPgoeSDu5ek HTTP/1.0\r\nIf-None-Match: " + feed_etag + "\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(200, response.headers.response_code);
+
+  // The feed can be cached until the tracker next polls Gitlab
+  tasktracker::SetNextFeedUpdate(util::GetTime() + std::chrono::minutes(10));
+  EXPECT_TRUE(PerformHTTPSGetRequestString(feed_url, response));
+  EXPECT_EQ(200, response.headers.response_code);
+  const std::string feed_cache_control = response.headers.raw_headers["Cache-Control"];
+  ASSERT_TRUE(feed_cache_control.starts_with("max-age="));
+  EXPECT_TRUE(feed_cache_control.ends_with(", must-revalidate"));
+  const int max_age = std::stoi(feed_cache_control.substr(8));
+  EXPECT_GE(max_age, 590);
+  EXPECT_LE(max_age, 600);
+  EXPECT_FALSE(response.headers.raw_headers["Expires"].empty());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("GET " + feed_url + " HTTP/1.0\r\nIf-None-Match: " + feed_etag + "\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(304, response.headers.response_code);
+  EXPECT_TRUE(response.headers.raw_headers["Cache-Control"].starts_with("max-age="));
+  EXPECT_FALSE(response.headers.raw_headers["Expires"].empty());
+
+  // The static resources keep the default
+  EXPECT_TRUE(PerformHTTPSGetRequestString("/style.css", response));
+  EXPECT_STREQ("must-revalidate, max-age=600", response.headers.raw_headers["Cache-Control"].c_str());
+
+  // Once the poll is overdue clients have to revalidate every time
+  tasktracker::SetNextFeedUpdate(util::GetTime() - std::chrono::minutes(1));
+  EXPECT_TRUE(PerformHTTPSGetRequestString(feed_url, response));
+  EXPECT_STREQ("max-age=0, must-revalidate", response.headers.raw_headers["Cache-Control"].c_str());
+
+  tasktracker::SetNextFeedUpdate(std::chrono::system_clock::time_point());
+}
+
+TEST_F(WebServerTest, TestTLSSessionResumption)
+{
+  const std::string request = HTTPSCreateRequest("/style.css");
+  const std::string user_agent = "UnitTest";
+
+  const tasktracker::cTLSSessionCounters counters_before = web_server_manager.GetTLSSessionCounters();
+
+  // The first connection performs a full handshake and the server gives us a session ticket
+  cTLSSession tls_session;
+  cHTTPResponse response;
+  EXPECT_TRUE(GnuTLSPerformRequest(request, port, user_agent, "./server.crt", tls_session, response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_FALSE(tls_session.resumed);
+  ASSERT_FALSE(tls_session.data.empty());
+
+  // Later connections resume the session
+  const size_t nresumed = 3;
+  for (size_t i = 0; i < nresumed; i++) {
+    EXPECT_TRUE(GnuTLSPerformRequest(request, port, user_agent, "./server.crt", tls_session, response));
+    EXPECT_EQ(200, response.headers.response_code);
+    EXPECT_TRUE(tls_session.resumed);
+  }
+
+  // A client without a previous session still gets a full handshake
+  cTLSSession new_tls_session;
+  EXPECT_TRUE(GnuTLSPerformRequest(request, port, user_agent, "./server.crt", new_tls_session, response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_FALSE(new_tls_session.resumed);
+
+  // The server counted each kind of handshake
+  const tasktracker::cTLSSessionCounters counters = web_server_manager.GetTLSSessionCounters();
+  EXPECT_EQ(2, counters.full_handshakes - counters_before.full_handshakes);
+  EXPECT_EQ(nresumed, counters.resumed_handshakes - counters_before.resumed_handshakes);
+}
+
+TEST(WebServer, TestTLSSessionResumptionAcrossEndpoints)
+{
+  const std::vector<tasktracker::cListenEndpoint> endpoints = {
+    tasktracker::cListenEndpoint(host, port),
+    tasktracker::cListenEndpoint(host, port + 1),
+  };
+
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const bool fuzzing = false;
+
+  const std::string request = HTTPSCreateRequest("/style.css");
+  const std::string user_agent = "UnitTest";
+
+  for (auto&& backend : GetAvailableBackends()) {
+    tasktracker::cWebServerOptions options;
+    options.backend = backend;
+
+    tasktracker::cWebServerManager web_server_manager;
+    ASSERT_TRUE(web_server_manager.Create(endpoints, "./test/configuration/unit_test_server.key", "./test/configuration/unit_test_server.crt", fuzzing, feed_views, options));
+
+    cTLSSession tls_session;
+    cHTTPResponse response;
+    EXPECT_TRUE(GnuTLSPerformRequest(request, port, user_agent, "./server.crt", tls_session, response));
+    EXPECT_EQ(200, response.headers.response_code);
+    EXPECT_FALSE(tls_session.resumed);
+
+    // The endpoints share a session ticket key, so the ticket from one endpoint resumes the session on the other, the same goes for prefork worker processes
+    EXPECT_TRUE(GnuTLSPerformRequest(request, port + 1, user_agent, "./server.crt", tls_session, response));
+    EXPECT_EQ(200, response.headers.response_code);
+    EXPECT_TRUE(tls_session.resumed);
+
+    EXPECT_TRUE(web_server_manager.Destroy());
+  }
+}
+
+TEST_F(WebServerTest, TestMethods)
+{
+  const std::string user_agent = "UnitTest";
+  cHTTPResponse response;
+
+  // HEAD gets the same headers as GET without the body
+  EXPECT_TRUE(GnuTLSPerformRequest("HEAD /style.css HTTP/1.0\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_STREQ("text/css", response.headers.content_type.c_str());
+  EXPECT_FALSE(response.headers.raw_headers["ETag"].empty());
+  EXPECT_TRUE(response.content.empty());
+
+  // HEAD for the feed doesn't need the feed to be rendered
+  EXPECT_TRUE(GnuTLSPerformRequest("HEAD /feed/atom.xml?token=FC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkBPJYM9sAlPgoeSDu5ek HTTP/1.0\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_STREQ("application/rss+xml", response.headers.content_type.c_str());
+  EXPECT_FALSE(response.headers.raw_headers["ETag"].empty());
+  EXPECT_TRUE(response.content.empty());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("HEAD /feed/atom.xml?token=wrong HTTP/1.0\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(401, response.headers.response_code);
+  EXPECT_TRUE(response.content.empty());
+
+  // Other methods are not allowed on our routes
+  EXPECT_TRUE(GnuTLSPerformRequest("POST /style.css HTTP/1.0\r\nContent-Length: 0\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(405, response.headers.response_code);
+  EXPECT_STREQ("GET, HEAD", response.headers.raw_headers["Allow"].c_str());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("DELETE /feed/atom.xml HTTP/1.0\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(405, response.headers.response_code);
+  EXPECT_STREQ("GET, HEAD", response.headers.raw_headers["Allow"].c_str());
+
+  // The event stream is only GET
+  EXPECT_TRUE(GnuTLSPerformRequest("HEAD /feed/events?token=FC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkBPJYM9sAlPgoeSDu5ek HTTP/1.0\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(405, response.headers.response_code);
+  EXPECT_STREQ("GET", response.headers.raw_headers["Allow"].c_str());
+
+  // Unknown resources are still not found whatever the method
+  EXPECT_TRUE(GnuTLSPerformRequest("POST /missing_missing.txt HTTP/1.0\r\nContent-Length: 0\r\n\r\n", port, user_agent, "./server.crt", response));
+  EXPECT_EQ(404, response.headers.response_code);
+}
+
+TEST_F(WebServerTest, TestWorkerPool)
+{
+  const std::string feed_url = "/feed/atom.xml?token=FC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkBPJYM9sAlPgoeSDu5ek";
+
+  const util::cWorkerPoolCounters counters_before = web_server_manager.GetWorkerPoolCounters();
+
+  // A client that already has this version of the feed is answered without rendering it
+  cHTTPResponse response;
+  EXPECT_TRUE(GnuTLSPerformRequest("HEAD " + feed_url + " HTTP/1.0\r\n\r\n", port, "UnitTest", "./server.crt", response));
+  EXPECT_EQ(200, response.headers.response_code);
+  const std::string etag = response.headers.raw_headers["ETag"];
+  ASSERT_FALSE(etag.empty());
+
+  EXPECT_TRUE(GnuTLSPerformRequest("GET " + feed_url + " HTTP/1.0\r\nIf-None-Match: " + etag + "\r\n\r\n", port, "UnitTest", "./server.crt", response));
+  EXPECT_EQ(304, response.headers.response_code);
+  EXPECT_EQ(0, web_server_manager.GetWorkerPoolCounters().completed - counters_before.completed);
+
+  // The first request for the feed has to render it, which happens on a worker thread
+  EXPECT_TRUE(PerformHTTPSGetRequestString(feed_url, response));
+  EXPECT_EQ(200, response.headers.response_code);
+  EXPECT_FALSE(response.content.empty());
+
+  // NOTE: The worker counts the job after it has resumed the connection, so we may have the response before it is counted
+  util::cWorkerPoolCounters counters = web_server_manager.GetWorkerPoolCounters();
+  for (size_t i = 0; (i < 100) && (counters.completed == counters_before.completed); i++) {
+    util::msleep(10);
+    counters = web_server_manager.GetWorkerPoolCounters();
+  }
+  EXPECT_EQ(1, counters.completed - counters_before.completed);
+
+  // The next request is answered from the cache without a worker
+  EXPECT_TRUE(PerformHTTPSGetRequestString(feed_url, response));
+  EXPECT_EQ(200, response.headers.response_code);
+
+  counters = web_server_manager.GetWorkerPoolCounters();
+  EXPECT_EQ(1, counters.completed - counters_before.completed);
+  EXPECT_EQ(0, counters.rejected - counters_before.rejected);
+}
+
+TEST_F(WebServerTest, TestKeepAlive)
+{
+  const tasktracker::cTLSSessionCounters counters_before = web_server_manager.GetTLSSessionCounters();
+
+  // Several requests on the same connection only perform one handshake
+  cHTTPSConnection connection;
+  ASSERT_TRUE(connection.Open(port, "./server.crt"));
+
+  const size_t nrequests = 5;
+  for (size_t i = 0; i < nrequests; i++) {
+    cHTTPResponse response;
+    EXPECT_TRUE(connection.PerformGetRequest((i % 2) == 0 ? "/style.css" : "/missing_missing.txt", response));
+    EXPECT_EQ(((i % 2) == 0) ? 200 : 404, response.headers.response_code);
+    EXPECT_EQ(response.headers.content_length, response.content.size());
+  }
+
+  EXPECT_TRUE(connection.IsOpen());
+  connection.Close();
+
+  const tasktracker::cTLSSessionCounters counters = web_server_manager.GetTLSSessionCounters();
+  EXPECT_EQ(1, counters.full_handshakes - counters_before.full_handshakes);
+  EXPECT_EQ(0, counters.resumed_handshakes - counters_before.resumed_handshakes);
+}
+
+TEST(WebServer, TestTLSKeyTypesAndPriorities)
+{
+  const std::filesystem::path folder = std::filesystem::temp_directory_path();
+  const std::string private_key = (folder / "task_tracker_unit_test.key").string();
+  const std::string public_cert = (folder / "task_tracker_unit_test.crt").string();
+
+  tasktracker::cWebServerOptions options;
+  options.tls_priorities = "NORMAL:-KX-ALL:+ECDHE-ECDSA:+ECDHE-RSA";
+
+  for (KEY_TYPE key_type : { KEY_TYPE::RSA_2048, KEY_TYPE::ECDSA_P256, KEY_TYPE::ED25519 }) {
+    SCOPED_TRACE(GetKeyTypeName(key_type));
+
+    ASSERT_TRUE(GenerateSelfSignedCertificate(key_type, private_key, public_cert));
+
+    tasktracker::cWebServerManager web_server_manager;
+    const bool fuzzing = false;
+    ASSERT_TRUE(web_server_manager.Create(host, port, private_key, public_cert, fuzzing, { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") }, options));
+
+    cHTTPResponse response;
+    EXPECT_TRUE(GnuTLSPerformRequest(HTTPSCreateRequest("/style.css"), port, "UnitTest", public_cert, response));
+    EXPECT_EQ(200, response.headers.response_code);
+
+    EXPECT_TRUE(web_server_manager.Destroy());
+  }
+
+  // An invalid priority string stops the server from starting
+  options.tls_priorities = "NOT-A-PRIORITY";
+  {
+    tasktracker::cWebServerManager web_server_manager;
+    const bool fuzzing = false;
+    EXPECT_FALSE(web_server_manager.Create(host, port, private_key, public_cert, fuzzing, { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") }, options));
+  }
+
+  std::filesystem::remove(private_key);
+  std::filesystem::remove(public_cert);
+}
+
+TEST(WebServer, TestReload)
+{
+  const std::filesystem::path folder = std::filesystem::temp_directory_path();
+  const std::string private_key = (folder / "task_tracker_unit_test.key").string();
+  const std::string public_cert = (folder / "task_tracker_unit_test.crt").string();
+  const std::string old_private_key = (folder / "task_tracker_unit_test_old.key").string();
+  const std::string old_public_cert = (folder / "task_tracker_unit_test_old.crt").string();
+
+  const std::string old_token = "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB";
+  const std::string new_token = "iN8Mgv0MTsGmqbXFYgQ6KTa9ZjrwfXQKPRdYKkjbJUhpmSlAzPMWp5fVbR1LWgoV";
+
+  const bool fuzzing = false;
+
+  for (auto&& backend : GetAvailableBackends()) {
+    tasktracker::cWebServerOptions options;
+    options.backend = backend;
+
+    ASSERT_TRUE(GenerateSelfSignedCertificate(KEY_TYPE::ECDSA_P256, old_private_key, old_public_cert));
+    std::filesystem::copy_file(old_private_key, private_key, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::copy_file(old_public_cert, public_cert, std::filesystem::copy_options::overwrite_existing);
+
+    tasktracker::cWebServerManager web_server_manager;
+    ASSERT_TRUE(web_server_manager.Create(host, port, private_key, public_cert, fuzzing, { tasktracker::cFeedView("default", old_token) }, options));
+
+    // A keep alive connection that was made before the reload
+    cHTTPSConnection connection;
+    ASSERT_TRUE(connection.Open(port, old_public_cert));
+
+    cHTTPResponse response;
+    EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=" + old_token, response));
+    EXPECT_EQ(200, response.headers.response_code);
+
+    // Rotate the certificate and the token
+    ASSERT_TRUE(GenerateSelfSignedCertificate(KEY_TYPE::ECDSA_P256, private_key, public_cert));
+    EXPECT_TRUE(web_server_manager.Reload({ tasktracker::cFeedView("default", new_token) }, private_key, public_cert));
+
+    // New connections get the new certificate
+    EXPECT_EQ(ReadCertificate(public_cert), GetServerCertificate(port));
+    EXPECT_NE(ReadCertificate(old_public_cert), GetServerCertificate(port));
+    EXPECT_TRUE(GnuTLSPerformRequest(HTTPSCreateRequest("/style.css"), port, "UnitTest", public_cert, response));
+    EXPECT_EQ(200, response.headers.response_code);
+
+    // The existing connection carries on, and its requests use the new token
+    EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=" + old_token, response));
+    EXPECT_EQ(401, response.headers.response_code);
+    EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=" + new_token, response));
+    EXPECT_EQ(200, response.headers.response_code);
+    connection.Close();
+
+    // A certificate that doesn't match the private key is rejected and the current certificate is kept
+    const std::string current_certificate = ReadCertificate(public_cert);
+    std::filesystem::copy_file(old_public_cert, public_cert, std::filesystem::copy_options::overwrite_existing);
+    EXPECT_FALSE(web_server_manager.Reload({ tasktracker::cFeedView("default", new_token) }, private_key, public_cert));
+    EXPECT_EQ(current_certificate, GetServerCertificate(port));
+
+    EXPECT_TRUE(web_server_manager.Destroy());
+  }
+
+  std::filesystem::remove(private_key);
+  std::filesystem::remove(public_cert);
+  std::filesystem::remove(old_private_key);
+  std::filesystem::remove(old_public_cert);
+}
+
+TEST(WebServer, TestListenEndpoints)
+{
+  util::cIPAddress ipv6_any;
+  ASSERT_TRUE(util::ParseAddress("::", ipv6_any));
+  util::cIPAddress ipv6_loopback;
+  ASSERT_TRUE(util::ParseAddress("::1", ipv6_loopback));
+
+  // The IPv6 any address is dual stack so it also accepts IPv4 connections, the second endpoint is IPv4 only
+  const std::vector<tasktracker::cListenEndpoint> endpoints = {
+    tasktracker::cListenEndpoint(ipv6_any, port),
+    tasktracker::cListenEndpoint(host, port + 1),
+  };
+
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const bool fuzzing = false;
+
+  tasktracker::cWebServerManager web_server_manager;
+  ASSERT_TRUE(web_server_manager.Create(endpoints, "", "", fuzzing, feed_views));
+
+  EXPECT_EQ(200, PerformPlainGetRequest(ipv6_loopback, port, "/style.css"));
+  EXPECT_EQ(200, PerformPlainGetRequest(host, port, "/style.css"));
+  EXPECT_EQ(404, PerformPlainGetRequest(host, port + 1, "/missing_missing.txt"));
+
+  // Nothing is listening on port + 1 for IPv6
+  EXPECT_EQ(0, PerformPlainGetRequest(ipv6_loopback, port + 1, "/style.css"));
+
+  EXPECT_TRUE(web_server_manager.Destroy());
+}
+
+TEST(WebServer, TestUnixSocket)
+{
+  const std::string path = (std::filesystem::temp_directory_path() / "task_tracker_unit_test.sock").string();
+
+  // The Unix domain socket is plain HTTP even though there is a certificate for the TCP endpoint
+  const std::vector<tasktracker::cListenEndpoint> endpoints = {
+    tasktracker::cListenEndpoint(path),
+    tasktracker::cListenEndpoint(host, port),
+  };
+
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const bool fuzzing = false;
+
+  for (auto&& backend : GetAvailableBackends()) {
+    tasktracker::cWebServerOptions options;
+    options.backend = backend;
+
+    tasktracker::cWebServerManager web_server_manager;
+    ASSERT_TRUE(web_server_manager.Create(endpoints, "./test/configuration/unit_test_server.key", "./test/configuration/unit_test_server.crt", fuzzing, feed_views, options));
+
+    EXPECT_EQ(200, PerformUnixSocketGetRequest(path, "/style.css"));
+    EXPECT_EQ(401, PerformUnixSocketGetRequest(path, "/feed/atom.xml?token=invalid"));
+    EXPECT_EQ(200, PerformUnixSocketGetRequest(path, "/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB"));
+
+    // The TCP endpoint is still HTTPS
+    cHTTPResponse response;
+    EXPECT_TRUE(GnuTLSPerformRequest(HTTPSCreateRequest("/style.css"), port, "UnitTest", "./server.crt", response));
+    EXPECT_EQ(200, response.headers.response_code);
+
+    EXPECT_TRUE(web_server_manager.Destroy());
+
+    // The socket is removed when the server stops
+    EXPECT_FALSE(std::filesystem::exists(path));
+  }
+}
+
+TEST(WebServer, TestListeningSocketHandOff)
+{
+  const std::string path = (std::filesystem::temp_directory_path() / "task_tracker_unit_test.sock").string();
+
+  const std::vector<tasktracker::cListenEndpoint> endpoints = {
+    tasktracker::cListenEndpoint(host, port),
+    tasktracker::cListenEndpoint(path),
+  };
+
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const bool fuzzing = false;
+
+  for (auto&& backend : GetAvailableBackends()) {
+    tasktracker::cWebServerOptions options;
+    options.backend = backend;
+
+    tasktracker::cWebServerManager old_web_server_manager;
+    ASSERT_TRUE(old_web_server_manager.Create(endpoints, "", "", fuzzing, feed_views, options));
+
+    // A keep alive connection to the old server
+    cHTTPSConnection connection;
+    ASSERT_TRUE(connection.Open(port, ""));
+
+    cHTTPResponse response;
+    EXPECT_TRUE(connection.PerformGetRequest("/style.css", response));
+    EXPECT_EQ(200, response.headers.response_code);
+
+    // Pass the listening sockets over like the old process does to the new process
+    const std::vector<int> sockets = old_web_server_manager.GetListeningSockets();
+    ASSERT_EQ(2u, sockets.size());
+
+    int pair[2] = { -1, -1 };
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair));
+    EXPECT_TRUE(tasktracker::SendListenSockets(pair[0], sockets));
+
+    std::vector<int> received;
+    EXPECT_TRUE(tasktracker::ReceiveListenSockets(pair[1], received));
+    close(pair[0]);
+    close(pair[1]);
+
+    std::vector<tasktracker::cListenEndpoint> new_endpoints = endpoints;
+    tasktracker::AssignListenSockets(received, new_endpoints);
+    EXPECT_NE(-1, new_endpoints[0].listen_socket);
+    EXPECT_NE(-1, new_endpoints[1].listen_socket);
+
+    tasktracker::cWebServerManager new_web_server_manager;
+    ASSERT_TRUE(new_web_server_manager.Create(new_endpoints, "", "", fuzzing, feed_views, options));
+
+    old_web_server_manager.HandOffListeningSockets();
+
+    // The new server accepts the new connections
+    EXPECT_EQ(200, PerformPlainGetRequest(host, port, "/style.css"));
+    EXPECT_EQ(200, PerformUnixSocketGetRequest(path, "/style.css"));
+
+    // The old server still services the connection that it already had
+    EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB", response));
+    EXPECT_EQ(200, response.headers.response_code);
+    connection.Close();
+
+    EXPECT_TRUE(old_web_server_manager.Destroy());
+
+    // The old server stopping doesn't affect the new server, and the Unix domain socket is still there
+    EXPECT_TRUE(std::filesystem::exists(path));
+    EXPECT_EQ(200, PerformPlainGetRequest(host, port, "/style.css"));
+    EXPECT_EQ(200, PerformUnixSocketGetRequest(path, "/style.css"));
+
+    EXPECT_TRUE(new_web_server_manager.Destroy());
+
+    tasktracker::RemoveUnixListeningSocket(path);
+  }
+}
+
+TEST(WebServer, TestGracefulShutdown)
+{
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const bool fuzzing = false;
+
+  for (auto&& backend : GetAvailableBackends()) {
+    tasktracker::GetFeedEventQueue().Clear();
+
+    tasktracker::cWebServerOptions options;
+    options.backend = backend;
+    options.shutdown_timeout_seconds = 30;
+
+    tasktracker::cWebServerManager web_server_manager;
+    ASSERT_TRUE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+
+    // An idle keep alive connection doesn't hold up shutting down
+    cHTTPSConnection connection;
+    ASSERT_TRUE(connection.Open(port, ""));
+
+    cHTTPResponse response;
+    EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB", response));
+    EXPECT_EQ(200, response.headers.response_code);
+
+    // An event stream is a request that is still in progress when we start shutting down
+    tcp_connection stream_connection;
+    ASSERT_TRUE(stream_connection.connect(host, port));
+
+    std::string received;
+    ASSERT_TRUE(OpenEventStream(stream_connection.get_sd(), "/feed/events?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB", "", received));
+    EXPECT_EQ(0, received.find("HTTP/1.1 200"));
+
+    tasktracker::cFeedEntry entry;
+    entry.title = "Water the plants";
+    entry.date_updated = util::GetTime();
+    tasktracker::GetFeedEventQueue().Publish({ entry });
+
+    // The stream is finished rather than waiting for the shutdown timeout
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(web_server_manager.Destroy());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+    // The client gets the rest of the response and then the connection is closed cleanly
+    received.clear();
+    EXPECT_TRUE(ReceiveUntil(stream_connection.get_sd(), "Water the plants", received));
+    char buffer[4096];
+    ssize_t length = 0;
+    while ((length = ::recv(stream_connection.get_sd(), buffer, sizeof(buffer), 0)) > 0) {
+    }
+    EXPECT_EQ(0, length);
+
+    connection.Close();
+
+    // We are not listening anymore
+    EXPECT_EQ(0, PerformPlainGetRequest(host, port, "/style.css"));
+  }
+
+  tasktracker::GetFeedEventQueue().Clear();
+}
+
+TEST(WebServer, TestAddressFilter)
+{
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const bool fuzzing = false;
+
+  util::cIPNetwork loopback;
+  ASSERT_TRUE(util::ParseNetwork("127.0.0.0/8", loopback));
+  util::cIPNetwork private_network;
+  ASSERT_TRUE(util::ParseNetwork("192.168.0.0/16", private_network));
+
+  for (auto&& backend : GetAvailableBackends()) {
+    tasktracker::cWebServerOptions options;
+    options.backend = backend;
+
+    // Only the private network is allowed, so the connection is closed before we get a response
+    options.allow_networks = { private_network };
+    {
+      tasktracker::cWebServerManager web_server_manager;
+      ASSERT_TRUE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+      EXPECT_EQ(0, PerformPlainGetRequest(host, port, "/style.css"));
+      EXPECT_TRUE(web_server_manager.Destroy());
+    }
+
+    // Loopback is allowed as well
+    options.allow_networks = { private_network, loopback };
+    {
+      tasktracker::cWebServerManager web_server_manager;
+      ASSERT_TRUE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+      EXPECT_EQ(200, PerformPlainGetRequest(host, port, "/style.css"));
+      EXPECT_TRUE(web_server_manager.Destroy());
+    }
+
+    // Loopback is denied
+    options.allow_networks.clear();
+    options.deny_networks = { loopback };
+    {
+      tasktracker::cWebServerManager web_server_manager;
+      ASSERT_TRUE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+      EXPECT_EQ(0, PerformPlainGetRequest(host, port, "/style.css"));
+      EXPECT_TRUE(web_server_manager.Destroy());
+    }
+  }
+}
+
+TEST(WebServer, TestRateLimits)
+{
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const bool fuzzing = false;
+
+  for (auto&& backend : GetAvailableBackends()) {
+    // Each IP address can make a burst of 2 feed requests, then one a minute
+    {
+      tasktracker::cWebServerOptions options;
+      options.backend = backend;
+      options.ip_rate_limit_per_minute = 1;
+      options.ip_rate_limit_burst = 2;
+
+      tasktracker::cWebServerManager web_server_manager;
+      ASSERT_TRUE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+
+      cHTTPSConnection connection;
+      ASSERT_TRUE(connection.Open(port, ""));
+
+      cHTTPResponse response;
+      for (size_t i = 0; i < 2; i++) {
+        EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB", response));
+        EXPECT_EQ(200, response.headers.response_code);
+      }
+
+      EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB", response));
+      EXPECT_EQ(429, response.headers.response_code);
+      EXPECT_EQ("60", response.headers.raw_headers["Retry-After"]);
+
+      // The limit only applies to the feed
+      EXPECT_TRUE(connection.PerformGetRequest("/style.css", response));
+      EXPECT_EQ(200, response.headers.response_code);
+
+      connection.Close();
+
+      EXPECT_TRUE(web_server_manager.Destroy());
+    }
+
+    // Each token can make a burst of 1 feed request, an invalid token doesn't use it up
+    {
+      tasktracker::cWebServerOptions options;
+      options.backend = backend;
+      options.token_rate_limit_per_minute = 1;
+      options.token_rate_limit_burst = 1;
+
+      tasktracker::cWebServerManager web_server_manager;
+      ASSERT_TRUE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+
+      EXPECT_EQ(401, PerformPlainGetRequest(host, port, "/feed/atom.xml?token=invalid"));
+      EXPECT_EQ(401, PerformPlainGetRequest(host, port, "/feed/atom.xml?token=invalid"));
+      EXPECT_EQ(200, PerformPlainGetRequest(host, port, "/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB"));
+      EXPECT_EQ(429, PerformPlainGetRequest(host, port, "/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB"));
+
+      EXPECT_TRUE(web_server_manager.Destroy());
+    }
+  }
+}
+
+TEST(WebServer, TestFeedEvents)
+{
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const std::string events_url = "/feed/events?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB";
+  const bool fuzzing = false;
+
+  for (auto&& backend : GetAvailableBackends()) {
+    tasktracker::cFeedEventQueue& queue = tasktracker::GetFeedEventQueue();
+    queue.Clear();
+
+    tasktracker::cWebServerOptions options;
+    options.backend = backend;
+
+    tasktracker::cWebServerManager web_server_manager;
+    ASSERT_TRUE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+
+    EXPECT_EQ(401, PerformPlainGetRequest(host, port, "/feed/events?token=invalid"));
+
+    // Subscribe
+    tcp_connection connection;
+    ASSERT_TRUE(connection.connect(host, port));
+
+    std::string received;
+    ASSERT_TRUE(OpenEventStream(connection.get_sd(), events_url, "", received));
+    EXPECT_EQ(0, received.find("HTTP/1.1 200"));
+    EXPECT_NE(std::string::npos, received.find("Content-Type: text/event-stream\r\n"));
+    EXPECT_NE(std::string::npos, received.find("Cache-Control: no-cache\r\n"));
+
+    // A new entry is pushed to the client
+    tasktracker::cFeedEntry entry;
+    entry.title = "Water the plants";
+    entry.date_updated = util::GetTime();
+    queue.Publish({ entry });
+    const std::string event_id = std::to_string(queue.GetLastEventID());
+
+    received.clear();
+    ASSERT_TRUE(ReceiveUntil(connection.get_sd(), "\n\n", received));
+    EXPECT_EQ(0, received.find("id: " + event_id + "\nevent: entry\ndata: {"));
+    EXPECT_NE(std::string::npos, received.find("Water the plants"));
+
+    // A client that reconnects gets the events that it missed straight away
+    tcp_connection resumed_connection;
+    ASSERT_TRUE(resumed_connection.connect(host, port));
+
+    received.clear();
+    ASSERT_TRUE(OpenEventStream(resumed_connection.get_sd(), events_url, "0", received));
+    ASSERT_TRUE(ReceiveUntil(resumed_connection.get_sd(), "\n\n", received));
+    EXPECT_NE(std::string::npos, received.find("id: " + event_id + "\n"));
+
+    // The streams are ended when shutting down rather than waiting for the shutdown timeout
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(web_server_manager.Destroy());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  }
+
+  tasktracker::GetFeedEventQueue().Clear();
+}
+
+TEST(WebServer, TestIOUringBackend)
+{
+  tasktracker::cWebServerOptions options;
+  options.backend = tasktracker::BACKEND::IO_URING;
+
+  const std::vector<tasktracker::cFeedView> feed_views = { tasktracker::cFeedView("default", "PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB") };
+  const bool fuzzing = false;
+
+#ifdef TASK_TRACKER_IO_URING
+  ASSERT_TRUE(tasktracker::IsIOUringWebServerAvailable());
+
+  // Plain HTTP, several requests on one connection
+  {
+    tasktracker::cWebServerManager web_server_manager;
+    ASSERT_TRUE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+
+    cHTTPSConnection connection;
+    ASSERT_TRUE(connection.Open(port, ""));
+
+    cHTTPResponse response;
+    EXPECT_TRUE(connection.PerformGetRequest("/style.css", response));
+    EXPECT_EQ(200, response.headers.response_code);
+    EXPECT_EQ(response.headers.content_length, response.content.size());
+    EXPECT_EQ("text/css", response.headers.content_type);
+
+    const std::string etag = response.headers.raw_headers["ETag"];
+    EXPECT_FALSE(etag.empty());
+
+    EXPECT_TRUE(connection.PerformGetRequest("/missing_missing.txt", response));
+    EXPECT_EQ(404, response.headers.response_code);
+
+    EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=invalid", response));
+    EXPECT_EQ(401, response.headers.response_code);
+
+    EXPECT_TRUE(connection.PerformGetRequest("/feed/atom.xml?token=PJYM9sAlPgoeSDu5ekFC40Q3AFJMl1uidxivonEL1NZ3DXQzzP0D8uibgnvZxbkB", response));
+    EXPECT_EQ(200, response.headers.response_code);
+    EXPECT_EQ(response.headers.content_length, response.content.size());
+
+    EXPECT_TRUE(connection.IsOpen());
+    connection.Close();
+
+    EXPECT_TRUE(web_server_manager.Destroy());
+  }
+
+  // HTTPS
+  {
+    tasktracker::cWebServerManager web_server_manager;
+    ASSERT_TRUE(web_server_manager.Create(host, port, "./test/configuration/unit_test_server.key", "./test/configuration/unit_test_server.crt", fuzzing, feed_views, options));
+
+    cHTTPResponse response;
+    EXPECT_TRUE(GnuTLSPerformRequest(HTTPSCreateRequest("/style.css"), port, "UnitTest", "./server.crt", response));
+    EXPECT_EQ(200, response.headers.response_code);
+
+    cHTTPSConnection connection;
+    ASSERT_TRUE(connection.Open(port, "./server.crt"));
+    for (size_t i = 0; i < 3; i++) {
+      EXPECT_TRUE(connection.PerformGetRequest("/style.css", response));
+      EXPECT_EQ(200, response.headers.response_code);
+      EXPECT_EQ(response.headers.content_length, response.content.size());
+    }
+    connection.Close();
+
+    EXPECT_EQ(2, web_server_manager.GetTLSSessionCounters().full_handshakes);
+
+    EXPECT_TRUE(web_server_manager.Destroy());
+  }
+#else
+  // The backend wasn't built so the server doesn't start
+  EXPECT_FALSE(tasktracker::IsIOUringWebServerAvailable());
+
+  tasktracker::cWebServerManager web_server_manager;
+  EXPECT_FALSE(web_server_manager.Create(host, port, "", "", fuzzing, feed_views, options));
+#endif
 }
@@ -0,0 +1,134 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// gtest headers
+#include <gtest/gtest.h>
+
+// Task Tracker headers
+#include "worker_pool.h"
+
+TEST(Util, TestWorkerPool)
+{
+  util::cWorkerPool pool;
+
+  // Jobs can't be queued until the pool has been created
+  EXPECT_FALSE(pool.IsRunning());
+  EXPECT_FALSE(pool.TrySubmit([]() {}));
+
+  EXPECT_FALSE(pool.Create(0, 4));
+  EXPECT_FALSE(pool.Create(2, 0));
+
+  ASSERT_TRUE(pool.Create(2, 4));
+  EXPECT_TRUE(pool.IsRunning());
+
+  // Every job is run
+  std::atomic<size_t> count(0);
+  const size_t njobs = 100;
+  size_t submitted = 0;
+  while (submitted < njobs) {
+    if (pool.TrySubmit([&count]() { count++; })) {
+      submitted++;
+    }
+  }
+
+  // Destroying the pool finishes the queued jobs
+  pool.Destroy();
+  EXPECT_FALSE(pool.IsRunning());
+  EXPECT_EQ(njobs, count);
+  EXPECT_EQ(njobs, pool.GetCounters().completed);
+  EXPECT_EQ(0, pool.GetCounters().queue_depth);
+  EXPECT_LE(pool.GetCounters().peak_queue_depth, 4);
+}
+
+TEST(Util, TestWorkerPoolBackpressure)
+{
+  util::cWorkerPool pool;
+  ASSERT_TRUE(pool.Create(1, 2));
+
+  // Block the only worker
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool started = false;
+  bool release = false;
+  EXPECT_TRUE(pool.TrySubmit([&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    started = true;
+    cv.notify_all();
+    cv.wait(lock, [&release]() { return release; });
+  }));
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&started]() { return started; });
+  }
+
+  // The queue fills up and then jobs are rejected
+  EXPECT_TRUE(pool.TrySubmit([]() {}));
+  EXPECT_TRUE(pool.TrySubmit([]() {}));
+  EXPECT_FALSE(pool.TrySubmit([]() {}));
+  EXPECT_FALSE(pool.TrySubmit([]() {}));
+
+  util::cWorkerPoolCounters counters = pool.GetCounters();
+  EXPECT_EQ(2, counters.queue_depth);
+  EXPECT_EQ(2, counters.peak_queue_depth);
+  EXPECT_EQ(2, counters.rejected);
+
+  // Let the worker go, the queue drains
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+
+  pool.Destroy();
+
+  counters = pool.GetCounters();
+  EXPECT_EQ(0, counters.queue_depth);
+  EXPECT_EQ(3, counters.completed);
+  EXPECT_EQ(2, counters.rejected);
+}
+
+TEST(Util, TestWorkerPoolDestroyWhileSubmitting)
+{
+  util::cWorkerPool pool;
+  ASSERT_TRUE(pool.Create(1, 4));
+
+  // Block the only worker so that Destroy has to wait for it
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool started = false;
+  bool release = false;
+  EXPECT_TRUE(pool.TrySubmit([&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    started = true;
+    cv.notify_all();
+    cv.wait(lock, [&release]() { return release; });
+  }));
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&started]() { return started; });
+  }
+
+  std::thread destroy_thread([&pool]() { pool.Destroy(); });
+
+  // Once Destroy has started the pool stops taking jobs, even though the worker is still running
+  while (pool.IsRunning()) {
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(pool.TrySubmit([]() {}));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+
+  destroy_thread.join();
+
+  const util::cWorkerPoolCounters counters = pool.GetCounters();
+  EXPECT_EQ(1, counters.completed);
+  EXPECT_EQ(1, counters.rejected);
+}
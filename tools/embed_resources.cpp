@@ -0,0 +1,228 @@
+// Generates a header containing each file in the resources folder, and its compressed variants, as constexpr data so that they can be compiled into task-trackerd
+// Usage: embed_resources <resources folder> <output header>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "compression.h"
+#include "http_headers.h"
+#include "util.h"
+
+namespace {
+
+const std::map<std::string, std::string> mime_types = {
+  { ".css", "text/css" },
+  { ".html", "text/html" },
+  { ".ico", "image/x-icon" },
+  { ".js", "text/javascript" },
+  { ".json", "application/json" },
+  { ".png", "image/png" },
+  { ".svg", "image/svg+xml" },
+  { ".txt", "text/plain" },
+};
+
+class cResource {
+public:
+  std::string relative_path;
+  std::string request_path;
+  std::string identifier;
+  std::string mime_type;
+  std::string content;
+};
+
+// NOTE: The index keeps the identifier unique, otherwise "a-b.css" and "a_b.css" would both be resource_a_b_css
+std::string GetIdentifier(const std::string& relative_path, size_t index)
+{
+  std::string identifier = "resource_" + std::to_string(index) + "_";
+  for (char c : relative_path) {
+    identifier += (isalnum(static_cast<unsigned char>(c)) ? c : '_');
+  }
+  return identifier;
+}
+
+bool ReadFile(const std::filesystem::path& file_path, std::string& out_contents)
+{
+  std::ifstream f(file_path, std::ios::binary);
+  if (!f.good()) {
+    return false;
+  }
+
+  std::ostringstream o;
+  o<<f.rdbuf();
+  out_contents = o.str();
+  return true;
+}
+
+// Escape a short string for use inside a string literal
+std::string EscapeString(std::string_view value)
+{
+  std::string escaped;
+  for (char c : value) {
+    if ((c == '"') || (c == '\\')) {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+void WriteByteArray(std::ostream& o, const std::string& name, std::string_view data)
+{
+  // NOTE: Each byte is written as a hex escape so that a following character can't be mistaken for part of the escape sequence
+  o<<"inline constexpr char "<<name<<"[] =";
+
+  const size_t bytes_per_line = 32;
+  for (size_t i = 0; i < data.length(); i++) {
+    if ((i % bytes_per_line) == 0) {
+      o<<((i == 0) ? "\n  \"" : "\"\n  \"");
+    }
+
+    const char* hex = "0123456789abcdef";
+    const uint8_t c = static_cast<uint8_t>(data[i]);
+    o<<"\\x"<<hex[c >> 4]<<hex[c & 0xf];
+  }
+
+  o<<(data.empty() ? " \"\";\n" : "\";\n");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    std::cerr<<"Usage: embed_resources <resources folder> <output header>"<<std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::filesystem::path resources_folder(argv[1]);
+  const std::filesystem::path output_file_path(argv[2]);
+
+  std::vector<cResource> resources;
+
+  std::error_code ec;
+  for (auto&& entry : std::filesystem::recursive_directory_iterator(resources_folder, ec)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+
+    const std::string relative_path = std::filesystem::relative(entry.path(), resources_folder).generic_string();
+
+    auto iter = mime_types.find(entry.path().extension().string());
+    if (iter == mime_types.end()) {
+      std::cerr<<"Unknown mime type for \""<<relative_path<<"\""<<std::endl;
+      return EXIT_FAILURE;
+    }
+
+    cResource resource;
+    resource.relative_path = relative_path;
+    resource.request_path = (relative_path == "index.html") ? "/" : ("/" + relative_path);
+    resource.mime_type = iter->second;
+    if (!ReadFile(entry.path(), resource.content)) {
+      std::cerr<<"Error reading \""<<entry.path()<<"\""<<std::endl;
+      return EXIT_FAILURE;
+    }
+
+    resources.push_back(resource);
+  }
+
+  if (ec) {
+    std::cerr<<"Error reading resources folder \""<<resources_folder<<"\""<<std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Sort the resources so that the output is the same every time
+  std::sort(resources.begin(), resources.end(), [](const cResource& lhs, const cResource& rhs) { return (lhs.request_path < rhs.request_path); });
+
+  for (size_t r = 0; r < resources.size(); r++) {
+    resources[r].identifier = GetIdentifier(resources[r].relative_path, r);
+  }
+
+  std::ostringstream o;
+  o<<"#pragma once"<<std::endl;
+  o<<std::endl;
+  o<<"// Generated by tools/embed_resources.cpp from the resources folder, do not edit"<<std::endl;
+  o<<std::endl;
+  o<<"#include \"embedded_resource.h\""<<std::endl;
+  o<<std::endl;
+  o<<"namespace tasktracker::embedded {"<<std::endl;
+  o<<std::endl;
+
+  std::vector<std::array<std::string, util::CONTENT_ENCODING_COUNT>> etags;
+
+  for (auto&& resource : resources) {
+    const std::string etag = http::CreateETag(util::HashFNV1a64(resource.content));
+
+    std::array<std::string, util::CONTENT_ENCODING_COUNT> resource_etags;
+
+    for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+      const util::CONTENT_ENCODING encoding = static_cast<util::CONTENT_ENCODING>(i);
+
+      std::string variant;
+      if (!util::Compress(encoding, resource.content, variant)) {
+        std::cerr<<"Error compressing \""<<resource.request_path<<"\" with "<<util::GetContentEncodingName(encoding)<<std::endl;
+        return EXIT_FAILURE;
+      }
+
+      WriteByteArray(o, resource.identifier + "_" + util::GetContentEncodingName(encoding), variant);
+      resource_etags[i] = http::CreateETagForEncoding(etag, encoding);
+    }
+
+    o<<std::endl;
+
+    etags.push_back(resource_etags);
+  }
+
+  o<<"inline constexpr std::array<cEmbeddedResource, "<<resources.size()<<"> resources = {{"<<std::endl;
+  for (size_t r = 0; r < resources.size(); r++) {
+    const cResource& resource = resources[r];
+
+    o<<"  {"<<std::endl;
+    o<<"    \""<<resource.request_path<<"\","<<std::endl;
+    o<<"    \""<<resource.mime_type<<"\","<<std::endl;
+    o<<"    {{"<<std::endl;
+    for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+      const std::string name = resource.identifier + "_" + util::GetContentEncodingName(static_cast<util::CONTENT_ENCODING>(i));
+      o<<"      std::string_view("<<name<<", sizeof("<<name<<") - 1),"<<std::endl;
+    }
+    o<<"    }},"<<std::endl;
+    o<<"    {{"<<std::endl;
+    for (size_t i = 0; i < util::CONTENT_ENCODING_COUNT; i++) {
+      o<<"      \""<<EscapeString(etags[r][i])<<"\","<<std::endl;
+    }
+    o<<"    }},"<<std::endl;
+    o<<"  },"<<std::endl;
+  }
+  o<<"}};"<<std::endl;
+  o<<std::endl;
+
+  o<<"inline constexpr std::array<std::string_view, "<<resources.size()<<"> request_paths = {"<<std::endl;
+  for (auto&& resource : resources) {
+    o<<"  \""<<resource.request_path<<"\","<<std::endl;
+  }
+  o<<"};"<<std::endl;
+  o<<std::endl;
+  o<<"}"<<std::endl;
+
+  // Only write the header if it has changed so that we don't trigger unnecessary rebuilds, the build system tracks when we last ran with a separate stamp file
+  std::string existing;
+  if (ReadFile(output_file_path, existing) && (existing == o.str())) {
+    return EXIT_SUCCESS;
+  }
+
+  std::filesystem::create_directories(output_file_path.parent_path(), ec);
+
+  std::ofstream f(output_file_path, std::ios::binary | std::ios::trunc);
+  f<<o.str();
+  if (!f.good()) {
+    std::cerr<<"Error writing \""<<output_file_path<<"\""<<std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}